@@ -307,6 +307,52 @@ RAY_CONFIG(bool, put_small_object_in_memory_store, false)
 /// pipelining task submission.
 RAY_CONFIG(uint32_t, max_tasks_in_flight_per_worker, 1)
 
+/// If true, the owner adapts the number of tasks pipelined to each leased worker per
+/// scheduling key, based on the observed RPC round-trip overhead and task execution
+/// time. max_tasks_in_flight_per_worker is then used as the upper bound.
+RAY_CONFIG(bool, adaptive_max_tasks_in_flight_per_worker, false)
+
+/// If true, a leased worker whose task queue has drained is handed over to another
+/// scheduling key of the same resource shape, whose tasks would be leased from the
+/// worker's node, instead of being returned to the raylet while those tasks wait for a
+/// new lease.
+RAY_CONFIG(bool, worker_lease_retargeting_enabled, false)
+
+/// Maximum number of worker leases that the owner requests from a raylet in a single
+/// RPC for one scheduling key. A value of 1 disables batched lease requests.
+RAY_CONFIG(uint32_t, max_worker_leases_per_request, 1)
+
+/// If true, a threaded actor (max_concurrency > 1) that is not async runs the tasks of
+/// each caller one at a time and in submission order, while tasks of different callers
+/// run concurrently on the actor's thread pool. The actor's main thread never blocks
+/// waiting for a free thread in this mode.
+RAY_CONFIG(bool, threaded_actor_per_caller_ordering, false)
+
+/// If positive, a caller stops sending new tasks to an actor while the actor reports
+/// that at least this many of the caller's tasks are queued and not yet started. Sending
+/// resumes when a later reply reports a shorter queue. 0 disables this backpressure.
+RAY_CONFIG(int64_t, max_actor_tasks_queued_per_caller, 0)
+
+/// Maximum number of actor tasks that a caller coalesces into a single PushTasks RPC to
+/// one actor. While this many tasks await replies, new tasks accumulate and are sent
+/// together once a reply arrives. The actor replies once for the whole batch, after all
+/// of its tasks have finished, so the reply to a task can be delayed by the tasks after
+/// it in the batch. Only actors that run one task at a time are sent batches; async
+/// and threaded actors always get one task per RPC. A value of 1 disables batching.
+RAY_CONFIG(uint32_t, max_actor_task_batch_size, 1)
+
+/// If true, a caller pushes actor tasks to an actor on the same node through a pair of
+/// shared-memory rings instead of gRPC. Only supported on Linux.
+RAY_CONFIG(bool, actor_shared_memory_transport_enabled, false)
+
+/// The size in bytes of each shared-memory ring between a caller and a same-node actor.
+/// Requests that do not fit into the ring are sent over gRPC.
+RAY_CONFIG(uint64_t, actor_shared_memory_ring_bytes, 4 * 1024 * 1024)
+
+/// How long the reader of a shared-memory ring busy-polls for new messages before it
+/// sleeps. Higher values lower latency at the cost of CPU time.
+RAY_CONFIG(int64_t, actor_shared_memory_spin_us, 50)
+
 /// Interval to restart dashboard agent after the process exit.
 RAY_CONFIG(uint32_t, agent_restart_interval_ms, 1000)
 
@@ -426,3 +472,52 @@ RAY_CONFIG(bool, gcs_task_scheduling_enabled,
                getenv("RAY_GCS_TASK_SCHEDULING_ENABLED") == std::string("true"))
 
 RAY_CONFIG(uint32_t, max_error_msg_size_bytes, 512 * 1024)
+
+/// If true, plasma clients send Release requests to the store through a shared-memory
+/// ring instead of the store socket. The store wakes up once to drain every request
+/// queued since it last looked. Only supported on Linux.
+RAY_CONFIG(bool, plasma_command_ring_enabled, false)
+
+/// The size in bytes of each plasma client's command ring. Requests that do not fit
+/// are sent over the socket.
+RAY_CONFIG(uint64_t, plasma_command_ring_bytes, 256 * 1024)
+
+/// The number of plasma Release requests that a client batches before sending them to
+/// the store. Pending releases are also sent before any other request to the store.
+/// A value of 1 disables batching.
+RAY_CONFIG(uint32_t, plasma_release_batch_size, 1)
+
+/// The longest time that a batched plasma Release request waits before it is sent.
+RAY_CONFIG(uint64_t, plasma_release_batch_timeout_ms, 10)
+
+/// Plasma objects of at most this many bytes are packed into slabs of equally sized
+/// slots instead of being allocated one by one from dlmalloc, e.g. 65536. 0 disables
+/// the slabs.
+RAY_CONFIG(uint64_t, plasma_slab_max_object_bytes, 0)
+
+/// The size in bytes of each plasma slab for small objects. Must be a power of two.
+RAY_CONFIG(uint64_t, plasma_slab_bytes, 1024 * 1024)
+
+/// How much raylets prefer the nodes that hold a task's arguments, which owners record
+/// in lease requests when locality-aware leasing is enabled and this is positive. A
+/// node holding all of the arguments has its critical resource utilization lowered by
+/// this much when the hybrid policy compares it to other nodes, e.g. 0.5. Tasks with
+/// argument locations are scheduled one by one, so 0 disables it.
+RAY_CONFIG(float, scheduler_locality_weight, 0)
+
+/// How long a raylet tries to reserve resources for all the leases of a gang lease
+/// request before it cancels them, when the request does not set its own timeout.
+RAY_CONFIG(int64_t, gang_lease_timeout_ms, 10000)
+
+/// After a failed attempt to reserve a gang, the raylet waits this long before it tries
+/// again, and doubles the wait after every failure up to gang_lease_max_backoff_ms.
+RAY_CONFIG(int64_t, gang_lease_initial_backoff_ms, 10)
+RAY_CONFIG(int64_t, gang_lease_max_backoff_ms, 1000)
+
+/// How long a raylet holds the resources that it reserved for the leases of a gang that
+/// another raylet schedules, before the owner claims them with a lease request.
+RAY_CONFIG(int64_t, gang_lease_reservation_timeout_ms, 10000)
+
+/// Whether a raylet kills a worker that runs a retriable task of a lower priority when
+/// a task of a higher priority cannot get resources anywhere.
+RAY_CONFIG(bool, preempt_lower_priority_tasks, false)
@@ -1,5 +1,6 @@
 #include "ray/common/task/scheduling_resources.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 
@@ -7,20 +8,174 @@
 #include "ray/util/logging.h"
 
 namespace ray {
+
+namespace {
+
+using ResourceVector = std::vector<std::pair<InternedResourceId, FixedPoint>>;
+
+/// \return The first entry of a sorted resource vector whose id is not less than "id".
+ResourceVector::const_iterator LowerBound(const ResourceVector &resources, int64_t id) {
+  return std::lower_bound(
+      resources.begin(), resources.end(), id,
+      [](const std::pair<InternedResourceId, FixedPoint> &entry, int64_t id) {
+        return entry.first < id;
+      });
+}
+
+/// \return The id of a predefined resource, or -1 if the name is not predefined.
+int64_t PredefinedResourceId(const std::string &resource_name) {
+  if (resource_name == kCPU_ResourceLabel) {
+    return CPU;
+  } else if (resource_name == kMemory_ResourceLabel) {
+    return MEM;
+  } else if (resource_name == kGPU_ResourceLabel) {
+    return GPU;
+  } else if (resource_name == kObjectStoreMemory_ResourceLabel) {
+    return OBJECT_STORE_MEM;
+  }
+  return -1;
+}
+
+/// Whether the name is one of the resources of a placement group bundle, see
+/// FormatPlacementGroupResource().
+bool IsPlacementGroupResource(const std::string &resource_name) {
+  return resource_name.find("_group_") != std::string::npos;
+}
+
+}  // namespace
+
+ResourceNameTable::ResourceNameTable() {
+  // The order of PredefinedResources.
+  for (const auto &resource_name :
+       {kCPU_ResourceLabel, kMemory_ResourceLabel, kGPU_ResourceLabel,
+        kObjectStoreMemory_ResourceLabel}) {
+    ids_.emplace(resource_name, names_.size());
+    names_.push_back(resource_name);
+  }
+}
+
+ResourceNameTable &ResourceNameTable::Instance() {
+  static ResourceNameTable instance;
+  return instance;
+}
+
+int64_t ResourceNameTable::Intern(const std::string &resource_name) {
+  int64_t id = PredefinedResourceId(resource_name);
+  if (id != -1) {
+    return id;
+  }
+  auto &table = Instance();
+  {
+    absl::ReaderMutexLock lock(&table.mutex_);
+    auto it = table.ids_.find(resource_name);
+    if (it != table.ids_.end()) {
+      if (IsReferenceCounted(it->second)) {
+        // A name is only forgotten under the writer lock, so it cannot go away here.
+        table.counted_names_.at(it->second).num_references++;
+      }
+      return it->second;
+    }
+  }
+  absl::MutexLock lock(&table.mutex_);
+  auto it = table.ids_.find(resource_name);
+  if (it != table.ids_.end()) {
+    id = it->second;
+  } else if (IsPlacementGroupResource(resource_name)) {
+    id = table.next_counted_id_++;
+    table.counted_names_[id].name = resource_name;
+    table.ids_.emplace(resource_name, id);
+  } else {
+    id = table.names_.size();
+    table.names_.push_back(resource_name);
+    table.ids_.emplace(resource_name, id);
+  }
+  if (IsReferenceCounted(id)) {
+    table.counted_names_.at(id).num_references++;
+  }
+  return id;
+}
+
+int64_t ResourceNameTable::Find(const std::string &resource_name) {
+  int64_t id = PredefinedResourceId(resource_name);
+  if (id != -1) {
+    return id;
+  }
+  auto &table = Instance();
+  absl::ReaderMutexLock lock(&table.mutex_);
+  auto it = table.ids_.find(resource_name);
+  return it == table.ids_.end() ? -1 : it->second;
+}
+
+const std::string &ResourceNameTable::Name(int64_t id) {
+  // The order of PredefinedResources.
+  static const std::string predefined_names[] = {
+      kCPU_ResourceLabel, kMemory_ResourceLabel, kGPU_ResourceLabel,
+      kObjectStoreMemory_ResourceLabel};
+  if (id >= 0 && id < PredefinedResources_MAX) {
+    return predefined_names[id];
+  }
+  auto &table = Instance();
+  absl::ReaderMutexLock lock(&table.mutex_);
+  if (IsReferenceCounted(id)) {
+    auto it = table.counted_names_.find(id);
+    RAY_CHECK(it != table.counted_names_.end()) << "Unknown resource id " << id;
+    return it->second.name;
+  }
+  RAY_CHECK(id >= 0 && static_cast<size_t>(id) < table.names_.size())
+      << "Unknown resource id " << id;
+  return table.names_[id];
+}
+
+void ResourceNameTable::AddReference(int64_t id) {
+  auto &table = Instance();
+  absl::ReaderMutexLock lock(&table.mutex_);
+  table.counted_names_.at(id).num_references++;
+}
+
+void ResourceNameTable::RemoveReference(int64_t id) {
+  auto &table = Instance();
+  {
+    absl::ReaderMutexLock lock(&table.mutex_);
+    if (--table.counted_names_.at(id).num_references > 0) {
+      return;
+    }
+  }
+  // The name may have been interned again since, so check under the writer lock.
+  absl::MutexLock lock(&table.mutex_);
+  auto it = table.counted_names_.find(id);
+  if (it != table.counted_names_.end() && it->second.num_references == 0) {
+    table.ids_.erase(it->second.name);
+    table.counted_names_.erase(it);
+  }
+}
+
+size_t ResourceNameTable::Size() {
+  auto &table = Instance();
+  absl::ReaderMutexLock lock(&table.mutex_);
+  return table.ids_.size();
+}
+
 ResourceSet::ResourceSet() {}
 
-ResourceSet::ResourceSet(const std::unordered_map<std::string, FixedPoint> &resource_map)
-    : resource_capacity_(resource_map) {
+ResourceSet::ResourceSet(
+    const std::unordered_map<std::string, FixedPoint> &resource_map) {
+  resource_capacity_.reserve(resource_map.size());
   for (auto const &resource_pair : resource_map) {
     RAY_CHECK(resource_pair.second > 0);
+    resource_capacity_.emplace_back(ResourceNameTable::Intern(resource_pair.first),
+                                    resource_pair.second);
   }
+  std::sort(resource_capacity_.begin(), resource_capacity_.end());
 }
 
 ResourceSet::ResourceSet(const std::unordered_map<std::string, double> &resource_map) {
+  resource_capacity_.reserve(resource_map.size());
   for (auto const &resource_pair : resource_map) {
     RAY_CHECK(resource_pair.second > 0);
-    resource_capacity_[resource_pair.first] = FixedPoint(resource_pair.second);
+    resource_capacity_.emplace_back(ResourceNameTable::Intern(resource_pair.first),
+                                    FixedPoint(resource_pair.second));
   }
+  std::sort(resource_capacity_.begin(), resource_capacity_.end());
 }
 
 ResourceSet::ResourceSet(const std::vector<std::string> &resource_labels,
@@ -28,7 +183,8 @@ ResourceSet::ResourceSet(const std::vector<std::string> &resource_labels,
   RAY_CHECK(resource_labels.size() == resource_capacity.size());
   for (size_t i = 0; i < resource_labels.size(); i++) {
     RAY_CHECK(resource_capacity[i] > 0);
-    resource_capacity_[resource_labels[i]] = FixedPoint(resource_capacity[i]);
+    SetResource(InternedResourceId(ResourceNameTable::Intern(resource_labels[i])),
+                FixedPoint(resource_capacity[i]));
   }
 }
 
@@ -44,13 +200,21 @@ bool ResourceSet::IsEmpty() const {
 }
 
 bool ResourceSet::IsSubset(const ResourceSet &other) const {
-  // Check to make sure all keys of this are in other.
+  // Both sets are sorted by id, so walk them together.
+  auto other_it = other.resource_capacity_.begin();
   for (const auto &resource_pair : resource_capacity_) {
-    const auto &resource_name = resource_pair.first;
+    while (other_it != other.resource_capacity_.end() &&
+           other_it->first < resource_pair.first) {
+      other_it++;
+    }
     const FixedPoint &lhs_quantity = resource_pair.second;
-    const FixedPoint &rhs_quantity = other.GetResource(resource_name);
+    const FixedPoint rhs_quantity =
+        (other_it != other.resource_capacity_.end() &&
+         other_it->first == resource_pair.first)
+            ? other_it->second
+            : FixedPoint(0);
     if (lhs_quantity > rhs_quantity) {
-      // Resource found in rhs, but lhs capacity exceeds rhs capacity.
+      // Resource not found in rhs, or lhs capacity exceeds rhs capacity.
       return false;
     }
   }
@@ -67,16 +231,28 @@ bool ResourceSet::IsEqual(const ResourceSet &rhs) const {
   return (this->IsSubset(rhs) && rhs.IsSubset(*this));
 }
 
+void ResourceSet::SetResource(InternedResourceId id, const FixedPoint &capacity) {
+  auto it = resource_capacity_.begin() + (LowerBound(resource_capacity_, id) -
+                                          resource_capacity_.begin());
+  if (it != resource_capacity_.end() && it->first == id) {
+    it->second = capacity;
+  } else {
+    resource_capacity_.emplace(it, std::move(id), capacity);
+  }
+}
+
 void ResourceSet::AddOrUpdateResource(const std::string &resource_name,
                                       const FixedPoint &capacity) {
   if (capacity > 0) {
-    resource_capacity_[resource_name] = capacity;
+    SetResource(InternedResourceId(ResourceNameTable::Intern(resource_name)), capacity);
   }
 }
 
 bool ResourceSet::DeleteResource(const std::string &resource_name) {
-  if (resource_capacity_.count(resource_name) == 1) {
-    resource_capacity_.erase(resource_name);
+  int64_t id = ResourceNameTable::Find(resource_name);
+  auto it = LowerBound(resource_capacity_, id);
+  if (id != -1 && it != resource_capacity_.end() && it->first == id) {
+    resource_capacity_.erase(it);
     return true;
   } else {
     return false;
@@ -85,64 +261,81 @@ bool ResourceSet::DeleteResource(const std::string &resource_name) {
 
 void ResourceSet::SubtractResources(const ResourceSet &other) {
   // Subtract the resources, make sure none goes below zero and delete any if new capacity
-  // is zero.
-  for (const auto &resource_pair : other.GetResourceAmountMap()) {
-    const std::string &resource_label = resource_pair.first;
-    const FixedPoint &resource_capacity = resource_pair.second;
-    if (resource_capacity_.count(resource_label) == 1) {
-      resource_capacity_[resource_label] -= resource_capacity;
+  // is zero. Resources that are only in the other set are ignored.
+  ResourceVector result;
+  result.reserve(resource_capacity_.size());
+  auto other_it = other.resource_capacity_.begin();
+  for (const auto &resource_pair : resource_capacity_) {
+    while (other_it != other.resource_capacity_.end() &&
+           other_it->first < resource_pair.first) {
+      other_it++;
     }
-    if (resource_capacity_[resource_label] <= 0) {
-      resource_capacity_.erase(resource_label);
+    FixedPoint capacity = resource_pair.second;
+    if (other_it != other.resource_capacity_.end() &&
+        other_it->first == resource_pair.first) {
+      capacity -= other_it->second;
+    }
+    if (capacity > 0) {
+      result.emplace_back(resource_pair.first, capacity);
     }
   }
+  resource_capacity_ = std::move(result);
 }
 
 void ResourceSet::SubtractResourcesStrict(const ResourceSet &other) {
   // Subtract the resources, make sure none goes below zero and delete any if new capacity
   // is zero.
-  for (const auto &resource_pair : other.GetResourceAmountMap()) {
-    const std::string &resource_label = resource_pair.first;
+  auto it = resource_capacity_.begin();
+  for (const auto &resource_pair : other.resource_capacity_) {
     const FixedPoint &resource_capacity = resource_pair.second;
-    RAY_CHECK(resource_capacity_.count(resource_label) == 1)
-        << "Attempt to acquire unknown resource: " << resource_label << " capacity "
+    while (it != resource_capacity_.end() && it->first < resource_pair.first) {
+      it++;
+    }
+    RAY_CHECK(it != resource_capacity_.end() && it->first == resource_pair.first)
+        << "Attempt to acquire unknown resource: "
+        << ResourceNameTable::Name(resource_pair.first) << " capacity "
         << resource_capacity.Double();
-    resource_capacity_[resource_label] -= resource_capacity;
-
-    // Ensure that quantity is positive. Note, we have to have the check before
-    // erasing the object to make sure that it doesn't get added back.
-    RAY_CHECK(resource_capacity_[resource_label] >= 0)
-        << "Capacity of resource after subtraction is negative, "
-        << resource_capacity_[resource_label].Double() << ".";
+    it->second -= resource_capacity;
 
-    if (resource_capacity_[resource_label] == 0) {
-      resource_capacity_.erase(resource_label);
-    }
+    // Ensure that quantity is positive.
+    RAY_CHECK(it->second >= 0) << "Capacity of resource after subtraction is negative, "
+                               << it->second.Double() << ".";
   }
+  resource_capacity_.erase(
+      std::remove_if(resource_capacity_.begin(), resource_capacity_.end(),
+                     [](const std::pair<InternedResourceId, FixedPoint> &resource_pair) {
+                       return resource_pair.second == 0;
+                     }),
+      resource_capacity_.end());
 }
 
 // Add a set of resources to the current set of resources subject to upper limits on
 // capacity from the total_resource set
 void ResourceSet::AddResourcesCapacityConstrained(const ResourceSet &other,
                                                   const ResourceSet &total_resources) {
-  const std::unordered_map<std::string, FixedPoint> &total_resource_map =
-      total_resources.GetResourceAmountMap();
-  for (const auto &resource_pair : other.GetResourceAmountMap()) {
-    const std::string &to_add_resource_label = resource_pair.first;
+  const auto &total_resource_vector = total_resources.resource_capacity_;
+  for (const auto &resource_pair : other.resource_capacity_) {
+    const InternedResourceId &to_add_resource_id = resource_pair.first;
     const FixedPoint &to_add_resource_capacity = resource_pair.second;
-    if (total_resource_map.count(to_add_resource_label) != 0) {
+    auto total_it = LowerBound(total_resource_vector, to_add_resource_id);
+    if (total_it != total_resource_vector.end() &&
+        total_it->first == to_add_resource_id) {
       // If resource exists in total map, add to the local capacity map.
       // If the new capacity is less than the total capacity, set the new capacity to
       // the local capacity (capping to the total).
-      const FixedPoint &total_capacity = total_resource_map.at(to_add_resource_label);
-      resource_capacity_[to_add_resource_label] =
-          std::min(resource_capacity_[to_add_resource_label] + to_add_resource_capacity,
-                   total_capacity);
+      const FixedPoint &total_capacity = total_it->second;
+      auto it = LowerBound(resource_capacity_, to_add_resource_id);
+      FixedPoint capacity = (it != resource_capacity_.end() &&
+                             it->first == to_add_resource_id)
+                                ? it->second
+                                : FixedPoint(0);
+      SetResource(to_add_resource_id,
+                  std::min(capacity + to_add_resource_capacity, total_capacity));
     } else {
       // Resource does not exist in the total map, it probably got deleted from the total.
       // Don't panic, do nothing and simply continue.
       RAY_LOG(DEBUG) << "[AddResourcesCapacityConstrained] Resource "
-                     << to_add_resource_label
+                     << ResourceNameTable::Name(to_add_resource_id)
                      << " not found in the total resource map. It probably got deleted, "
                         "not adding back to resource_capacity_.";
     }
@@ -151,26 +344,42 @@ void ResourceSet::AddResourcesCapacityConstrained(const ResourceSet &other,
 
 // Perform an outer join.
 void ResourceSet::AddResources(const ResourceSet &other) {
-  for (const auto &resource_pair : other.GetResourceAmountMap()) {
-    const std::string &resource_label = resource_pair.first;
-    const FixedPoint &resource_capacity = resource_pair.second;
-    resource_capacity_[resource_label] += resource_capacity;
+  if (other.resource_capacity_.empty()) {
+    return;
+  }
+  ResourceVector result;
+  result.reserve(resource_capacity_.size() + other.resource_capacity_.size());
+  auto it = resource_capacity_.begin();
+  auto other_it = other.resource_capacity_.begin();
+  while (it != resource_capacity_.end() || other_it != other.resource_capacity_.end()) {
+    if (other_it == other.resource_capacity_.end() ||
+        (it != resource_capacity_.end() && it->first < other_it->first)) {
+      result.push_back(*it++);
+    } else if (it == resource_capacity_.end() || other_it->first < it->first) {
+      result.push_back(*other_it++);
+    } else {
+      result.emplace_back(it->first, it->second + other_it->second);
+      it++;
+      other_it++;
+    }
   }
+  resource_capacity_ = std::move(result);
 }
 
 FixedPoint ResourceSet::GetResource(const std::string &resource_name) const {
-  if (resource_capacity_.count(resource_name) == 0) {
+  int64_t id = ResourceNameTable::Find(resource_name);
+  auto it = LowerBound(resource_capacity_, id);
+  if (id == -1 || it == resource_capacity_.end() || it->first != id) {
     return 0;
   }
-  const FixedPoint &capacity = resource_capacity_.at(resource_name);
-  return capacity;
+  return it->second;
 }
 
 const ResourceSet ResourceSet::GetNumCpus() const {
   ResourceSet cpu_resource_set;
-  const FixedPoint cpu_quantity = GetResource(kCPU_ResourceLabel);
-  if (cpu_quantity > 0) {
-    cpu_resource_set.resource_capacity_[kCPU_ResourceLabel] = cpu_quantity;
+  auto it = LowerBound(resource_capacity_, CPU);
+  if (it != resource_capacity_.end() && it->first == CPU) {
+    cpu_resource_set.resource_capacity_.push_back(*it);
   }
   return cpu_resource_set;
 }
@@ -192,17 +401,19 @@ const std::string ResourceSet::ToString() const {
 
     // Convert the first element to a string.
     if (it != resource_capacity_.end()) {
+      const std::string &resource_name = ResourceNameTable::Name(it->first);
       double resource_amount = (it->second).Double();
-      return_string +=
-          "{" + it->first + ": " + format_resource(it->first, resource_amount) + "}";
+      return_string += "{" + resource_name + ": " +
+                       format_resource(resource_name, resource_amount) + "}";
       it++;
     }
 
     // Add the remaining elements to the string (along with a comma).
     for (; it != resource_capacity_.end(); ++it) {
+      const std::string &resource_name = ResourceNameTable::Name(it->first);
       double resource_amount = (it->second).Double();
-      return_string +=
-          ", {" + it->first + ": " + format_resource(it->first, resource_amount) + "}";
+      return_string += ", {" + resource_name + ": " +
+                       format_resource(resource_name, resource_amount) + "}";
     }
 
     return return_string;
@@ -212,16 +423,25 @@ const std::string ResourceSet::ToString() const {
 const std::unordered_map<std::string, double> ResourceSet::GetResourceMap() const {
   std::unordered_map<std::string, double> result;
   for (const auto &resource_pair : resource_capacity_) {
-    result[resource_pair.first] = resource_pair.second.Double();
+    result[ResourceNameTable::Name(resource_pair.first)] = resource_pair.second.Double();
   }
   return result;
 };
 
-const std::unordered_map<std::string, FixedPoint> &ResourceSet::GetResourceAmountMap()
+const std::unordered_map<std::string, FixedPoint> ResourceSet::GetResourceAmountMap()
     const {
-  return resource_capacity_;
+  std::unordered_map<std::string, FixedPoint> result;
+  for (const auto &resource_pair : resource_capacity_) {
+    result[ResourceNameTable::Name(resource_pair.first)] = resource_pair.second;
+  }
+  return result;
 };
 
+const std::vector<std::pair<InternedResourceId, FixedPoint>>
+    &ResourceSet::GetInternedResources() const {
+  return resource_capacity_;
+}
+
 /// ResourceIds class implementation
 
 ResourceIds::ResourceIds() {}
@@ -468,9 +688,9 @@ bool ResourceIds::IsWhole(double resource_quantity) const {
 ResourceIdSet::ResourceIdSet() {}
 
 ResourceIdSet::ResourceIdSet(const ResourceSet &resource_set) {
-  for (auto const &resource_pair : resource_set.GetResourceMap()) {
-    auto const &resource_name = resource_pair.first;
-    double resource_quantity = resource_pair.second;
+  for (auto const &resource_pair : resource_set.GetInternedResources()) {
+    auto const &resource_name = ResourceNameTable::Name(resource_pair.first);
+    double resource_quantity = resource_pair.second.Double();
     available_resources_[resource_name] = ResourceIds(resource_quantity);
   }
 }
@@ -480,8 +700,8 @@ ResourceIdSet::ResourceIdSet(
     : available_resources_(available_resources) {}
 
 bool ResourceIdSet::Contains(const ResourceSet &resource_set) const {
-  for (auto const &resource_pair : resource_set.GetResourceAmountMap()) {
-    auto const &resource_name = resource_pair.first;
+  for (auto const &resource_pair : resource_set.GetInternedResources()) {
+    auto const &resource_name = ResourceNameTable::Name(resource_pair.first);
     const FixedPoint &resource_quantity = resource_pair.second;
 
     auto it = available_resources_.find(resource_name);
@@ -499,8 +719,8 @@ bool ResourceIdSet::Contains(const ResourceSet &resource_set) const {
 ResourceIdSet ResourceIdSet::Acquire(const ResourceSet &resource_set) {
   std::unordered_map<std::string, ResourceIds> acquired_resources;
 
-  for (auto const &resource_pair : resource_set.GetResourceAmountMap()) {
-    auto const &resource_name = resource_pair.first;
+  for (auto const &resource_pair : resource_set.GetInternedResources()) {
+    auto const &resource_name = ResourceNameTable::Name(resource_pair.first);
     const FixedPoint &resource_quantity = resource_pair.second;
 
     auto it = available_resources_.find(resource_name);
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "ray/common/id.h"
 #include "ray/raylet/format/node_manager_generated.h"
 #include "ray/raylet/scheduling/cluster_resource_data.h"
@@ -21,6 +26,103 @@ const std::string kGPU_ResourceLabel = "GPU";
 const std::string kObjectStoreMemory_ResourceLabel = "object_store_memory";
 const std::string kMemory_ResourceLabel = "memory";
 
+/// \class ResourceNameTable
+/// \brief Interns resource names as integer ids, so that resource sets can be
+/// compared and combined without hashing the names. The ids are only meaningful within
+/// the process. The predefined resources get the ids of their PredefinedResources
+/// values and are looked up without locking.
+///
+/// Placement group resource names are created and dropped with their placement
+/// groups, so their ids are reference counted: a name is forgotten once no
+/// InternedResourceId refers to it, and gets a new id if it is interned again. All
+/// other names keep their ids until the process exits.
+class ResourceNameTable {
+ public:
+  /// \brief Return the id of a resource name, and assign one on first use. For a
+  /// reference counted name, the caller owns a reference to the id, see
+  /// InternedResourceId.
+  static int64_t Intern(const std::string &resource_name);
+
+  /// \brief Return the id of a resource name, or -1 if it is not interned.
+  static int64_t Find(const std::string &resource_name);
+
+  /// \brief Return the name of an interned id. The id must stay referenced while the
+  /// name is used.
+  static const std::string &Name(int64_t id);
+
+  /// \brief Whether the id belongs to a reference counted name.
+  static bool IsReferenceCounted(int64_t id) { return id >= kReferenceCountedIdBase; }
+
+  /// \brief Add a reference to a reference counted id that is already referenced.
+  static void AddReference(int64_t id);
+
+  /// \brief Drop a reference to a reference counted id, and forget its name if it was
+  /// the last one.
+  static void RemoveReference(int64_t id);
+
+  /// \brief The number of names in the table, for tests.
+  static size_t Size();
+
+ private:
+  /// The ids of reference counted names start here, so that they are never reused
+  /// and are told apart from the other ids without a lookup.
+  static constexpr int64_t kReferenceCountedIdBase = int64_t(1) << 40;
+
+  struct ReferenceCountedName {
+    std::string name;
+    std::atomic<int64_t> num_references{0};
+  };
+
+  ResourceNameTable();
+
+  static ResourceNameTable &Instance();
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, int64_t> ids_ GUARDED_BY(mutex_);
+  /// The names that are never forgotten, indexed by id. A deque, so that the names
+  /// that Name() returns stay valid as names are added.
+  std::deque<std::string> names_ GUARDED_BY(mutex_);
+  /// The reference counted names. Nodes are stable, so that Name() can return them.
+  absl::node_hash_map<int64_t, ReferenceCountedName> counted_names_ GUARDED_BY(mutex_);
+  int64_t next_counted_id_ GUARDED_BY(mutex_) = kReferenceCountedIdBase;
+};
+
+/// \class InternedResourceId
+/// \brief An id from ResourceNameTable that keeps its name in the table. Only the ids
+/// of reference counted names do any work when they are copied or destroyed. Converts
+/// to the plain id.
+class InternedResourceId {
+ public:
+  /// \brief Take over the reference that ResourceNameTable::Intern() returned.
+  explicit InternedResourceId(int64_t id) : id_(id) {}
+
+  InternedResourceId(const InternedResourceId &other) : id_(other.id_) {
+    if (ResourceNameTable::IsReferenceCounted(id_)) {
+      ResourceNameTable::AddReference(id_);
+    }
+  }
+
+  InternedResourceId(InternedResourceId &&other) noexcept : id_(other.id_) {
+    other.id_ = -1;
+  }
+
+  InternedResourceId &operator=(InternedResourceId other) noexcept {
+    std::swap(id_, other.id_);
+    return *this;
+  }
+
+  ~InternedResourceId() {
+    if (ResourceNameTable::IsReferenceCounted(id_)) {
+      ResourceNameTable::RemoveReference(id_);
+    }
+  }
+
+  operator int64_t() const { return id_; }
+
+ private:
+  int64_t id_;
+};
+
 /// \class ResourceSet
 /// \brief Encapsulates and operates on a set of resources, including CPUs,
 /// GPUs, and custom labels.
@@ -150,13 +252,23 @@ class ResourceSet {
   /// size is in kResourceConversionFactor of a unit.
   ///
   /// \return map of resource in string to size in FixedPoint.
-  const std::unordered_map<std::string, FixedPoint> &GetResourceAmountMap() const;
+  const std::unordered_map<std::string, FixedPoint> GetResourceAmountMap() const;
+
+  /// \brief Return the resources without their names, for code on the scheduling
+  /// path.
+  ///
+  /// \return (id, capacity) pairs sorted by the ids from ResourceNameTable.
+  const std::vector<std::pair<InternedResourceId, FixedPoint>> &GetInternedResources()
+      const;
 
   const std::string ToString() const;
 
  private:
-  /// Resource capacity map.
-  std::unordered_map<std::string, FixedPoint> resource_capacity_;
+  /// Set the capacity of a resource, adding it if it is not in the set.
+  void SetResource(InternedResourceId id, const FixedPoint &capacity);
+
+  /// Resource capacities by interned id, sorted by id. All capacities are positive.
+  std::vector<std::pair<InternedResourceId, FixedPoint>> resource_capacity_;
 };
 
 /// \class ResourceIds
@@ -517,10 +629,10 @@ namespace std {
 template <>
 struct hash<ray::ResourceSet> {
   size_t operator()(ray::ResourceSet const &k) const {
-    size_t seed = k.GetResourceMap().size();
-    for (auto &elem : k.GetResourceMap()) {
-      seed ^= std::hash<std::string>()(elem.first);
-      seed ^= std::hash<double>()(elem.second);
+    size_t seed = k.GetInternedResources().size();
+    for (auto &elem : k.GetInternedResources()) {
+      seed ^= std::hash<int64_t>()(elem.first);
+      seed ^= std::hash<double>()(elem.second.Double());
     }
     return seed;
   }
@@ -165,6 +165,34 @@ const std::vector<ObjectID> TaskSpecification::ArgInlinedIds(size_t arg_index) c
   return IdVectorFromProtobuf<ObjectID>(message_->args(arg_index).nested_inlined_ids());
 }
 
+uint64_t TaskSpecification::ArgObjectSize(size_t arg_index) const {
+  return message_->args(arg_index).object_size();
+}
+
+std::vector<NodeID> TaskSpecification::ArgObjectLocations(size_t arg_index) const {
+  return IdVectorFromProtobuf<NodeID>(message_->args(arg_index).object_locations());
+}
+
+bool TaskSpecification::HasArgObjectLocations() const {
+  for (const auto &arg : message_->args()) {
+    if (arg.object_locations_size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t TaskSpecification::Priority() const { return message_->priority(); }
+
+TaskID TaskSpecification::GangId() const {
+  if (message_->gang_id().empty()) {
+    return TaskID::Nil();
+  }
+  return TaskID::FromBinary(message_->gang_id());
+}
+
+int32_t TaskSpecification::GangSize() const { return message_->gang_size(); }
+
 const ResourceSet &TaskSpecification::GetRequiredResources() const {
   return *required_resources_;
 }
@@ -102,6 +102,28 @@ class TaskSpecification : public MessageWrapper<rpc::TaskSpec> {
   /// Return the ObjectIDs that were inlined in this task argument.
   const std::vector<ObjectID> ArgInlinedIds(size_t arg_index) const;
 
+  /// Return the size of a pass-by-ref argument, as recorded by the owner.
+  uint64_t ArgObjectSize(size_t arg_index) const;
+
+  /// Return the nodes that held a pass-by-ref argument when the owner requested a
+  /// lease for the task.
+  std::vector<NodeID> ArgObjectLocations(size_t arg_index) const;
+
+  /// Return whether the owner recorded the locations of any argument.
+  bool HasArgObjectLocations() const;
+
+  /// Return the priority class of the task. Tasks with higher priorities are
+  /// dispatched first.
+  int32_t Priority() const;
+
+  /// Return the ID of the gang that the task belongs to, or nil if it is not part of a
+  /// gang.
+  TaskID GangId() const;
+
+  /// Return the number of tasks in the gang of the task, or 0 if it is not part of a
+  /// gang.
+  int32_t GangSize() const;
+
   /// Return the scheduling class of the task. The scheduler makes a best effort
   /// attempt to fairly dispatch tasks of different classes, preventing
   /// starvation of any single class of task.
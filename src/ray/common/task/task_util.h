@@ -138,6 +138,25 @@ class TaskSpecBuilder {
     return *this;
   }
 
+  /// Make the task part of a gang of tasks that are leased workers all at once.
+  /// See `common.proto` for meaning of the arguments.
+  ///
+  /// \return Reference to the builder object itself.
+  TaskSpecBuilder &SetGang(const TaskID &gang_id, int32_t gang_size) {
+    message_->set_gang_id(gang_id.Binary());
+    message_->set_gang_size(gang_size);
+    return *this;
+  }
+
+  /// Set the priority class of the task.
+  /// See `common.proto` for meaning of the arguments.
+  ///
+  /// \return Reference to the builder object itself.
+  TaskSpecBuilder &SetPriority(int32_t priority) {
+    message_->set_priority(priority);
+    return *this;
+  }
+
   /// Add an argument to the task.
   TaskSpecBuilder &AddArg(const TaskArg &arg) {
     auto ref = message_->add_args();
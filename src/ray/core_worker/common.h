@@ -76,6 +76,13 @@ struct TaskOptions {
   /// value.  Can override existing environment variables and introduce new ones.
   /// Propagated to child actors and/or tasks.
   const std::unordered_map<std::string, std::string> override_environment_variables;
+  /// The gang that this task belongs to and the number of tasks in it, if any. Set by
+  /// CoreWorker::SubmitGang.
+  TaskID gang_id = TaskID::Nil();
+  int gang_size = 0;
+  /// The priority class of this task. Raylets dispatch tasks of higher priorities
+  /// first. Not propagated to child tasks.
+  int32_t priority = 0;
 };
 
 /// Options for actor creation tasks.
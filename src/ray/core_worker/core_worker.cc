@@ -483,6 +483,21 @@ CoreWorker::CoreWorker(const CoreWorkerOptions &options, const WorkerID &worker_
 
   core_worker_client_pool_ =
       std::make_shared<rpc::CoreWorkerClientPool>(*client_call_manager_);
+  if (RayConfig::instance().actor_shared_memory_transport_enabled()) {
+    // Push actor tasks to workers on the same node over shared memory. Only the actor
+    // task submitter uses this pool, so that leased workers and owners, which never
+    // receive actor tasks, don't get rings and reply threads.
+    actor_client_pool_ = std::make_shared<rpc::CoreWorkerClientPool>(
+        [this](const rpc::Address &addr) -> std::shared_ptr<rpc::CoreWorkerClient> {
+          if (addr.raylet_id() == rpc_address_.raylet_id()) {
+            return std::make_shared<SharedMemoryCoreWorkerClient>(addr,
+                                                                  *client_call_manager_);
+          }
+          return std::make_shared<rpc::CoreWorkerClient>(addr, *client_call_manager_);
+        });
+  } else {
+    actor_client_pool_ = core_worker_client_pool_;
+  }
 
   object_status_publisher_ = std::make_unique<pubsub::Publisher>(
       /*periodical_runner=*/&periodical_runner_,
@@ -613,7 +628,7 @@ CoreWorker::CoreWorker(const CoreWorkerOptions &options, const WorkerID &worker_
       std::make_shared<DefaultActorCreator>(gcs_client_);
 
   direct_actor_submitter_ = std::shared_ptr<CoreWorkerDirectActorTaskSubmitter>(
-      new CoreWorkerDirectActorTaskSubmitter(core_worker_client_pool_, memory_store_,
+      new CoreWorkerDirectActorTaskSubmitter(actor_client_pool_, memory_store_,
                                              task_manager_));
 
   auto node_addr_factory = [this](const NodeID &node_id) {
@@ -656,6 +671,16 @@ CoreWorker::CoreWorker(const CoreWorkerOptions &options, const WorkerID &worker_
                                 task_argument_waiter_);
   }
 
+  if (options_.worker_type == WorkerType::WORKER &&
+      RayConfig::instance().actor_shared_memory_transport_enabled()) {
+    shared_memory_task_server_ = std::make_unique<SharedMemoryTaskServer>(
+        GetWorkerID(), [this](const rpc::PushTaskRequest &request,
+                              rpc::PushTaskReply *reply,
+                              rpc::SendReplyCallback send_reply_callback) {
+          HandlePushTask(request, reply, std::move(send_reply_callback));
+        });
+  }
+
   actor_manager_ = std::make_unique<ActorManager>(gcs_client_, direct_actor_submitter_,
                                                   reference_counter_);
 
@@ -1638,6 +1663,10 @@ void CoreWorker::SubmitTask(const RayFunction &function,
                       placement_options, placement_group_capture_child_tasks,
                       debugger_breakpoint, task_options.serialized_runtime_env,
                       override_environment_variables);
+  if (task_options.gang_size > 0) {
+    builder.SetGang(task_options.gang_id, task_options.gang_size);
+  }
+  builder.SetPriority(task_options.priority);
   TaskSpecification task_spec = builder.Build();
   RAY_LOG(DEBUG) << "Submit task " << task_spec.DebugString();
   if (options_.is_local_mode) {
@@ -1653,6 +1682,23 @@ void CoreWorker::SubmitTask(const RayFunction &function,
   }
 }
 
+void CoreWorker::SubmitGang(
+    const RayFunction &function,
+    const std::vector<std::vector<std::unique_ptr<TaskArg>>> &args,
+    const TaskOptions &task_options, std::vector<std::vector<ObjectID>> *return_ids,
+    int max_retries, BundleID placement_options,
+    bool placement_group_capture_child_tasks) {
+  TaskOptions gang_options = task_options;
+  gang_options.gang_id = TaskID::ForFakeTask();
+  gang_options.gang_size = args.size();
+  return_ids->resize(args.size());
+  for (size_t i = 0; i < args.size(); i++) {
+    SubmitTask(function, args[i], gang_options, &(*return_ids)[i], max_retries,
+               placement_options, placement_group_capture_child_tasks,
+               /*debugger_breakpoint=*/"");
+  }
+}
+
 Status CoreWorker::CreateActor(const RayFunction &function,
                                const std::vector<std::unique_ptr<TaskArg>> &args,
                                const ActorCreationOptions &actor_creation_options,
@@ -2363,6 +2409,69 @@ void CoreWorker::HandlePushTask(const rpc::PushTaskRequest &request,
   }
 }
 
+void CoreWorker::HandlePushTasks(const rpc::PushTasksRequest &request,
+                                 rpc::PushTasksReply *reply,
+                                 rpc::SendReplyCallback send_reply_callback) {
+  if (HandleWrongRecipient(WorkerID::FromBinary(request.intended_worker_id()),
+                           send_reply_callback)) {
+    return;
+  }
+  const int num_tasks = request.requests_size();
+  if (num_tasks == 0) {
+    send_reply_callback(Status::OK(), nullptr, nullptr);
+    return;
+  }
+  // Only actor tasks are batched. Check the whole batch before running any of it, so
+  // that a bad request is rejected instead of running part of the batch.
+  for (const auto &task_request : request.requests()) {
+    if (task_request.task_spec().type() != TaskType::ACTOR_TASK) {
+      send_reply_callback(
+          Status::Invalid("Only actor tasks can be pushed in a batch, but task " +
+                          TaskID::FromBinary(task_request.task_spec().task_id()).Hex() +
+                          " is not one."),
+          nullptr, nullptr);
+      return;
+    }
+  }
+
+  task_queue_length_ += num_tasks;
+
+  // Allocate every reply up front so that tasks finishing on different threads write
+  // to their own messages. The batch is replied to once the last task finishes.
+  // Callers only send batches to actors that run one task at a time, see
+  // PushTaskReply.runs_tasks_sequentially.
+  for (int i = 0; i < num_tasks; i++) {
+    reply->add_replies();
+    reply->add_statuses();
+  }
+  auto num_remaining = std::make_shared<std::atomic<int>>(num_tasks);
+  task_execution_service_.post(
+      [this, request, reply, num_remaining,
+       send_reply_callback = std::move(send_reply_callback)] {
+        // We have posted an exit task onto the main event loop,
+        // so shouldn't bother executing any further work.
+        if (exiting_) return;
+        for (int i = 0; i < request.requests_size(); i++) {
+          const auto &task_request = request.requests(i);
+          auto task_status = reply->mutable_statuses(i);
+          auto task_reply_callback = [task_status, num_remaining, send_reply_callback](
+                                         Status status, std::function<void()> success,
+                                         std::function<void()> failure) {
+            task_status->set_ok(status.ok());
+            if (!status.ok()) {
+              task_status->set_message(status.message());
+            }
+            if (--*num_remaining == 0) {
+              send_reply_callback(Status::OK(), nullptr, nullptr);
+            }
+          };
+          direct_task_receiver_->HandleTask(task_request, reply->mutable_replies(i),
+                                            std::move(task_reply_callback));
+        }
+      },
+      "CoreWorker.HandlePushTasks");
+}
+
 void CoreWorker::HandleStealTasks(const rpc::StealTasksRequest &request,
                                   rpc::StealTasksReply *reply,
                                   rpc::SendReplyCallback send_reply_callback) {
@@ -2980,36 +3089,35 @@ void CoreWorker::PlasmaCallback(SetResultCallback success,
                                 void *py_future) {
   RAY_CHECK(ray_object->IsInPlasmaError());
 
-  // First check if the object is available in local plasma store.
-  // Note that we are using Contains instead of Get so it won't trigger pull request
-  // to remote nodes.
-  bool object_is_local = false;
-  if (Contains(object_id, &object_is_local).ok() && object_is_local) {
-    std::vector<std::shared_ptr<RayObject>> vec;
-    if (Get(std::vector<ObjectID>{object_id}, 0, &vec).ok()) {
-      RAY_CHECK(vec.size() > 0)
-          << "Failed to get local object but Raylet notified object is local.";
-      return success(vec.front(), object_id, py_future);
-    }
-  }
-
-  // Object is not available locally. We now add the callback to listener queue.
-  {
-    absl::MutexLock lock(&plasma_mutex_);
-    auto plasma_arrived_callback = [this, success, object_id, py_future]() {
-      // This callback is invoked on the io_service_ event loop, so it cannot call
-      // blocking call like Get(). We used GetAsync here, which should immediate call
-      // PlasmaCallback again with object available locally.
-      GetAsync(object_id, success, py_future);
-    };
+  // First check if the object is available in local plasma store. This may run on the
+  // io_service_ event loop, so the request to the store is made off this thread and
+  // its result comes back on io_service_. It does not trigger a pull from remote nodes.
+  plasma_store_provider_->GetIfLocalAsync(
+      object_id, io_service_,
+      [this, success, object_id, py_future](std::shared_ptr<RayObject> local_object) {
+        if (local_object != nullptr) {
+          success(local_object, object_id, py_future);
+          return;
+        }
 
-    async_plasma_callbacks_[object_id].push_back(plasma_arrived_callback);
-  }
+        // Object is not available locally. We now add the callback to listener queue.
+        {
+          absl::MutexLock lock(&plasma_mutex_);
+          auto plasma_arrived_callback = [this, success, object_id, py_future]() {
+            // This callback is invoked on the io_service_ event loop, so it cannot call
+            // blocking call like Get(). We used GetAsync here, which calls
+            // PlasmaCallback again to read the now local object.
+            GetAsync(object_id, success, py_future);
+          };
+
+          async_plasma_callbacks_[object_id].push_back(plasma_arrived_callback);
+        }
 
-  // Ask raylet to subscribe to object notification. Raylet will call this core worker
-  // when the object is local (and it will fire the callback immediately if the object
-  // exists). CoreWorker::HandlePlasmaObjectReady handles such request.
-  local_raylet_client_->SubscribeToPlasma(object_id, GetOwnerAddress(object_id));
+        // Ask raylet to subscribe to object notification. Raylet will call this core
+        // worker when the object is local (and it will fire the callback immediately if
+        // the object exists). CoreWorker::HandlePlasmaObjectReady handles such request.
+        local_raylet_client_->SubscribeToPlasma(object_id, GetOwnerAddress(object_id));
+      });
 }
 
 void CoreWorker::HandlePlasmaObjectReady(const rpc::PlasmaObjectReadyRequest &request,
@@ -33,6 +33,7 @@
 #include "ray/core_worker/store_provider/plasma_store_provider.h"
 #include "ray/core_worker/transport/direct_actor_transport.h"
 #include "ray/core_worker/transport/direct_task_transport.h"
+#include "ray/core_worker/transport/shared_memory_transport.h"
 #include "ray/gcs/gcs_client.h"
 #include "ray/pubsub/publisher.h"
 #include "ray/pubsub/subscriber.h"
@@ -716,6 +717,25 @@ class CoreWorker : public rpc::CoreWorkerServiceHandler {
                   bool placement_group_capture_child_tasks,
                   const std::string &debugger_breakpoint);
 
+  /// Submit a gang of normal tasks that are leased workers all at once or not at all,
+  /// such as the workers of one step of a collective operation. The tasks share their
+  /// function and options and differ in their arguments.
+  ///
+  /// \param[in] function The remote function to execute.
+  /// \param[in] args Arguments of each task of the gang.
+  /// \param[in] task_options Options for every task of the gang.
+  /// \param[out] return_ids Ids of the return objects of each task.
+  /// \param[in] max_retires max number of retry when a task fails.
+  /// \param[in] placement_options placement group options.
+  /// \param[in] placement_group_capture_child_tasks whether or not the submitted tasks
+  /// should capture parent's placement group implicilty.
+  void SubmitGang(const RayFunction &function,
+                  const std::vector<std::vector<std::unique_ptr<TaskArg>>> &args,
+                  const TaskOptions &task_options,
+                  std::vector<std::vector<ObjectID>> *return_ids, int max_retries,
+                  BundleID placement_options,
+                  bool placement_group_capture_child_tasks);
+
   /// Create an actor.
   ///
   /// \param[in] caller_id ID of the task submitter.
@@ -896,6 +916,10 @@ class CoreWorker : public rpc::CoreWorkerServiceHandler {
   void HandlePushTask(const rpc::PushTaskRequest &request, rpc::PushTaskReply *reply,
                       rpc::SendReplyCallback send_reply_callback) override;
 
+  /// Implements gRPC server handler.
+  void HandlePushTasks(const rpc::PushTasksRequest &request, rpc::PushTasksReply *reply,
+                       rpc::SendReplyCallback send_reply_callback) override;
+
   /// Implements gRPC server handler.
   void HandleStealTasks(const rpc::StealTasksRequest &request,
                         rpc::StealTasksReply *reply,
@@ -1232,6 +1256,10 @@ class CoreWorker : public rpc::CoreWorkerServiceHandler {
   /// Shared core worker client pool.
   std::shared_ptr<rpc::CoreWorkerClientPool> core_worker_client_pool_;
 
+  /// Client pool used to push actor tasks. Same as core_worker_client_pool_ unless
+  /// actor tasks go over shared memory.
+  std::shared_ptr<rpc::CoreWorkerClientPool> actor_client_pool_;
+
   /// The runner to run function periodically.
   PeriodicalRunner periodical_runner_;
 
@@ -1383,6 +1411,11 @@ class CoreWorker : public rpc::CoreWorkerServiceHandler {
   friend class CoreWorkerTest;
 
   std::unique_ptr<rpc::JobConfig> job_config_;
+
+  /// Receives actor tasks from callers on the same node over shared memory. This is
+  /// declared last so that it stops handing out tasks before anything else is
+  /// destroyed.
+  std::unique_ptr<SharedMemoryTaskServer> shared_memory_task_server_;
 };
 
 }  // namespace ray
@@ -53,6 +53,21 @@ absl::optional<NodeID> LocalityAwareLeasePolicy::GetBestNodeIdForTask(
   return max_bytes_node;
 }
 
+void LocalityAwareLeasePolicy::AddArgObjectLocations(rpc::TaskSpec *spec) {
+  for (auto &arg : *spec->mutable_args()) {
+    if (!arg.has_object_ref()) {
+      continue;
+    }
+    const auto object_id = ObjectID::FromBinary(arg.object_ref().object_id());
+    if (auto locality_data = locality_data_provider_->GetLocalityData(object_id)) {
+      arg.set_object_size(locality_data->object_size);
+      for (const NodeID &node_id : locality_data->nodes_containing_object) {
+        arg.add_object_locations(node_id.Binary());
+      }
+    }
+  }
+}
+
 rpc::Address LocalLeasePolicy::GetBestNodeForTask(const TaskSpecification &spec) {
   // Always return the local node.
   return local_node_rpc_address_;
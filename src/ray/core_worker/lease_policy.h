@@ -42,6 +42,11 @@ class LeasePolicyInterface {
   /// Get the address of the best worker node for a lease request for the provided task.
   virtual rpc::Address GetBestNodeForTask(const TaskSpecification &spec) = 0;
 
+  /// Record the sizes and locations of the task's arguments in the task spec that is
+  /// sent with the lease request, so that the raylets can schedule the task near its
+  /// arguments.
+  virtual void AddArgObjectLocations(rpc::TaskSpec *spec) {}
+
   virtual ~LeasePolicyInterface() {}
 };
 
@@ -64,6 +69,9 @@ class LocalityAwareLeasePolicy : public LeasePolicyInterface {
   /// Get the address of the best worker node for a lease request for the provided task.
   rpc::Address GetBestNodeForTask(const TaskSpecification &spec);
 
+  /// Record the sizes and locations of the task's arguments in the task spec.
+  void AddArgObjectLocations(rpc::TaskSpec *spec);
+
  private:
   /// Get the best worker node for a lease request for the provided task.
   absl::optional<NodeID> GetBestNodeIdForTask(const TaskSpecification &spec);
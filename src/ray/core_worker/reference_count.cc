@@ -15,15 +15,17 @@
 #include "ray/core_worker/reference_count.h"
 
 #define PRINT_REF_COUNT(it)                                                              \
-  RAY_LOG(DEBUG) << "REF " << it->first << " borrowers: " << it->second.borrowers.size() \
+  RAY_LOG(DEBUG) << "REF " << it->first                                                  \
+                 << " borrowers: " << it->second.borrow().borrowers.size()               \
                  << " local_ref_count: " << it->second.local_ref_count                   \
                  << " submitted_count: " << it->second.submitted_task_ref_count          \
-                 << " contained_in_owned: " << it->second.contained_in_owned.size()      \
+                 << " contained_in_owned: "                                              \
+                 << it->second.nested().contained_in_owned.size()                        \
                  << " contained_in_borrowed: "                                           \
-                 << (it->second.contained_in_borrowed_id.has_value()                     \
-                         ? *it->second.contained_in_borrowed_id                          \
+                 << (it->second.nested().contained_in_borrowed_id.has_value()            \
+                         ? *it->second.nested().contained_in_borrowed_id                 \
                          : ObjectID::Nil())                                              \
-                 << " contains: " << it->second.contains.size()                          \
+                 << " contains: " << it->second.nested().contains.size()                 \
                  << " lineage_ref_count: " << it->second.lineage_ref_count;
 
 namespace {}  // namespace
@@ -90,6 +92,19 @@ bool ReferenceCounter::AddBorrowedObject(const ObjectID &object_id,
   return AddBorrowedObjectInternal(object_id, outer_id, owner_address);
 }
 
+std::shared_ptr<const rpc::Address> ReferenceCounter::SharedOwnerAddress(
+    const rpc::Address &owner_address) {
+  // The owner ID changes for workers executing normal tasks, so compare the address.
+  if (owner_address_ == nullptr ||
+      owner_address_->worker_id() != owner_address.worker_id() ||
+      owner_address_->raylet_id() != owner_address.raylet_id() ||
+      owner_address_->ip_address() != owner_address.ip_address() ||
+      owner_address_->port() != owner_address.port()) {
+    owner_address_ = std::make_shared<const rpc::Address>(owner_address);
+  }
+  return owner_address_;
+}
+
 bool ReferenceCounter::AddBorrowedObjectInternal(const ObjectID &object_id,
                                                  const ObjectID &outer_id,
                                                  const rpc::Address &owner_address) {
@@ -105,16 +120,16 @@ bool ReferenceCounter::AddBorrowedObjectInternal(const ObjectID &object_id,
     return false;
   }
 
-  it->second.owner_address = owner_address;
+  it->second.owner_address = std::make_shared<const rpc::Address>(owner_address);
 
   if (!outer_id.IsNil()) {
     auto outer_it = object_id_refs_.find(outer_id);
     if (outer_it != object_id_refs_.end() && !outer_it->second.owned_by_us) {
       RAY_LOG(DEBUG) << "Setting borrowed inner ID " << object_id
                      << " contained_in_borrowed: " << outer_id;
-      RAY_CHECK(!it->second.contained_in_borrowed_id.has_value());
-      it->second.contained_in_borrowed_id = outer_id;
-      outer_it->second.contains.insert(object_id);
+      RAY_CHECK(!it->second.nested().contained_in_borrowed_id.has_value());
+      it->second.mutable_nested()->contained_in_borrowed_id = outer_id;
+      outer_it->second.mutable_nested()->contains.insert(object_id);
     }
   }
   return true;
@@ -142,7 +157,7 @@ void ReferenceCounter::AddObjectRefStats(
         ref_proto->set_call_site(it->second.second);
       }
     }
-    for (const auto &obj_id : ref.second.contained_in_owned) {
+    for (const auto &obj_id : ref.second.nested().contained_in_owned) {
       ref_proto->add_contained_in_owned(obj_id.Binary());
     }
   }
@@ -171,10 +186,12 @@ void ReferenceCounter::AddOwnedObject(const ObjectID &object_id,
   // If the entry doesn't exist, we initialize the direct reference count to zero
   // because this corresponds to a submitted task whose return ObjectID will be created
   // in the frontend language, incrementing the reference count.
-  auto it = object_id_refs_
-                .emplace(object_id, Reference(owner_address, call_site, object_size,
-                                              is_reconstructable, pinned_at_raylet_id))
-                .first;
+  auto it =
+      object_id_refs_
+          .emplace(object_id,
+                   Reference(SharedOwnerAddress(owner_address), call_site, object_size,
+                             is_reconstructable, pinned_at_raylet_id))
+          .first;
   if (!inner_ids.empty()) {
     // Mark that this object ID contains other inner IDs. Then, we will not GC
     // the inner objects until the outer object ID goes out of scope.
@@ -211,11 +228,18 @@ void ReferenceCounter::UpdateObjectSize(const ObjectID &object_id, int64_t objec
 
 void ReferenceCounter::AddLocalReference(const ObjectID &object_id,
                                          const std::string &call_site) {
-  absl::MutexLock lock(&mutex_);
-  auto it = object_id_refs_.find(object_id);
-  if (it == object_id_refs_.end()) {
+  absl::ReaderMutexLock lock(&mutex_);
+  AddLocalReferenceInShard(object_id, call_site);
+}
+
+void ReferenceCounter::AddLocalReferenceInShard(const ObjectID &object_id,
+                                                const std::string &call_site) {
+  auto &shard = object_id_refs_.GetShard(object_id);
+  absl::MutexLock shard_lock(&shard.mutex);
+  auto it = shard.refs.find(object_id);
+  if (it == shard.refs.end()) {
     // NOTE: ownership info for these objects must be added later via AddBorrowedObject.
-    it = object_id_refs_.emplace(object_id, Reference(call_site, -1)).first;
+    it = shard.refs.emplace(object_id, Reference(call_site, -1)).first;
   }
   it->second.local_ref_count++;
   RAY_LOG(DEBUG) << "Add local reference " << object_id;
@@ -224,6 +248,13 @@ void ReferenceCounter::AddLocalReference(const ObjectID &object_id,
 
 void ReferenceCounter::RemoveLocalReference(const ObjectID &object_id,
                                             std::vector<ObjectID> *deleted) {
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (TryRemoveLocalReferenceInShard(object_id)) {
+      return;
+    }
+  }
+  // The reference may go out of scope, which can touch other objects' entries.
   absl::MutexLock lock(&mutex_);
   auto it = object_id_refs_.find(object_id);
   if (it == object_id_refs_.end()) {
@@ -248,6 +279,11 @@ void ReferenceCounter::RemoveLocalReference(const ObjectID &object_id,
 void ReferenceCounter::UpdateSubmittedTaskReferences(
     const std::vector<ObjectID> &argument_ids_to_add,
     const std::vector<ObjectID> &argument_ids_to_remove, std::vector<ObjectID> *deleted) {
+  if (argument_ids_to_remove.empty()) {
+    absl::ReaderMutexLock lock(&mutex_);
+    AddSubmittedTaskReferencesInShards(argument_ids_to_add);
+    return;
+  }
   absl::MutexLock lock(&mutex_);
   for (const ObjectID &argument_id : argument_ids_to_add) {
     RAY_LOG(DEBUG) << "Increment ref count for submitted task argument " << argument_id;
@@ -282,7 +318,23 @@ void ReferenceCounter::UpdateFinishedTaskReferences(
     const std::vector<ObjectID> &argument_ids, bool release_lineage,
     const rpc::Address &worker_addr, const ReferenceTableProto &borrowed_refs,
     std::vector<ObjectID> *deleted) {
+  size_t num_removed = 0;
+  if (borrowed_refs.empty()) {
+    // There are no borrowers to merge, so the references can be removed
+    // without the exclusive lock as long as none of them go out of scope.
+    absl::ReaderMutexLock lock(&mutex_);
+    num_removed = TryRemoveSubmittedTaskReferencesInShards(argument_ids, release_lineage);
+    if (num_removed == argument_ids.size()) {
+      return;
+    }
+  }
   absl::MutexLock lock(&mutex_);
+  if (num_removed > 0) {
+    RemoveSubmittedTaskReferences(
+        std::vector<ObjectID>(argument_ids.begin() + num_removed, argument_ids.end()),
+        release_lineage, deleted);
+    return;
+  }
   // Must merge the borrower refs before decrementing any ref counts. This is
   // to make sure that for serialized IDs, we increment the borrower count for
   // the inner ID before decrementing the submitted_task_ref_count for the
@@ -331,6 +383,66 @@ void ReferenceCounter::ReleaseLineageReferencesInternal(
   }
 }
 
+void ReferenceCounter::AddSubmittedTaskReferencesInShards(
+    const std::vector<ObjectID> &argument_ids) {
+  for (const ObjectID &argument_id : argument_ids) {
+    RAY_LOG(DEBUG) << "Increment ref count for submitted task argument " << argument_id;
+    auto &shard = object_id_refs_.GetShard(argument_id);
+    absl::MutexLock shard_lock(&shard.mutex);
+    auto it = shard.refs.find(argument_id);
+    if (it == shard.refs.end()) {
+      // This happens if a large argument is transparently passed by reference
+      // because we don't hold a Python reference to its ObjectID.
+      it = shard.refs.emplace(argument_id, Reference()).first;
+    }
+    it->second.submitted_task_ref_count++;
+    // The lineage ref will get released once the task finishes and cannot be
+    // retried again.
+    it->second.lineage_ref_count++;
+  }
+}
+
+bool ReferenceCounter::TryRemoveLocalReferenceInShard(const ObjectID &object_id) {
+  auto &shard = object_id_refs_.GetShard(object_id);
+  absl::MutexLock shard_lock(&shard.mutex);
+  auto it = shard.refs.find(object_id);
+  if (it == shard.refs.end() || it->second.local_ref_count == 0 ||
+      it->second.RefCount() == 1) {
+    // Let the slow path log the error or delete the reference.
+    return false;
+  }
+  it->second.local_ref_count--;
+  RAY_LOG(DEBUG) << "Remove local reference " << object_id;
+  PRINT_REF_COUNT(it);
+  return true;
+}
+
+size_t ReferenceCounter::TryRemoveSubmittedTaskReferencesInShards(
+    const std::vector<ObjectID> &argument_ids, bool release_lineage) {
+  size_t num_removed = 0;
+  for (const ObjectID &argument_id : argument_ids) {
+    auto &shard = object_id_refs_.GetShard(argument_id);
+    absl::MutexLock shard_lock(&shard.mutex);
+    auto it = shard.refs.find(argument_id);
+    if (it == shard.refs.end() || it->second.submitted_task_ref_count == 0 ||
+        it->second.RefCount() == 1) {
+      break;
+    }
+    RAY_LOG(DEBUG) << "Releasing ref for submitted task argument " << argument_id;
+    it->second.submitted_task_ref_count--;
+    if (release_lineage) {
+      if (it->second.lineage_ref_count > 0) {
+        it->second.lineage_ref_count--;
+      } else {
+        // References can get evicted early when lineage pinning is disabled.
+        RAY_CHECK(!lineage_pinning_enabled_);
+      }
+    }
+    num_removed++;
+  }
+  return num_removed;
+}
+
 void ReferenceCounter::RemoveSubmittedTaskReferences(
     const std::vector<ObjectID> &argument_ids, bool release_lineage,
     std::vector<ObjectID> *deleted) {
@@ -433,14 +545,14 @@ void ReferenceCounter::FreePlasmaObjects(const std::vector<ObjectID> &object_ids
   }
 }
 
-void ReferenceCounter::DeleteReferenceInternal(ReferenceTable::iterator it,
+void ReferenceCounter::DeleteReferenceInternal(ShardedReferenceTable::iterator it,
                                                std::vector<ObjectID> *deleted) {
   const ObjectID id = it->first;
   RAY_LOG(DEBUG) << "Attempting to delete object " << id;
-  if (it->second.RefCount() == 0 && it->second.on_ref_removed) {
+  if (it->second.RefCount() == 0 && it->second.callbacks().on_ref_removed) {
     RAY_LOG(DEBUG) << "Calling on_ref_removed for object " << id;
-    it->second.on_ref_removed(id);
-    it->second.on_ref_removed = nullptr;
+    it->second.mutable_callbacks()->on_ref_removed(id);
+    it->second.mutable_callbacks()->on_ref_removed = nullptr;
   }
   PRINT_REF_COUNT(it);
 
@@ -451,7 +563,7 @@ void ReferenceCounter::DeleteReferenceInternal(ReferenceTable::iterator it,
     // If distributed ref counting is enabled, then delete the object once its
     // ref count across all processes is 0.
     should_delete_value = true;
-    for (const auto &inner_id : it->second.contains) {
+    for (const auto &inner_id : it->second.nested().contains) {
       auto inner_it = object_id_refs_.find(inner_id);
       if (inner_it != object_id_refs_.end()) {
         RAY_LOG(DEBUG) << "Try to delete inner object " << inner_id;
@@ -459,12 +571,12 @@ void ReferenceCounter::DeleteReferenceInternal(ReferenceTable::iterator it,
           // If this object ID was nested in an owned object, make sure that
           // the outer object counted towards the ref count for the inner
           // object.
-          RAY_CHECK(inner_it->second.contained_in_owned.erase(id));
+          RAY_CHECK(inner_it->second.mutable_nested()->contained_in_owned.erase(id));
         } else {
           // If this object ID was nested in a borrowed object, make sure that
           // we have already returned this information through a previous
           // GetAndClearLocalBorrowers call.
-          RAY_CHECK(!inner_it->second.contained_in_borrowed_id.has_value())
+          RAY_CHECK(!inner_it->second.nested().contained_in_borrowed_id.has_value())
               << "Outer object " << id << ", inner object " << inner_id;
         }
         DeleteReferenceInternal(inner_it, deleted);
@@ -495,11 +607,11 @@ void ReferenceCounter::DeleteReferenceInternal(ReferenceTable::iterator it,
   }
 }
 
-void ReferenceCounter::ReleasePlasmaObject(ReferenceTable::iterator it) {
-  if (it->second.on_delete) {
+void ReferenceCounter::ReleasePlasmaObject(ShardedReferenceTable::iterator it) {
+  if (it->second.callbacks().on_delete) {
     RAY_LOG(DEBUG) << "Calling on_delete for object " << it->first;
-    it->second.on_delete(it->first);
-    it->second.on_delete = nullptr;
+    it->second.mutable_callbacks()->on_delete(it->first);
+    it->second.mutable_callbacks()->on_delete = nullptr;
   }
   it->second.pinned_at_raylet_id.reset();
 }
@@ -530,7 +642,7 @@ bool ReferenceCounter::SetDeleteCallback(
   // will resend the registration request after GCS restarts.
   // 2.After GCS restarts, GCS will send `WaitForActorOutOfScope` request to owned actors
   // again.
-  it->second.on_delete = callback;
+  it->second.mutable_callbacks()->on_delete = callback;
   return true;
 }
 
@@ -662,21 +774,21 @@ bool ReferenceCounter::GetAndClearLocalBorrowersInternal(const ObjectID &object_
   // Clear the local list of borrowers that we have accumulated. The receiver
   // of the returned borrowed_refs must merge this list into their own list
   // until all active borrowers are merged into the owner.
-  it->second.borrowers.clear();
-  it->second.stored_in_objects.clear();
+  it->second.borrow_info.Clear();
 
-  if (it->second.contained_in_borrowed_id.has_value()) {
+  if (it->second.nested().contained_in_borrowed_id.has_value()) {
     /// This ID was nested in another ID that we (or a nested task) borrowed.
     /// Make sure that we also returned the ID that contained it.
-    RAY_CHECK(borrowed_refs->count(it->second.contained_in_borrowed_id.value()) > 0);
+    RAY_CHECK(
+        borrowed_refs->count(it->second.nested().contained_in_borrowed_id.value()) > 0);
     /// Clear the fact that this ID was nested because we are including it in
     /// the returned borrowed_refs. If the nested ID is not being borrowed by
     /// us, then it will be deleted recursively when deleting the outer ID.
-    it->second.contained_in_borrowed_id.reset();
+    it->second.mutable_nested()->contained_in_borrowed_id.reset();
   }
 
   // Attempt to pop children.
-  for (const auto &contained_id : it->second.contains) {
+  for (const auto &contained_id : it->second.nested().contains) {
     GetAndClearLocalBorrowersInternal(contained_id, borrowed_refs);
   }
 
@@ -693,28 +805,30 @@ void ReferenceCounter::MergeRemoteBorrowers(const ObjectID &object_id,
   }
   const auto &borrower_ref = borrower_it->second;
   RAY_LOG(DEBUG) << "Borrower ref " << object_id << " has "
-                 << borrower_ref.borrowers.size() << " borrowers "
+                 << borrower_ref.borrow().borrowers.size() << " borrowers "
                  << ", has local: " << borrower_ref.local_ref_count
                  << " submitted: " << borrower_ref.submitted_task_ref_count
-                 << " contained_in_owned " << borrower_ref.contained_in_owned.size();
+                 << " contained_in_owned "
+                 << borrower_ref.nested().contained_in_owned.size();
 
   auto it = object_id_refs_.find(object_id);
   if (it == object_id_refs_.end()) {
     it = object_id_refs_.emplace(object_id, Reference()).first;
   }
-  if (!it->second.owner_address && borrower_ref.contained_in_borrowed_id.has_value()) {
+  if (!it->second.owner_address &&
+      borrower_ref.nested().contained_in_borrowed_id.has_value()) {
     // We don't have owner information about this object ID yet and the worker
     // received it because it was nested in another ID that the worker was
     // borrowing. Copy this information to our local table.
     RAY_CHECK(borrower_ref.owner_address);
-    AddBorrowedObjectInternal(object_id, *borrower_it->second.contained_in_borrowed_id,
+    AddBorrowedObjectInternal(object_id, *borrower_ref.nested().contained_in_borrowed_id,
                               *borrower_ref.owner_address);
   }
   std::vector<rpc::WorkerAddress> new_borrowers;
 
   // The worker is still using the reference, so it is still a borrower.
   if (borrower_ref.RefCount() > 0) {
-    auto inserted = it->second.borrowers.insert(worker_addr).second;
+    auto inserted = it->second.mutable_borrow()->borrowers.insert(worker_addr).second;
     // If we are the owner of id, then send WaitForRefRemoved to borrower.
     if (inserted) {
       RAY_LOG(DEBUG) << "Adding borrower " << worker_addr.ip_address << ":"
@@ -724,8 +838,8 @@ void ReferenceCounter::MergeRemoteBorrowers(const ObjectID &object_id,
   }
 
   // Add any other workers that this worker passed the ID to as new borrowers.
-  for (const auto &nested_borrower : borrower_ref.borrowers) {
-    auto inserted = it->second.borrowers.insert(nested_borrower).second;
+  for (const auto &nested_borrower : borrower_ref.borrow().borrowers) {
+    auto inserted = it->second.mutable_borrow()->borrowers.insert(nested_borrower).second;
     if (inserted) {
       RAY_LOG(DEBUG) << "Adding borrower " << nested_borrower.ip_address << ":"
                      << nested_borrower.port << " to id " << object_id;
@@ -743,14 +857,14 @@ void ReferenceCounter::MergeRemoteBorrowers(const ObjectID &object_id,
 
   // If the borrower stored this object ID inside another object ID that it did
   // not own, then mark that the object ID is nested inside another.
-  for (const auto &stored_in_object : borrower_ref.stored_in_objects) {
+  for (const auto &stored_in_object : borrower_ref.borrow().stored_in_objects) {
     AddNestedObjectIdsInternal(stored_in_object.first, {object_id},
                                stored_in_object.second);
   }
 
   // Recursively merge any references that were contained in this object, to
   // handle any borrowers of nested objects.
-  for (const auto &inner_id : borrower_ref.contains) {
+  for (const auto &inner_id : borrower_ref.nested().contains) {
     MergeRemoteBorrowers(inner_id, worker_addr, borrowed_refs);
   }
 }
@@ -765,11 +879,11 @@ void ReferenceCounter::CleanupBorrowersOnRefRemoved(
   // Erase the previous borrower.
   auto it = object_id_refs_.find(object_id);
   RAY_CHECK(it != object_id_refs_.end()) << object_id;
-  RAY_CHECK(it->second.borrowers.erase(borrower_addr));
+  RAY_CHECK(it->second.mutable_borrow()->borrowers.erase(borrower_addr));
   DeleteReferenceInternal(it, nullptr);
 }
 
-void ReferenceCounter::WaitForRefRemoved(const ReferenceTable::iterator &ref_it,
+void ReferenceCounter::WaitForRefRemoved(const ShardedReferenceTable::iterator &ref_it,
                                          const rpc::WorkerAddress &addr,
                                          const ObjectID &contained_in_id) {
   const ObjectID &object_id = ref_it->first;
@@ -832,12 +946,12 @@ void ReferenceCounter::AddNestedObjectIdsInternal(
       // contained in the outer object ID so we do not GC the inner objects
       // until the outer object goes out of scope.
       for (const auto &inner_id : inner_ids) {
-        it->second.contains.insert(inner_id);
+        it->second.mutable_nested()->contains.insert(inner_id);
         auto inner_it = object_id_refs_.find(inner_id);
         RAY_CHECK(inner_it != object_id_refs_.end());
         RAY_LOG(DEBUG) << "Setting inner ID " << inner_id
                        << " contained_in_owned: " << object_id;
-        inner_it->second.contained_in_owned.insert(object_id);
+        inner_it->second.mutable_nested()->contained_in_owned.insert(object_id);
       }
     }
   } else {
@@ -851,14 +965,16 @@ void ReferenceCounter::AddNestedObjectIdsInternal(
       RAY_CHECK(inner_it != object_id_refs_.end());
       // Add the task's caller as a borrower.
       if (inner_it->second.owned_by_us) {
-        auto inserted = inner_it->second.borrowers.insert(owner_address).second;
+        auto inserted =
+            inner_it->second.mutable_borrow()->borrowers.insert(owner_address).second;
         if (inserted) {
           // Wait for it to remove its reference.
           WaitForRefRemoved(inner_it, owner_address, object_id);
         }
       } else {
-        auto inserted =
-            inner_it->second.stored_in_objects.emplace(object_id, owner_address).second;
+        auto inserted = inner_it->second.mutable_borrow()
+                            ->stored_in_objects.emplace(object_id, owner_address)
+                            .second;
         // This should be the first time that we have stored this object ID
         // inside this return ID.
         RAY_CHECK(inserted);
@@ -871,7 +987,7 @@ void ReferenceCounter::HandleRefRemoved(const ObjectID &object_id) {
   ReferenceTable borrowed_refs;
   RAY_UNUSED(GetAndClearLocalBorrowersInternal(object_id, &borrowed_refs));
   for (const auto &pair : borrowed_refs) {
-    RAY_LOG(DEBUG) << pair.first << " has " << pair.second.borrowers.size()
+    RAY_LOG(DEBUG) << pair.first << " has " << pair.second.borrow().borrowers.size()
                    << " borrowers";
   }
   auto it = object_id_refs_.find(object_id);
@@ -928,7 +1044,7 @@ void ReferenceCounter::SetRefRemovedCallback(
   } else {
     // We are still borrowing the object ID. Respond to the owner once we have
     // stopped borrowing it.
-    if (it->second.on_ref_removed != nullptr) {
+    if (it->second.callbacks().on_ref_removed != nullptr) {
       // TODO(swang): If the owner of an object dies and and is re-executed, it
       // is possible that we will receive a duplicate request to set
       // on_ref_removed. If messages are delayed and we overwrite the
@@ -938,7 +1054,7 @@ void ReferenceCounter::SetRefRemovedCallback(
       RAY_LOG(WARNING) << "on_ref_removed already set for " << object_id
                        << ". The owner task must have died and been re-executed.";
     }
-    it->second.on_ref_removed = ref_removed_callback;
+    it->second.mutable_callbacks()->on_ref_removed = ref_removed_callback;
   }
 }
 
@@ -961,9 +1077,9 @@ bool ReferenceCounter::AddObjectLocation(const ObjectID &object_id,
   return true;
 }
 
-void ReferenceCounter::AddObjectLocationInternal(ReferenceTable::iterator it,
+void ReferenceCounter::AddObjectLocationInternal(ShardedReferenceTable::iterator it,
                                                  const NodeID &node_id) {
-  if (it->second.locations.emplace(node_id).second) {
+  if (it->second.locations.Insert(node_id)) {
     // Only push to subscribers if we added a new location. We eagerly add the pinned
     // location without waiting for the object store notification to trigger a location
     // report, so there's a chance that we already knew about the node_id location.
@@ -980,7 +1096,7 @@ bool ReferenceCounter::RemoveObjectLocation(const ObjectID &object_id,
                   << " that doesn't exist in the reference table";
     return false;
   }
-  it->second.locations.erase(node_id);
+  it->second.locations.Erase(node_id);
   PushToLocationSubscribers(it);
   return true;
 }
@@ -994,7 +1110,7 @@ absl::optional<absl::flat_hash_set<NodeID>> ReferenceCounter::GetObjectLocations
                      << " that doesn't exist in the reference table";
     return absl::nullopt;
   }
-  return it->second.locations;
+  return it->second.LocationSet();
 }
 
 size_t ReferenceCounter::GetObjectSize(const ObjectID &object_id) const {
@@ -1019,10 +1135,10 @@ bool ReferenceCounter::HandleObjectSpilled(const ObjectID &object_id,
 
   it->second.spilled = true;
   if (spilled_url != "") {
-    it->second.spilled_url = spilled_url;
+    it->second.mutable_spill()->spilled_url = spilled_url;
   }
   if (!spilled_node_id.IsNil()) {
-    it->second.spilled_node_id = spilled_node_id;
+    it->second.mutable_spill()->spilled_node_id = spilled_node_id;
   }
   if (size > 0) {
     it->second.object_size = size;
@@ -1063,7 +1179,7 @@ absl::optional<LocalityData> ReferenceCounter::GetLocalityData(
   // - If we own this object and the ownership-based object directory is disabled, this
   // will only contain the pinned location, if known.
   // - If we don't own this object, this will be empty.
-  const auto &node_ids = it->second.locations;
+  const auto node_ids = it->second.LocationSet();
 
   // We should only reach here if we have valid locality data to return.
   absl::optional<LocalityData> locality_data(
@@ -1085,7 +1201,7 @@ bool ReferenceCounter::ReportLocalityData(const ObjectID &object_id,
   RAY_CHECK(!it->second.owned_by_us)
       << "ReportLocalityData should only be used for borrowed references.";
   for (const auto &location : locations) {
-    it->second.locations.emplace(location);
+    it->second.locations.Insert(location);
   }
   if (object_size > 0) {
     it->second.object_size = object_size;
@@ -1093,13 +1209,17 @@ bool ReferenceCounter::ReportLocalityData(const ObjectID &object_id,
   return true;
 }
 
-void ReferenceCounter::PushToLocationSubscribers(ReferenceTable::iterator it) {
-  const auto callbacks = it->second.location_subscription_callbacks;
-  it->second.location_subscription_callbacks.clear();
+void ReferenceCounter::PushToLocationSubscribers(ShardedReferenceTable::iterator it) {
   it->second.location_version++;
+  if (it->second.callbacks().location_subscription_callbacks.empty()) {
+    return;
+  }
+  const auto callbacks = it->second.callbacks().location_subscription_callbacks;
+  it->second.mutable_callbacks()->location_subscription_callbacks.clear();
+  const auto locations = it->second.LocationSet();
   for (const auto &callback : callbacks) {
-    callback(it->second.locations, it->second.object_size, it->second.spilled_url,
-             it->second.spilled_node_id, it->second.location_version,
+    callback(locations, it->second.object_size, it->second.spill().spilled_url,
+             it->second.spill().spilled_node_id, it->second.location_version,
              it->second.pinned_at_raylet_id);
   }
 }
@@ -1120,12 +1240,12 @@ Status ReferenceCounter::SubscribeObjectLocations(
     // If the last location version is less than the current location version, we
     // already have location data that the subscriber hasn't seen yet, so we immediately
     // invoke the callback.
-    callback(it->second.locations, it->second.object_size, it->second.spilled_url,
-             it->second.spilled_node_id, it->second.location_version,
-             it->second.pinned_at_raylet_id);
+    callback(it->second.LocationSet(), it->second.object_size,
+             it->second.spill().spilled_url, it->second.spill().spilled_node_id,
+             it->second.location_version, it->second.pinned_at_raylet_id);
   } else {
     // Otherwise, save the callback for later invocation.
-    it->second.location_subscription_callbacks.push_back(callback);
+    it->second.mutable_callbacks()->location_subscription_callbacks.push_back(callback);
   }
   return Status::OK();
 }
@@ -1133,23 +1253,25 @@ Status ReferenceCounter::SubscribeObjectLocations(
 ReferenceCounter::Reference ReferenceCounter::Reference::FromProto(
     const rpc::ObjectReferenceCount &ref_count) {
   Reference ref;
-  ref.owner_address = ref_count.reference().owner_address();
+  ref.owner_address =
+      std::make_shared<const rpc::Address>(ref_count.reference().owner_address());
   ref.local_ref_count = ref_count.has_local_ref() ? 1 : 0;
 
   for (const auto &borrower : ref_count.borrowers()) {
-    ref.borrowers.insert(rpc::WorkerAddress(borrower));
+    ref.mutable_borrow()->borrowers.insert(rpc::WorkerAddress(borrower));
   }
   for (const auto &object : ref_count.stored_in_objects()) {
     const auto &object_id = ObjectID::FromBinary(object.object_id());
-    ref.stored_in_objects.emplace(object_id, rpc::WorkerAddress(object.owner_address()));
+    ref.mutable_borrow()->stored_in_objects.emplace(
+        object_id, rpc::WorkerAddress(object.owner_address()));
   }
   for (const auto &id : ref_count.contains()) {
-    ref.contains.insert(ObjectID::FromBinary(id));
+    ref.mutable_nested()->contains.insert(ObjectID::FromBinary(id));
   }
   const auto contained_in_borrowed_id =
       ObjectID::FromBinary(ref_count.contained_in_borrowed_id());
   if (!contained_in_borrowed_id.IsNil()) {
-    ref.contained_in_borrowed_id = contained_in_borrowed_id;
+    ref.mutable_nested()->contained_in_borrowed_id = contained_in_borrowed_id;
   }
   return ref;
 }
@@ -1160,18 +1282,18 @@ void ReferenceCounter::Reference::ToProto(rpc::ObjectReferenceCount *ref) const
   }
   bool has_local_ref = RefCount() > 0;
   ref->set_has_local_ref(has_local_ref);
-  for (const auto &borrower : borrowers) {
+  for (const auto &borrower : borrow().borrowers) {
     ref->add_borrowers()->CopyFrom(borrower.ToProto());
   }
-  for (const auto &object : stored_in_objects) {
+  for (const auto &object : borrow().stored_in_objects) {
     auto ref_object = ref->add_stored_in_objects();
     ref_object->set_object_id(object.first.Binary());
     ref_object->mutable_owner_address()->CopyFrom(object.second.ToProto());
   }
-  if (contained_in_borrowed_id.has_value()) {
-    ref->set_contained_in_borrowed_id(contained_in_borrowed_id->Binary());
+  if (nested().contained_in_borrowed_id.has_value()) {
+    ref->set_contained_in_borrowed_id(nested().contained_in_borrowed_id->Binary());
   }
-  for (const auto &contains_id : contains) {
+  for (const auto &contains_id : nested().contains) {
     ref->add_contains(contains_id.Binary());
   }
 }
@@ -14,11 +14,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+
 #include <boost/bind.hpp>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/synchronization/mutex.h"
 #include "ray/common/id.h"
 #include "ray/core_worker/lease_policy.h"
@@ -168,10 +174,10 @@ class ReferenceCounter : public ReferenceCounterInterface,
   /// reference count for the ObjectID is set to zero, which assumes that an
   /// ObjectID for it will be created in the language frontend after this call.
   ///
-  /// TODO(swang): We could avoid copying the owner_address since
-  /// we are the owner, but it is easier to store a copy for now, since the
-  /// owner ID will change for workers executing normal tasks and it is
-  /// possible to have leftover references after a task has finished.
+  /// The owned objects share one copy of the owner_address for as long as it
+  /// stays the same. The owner ID will change for workers executing normal
+  /// tasks and it is possible to have leftover references after a task has
+  /// finished, so each Reference holds on to the address it was created with.
   ///
   /// \param[in] object_id The ID of the object that we own.
   /// \param[in] contained_ids ObjectIDs that are contained in the object's value.
@@ -457,22 +463,209 @@ class ReferenceCounter : public ReferenceCounterInterface,
                           uint64_t object_size);
 
  private:
+  /// A value that is stored out of line, allocated on first mutable access and
+  /// deep-copied along with its owner. Reading a value that was never set
+  /// returns a shared empty default without allocating.
+  template <typename T>
+  class OutOfLine {
+   public:
+    OutOfLine() = default;
+    OutOfLine(const OutOfLine &other)
+        : value_(other.value_ ? std::make_unique<T>(*other.value_) : nullptr) {}
+    OutOfLine(OutOfLine &&other) = default;
+    OutOfLine &operator=(const OutOfLine &other) {
+      value_ = other.value_ ? std::make_unique<T>(*other.value_) : nullptr;
+      return *this;
+    }
+    OutOfLine &operator=(OutOfLine &&other) = default;
+
+    const T &Get() const {
+      static const T *empty = new T();
+      return value_ ? *value_ : *empty;
+    }
+
+    T *GetMutable() {
+      if (!value_) {
+        value_ = std::make_unique<T>();
+      }
+      return value_.get();
+    }
+
+    /// Free the value. Later reads return the empty default.
+    void Clear() { value_.reset(); }
+
+   private:
+    std::unique_ptr<T> value_;
+  };
+
+  /// The locations of an object, without duplicates. An object is usually on
+  /// one node, so one location is stored inline. Locations are looked up with
+  /// a linear scan until there are more than kMaxInlineLocations of them; from
+  /// then on they are kept in a hash set allocated out of line.
+  class ObjectLocations {
+   public:
+    ObjectLocations() = default;
+    ObjectLocations(const ObjectLocations &other)
+        : inline_(other.inline_),
+          set_(other.set_ ? std::make_unique<absl::flat_hash_set<NodeID>>(*other.set_)
+                          : nullptr) {}
+    ObjectLocations(ObjectLocations &&other) = default;
+    ObjectLocations &operator=(const ObjectLocations &other) {
+      inline_ = other.inline_;
+      set_ = other.set_ ? std::make_unique<absl::flat_hash_set<NodeID>>(*other.set_)
+                        : nullptr;
+      return *this;
+    }
+    ObjectLocations &operator=(ObjectLocations &&other) = default;
+
+    /// Add a location. Returns whether it was not already present.
+    bool Insert(const NodeID &node_id) {
+      if (set_) {
+        return set_->insert(node_id).second;
+      }
+      if (std::find(inline_.begin(), inline_.end(), node_id) != inline_.end()) {
+        return false;
+      }
+      if (inline_.size() < kMaxInlineLocations) {
+        inline_.push_back(node_id);
+        return true;
+      }
+      set_ = std::make_unique<absl::flat_hash_set<NodeID>>(inline_.begin(),
+                                                           inline_.end());
+      set_->insert(node_id);
+      inline_.clear();
+      inline_.shrink_to_fit();
+      return true;
+    }
+
+    /// Remove a location. Returns whether it was present.
+    bool Erase(const NodeID &node_id) {
+      if (set_) {
+        return set_->erase(node_id) > 0;
+      }
+      auto it = std::find(inline_.begin(), inline_.end(), node_id);
+      if (it == inline_.end()) {
+        return false;
+      }
+      inline_.erase(it);
+      return true;
+    }
+
+    /// The locations as a set, for the callers that take one.
+    absl::flat_hash_set<NodeID> ToSet() const {
+      if (set_) {
+        return *set_;
+      }
+      return absl::flat_hash_set<NodeID>(inline_.begin(), inline_.end());
+    }
+
+   private:
+    static constexpr size_t kMaxInlineLocations = 4;
+    absl::InlinedVector<NodeID, 1> inline_;
+    std::unique_ptr<absl::flat_hash_set<NodeID>> set_;
+  };
+
   struct Reference {
     /// Constructor for a reference whose origin is unknown.
     Reference() {}
     Reference(std::string call_site, const int64_t object_size)
         : call_site(call_site), object_size(object_size) {}
     /// Constructor for a reference that we created.
-    Reference(const rpc::Address &owner_address, std::string call_site,
+    Reference(std::shared_ptr<const rpc::Address> owner_address, std::string call_site,
               const int64_t object_size, bool is_reconstructable,
               const absl::optional<NodeID> &pinned_at_raylet_id)
         : call_site(call_site),
           object_size(object_size),
-          owned_by_us(true),
-          owner_address(owner_address),
+          owner_address(std::move(owner_address)),
           pinned_at_raylet_id(pinned_at_raylet_id),
+          owned_by_us(true),
           is_reconstructable(is_reconstructable) {}
 
+    /// Bookkeeping for object IDs that are nested in other objects. Most
+    /// objects are never nested, so this is kept out of line.
+    struct NestedReferenceCount {
+      /// Object IDs that we own and that contain this object ID.
+      /// ObjectIDs are added to this field when we discover that this object
+      /// contains other IDs. This can happen in 2 cases:
+      ///  1. We call ray.put() and store the inner ID(s) in the outer object.
+      ///  2. A task that we submitted returned an ID(s).
+      /// ObjectIDs are erased from this field when their Reference is deleted.
+      absl::flat_hash_set<ObjectID> contained_in_owned;
+      /// An Object ID that we (or one of our children) borrowed that contains
+      /// this object ID, which is also borrowed. This is used in cases where an
+      /// ObjectID is nested. We need to notify the owner of the outer ID of any
+      /// borrowers of this object, so we keep this field around until
+      /// GetAndClearLocalBorrowersInternal is called on the outer ID. This field
+      /// is updated in 2 cases:
+      ///  1. We deserialize an ID that we do not own and that was stored in
+      ///     another object that we do not own.
+      ///  2. Case (1) occurred for a task that we submitted and we also do not
+      ///     own the inner or outer object. Then, we need to notify our caller
+      ///     that the task we submitted is a borrower for the inner ID.
+      /// This field is reset to null once GetAndClearLocalBorrowersInternal is
+      /// called on contained_in_borrowed_id. For each borrower, this field is
+      /// set at most once during the reference's lifetime. If the object ID is
+      /// later found to be nested in a second object, we do not need to remember
+      /// the second ID because we will already have notified the owner of the
+      /// first outer object about our reference.
+      absl::optional<ObjectID> contained_in_borrowed_id;
+      /// The object IDs contained in this object. These could be objects that we
+      /// own or are borrowing. This field is updated in 2 cases:
+      ///  1. We call ray.put() on this ID and store the contained IDs.
+      ///  2. We call ray.get() on an ID whose contents we do not know and we
+      ///     discover that it contains these IDs.
+      absl::flat_hash_set<ObjectID> contains;
+    };
+
+    /// Bookkeeping for other processes that borrow the object. Most objects
+    /// are never passed to another process, so this is kept out of line.
+    struct BorrowInfo {
+      /// A list of processes that are we gave a reference to that are still
+      /// borrowing the ID. This field is updated in 2 cases:
+      ///  1. If we are a borrower of the ID, then we add a process to this list
+      ///     if we passed that process a copy of the ID via task submission and
+      ///     the process is still using the ID by the time it finishes its task.
+      ///     Borrowers are removed from the list when we recursively merge our
+      ///     list into the owner.
+      ///  2. If we are the owner of the ID, then either the above case, or when
+      ///     we hear from a borrower that it has passed the ID to other
+      ///     borrowers. A borrower is removed from the list when it responds
+      ///     that it is no longer using the reference.
+      absl::flat_hash_set<rpc::WorkerAddress> borrowers;
+      /// When a process that is borrowing an object ID stores the ID inside the
+      /// return value of a task that it executes, the caller of the task is also
+      /// considered a borrower for as long as its reference to the task's return
+      /// ID stays in scope. Thus, the borrower must notify the owner that the
+      /// task's caller is also a borrower. The key is the task's return ID, and
+      /// the value is the task ID and address of the task's caller.
+      absl::flat_hash_map<ObjectID, rpc::WorkerAddress> stored_in_objects;
+    };
+
+    /// Where the object was spilled to, if it was spilled.
+    struct SpillInfo {
+      /// For objects that have been spilled to external storage, the URL from which
+      /// they can be retrieved.
+      std::string spilled_url = "";
+      /// The ID of the node that spilled the object.
+      /// This will be Nil if the object has not been spilled or if it is spilled
+      /// distributed external storage.
+      NodeID spilled_node_id = NodeID::Nil();
+    };
+
+    /// Callbacks registered on the object. Only objects that other processes
+    /// wait on have any, so these are kept out of line.
+    struct Callbacks {
+      /// Location subscription callbacks registered by async location get requests.
+      /// These will be invoked whenever locations or object_size are changed.
+      std::vector<LocationSubscriptionCallback> location_subscription_callbacks;
+      /// Callback that will be called when this ObjectID no longer has
+      /// references.
+      std::function<void(const ObjectID &)> on_delete;
+      /// Callback that is called when this process is no longer a borrower
+      /// (RefCount() == 0).
+      std::function<void(const ObjectID &)> on_ref_removed;
+    };
+
     /// Constructor from a protobuf. This is assumed to be a message from
     /// another process, so the object defaults to not being owned by us.
     static Reference FromProto(const rpc::ObjectReferenceCount &ref_count);
@@ -485,9 +678,25 @@ class ReferenceCounter : public ReferenceCounterInterface,
     /// - ObjectIDs that we own, that contain this ObjectID, and that are still
     ///   in scope.
     size_t RefCount() const {
-      return local_ref_count + submitted_task_ref_count + contained_in_owned.size();
+      return local_ref_count + submitted_task_ref_count +
+             nested().contained_in_owned.size();
     }
 
+    const NestedReferenceCount &nested() const { return nested_reference_count.Get(); }
+    NestedReferenceCount *mutable_nested() { return nested_reference_count.GetMutable(); }
+
+    const BorrowInfo &borrow() const { return borrow_info.Get(); }
+    BorrowInfo *mutable_borrow() { return borrow_info.GetMutable(); }
+
+    const SpillInfo &spill() const { return spill_info.Get(); }
+    SpillInfo *mutable_spill() { return spill_info.GetMutable(); }
+
+    const Callbacks &callbacks() const { return callbacks_info.Get(); }
+    Callbacks *mutable_callbacks() { return callbacks_info.GetMutable(); }
+
+    /// The object locations as a set, for the callers that take one.
+    absl::flat_hash_set<NodeID> LocationSet() const { return locations.ToSet(); }
+
     /// Whether this reference is no longer in scope. A reference is in scope
     /// if any of the following are true:
     /// - The reference is still being used by this process.
@@ -496,9 +705,9 @@ class ReferenceCounter : public ReferenceCounterInterface,
     /// - We gave the reference to at least one other process.
     bool OutOfScope(bool lineage_pinning_enabled) const {
       bool in_scope = RefCount() > 0;
-      bool was_contained_in_borrowed_id = contained_in_borrowed_id.has_value();
-      bool has_borrowers = borrowers.size() > 0;
-      bool was_stored_in_objects = stored_in_objects.size() > 0;
+      bool was_contained_in_borrowed_id = nested().contained_in_borrowed_id.has_value();
+      bool has_borrowers = borrow().borrowers.size() > 0;
+      bool was_stored_in_objects = borrow().stored_in_objects.size() > 0;
 
       bool has_lineage_references = false;
       if (lineage_pinning_enabled && owned_by_us && !is_reconstructable) {
@@ -527,119 +736,230 @@ class ReferenceCounter : public ReferenceCounterInterface,
     /// Object size if known, otherwise -1;
     int64_t object_size = -1;
 
-    /// Whether we own the object. If we own the object, then we are
-    /// responsible for tracking the state of the task that creates the object
-    /// (see task_manager.h).
-    bool owned_by_us = false;
     /// The object's owner's address, if we know it. If this process is the
     /// owner, then this is added during creation of the Reference. If this is
     /// process is a borrower, the borrower must add the owner's address before
-    /// using the ObjectID.
-    absl::optional<rpc::Address> owner_address;
+    /// using the ObjectID. The address is immutable, so that references with
+    /// the same owner can share it.
+    std::shared_ptr<const rpc::Address> owner_address;
     /// If this object is owned by us and stored in plasma, and reference
     /// counting is enabled, then some raylet must be pinning the object value.
     /// This is the address of that raylet.
     absl::optional<NodeID> pinned_at_raylet_id;
     /// If this object is owned by us and stored in plasma, this contains all
     /// object locations.
-    absl::flat_hash_set<NodeID> locations;
+    ObjectLocations locations;
     /// A logical counter for object location updates, used for object location
     /// subscriptions. Subscribers use -1 to indicate that they want us to
     /// immediately send them the current location data.
     int64_t location_version = 0;
-    // Whether this object can be reconstructed via lineage. If false, then the
-    // object's value will be pinned as long as it is referenced by any other
-    // object's lineage.
-    const bool is_reconstructable = false;
 
     /// The local ref count for the ObjectID in the language frontend.
     size_t local_ref_count = 0;
     /// The ref count for submitted tasks that depend on the ObjectID.
     size_t submitted_task_ref_count = 0;
-    /// Object IDs that we own and that contain this object ID.
-    /// ObjectIDs are added to this field when we discover that this object
-    /// contains other IDs. This can happen in 2 cases:
-    ///  1. We call ray.put() and store the inner ID(s) in the outer object.
-    ///  2. A task that we submitted returned an ID(s).
-    /// ObjectIDs are erased from this field when their Reference is deleted.
-    absl::flat_hash_set<ObjectID> contained_in_owned;
-    /// An Object ID that we (or one of our children) borrowed that contains
-    /// this object ID, which is also borrowed. This is used in cases where an
-    /// ObjectID is nested. We need to notify the owner of the outer ID of any
-    /// borrowers of this object, so we keep this field around until
-    /// GetAndClearLocalBorrowersInternal is called on the outer ID. This field
-    /// is updated in 2 cases:
-    ///  1. We deserialize an ID that we do not own and that was stored in
-    ///     another object that we do not own.
-    ///  2. Case (1) occurred for a task that we submitted and we also do not
-    ///     own the inner or outer object. Then, we need to notify our caller
-    ///     that the task we submitted is a borrower for the inner ID.
-    /// This field is reset to null once GetAndClearLocalBorrowersInternal is
-    /// called on contained_in_borrowed_id. For each borrower, this field is
-    /// set at most once during the reference's lifetime. If the object ID is
-    /// later found to be nested in a second object, we do not need to remember
-    /// the second ID because we will already have notified the owner of the
-    /// first outer object about our reference.
-    absl::optional<ObjectID> contained_in_borrowed_id;
-    /// The object IDs contained in this object. These could be objects that we
-    /// own or are borrowing. This field is updated in 2 cases:
-    ///  1. We call ray.put() on this ID and store the contained IDs.
-    ///  2. We call ray.get() on an ID whose contents we do not know and we
-    ///     discover that it contains these IDs.
-    absl::flat_hash_set<ObjectID> contains;
-    /// A list of processes that are we gave a reference to that are still
-    /// borrowing the ID. This field is updated in 2 cases:
-    ///  1. If we are a borrower of the ID, then we add a process to this list
-    ///     if we passed that process a copy of the ID via task submission and
-    ///     the process is still using the ID by the time it finishes its task.
-    ///     Borrowers are removed from the list when we recursively merge our
-    ///     list into the owner.
-    ///  2. If we are the owner of the ID, then either the above case, or when
-    ///     we hear from a borrower that it has passed the ID to other
-    ///     borrowers. A borrower is removed from the list when it responds
-    ///     that it is no longer using the reference.
-    absl::flat_hash_set<rpc::WorkerAddress> borrowers;
-    /// When a process that is borrowing an object ID stores the ID inside the
-    /// return value of a task that it executes, the caller of the task is also
-    /// considered a borrower for as long as its reference to the task's return
-    /// ID stays in scope. Thus, the borrower must notify the owner that the
-    /// task's caller is also a borrower. The key is the task's return ID, and
-    /// the value is the task ID and address of the task's caller.
-    absl::flat_hash_map<ObjectID, rpc::WorkerAddress> stored_in_objects;
     /// The number of tasks that depend on this object that may be retried in
     /// the future (pending execution or finished but retryable). If the object
     /// is inlined (not stored in plasma), then its lineage ref count is 0
     /// because any dependent task will already have the value of the object.
     size_t lineage_ref_count = 0;
+    /// Whether we own the object. If we own the object, then we are
+    /// responsible for tracking the state of the task that creates the object
+    /// (see task_manager.h).
+    bool owned_by_us = false;
+    // Whether this object can be reconstructed via lineage. If false, then the
+    // object's value will be pinned as long as it is referenced by any other
+    // object's lineage.
+    const bool is_reconstructable = false;
     /// Whether this object has been spilled to external storage.
     bool spilled = false;
-    /// For objects that have been spilled to external storage, the URL from which
-    /// they can be retrieved.
-    std::string spilled_url = "";
-    /// The ID of the node that spilled the object.
-    /// This will be Nil if the object has not been spilled or if it is spilled
-    /// distributed external storage.
-    NodeID spilled_node_id = NodeID::Nil();
-    /// Location subscription callbacks registered by async location get requests.
-    /// These will be invoked whenever locations or object_size are changed.
-    std::vector<LocationSubscriptionCallback> location_subscription_callbacks;
-    /// Callback that will be called when this ObjectID no longer has
-    /// references.
-    std::function<void(const ObjectID &)> on_delete;
-    /// Callback that is called when this process is no longer a borrower
-    /// (RefCount() == 0).
-    std::function<void(const ObjectID &)> on_ref_removed;
+    /// Fields that most references don't use. Access these through nested(),
+    /// borrow(), spill() and callbacks() and their mutable_ counterparts.
+    OutOfLine<NestedReferenceCount> nested_reference_count;
+    OutOfLine<BorrowInfo> borrow_info;
+    OutOfLine<SpillInfo> spill_info;
+    OutOfLine<Callbacks> callbacks_info;
   };
 
   using ReferenceTable = absl::flat_hash_map<ObjectID, Reference>;
 
+  /// The table of all references tracked by this process, split into shards
+  /// by ObjectID hash. Each shard has its own lock, which lets the hot
+  /// reference count updates for different objects run in parallel. The
+  /// locking protocol is:
+  /// - Operations that only change the counts of one object without letting
+  ///   it go out of scope hold mutex_ in shared mode plus the lock of the
+  ///   object's shard, and only touch that shard's map.
+  /// - All other operations hold mutex_ exclusively. This excludes every
+  ///   shared holder, so they can use the table like a single map without
+  ///   taking any shard locks, including when following nested or borrowed
+  ///   IDs to other shards.
+  class ShardedReferenceTable {
+   public:
+    static constexpr size_t kNumShards = 32;
+
+    /// Aligned to a cache line so that threads working on different shards
+    /// don't contend on the same line.
+    struct alignas(64) Shard {
+      absl::Mutex mutex;
+      ReferenceTable refs;
+    };
+    using Shards = std::array<Shard, kNumShards>;
+
+    /// Forward iterator over the entries of all shards.
+    template <bool kConst>
+    class Iterator {
+     public:
+      using ShardsPtr = typename std::conditional<kConst, const Shards *, Shards *>::type;
+      using InnerIterator =
+          typename std::conditional<kConst, ReferenceTable::const_iterator,
+                                    ReferenceTable::iterator>::type;
+      using value_type = ReferenceTable::value_type;
+      using reference = decltype(*std::declval<InnerIterator>());
+      using pointer = decltype(&*std::declval<InnerIterator>());
+
+      /// Construct the end iterator.
+      Iterator() : shards_(nullptr), shard_(kNumShards) {}
+
+      Iterator(ShardsPtr shards, size_t shard, InnerIterator it)
+          : shards_(shards), shard_(shard), it_(it) {
+        SkipEmptyShards();
+      }
+
+      /// Iterators of a mutable table convert to const iterators.
+      template <bool kOtherConst,
+                typename = typename std::enable_if<kConst && !kOtherConst>::type>
+      Iterator(const Iterator<kOtherConst> &other)
+          : shards_(other.shards_), shard_(other.shard_), it_(other.it_) {}
+
+      reference operator*() const { return *it_; }
+      pointer operator->() const { return &*it_; }
+
+      Iterator &operator++() {
+        ++it_;
+        SkipEmptyShards();
+        return *this;
+      }
+
+      Iterator operator++(int) {
+        Iterator copy = *this;
+        ++*this;
+        return copy;
+      }
+
+      bool operator==(const Iterator &other) const {
+        return shard_ == other.shard_ && (shard_ == kNumShards || it_ == other.it_);
+      }
+      bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+     private:
+      template <bool kOtherConst>
+      friend class Iterator;
+      friend class ShardedReferenceTable;
+
+      void SkipEmptyShards() {
+        while (shard_ < kNumShards && it_ == (*shards_)[shard_].refs.end()) {
+          if (++shard_ < kNumShards) {
+            it_ = (*shards_)[shard_].refs.begin();
+          }
+        }
+      }
+
+      ShardsPtr shards_;
+      size_t shard_;
+      InnerIterator it_;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    static size_t ShardIndex(const ObjectID &object_id) {
+      return object_id.Hash() % kNumShards;
+    }
+
+    Shard &GetShard(const ObjectID &object_id) {
+      return shards_[ShardIndex(object_id)];
+    }
+
+    iterator begin() { return iterator(&shards_, 0, shards_[0].refs.begin()); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const {
+      return const_iterator(&shards_, 0, shards_[0].refs.begin());
+    }
+    const_iterator end() const { return const_iterator(); }
+
+    iterator find(const ObjectID &object_id) {
+      const size_t shard = ShardIndex(object_id);
+      auto it = shards_[shard].refs.find(object_id);
+      return it == shards_[shard].refs.end() ? end() : iterator(&shards_, shard, it);
+    }
+
+    const_iterator find(const ObjectID &object_id) const {
+      const size_t shard = ShardIndex(object_id);
+      auto it = shards_[shard].refs.find(object_id);
+      return it == shards_[shard].refs.end() ? end()
+                                             : const_iterator(&shards_, shard, it);
+    }
+
+    size_t count(const ObjectID &object_id) const {
+      return shards_[ShardIndex(object_id)].refs.count(object_id);
+    }
+
+    std::pair<iterator, bool> emplace(const ObjectID &object_id, Reference &&reference) {
+      const size_t shard = ShardIndex(object_id);
+      auto result = shards_[shard].refs.emplace(object_id, std::move(reference));
+      return {iterator(&shards_, shard, result.first), result.second};
+    }
+
+    void erase(iterator it) { shards_[it.shard_].refs.erase(it.it_); }
+
+    size_t size() const {
+      size_t size = 0;
+      for (const auto &shard : shards_) {
+        size += shard.refs.size();
+      }
+      return size;
+    }
+
+    bool empty() const { return size() == 0; }
+
+   private:
+    Shards shards_;
+  };
+
+  /// Fast path of AddLocalReference. Must hold mutex_ in shared mode.
+  void AddLocalReferenceInShard(const ObjectID &object_id, const std::string &call_site)
+      SHARED_LOCKS_REQUIRED(mutex_);
+
+  /// Fast path of RemoveLocalReference. Must hold mutex_ in shared mode.
+  ///
+  /// \return False if the reference may go out of scope, in which case nothing
+  /// was changed and the caller must retry with mutex_ held exclusively.
+  bool TryRemoveLocalReferenceInShard(const ObjectID &object_id)
+      SHARED_LOCKS_REQUIRED(mutex_);
+
+  /// Fast path of UpdateSubmittedTaskReferences for the arguments to add.
+  /// Must hold mutex_ in shared mode.
+  void AddSubmittedTaskReferencesInShards(const std::vector<ObjectID> &argument_ids)
+      SHARED_LOCKS_REQUIRED(mutex_);
+
+  /// Fast path of RemoveSubmittedTaskReferences. Must hold mutex_ in shared
+  /// mode. Decrements the references of the arguments in order, until one
+  /// of them may go out of scope.
+  ///
+  /// \return The number of arguments whose references were removed. The
+  /// caller must remove the references of the remaining arguments with mutex_
+  /// held exclusively.
+  size_t TryRemoveSubmittedTaskReferencesInShards(
+      const std::vector<ObjectID> &argument_ids, bool release_lineage)
+      SHARED_LOCKS_REQUIRED(mutex_);
+
   bool GetOwnerInternal(const ObjectID &object_id,
                         rpc::Address *owner_address = nullptr) const
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   /// Release the pinned plasma object, if any. Also unsets the raylet address
   /// that the object was pinned at, if the address was set.
-  void ReleasePlasmaObject(ReferenceTable::iterator it);
+  void ReleasePlasmaObject(ShardedReferenceTable::iterator it);
 
   /// Shutdown if all references have gone out of scope and shutdown
   /// is scheduled.
@@ -723,11 +1043,16 @@ class ReferenceCounter : public ReferenceCounterInterface,
   /// ID. This is used in cases where we return an object ID that we own inside
   /// an object that we do not own. Then, we must notify the owner of the outer
   /// object that they are borrowing the inner.
-  void WaitForRefRemoved(const ReferenceTable::iterator &reference_it,
+  void WaitForRefRemoved(const ShardedReferenceTable::iterator &reference_it,
                          const rpc::WorkerAddress &addr,
                          const ObjectID &contained_in_id = ObjectID::Nil())
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  /// Return a copy of the owner address of an owned object that can be shared with the
+  /// other owned objects.
+  std::shared_ptr<const rpc::Address> SharedOwnerAddress(
+      const rpc::Address &owner_address) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   /// Helper method to add an object that we are borrowing. This is used when
   /// deserializing IDs from a task's arguments, or when deserializing an ID
   /// during ray.get().
@@ -738,7 +1063,7 @@ class ReferenceCounter : public ReferenceCounterInterface,
   /// Helper method to delete an entry from the reference map and run any necessary
   /// callbacks. Assumes that the entry is in object_id_refs_ and invalidates the
   /// iterator.
-  void DeleteReferenceInternal(ReferenceTable::iterator entry,
+  void DeleteReferenceInternal(ShardedReferenceTable::iterator entry,
                                std::vector<ObjectID> *deleted)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -751,15 +1076,15 @@ class ReferenceCounter : public ReferenceCounterInterface,
   ///
   /// \param[in] it The reference iterator for the object.
   /// \param[in] node_id The new object location to be added.
-  void AddObjectLocationInternal(ReferenceTable::iterator it, const NodeID &node_id)
-      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void AddObjectLocationInternal(ShardedReferenceTable::iterator it,
+                                 const NodeID &node_id) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   /// Pushes location updates to subscribers of a particular reference, invoking all
   /// callbacks registered for the reference by GetLocationsAsync calls. This method
   /// also increments the reference's location version counter.
   ///
   /// \param[in] it The reference iterator for the object.
-  void PushToLocationSubscribers(ReferenceTable::iterator it)
+  void PushToLocationSubscribers(ShardedReferenceTable::iterator it)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   /// Clean up borrowers and references when the reference is removed from borrowers.
@@ -773,6 +1098,10 @@ class ReferenceCounter : public ReferenceCounterInterface,
   /// object's owner.
   rpc::WorkerAddress rpc_address_;
 
+  /// The owner address of the last owned object that was added. See
+  /// SharedOwnerAddress().
+  std::shared_ptr<const rpc::Address> owner_address_ GUARDED_BY(mutex_);
+
   /// Feature flag for lineage pinning. If this is false, then we will keep the
   /// lineage ref count, but this will not be used to decide when the object's
   /// Reference can be deleted. The object's lineage ref count is the number of
@@ -787,11 +1116,12 @@ class ReferenceCounter : public ReferenceCounterInterface,
   /// borrower's ref count for the ID goes to 0.
   rpc::CoreWorkerClientPool borrower_pool_;
 
-  /// Protects access to the reference counting state.
+  /// Protects access to the reference counting state. See ShardedReferenceTable
+  /// for when this may be held in shared mode.
   mutable absl::Mutex mutex_;
 
   /// Holds all reference counts and dependency information for tracked ObjectIDs.
-  ReferenceTable object_id_refs_ GUARDED_BY(mutex_);
+  ShardedReferenceTable object_id_refs_ GUARDED_BY(mutex_);
 
   /// Objects whose values have been freed by the language frontend.
   /// The values in plasma will not be pinned. An object ID is
@@ -14,6 +14,7 @@
 
 #include "ray/core_worker/reference_count.h"
 
+#include <thread>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -579,6 +580,9 @@ TEST_F(ReferenceCountTest, TestOwnerAddress) {
   rc->AddOwnedObject(object_id2, {}, address, "", 0, false);
   ASSERT_TRUE(rc->GetOwner(object_id2, &added_address));
   ASSERT_EQ(address.ip_address(), added_address.ip_address());
+  // Objects that were added with the previous address keep it.
+  ASSERT_TRUE(rc->GetOwner(object_id, &added_address));
+  ASSERT_EQ(added_address.ip_address(), "1234");
 
   auto object_id3 = ObjectID::FromRandom();
   ASSERT_FALSE(rc->GetOwner(object_id3, &added_address));
@@ -586,6 +590,224 @@ TEST_F(ReferenceCountTest, TestOwnerAddress) {
   ASSERT_FALSE(rc->GetOwner(object_id3, &added_address));
 }
 
+// Tests that removing references for several task arguments at once deletes
+// only the arguments that went out of scope, when some of them can be removed
+// without going through the exclusive lock and some cannot.
+TEST_F(ReferenceCountTest, TestPartialFastPathRemoval) {
+  std::vector<ObjectID> out;
+  ObjectID id1 = ObjectID::FromRandom();
+  ObjectID id2 = ObjectID::FromRandom();
+  ObjectID id3 = ObjectID::FromRandom();
+
+  rc->AddLocalReference(id1, "");
+  rc->AddLocalReference(id3, "");
+  rc->UpdateSubmittedTaskReferences({id1, id2, id3});
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 3);
+  rc->UpdateFinishedTaskReferences({id1, id2, id3}, false, empty_borrower, empty_refs,
+                                   &out);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 2);
+  ASSERT_EQ(out, std::vector<ObjectID>({id2}));
+  ASSERT_TRUE(rc->HasReference(id1));
+  ASSERT_TRUE(rc->HasReference(id3));
+
+  rc->RemoveLocalReference(id1, &out);
+  rc->RemoveLocalReference(id3, &out);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 0);
+  ASSERT_EQ(out.size(), 3);
+}
+
+// Tests that the spill location, which is stored out of line, is reported to
+// location subscribers.
+TEST_F(ReferenceCountTest, TestSpilledLocationSubscription) {
+  ObjectID id = ObjectID::FromRandom();
+  rc->AddOwnedObject(id, {}, rpc::Address(), "", 0, false);
+  rc->AddLocalReference(id, "");
+
+  std::string spilled_url;
+  NodeID spilled_node_id;
+  int64_t version = -1;
+  auto callback = [&](const absl::flat_hash_set<NodeID> &, int64_t,
+                      const std::string &url, const NodeID &node_id,
+                      int64_t current_version, const absl::optional<NodeID> &) {
+    spilled_url = url;
+    spilled_node_id = node_id;
+    version = current_version;
+  };
+  ASSERT_TRUE(rc->SubscribeObjectLocations(id, version, callback).ok());
+  ASSERT_EQ(version, 0);
+  ASSERT_TRUE(spilled_url.empty());
+  ASSERT_TRUE(spilled_node_id.IsNil());
+
+  ASSERT_TRUE(rc->SubscribeObjectLocations(id, version, callback).ok());
+  NodeID node_id = NodeID::FromRandom();
+  ASSERT_TRUE(rc->HandleObjectSpilled(id, "s3://bucket/object", node_id, 100, false));
+  ASSERT_EQ(version, 1);
+  ASSERT_EQ(spilled_url, "s3://bucket/object");
+  ASSERT_EQ(spilled_node_id, node_id);
+
+  std::vector<ObjectID> out;
+  rc->RemoveLocalReference(id, &out);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 0);
+}
+
+// Tests that an object's locations are kept without duplicates, and that
+// subscribers are only notified when they change.
+TEST_F(ReferenceCountTest, TestObjectLocations) {
+  ObjectID id = ObjectID::FromRandom();
+  NodeID node1 = NodeID::FromRandom();
+  NodeID node2 = NodeID::FromRandom();
+  rc->AddOwnedObject(id, {}, rpc::Address(), "", 0, false, node1);
+  rc->AddLocalReference(id, "");
+
+  absl::flat_hash_set<NodeID> locations;
+  int64_t version = 0;
+  auto callback = [&](const absl::flat_hash_set<NodeID> &node_ids, int64_t,
+                      const std::string &, const NodeID &, int64_t current_version,
+                      const absl::optional<NodeID> &) {
+    locations = node_ids;
+    version = current_version;
+  };
+  // The pinned location is added with the object.
+  ASSERT_EQ(*rc->GetObjectLocations(id), absl::flat_hash_set<NodeID>({node1}));
+  ASSERT_TRUE(rc->SubscribeObjectLocations(id, version, callback).ok());
+  ASSERT_EQ(version, 1);
+
+  // Adding a known location does not notify the subscribers.
+  ASSERT_TRUE(rc->SubscribeObjectLocations(id, version, callback).ok());
+  ASSERT_TRUE(rc->AddObjectLocation(id, node1));
+  ASSERT_EQ(version, 1);
+  ASSERT_TRUE(rc->AddObjectLocation(id, node2));
+  ASSERT_EQ(version, 2);
+  ASSERT_EQ(locations, absl::flat_hash_set<NodeID>({node1, node2}));
+
+  ASSERT_TRUE(rc->SubscribeObjectLocations(id, version, callback).ok());
+  ASSERT_TRUE(rc->RemoveObjectLocation(id, node1));
+  ASSERT_EQ(version, 3);
+  ASSERT_EQ(locations, absl::flat_hash_set<NodeID>({node2}));
+  ASSERT_EQ(*rc->GetObjectLocations(id), absl::flat_hash_set<NodeID>({node2}));
+
+  std::vector<ObjectID> out;
+  rc->RemoveLocalReference(id, &out);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 0);
+}
+
+// Tests that an object's locations stay correct when it is on more nodes than
+// are kept inline.
+TEST_F(ReferenceCountTest, TestManyObjectLocations) {
+  ObjectID id = ObjectID::FromRandom();
+  rc->AddOwnedObject(id, {}, rpc::Address(), "", 0, false);
+  rc->AddLocalReference(id, "");
+
+  std::vector<NodeID> node_ids;
+  for (int i = 0; i < 10; i++) {
+    node_ids.push_back(NodeID::FromRandom());
+  }
+  for (const auto &node_id : node_ids) {
+    ASSERT_TRUE(rc->AddObjectLocation(id, node_id));
+    ASSERT_TRUE(rc->AddObjectLocation(id, node_id));
+  }
+  ASSERT_EQ(*rc->GetObjectLocations(id),
+            absl::flat_hash_set<NodeID>(node_ids.begin(), node_ids.end()));
+
+  for (int i = 0; i < 9; i++) {
+    ASSERT_TRUE(rc->RemoveObjectLocation(id, node_ids[i]));
+  }
+  ASSERT_EQ(*rc->GetObjectLocations(id), absl::flat_hash_set<NodeID>({node_ids[9]}));
+  ASSERT_TRUE(rc->AddObjectLocation(id, node_ids[0]));
+  ASSERT_EQ(*rc->GetObjectLocations(id),
+            absl::flat_hash_set<NodeID>({node_ids[0], node_ids[9]}));
+
+  std::vector<ObjectID> out;
+  rc->RemoveLocalReference(id, &out);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), 0);
+}
+
+// Tests that concurrent reference updates from many threads on shared and
+// thread-local objects leave consistent counts.
+TEST_F(ReferenceCountTest, TestConcurrentReferenceUpdates) {
+  const int num_threads = 8;
+  const int num_iterations = 1000;
+  std::vector<ObjectID> shared_ids;
+  for (int i = 0; i < 4; i++) {
+    shared_ids.push_back(ObjectID::FromRandom());
+    rc->AddLocalReference(shared_ids.back(), "");
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<std::vector<ObjectID>> deleted(num_threads);
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < num_iterations; i++) {
+        const ObjectID &shared_id = shared_ids[i % shared_ids.size()];
+        ObjectID local_id = ObjectID::FromRandom();
+        rc->AddLocalReference(shared_id, "");
+        rc->AddLocalReference(local_id, "");
+        rc->UpdateSubmittedTaskReferences({shared_id, local_id});
+        rc->UpdateFinishedTaskReferences({shared_id, local_id}, false, empty_borrower,
+                                         empty_refs, &deleted[t]);
+        rc->RemoveLocalReference(local_id, &deleted[t]);
+        rc->RemoveLocalReference(shared_id, &deleted[t]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  size_t num_deleted = 0;
+  for (const auto &ids : deleted) {
+    num_deleted += ids.size();
+  }
+  ASSERT_EQ(num_deleted, num_threads * num_iterations);
+  ASSERT_EQ(rc->NumObjectIDsInScope(), shared_ids.size());
+  auto ref_counts = rc->GetAllReferenceCounts();
+  for (const auto &shared_id : shared_ids) {
+    ASSERT_EQ(ref_counts[shared_id].first, 1);
+    ASSERT_EQ(ref_counts[shared_id].second, 0);
+  }
+}
+
+// Performance benchmark for reference count updates from many threads.
+TEST_F(ReferenceCountTest, TestConcurrentReferenceUpdatesPerf) {
+  const int num_objects_per_thread = 1000;
+  const int num_iterations = 100;
+  for (int num_threads : {1, 2, 4, 8, 16}) {
+    std::vector<std::thread> threads;
+    int64_t start_ms = current_time_ms();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&]() {
+        std::vector<ObjectID> ids;
+        for (int i = 0; i < num_objects_per_thread; i++) {
+          ids.push_back(ObjectID::FromRandom());
+          rc->AddLocalReference(ids.back(), "");
+        }
+        std::vector<ObjectID> deleted;
+        for (int i = 0; i < num_iterations; i++) {
+          for (const auto &id : ids) {
+            rc->AddLocalReference(id, "");
+            rc->UpdateSubmittedTaskReferences({id});
+            rc->UpdateFinishedTaskReferences({id}, false, empty_borrower, empty_refs,
+                                             &deleted);
+            rc->RemoveLocalReference(id, &deleted);
+          }
+        }
+        for (const auto &id : ids) {
+          rc->RemoveLocalReference(id, &deleted);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    const int64_t num_ops = 4LL * num_threads * num_objects_per_thread * num_iterations;
+    const int64_t elapsed_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+    RAY_LOG(INFO) << num_threads << " threads made " << num_ops
+                  << " reference count updates in " << elapsed_ms << " ms, "
+                  << num_ops * 1000 / elapsed_ms << " updates/s";
+    ASSERT_EQ(rc->NumObjectIDsInScope(), 0);
+  }
+}
+
 // Tests that the ref counts are properly integrated into the local
 // object memory store.
 TEST(MemoryStoreIntegrationTest, TestSimple) {
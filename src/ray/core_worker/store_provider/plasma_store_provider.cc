@@ -174,20 +174,7 @@ Status CoreWorkerPlasmaStoreProvider::FetchAndGetFromPlasmaStore(
   for (size_t i = 0; i < plasma_results.size(); i++) {
     if (plasma_results[i].data != nullptr || plasma_results[i].metadata != nullptr) {
       const auto &object_id = batch_ids[i];
-      std::shared_ptr<TrackedBuffer> data = nullptr;
-      std::shared_ptr<Buffer> metadata = nullptr;
-      if (plasma_results[i].data && plasma_results[i].data->Size()) {
-        // We track the set of active data buffers in active_buffers_. On destruction,
-        // the buffer entry will be removed from the set via callback.
-        data = std::make_shared<TrackedBuffer>(plasma_results[i].data, buffer_tracker_,
-                                               object_id);
-        buffer_tracker_->Record(object_id, data.get(), get_current_call_site_());
-      }
-      if (plasma_results[i].metadata && plasma_results[i].metadata->Size()) {
-        metadata = plasma_results[i].metadata;
-      }
-      const auto result_object =
-          std::make_shared<RayObject>(data, metadata, std::vector<ObjectID>());
+      const auto result_object = MakeRayObject(object_id, plasma_results[i]);
       (*results)[object_id] = result_object;
       remaining.erase(object_id);
       if (result_object->IsException()) {
@@ -210,27 +197,51 @@ Status CoreWorkerPlasmaStoreProvider::GetIfLocal(
 
   for (size_t i = 0; i < object_ids.size(); i++) {
     if (plasma_results[i].data != nullptr || plasma_results[i].metadata != nullptr) {
-      const auto &object_id = object_ids[i];
-      std::shared_ptr<TrackedBuffer> data = nullptr;
-      std::shared_ptr<Buffer> metadata = nullptr;
-      if (plasma_results[i].data && plasma_results[i].data->Size()) {
-        // We track the set of active data buffers in active_buffers_. On destruction,
-        // the buffer entry will be removed from the set via callback.
-        data = std::make_shared<TrackedBuffer>(plasma_results[i].data, buffer_tracker_,
-                                               object_id);
-        buffer_tracker_->Record(object_id, data.get(), get_current_call_site_());
-      }
-      if (plasma_results[i].metadata && plasma_results[i].metadata->Size()) {
-        metadata = plasma_results[i].metadata;
-      }
-      const auto result_object =
-          std::make_shared<RayObject>(data, metadata, std::vector<ObjectID>());
-      (*results)[object_id] = result_object;
+      (*results)[object_ids[i]] = MakeRayObject(object_ids[i], plasma_results[i]);
     }
   }
   return Status::OK();
 }
 
+void CoreWorkerPlasmaStoreProvider::GetIfLocalAsync(
+    const ObjectID &object_id, instrumented_io_context &io_service,
+    std::function<void(std::shared_ptr<RayObject>)> callback) {
+  // A timeout of 0 returns right away with whatever is sealed in the local store, and
+  // unlike Get() it does not ask the raylet to pull the object.
+  store_client_.GetAsync(
+      {object_id}, /*timeout_ms=*/0, /*is_from_worker=*/true, io_service,
+      [this, object_id, callback](Status status,
+                                  std::vector<plasma::ObjectBuffer> plasma_results) {
+        if (!status.ok()) {
+          RAY_LOG(DEBUG) << "Failed to get object " << object_id
+                         << " from the local plasma store: " << status.ToString();
+          callback(nullptr);
+        } else if (plasma_results[0].data == nullptr &&
+                   plasma_results[0].metadata == nullptr) {
+          callback(nullptr);
+        } else {
+          callback(MakeRayObject(object_id, plasma_results[0]));
+        }
+      });
+}
+
+std::shared_ptr<RayObject> CoreWorkerPlasmaStoreProvider::MakeRayObject(
+    const ObjectID &object_id, const plasma::ObjectBuffer &plasma_result) {
+  std::shared_ptr<TrackedBuffer> data = nullptr;
+  std::shared_ptr<Buffer> metadata = nullptr;
+  if (plasma_result.data && plasma_result.data->Size()) {
+    // We track the set of active data buffers in active_buffers_. On destruction,
+    // the buffer entry will be removed from the set via callback.
+    data =
+        std::make_shared<TrackedBuffer>(plasma_result.data, buffer_tracker_, object_id);
+    buffer_tracker_->Record(object_id, data.get(), get_current_call_site_());
+  }
+  if (plasma_result.metadata && plasma_result.metadata->Size()) {
+    metadata = plasma_result.metadata;
+  }
+  return std::make_shared<RayObject>(data, metadata, std::vector<ObjectID>());
+}
+
 Status UnblockIfNeeded(const std::shared_ptr<raylet::RayletClient> &client,
                        const WorkerContext &ctx) {
   if (ctx.CurrentTaskIsDirectCall()) {
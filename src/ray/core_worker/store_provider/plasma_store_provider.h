@@ -16,6 +16,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "ray/common/asio/instrumented_io_context.h"
 #include "ray/common/buffer.h"
 #include "ray/common/id.h"
 #include "ray/common/status.h"
@@ -155,6 +156,16 @@ class CoreWorkerPlasmaStoreProvider {
   Status GetIfLocal(const std::vector<ObjectID> &ids,
                     absl::flat_hash_map<ObjectID, std::shared_ptr<RayObject>> *results);
 
+  /// Get an object from the local plasma store without blocking the calling thread.
+  /// Like GetIfLocal(), this does not fetch the object from another node.
+  ///
+  /// \param[in] object_id The ID of the object to get.
+  /// \param[in] io_service The event loop on which to run the callback.
+  /// \param[in] callback Called with the object, or with nullptr if it was not in the
+  /// local store or the request to the store failed.
+  void GetIfLocalAsync(const ObjectID &object_id, instrumented_io_context &io_service,
+                       std::function<void(std::shared_ptr<RayObject>)> callback);
+
   Status Contains(const ObjectID &object_id, bool *has_object);
 
   Status Wait(const absl::flat_hash_set<ObjectID> &object_ids, int num_objects,
@@ -195,6 +206,10 @@ class CoreWorkerPlasmaStoreProvider {
       absl::flat_hash_map<ObjectID, std::shared_ptr<RayObject>> *results,
       bool *got_exception);
 
+  /// Wrap an object that was read from the plasma store, tracking its data buffer.
+  std::shared_ptr<RayObject> MakeRayObject(const ObjectID &object_id,
+                                           const plasma::ObjectBuffer &plasma_result);
+
   /// Print a warning if we've attempted too many times, but some objects are still
   /// unavailable. Only the keys in the 'remaining' map are used.
   ///
@@ -66,12 +66,19 @@ class MockWorkerClient : public rpc::CoreWorkerClientInterface {
     callbacks.push_back(callback);
   }
 
-  bool ReplyPushTask(Status status = Status::OK(), size_t index = 0) {
+  void PushActorTasks(std::vector<rpc::PushTaskRequestAndCallback> requests,
+                      size_t max_batch_size) override {
+    batch_sizes.push_back(requests.size());
+    CoreWorkerClientInterface::PushActorTasks(std::move(requests), max_batch_size);
+  }
+
+  bool ReplyPushTask(Status status = Status::OK(), size_t index = 0,
+                     const rpc::PushTaskReply &reply = rpc::PushTaskReply()) {
     if (callbacks.size() == 0) {
       return false;
     }
     auto callback = callbacks.at(index);
-    callback(status, rpc::PushTaskReply());
+    callback(status, reply);
     callbacks.erase(callbacks.begin() + index);
     return true;
   }
@@ -79,6 +86,7 @@ class MockWorkerClient : public rpc::CoreWorkerClientInterface {
   rpc::Address addr;
   std::vector<rpc::ClientCallback<rpc::PushTaskReply>> callbacks;
   std::vector<uint64_t> received_seq_nos;
+  std::vector<size_t> batch_sizes;
 };
 
 class MockTaskFinisher : public TaskFinisherInterface {
@@ -159,6 +167,88 @@ TEST_F(DirectActorSubmitterTest, TestSubmitTask) {
   ASSERT_THAT(worker_client_->received_seq_nos, ElementsAre(0, 1));
 }
 
+TEST_F(DirectActorSubmitterTest, TestBackpressureFromActorQueue) {
+  CoreWorkerDirectActorTaskSubmitter submitter(
+      std::make_shared<rpc::CoreWorkerClientPool>(
+          [&](const rpc::Address &addr) { return worker_client_; }),
+      store_, task_finisher_, /*max_tasks_queued_per_caller=*/2);
+  rpc::Address addr;
+  auto worker_id = WorkerID::FromRandom();
+  addr.set_worker_id(worker_id.Binary());
+  ActorID actor_id = ActorID::Of(JobID::FromInt(0), TaskID::Nil(), 0);
+  submitter.AddActorQueueIfNotExists(actor_id);
+  submitter.ConnectActor(actor_id, addr, 0);
+  EXPECT_CALL(*task_finisher_, CompletePendingTask(TaskID::Nil(), _, _)).Times(3);
+
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 0)).ok());
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 1)).ok());
+  ASSERT_EQ(worker_client_->callbacks.size(), 2);
+
+  // The actor reports that two of our tasks are still queued, so the next task
+  // is held back while a reply is outstanding.
+  rpc::PushTaskReply reply;
+  reply.set_num_queued_caller_tasks(2);
+  ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, reply));
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 2)).ok());
+  ASSERT_EQ(worker_client_->callbacks.size(), 1);
+  ASSERT_THAT(worker_client_->received_seq_nos, ElementsAre(0, 1));
+
+  // Once the actor has drained its queue, the held task is sent.
+  reply.set_num_queued_caller_tasks(0);
+  ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, reply));
+  ASSERT_EQ(worker_client_->callbacks.size(), 1);
+  ASSERT_THAT(worker_client_->received_seq_nos, ElementsAre(0, 1, 2));
+  ASSERT_TRUE(worker_client_->ReplyPushTask());
+}
+
+TEST_F(DirectActorSubmitterTest, TestBatchedSubmission) {
+  CoreWorkerDirectActorTaskSubmitter submitter(
+      std::make_shared<rpc::CoreWorkerClientPool>(
+          [&](const rpc::Address &addr) { return worker_client_; }),
+      store_, task_finisher_, /*max_tasks_queued_per_caller=*/0,
+      /*max_task_batch_size=*/2);
+  rpc::Address addr;
+  auto worker_id = WorkerID::FromRandom();
+  addr.set_worker_id(worker_id.Binary());
+  ActorID actor_id = ActorID::Of(JobID::FromInt(0), TaskID::Nil(), 0);
+  submitter.AddActorQueueIfNotExists(actor_id);
+  EXPECT_CALL(*task_finisher_, CompletePendingTask(TaskID::Nil(), _, _)).Times(8);
+  rpc::PushTaskReply sequential_reply;
+  sequential_reply.set_runs_tasks_sequentially(true);
+
+  // Until the actor reports that it runs one task at a time, tasks are sent one by
+  // one, even if they are ready together.
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 0)).ok());
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 1)).ok());
+  submitter.ConnectActor(actor_id, addr, 0);
+  ASSERT_TRUE(worker_client_->batch_sizes.empty());
+  ASSERT_EQ(worker_client_->callbacks.size(), 2);
+  while (!worker_client_->callbacks.empty()) {
+    ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, sequential_reply));
+  }
+
+  // Once a full batch is in flight, new tasks accumulate.
+  for (int i = 2; i < 7; i++) {
+    ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, i)).ok());
+  }
+  ASSERT_THAT(worker_client_->batch_sizes, ElementsAre(1, 1));
+
+  // The first reply releases all accumulated tasks together.
+  ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, sequential_reply));
+  ASSERT_THAT(worker_client_->batch_sizes, ElementsAre(1, 1, 3));
+
+  // Below the batch size, tasks are sent right away.
+  while (worker_client_->callbacks.size() > 1) {
+    ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, sequential_reply));
+  }
+  ASSERT_TRUE(submitter.SubmitTask(CreateActorTaskHelper(actor_id, worker_id, 7)).ok());
+  ASSERT_THAT(worker_client_->batch_sizes, ElementsAre(1, 1, 3, 1));
+  ASSERT_THAT(worker_client_->received_seq_nos, ElementsAre(0, 1, 2, 3, 4, 5, 6, 7));
+  while (!worker_client_->callbacks.empty()) {
+    ASSERT_TRUE(worker_client_->ReplyPushTask(Status::OK(), 0, sequential_reply));
+  }
+}
+
 TEST_F(DirectActorSubmitterTest, TestDependencies) {
   rpc::Address addr;
   auto worker_id = WorkerID::FromRandom();
@@ -612,6 +702,183 @@ TEST_F(DirectActorReceiverTest, TestNewTaskFromDifferentWorker) {
   StopIOService();
 }
 
+/// Stands in for the gRPC transport in the throughput benchmark below. Each call hands
+/// its tasks to a local receiver on the receiver's io service, and replies once all of
+/// them have finished, like CoreWorker::HandlePushTasks.
+class LoopbackWorkerClient : public rpc::CoreWorkerClientInterface {
+ public:
+  LoopbackWorkerClient(instrumented_io_context &io_service,
+                       CoreWorkerDirectTaskReceiver &receiver)
+      : io_service_(io_service), receiver_(receiver) {}
+
+  void PushActorTask(std::unique_ptr<rpc::PushTaskRequest> request, bool skip_queue,
+                     const rpc::ClientCallback<rpc::PushTaskReply> &callback) override {
+    auto batch = std::make_shared<std::vector<rpc::PushTaskRequestAndCallback>>();
+    batch->emplace_back(std::move(request), callback);
+    Send(batch);
+  }
+
+  void PushActorTasks(std::vector<rpc::PushTaskRequestAndCallback> requests,
+                      size_t max_batch_size) override {
+    auto batch = std::make_shared<std::vector<rpc::PushTaskRequestAndCallback>>();
+    for (auto &request : requests) {
+      batch->push_back(std::move(request));
+      if (batch->size() == max_batch_size) {
+        Send(batch);
+        batch = std::make_shared<std::vector<rpc::PushTaskRequestAndCallback>>();
+      }
+    }
+    if (!batch->empty()) {
+      Send(batch);
+    }
+  }
+
+  std::atomic<int64_t> num_rpcs{0};
+
+ private:
+  void Send(std::shared_ptr<std::vector<rpc::PushTaskRequestAndCallback>> batch) {
+    num_rpcs++;
+    io_service_.post(
+        [this, batch]() {
+          auto replies = std::make_shared<std::vector<rpc::PushTaskReply>>(batch->size());
+          auto statuses = std::make_shared<std::vector<Status>>(batch->size());
+          auto num_remaining = std::make_shared<size_t>(batch->size());
+          for (size_t i = 0; i < batch->size(); i++) {
+            auto &request = *(*batch)[i].first;
+            request.set_client_processed_up_to(-1);
+            receiver_.HandleTask(
+                request, &(*replies)[i],
+                [batch, replies, statuses, num_remaining, i](
+                    Status status, std::function<void()> success,
+                    std::function<void()> failure) {
+                  (*statuses)[i] = status;
+                  if (--*num_remaining > 0) {
+                    return;
+                  }
+                  for (size_t j = 0; j < batch->size(); j++) {
+                    (*batch)[j].second((*statuses)[j], (*replies)[j]);
+                  }
+                });
+          }
+        },
+        "LoopbackWorkerClient.Send");
+  }
+
+  instrumented_io_context &io_service_;
+  CoreWorkerDirectTaskReceiver &receiver_;
+};
+
+class CountingTaskFinisher : public TaskFinisherInterface {
+ public:
+  void CompletePendingTask(const TaskID &task_id, const rpc::PushTaskReply &reply,
+                           const rpc::Address &actor_addr) override {
+    num_completed++;
+  }
+
+  bool PendingTaskFailed(const TaskID &task_id, rpc::ErrorType error_type,
+                         Status *status,
+                         const std::shared_ptr<rpc::RayException> &creation_task_exception,
+                         bool immediately_mark_object_fail) override {
+    RAY_LOG(FATAL) << "Task failed: " << status->ToString();
+    return false;
+  }
+
+  void OnTaskDependenciesInlined(const std::vector<ObjectID> &inlined_dependency_ids,
+                                 const std::vector<ObjectID> &contained_ids) override {}
+
+  bool MarkTaskCanceled(const TaskID &task_id) override { return false; }
+
+  void MarkPendingTaskFailed(
+      const TaskID &task_id, const TaskSpecification &spec, rpc::ErrorType error_type,
+      const std::shared_ptr<rpc::RayException> &creation_task_exception) override {}
+
+  absl::optional<TaskSpecification> GetTaskSpec(const TaskID &task_id) const override {
+    return absl::nullopt;
+  }
+
+  std::atomic<int64_t> num_completed{0};
+};
+
+/// Submit tasks from num_callers callers, each on its own thread, to one actor and
+/// log the throughput. The RPC layer is replaced by LoopbackWorkerClient, so this
+/// measures the submitter and receiver overhead and counts the RPCs that would be
+/// sent.
+void TestActorCallThroughput(int num_callers, uint32_t batch_size) {
+  const int num_tasks = 20000;
+  instrumented_io_context io_service;
+  MockWorkerContext worker_context(WorkerType::WORKER, JobID::FromInt(0));
+  auto receiver = std::make_unique<CoreWorkerDirectTaskReceiver>(
+      worker_context, io_service,
+      [](const TaskSpecification &task_spec,
+         const std::shared_ptr<ResourceMappingType> &resource_ids,
+         std::vector<std::shared_ptr<RayObject>> *return_objects,
+         ReferenceCounter::ReferenceTableProto *borrowed_refs) { return Status::OK(); },
+      [] { return Status::OK(); });
+  auto client = std::make_shared<LoopbackWorkerClient>(io_service, *receiver);
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [client](const rpc::Address &addr) { return client; });
+  receiver->Init(client_pool, rpc::Address(), std::make_shared<MockDependencyWaiter>());
+  std::unique_ptr<boost::asio::io_service::work> work(
+      new boost::asio::io_service::work(io_service));
+  std::thread io_thread([&io_service]() { io_service.run(); });
+
+  rpc::Address actor_addr;
+  actor_addr.set_worker_id(WorkerID::FromRandom().Binary());
+  ActorID actor_id = ActorID::Of(JobID::FromInt(0), TaskID::Nil(), 0);
+  auto task_finisher = std::make_shared<CountingTaskFinisher>();
+  std::vector<std::unique_ptr<CoreWorkerDirectActorTaskSubmitter>> submitters;
+  for (int i = 0; i < num_callers; i++) {
+    submitters.emplace_back(new CoreWorkerDirectActorTaskSubmitter(
+        client_pool, std::make_shared<CoreWorkerMemoryStore>(), task_finisher,
+        /*max_tasks_queued_per_caller=*/0, batch_size));
+    submitters.back()->AddActorQueueIfNotExists(actor_id);
+    submitters.back()->ConnectActor(actor_id, actor_addr, 0);
+  }
+
+  int64_t start_ms = current_time_ms();
+  std::vector<std::thread> callers;
+  for (int i = 0; i < num_callers; i++) {
+    callers.emplace_back([&, i]() {
+      auto caller_worker_id = WorkerID::FromRandom();
+      for (int j = 0; j < num_tasks / num_callers; j++) {
+        RAY_CHECK_OK(submitters[i]->SubmitTask(
+            CreateActorTaskHelper(actor_id, caller_worker_id, j)));
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+  const int64_t total_tasks = (num_tasks / num_callers) * num_callers;
+  while (task_finisher->num_completed < total_tasks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int64_t elapsed_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+  RAY_LOG(INFO) << num_callers << ":1 actor calls with batch size " << batch_size
+                << ": " << total_tasks << " tasks in " << elapsed_ms << " ms ("
+                << total_tasks * 1000 / elapsed_ms << " tasks/s), " << client->num_rpcs
+                << " RPCs";
+
+  // The receiver must be deleted on its io service, before the service stops.
+  io_service.post(
+      [&]() {
+        receiver.reset();
+        io_service.stop();
+      },
+      "TestActorCallThroughput.Stop");
+  io_thread.join();
+}
+
+// Performance benchmark for 1:1 and N:1 actor call throughput, with and without
+// batching.
+TEST(DirectActorTransportPerfTest, TestActorCallThroughputPerf) {
+  for (int num_callers : {1, 8}) {
+    for (uint32_t batch_size : {1, 32}) {
+      TestActorCallThroughput(num_callers, batch_size);
+    }
+  }
+}
+
 }  // namespace ray
 
 int main(int argc, char **argv) {
@@ -64,7 +64,7 @@ class MockWorkerClient : public rpc::CoreWorkerClientInterface {
   }
 
   bool ReplyPushTask(Status status = Status::OK(), bool exit = false,
-                     bool stolen = false) {
+                     bool stolen = false, int64_t execution_time_us = 0) {
     if (callbacks.size() == 0) {
       return false;
     }
@@ -76,6 +76,8 @@ class MockWorkerClient : public rpc::CoreWorkerClientInterface {
     if (stolen) {
       reply.set_task_stolen(true);
     }
+    reply.set_task_execution_time_us(execution_time_us);
+    reply.set_worker_handling_time_us(execution_time_us);
     callback(status, reply);
     callbacks.pop_front();
     return true;
@@ -152,6 +154,18 @@ class MockRayletClient : public WorkerLeaseInterface {
     callbacks.push_back(callback);
   }
 
+  void RequestWorkerLeases(
+      const ray::TaskSpecification &resource_spec, const std::vector<TaskID> &lease_ids,
+      const rpc::ClientCallback<rpc::RequestWorkerLeasesReply> &callback,
+      const int64_t backlog_size, bool gang,
+      const TaskID &gang_reservation_id) override {
+    num_workers_requested += lease_ids.size();
+    num_batched_lease_requests += 1;
+    last_lease_request_gang = gang;
+    last_gang_reservation_id = gang_reservation_id;
+    batch_callbacks.push_back(callback);
+  }
+
   void ReleaseUnusedWorkers(
       const std::vector<WorkerID> &workers_in_use,
       const rpc::ClientCallback<rpc::ReleaseUnusedWorkersReply> &callback) override {}
@@ -194,6 +208,58 @@ class MockRayletClient : public WorkerLeaseInterface {
     }
   }
 
+  // Trigger reply to RequestWorkerLeases. The first num_granted leases are granted
+  // to workers listening on consecutive ports, the rest are canceled.
+  bool GrantWorkerLeases(const std::string &address, int first_port, int num_granted,
+                         int num_canceled) {
+    if (batch_callbacks.empty()) {
+      return false;
+    }
+    rpc::RequestWorkerLeasesReply reply;
+    for (int i = 0; i < num_granted; i++) {
+      auto lease_reply = reply.add_replies();
+      lease_reply->mutable_worker_address()->set_ip_address(address);
+      lease_reply->mutable_worker_address()->set_port(first_port + i);
+      lease_reply->mutable_worker_address()->set_raylet_id(NodeID::Nil().Binary());
+    }
+    for (int i = 0; i < num_canceled; i++) {
+      reply.add_replies()->set_canceled(true);
+    }
+    auto callback = batch_callbacks.front();
+    batch_callbacks.pop_front();
+    callback(Status::OK(), reply);
+    return true;
+  }
+
+  // Trigger reply to a RequestWorkerLeases for a gang. The first num_granted leases are
+  // granted and the rest are spilled back to a raylet that reserved them.
+  bool GrantGangLeases(const std::string &address, int first_port, int num_granted,
+                       int num_spilled, const NodeID &retry_at_raylet_id,
+                       const TaskID &reservation_id) {
+    if (batch_callbacks.empty()) {
+      return false;
+    }
+    rpc::RequestWorkerLeasesReply reply;
+    for (int i = 0; i < num_granted; i++) {
+      auto lease_reply = reply.add_replies();
+      lease_reply->mutable_worker_address()->set_ip_address(address);
+      lease_reply->mutable_worker_address()->set_port(first_port + i);
+      lease_reply->mutable_worker_address()->set_raylet_id(NodeID::Nil().Binary());
+    }
+    for (int i = 0; i < num_spilled; i++) {
+      auto lease_reply = reply.add_replies();
+      lease_reply->mutable_retry_at_raylet_address()->set_ip_address(address);
+      lease_reply->mutable_retry_at_raylet_address()->set_port(first_port + num_granted);
+      lease_reply->mutable_retry_at_raylet_address()->set_raylet_id(
+          retry_at_raylet_id.Binary());
+      lease_reply->set_gang_reservation_id(reservation_id.Binary());
+    }
+    auto callback = batch_callbacks.front();
+    batch_callbacks.pop_front();
+    callback(Status::OK(), reply);
+    return true;
+  }
+
   bool ReplyCancelWorkerLease(bool success = true) {
     rpc::CancelWorkerLeaseReply reply;
     reply.set_success(success);
@@ -213,7 +279,11 @@ class MockRayletClient : public WorkerLeaseInterface {
   int num_workers_returned = 0;
   int num_workers_disconnected = 0;
   int num_leases_canceled = 0;
+  int num_batched_lease_requests = 0;
+  bool last_lease_request_gang = false;
+  TaskID last_gang_reservation_id = TaskID::Nil();
   std::list<rpc::ClientCallback<rpc::RequestWorkerLeaseReply>> callbacks = {};
+  std::list<rpc::ClientCallback<rpc::RequestWorkerLeasesReply>> batch_callbacks = {};
   std::list<rpc::ClientCallback<rpc::CancelWorkerLeaseReply>> cancel_callbacks = {};
 };
 
@@ -1013,6 +1083,13 @@ TEST(DirectTaskTransportTest, TestSchedulingKeys) {
                     BuildTaskSpec(resources1, descriptor2),
                     BuildTaskSpec(resources2, descriptor1));
 
+  // Tasks with different priorities should request different worker leases.
+  RAY_LOG(INFO) << "Test different priorities";
+  TaskSpecification high_priority = BuildTaskSpec(resources1, descriptor1);
+  high_priority.GetMutableMessage().set_priority(1);
+  TestSchedulingKey(store, BuildTaskSpec(resources1, descriptor1),
+                    BuildTaskSpec(resources1, descriptor1), high_priority);
+
   ObjectID direct1 = ObjectID::FromRandom();
   ObjectID direct2 = ObjectID::FromRandom();
   ObjectID plasma1 = ObjectID::FromRandom();
@@ -1057,6 +1134,248 @@ TEST(DirectTaskTransportTest, TestSchedulingKeys) {
   TestSchedulingKey(store, same_deps_1, same_deps_2, different_deps);
 }
 
+TEST(DirectTaskTransportTest, TestRetargetWorkerLease) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      NodeID::Nil(), kLongTimeout, actor_creator, /*max_tasks_in_flight_per_worker=*/1,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/false,
+      /*worker_lease_retargeting_enabled=*/true);
+
+  // Two tasks of the same shape get different scheduling keys because they depend on
+  // different plasma objects.
+  std::string meta = std::to_string(static_cast<int>(rpc::ErrorType::OBJECT_IN_PLASMA));
+  auto metadata = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(meta.data()));
+  auto meta_buffer = std::make_shared<LocalMemoryBuffer>(metadata, meta.size());
+  auto plasma_data = RayObject(nullptr, meta_buffer, std::vector<ObjectID>());
+  ray::FunctionDescriptor descriptor =
+      ray::FunctionDescriptorBuilder::BuildPython("a", "", "", "");
+  std::vector<TaskSpecification> same_shape_tasks;
+  for (int i = 0; i < 2; i++) {
+    ObjectID plasma_id = ObjectID::FromRandom();
+    ASSERT_TRUE(store->Put(plasma_data, plasma_id));
+    TaskSpecification task = BuildTaskSpec({{"a", 1.0}}, descriptor);
+    task.GetMutableMessage().add_args()->mutable_object_ref()->set_object_id(
+        plasma_id.Binary());
+    same_shape_tasks.push_back(task);
+  }
+  TaskSpecification smaller_task = BuildTaskSpec({{"a", 0.5}}, descriptor);
+  ASSERT_TRUE(submitter.SubmitTask(same_shape_tasks[0]).ok());
+  ASSERT_TRUE(submitter.SubmitTask(same_shape_tasks[1]).ok());
+  ASSERT_TRUE(submitter.SubmitTask(smaller_task).ok());
+  ASSERT_EQ(raylet_client->num_workers_requested, 3);
+
+  // The first task is pushed.
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1000, NodeID::Nil()));
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+
+  // Once the first task finishes, the worker is handed over to the second task, which
+  // has the same shape and would be leased from the same node, and the second task's
+  // lease request is canceled.
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(raylet_client->num_workers_returned, 0);
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+  ASSERT_EQ(raylet_client->num_leases_canceled, 1);
+
+  // The smaller task has another shape, so the worker is returned once the second task
+  // finishes.
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(raylet_client->num_workers_returned, 1);
+  ASSERT_EQ(worker_client->callbacks.size(), 0);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 2);
+
+  // The second task's lease request is canceled, and the smaller task gets its own
+  // worker.
+  ASSERT_TRUE(raylet_client->ReplyCancelWorkerLease());
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("nil", 0, NodeID::Nil(), /*cancel=*/true));
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1001, NodeID::Nil()));
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(raylet_client->num_workers_returned, 2);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 3);
+  ASSERT_EQ(task_finisher->num_tasks_failed, 0);
+
+  // Check that there are no entries left in the scheduling_key_entries_ hashmap. These
+  // would otherwise cause a memory leak.
+  ASSERT_TRUE(submitter.CheckNoSchedulingKeyEntriesPublic());
+}
+
+TEST(DirectTaskTransportTest, TestRetargetWorkerLeaseKeepsLocality) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  // The lease policy picks a node other than the one that the workers are leased from.
+  auto node_id = NodeID::FromRandom();
+  auto lease_policy = std::make_shared<MockLeasePolicy>(node_id);
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      node_id, kLongTimeout, actor_creator, /*max_tasks_in_flight_per_worker=*/1,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/false,
+      /*worker_lease_retargeting_enabled=*/true);
+
+  std::string meta = std::to_string(static_cast<int>(rpc::ErrorType::OBJECT_IN_PLASMA));
+  auto metadata = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(meta.data()));
+  auto meta_buffer = std::make_shared<LocalMemoryBuffer>(metadata, meta.size());
+  auto plasma_data = RayObject(nullptr, meta_buffer, std::vector<ObjectID>());
+  ray::FunctionDescriptor descriptor =
+      ray::FunctionDescriptorBuilder::BuildPython("a", "", "", "");
+  for (int i = 0; i < 2; i++) {
+    ObjectID plasma_id = ObjectID::FromRandom();
+    ASSERT_TRUE(store->Put(plasma_data, plasma_id));
+    TaskSpecification task = BuildTaskSpec({{"a", 1.0}}, descriptor);
+    task.GetMutableMessage().add_args()->mutable_object_ref()->set_object_id(
+        plasma_id.Binary());
+    ASSERT_TRUE(submitter.SubmitTask(task).ok());
+  }
+  ASSERT_EQ(raylet_client->num_workers_requested, 2);
+
+  // The second task would be leased from another node, so the worker is returned
+  // instead of being handed over.
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1000, NodeID::Nil()));
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(raylet_client->num_workers_returned, 1);
+  ASSERT_EQ(raylet_client->num_leases_canceled, 0);
+
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1001, NodeID::Nil()));
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(raylet_client->num_workers_returned, 2);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 2);
+  ASSERT_TRUE(submitter.CheckNoSchedulingKeyEntriesPublic());
+}
+
+TEST(DirectTaskTransportTest, TestBatchedWorkerLeases) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      NodeID::Nil(), kLongTimeout, actor_creator, /*max_tasks_in_flight_per_worker=*/1,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/false,
+      /*worker_lease_retargeting_enabled=*/true, /*max_worker_leases_per_request=*/4);
+
+  for (int i = 0; i < 6; i++) {
+    ASSERT_TRUE(submitter.SubmitTask(BuildEmptyTaskSpec()).ok());
+  }
+  // The first lease is requested as soon as the first task is queued.
+  ASSERT_EQ(raylet_client->num_workers_requested, 1);
+  ASSERT_EQ(raylet_client->num_batched_lease_requests, 0);
+
+  // Once the first lease is granted, the leases for the other queued tasks are
+  // requested in one batch, up to the maximum batch size.
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1000, NodeID::Nil()));
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+  ASSERT_EQ(raylet_client->num_workers_requested, 5);
+  ASSERT_EQ(raylet_client->num_batched_lease_requests, 1);
+
+  // The raylet grants part of the batch. The leases that were returned as canceled
+  // are requested again.
+  ASSERT_TRUE(raylet_client->GrantWorkerLeases("localhost", 1001, /*num_granted=*/2,
+                                               /*num_canceled=*/2));
+  ASSERT_EQ(worker_client->callbacks.size(), 3);
+  ASSERT_EQ(raylet_client->num_workers_requested, 8);
+  ASSERT_EQ(raylet_client->num_batched_lease_requests, 2);
+
+  ASSERT_TRUE(raylet_client->GrantWorkerLeases("localhost", 1003, /*num_granted=*/3,
+                                               /*num_canceled=*/0));
+  ASSERT_EQ(worker_client->callbacks.size(), 6);
+  ASSERT_EQ(raylet_client->num_workers_requested, 8);
+  ASSERT_EQ(raylet_client->num_leases_canceled, 0);
+
+  for (int i = 0; i < 6; i++) {
+    ASSERT_TRUE(worker_client->ReplyPushTask());
+  }
+  ASSERT_EQ(raylet_client->num_workers_returned, 6);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 6);
+  ASSERT_EQ(task_finisher->num_tasks_failed, 0);
+  ASSERT_TRUE(submitter.CheckNoSchedulingKeyEntriesPublic());
+}
+
+TEST(DirectTaskTransportTest, TestGangWorkerLeases) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  std::shared_ptr<MockRayletClient> remote_raylet_client;
+  auto lease_client_factory = [&](const std::string &ip, int port) {
+    RAY_CHECK(remote_raylet_client == nullptr);
+    remote_raylet_client = std::make_shared<MockRayletClient>();
+    return remote_raylet_client;
+  };
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, lease_client_factory, lease_policy, store,
+      task_finisher, NodeID::Nil(), kLongTimeout, actor_creator,
+      /*max_tasks_in_flight_per_worker=*/10);
+
+  auto gang_message = BuildEmptyTaskSpec().GetMutableMessage();
+  gang_message.set_gang_id(TaskID::ForFakeTask().Binary());
+  gang_message.set_gang_size(3);
+  TaskSpecification gang_task(gang_message);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(submitter.SubmitTask(gang_task).ok());
+  }
+  // No worker is requested before every task of the gang is queued, and the tasks of a
+  // gang are not pipelined.
+  ASSERT_EQ(raylet_client->num_workers_requested, 0);
+  ASSERT_EQ(submitter.GetMaxTasksInFlightPerWorkerPublic(gang_task), 1);
+
+  // The whole gang is requested at once.
+  ASSERT_TRUE(submitter.SubmitTask(gang_task).ok());
+  ASSERT_EQ(raylet_client->num_workers_requested, 3);
+  ASSERT_EQ(raylet_client->num_batched_lease_requests, 1);
+  ASSERT_TRUE(raylet_client->last_lease_request_gang);
+
+  // Two leases are granted and the third is spilled back to a node that reserved it.
+  // The spilled lease is claimed from that node, and no other lease is requested in
+  // the meantime.
+  auto remote_raylet_id = NodeID::FromRandom();
+  auto reservation_id = TaskID::ForFakeTask();
+  ASSERT_TRUE(raylet_client->GrantGangLeases("localhost", 1000, /*num_granted=*/2,
+                                             /*num_spilled=*/1, remote_raylet_id,
+                                             reservation_id));
+  ASSERT_EQ(worker_client->callbacks.size(), 2);
+  ASSERT_NE(remote_raylet_client, nullptr);
+  ASSERT_EQ(remote_raylet_client->num_workers_requested, 1);
+  ASSERT_EQ(remote_raylet_client->last_gang_reservation_id, reservation_id);
+  ASSERT_FALSE(remote_raylet_client->last_lease_request_gang);
+  ASSERT_EQ(raylet_client->num_workers_requested, 3);
+
+  ASSERT_TRUE(remote_raylet_client->GrantWorkerLeases("localhost", 2000,
+                                                      /*num_granted=*/1,
+                                                      /*num_canceled=*/0));
+  ASSERT_EQ(worker_client->callbacks.size(), 3);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(worker_client->ReplyPushTask());
+  }
+  ASSERT_EQ(raylet_client->num_workers_returned, 2);
+  ASSERT_EQ(remote_raylet_client->num_workers_returned, 1);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 3);
+  ASSERT_TRUE(submitter.CheckNoSchedulingKeyEntriesPublic());
+}
+
 TEST(DirectTaskTransportTest, TestWorkerLeaseTimeout) {
   rpc::Address address;
   auto raylet_client = std::make_shared<MockRayletClient>();
@@ -1984,6 +2303,154 @@ TEST(DirectTaskTransportTest, TestNoWorkerRequestedIfStealingUnavailable) {
   ASSERT_EQ(worker_client->steal_callbacks.size(), 0);
 }
 
+TEST(DirectTaskTransportTest, TestAdaptivePipelineDepth) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+
+  // With adaptive pipelining, max_tasks_in_flight_per_worker is the upper bound of the
+  // pipeline depth.
+  uint32_t max_tasks_in_flight_per_worker = 10;
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      NodeID::Nil(), kLongTimeout, actor_creator, max_tasks_in_flight_per_worker,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/true);
+
+  std::vector<TaskSpecification> tasks;
+  for (int i = 0; i < 20; i++) {
+    tasks.push_back(BuildEmptyTaskSpec());
+  }
+  for (auto task : tasks) {
+    ASSERT_TRUE(submitter.SubmitTask(task).ok());
+  }
+  ASSERT_EQ(raylet_client->num_workers_requested, 1);
+
+  // Before any task has finished, the full pipeline depth is used.
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1000, NodeID::Nil()));
+  ASSERT_EQ(worker_client->callbacks.size(), 10);
+  ASSERT_EQ(submitter.GetMaxTasksInFlightPerWorkerPublic(tasks[0]), 10);
+
+  // A task that runs for much longer than the RPC round trip shrinks the pipeline to a
+  // single task, so no more tasks are pushed until the worker has drained.
+  ASSERT_TRUE(worker_client->ReplyPushTask(Status::OK(), false, false,
+                                           /*execution_time_us=*/10 * 1000 * 1000));
+  ASSERT_EQ(submitter.GetMaxTasksInFlightPerWorkerPublic(tasks[0]), 1);
+  ASSERT_EQ(worker_client->callbacks.size(), 9);
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(worker_client->ReplyPushTask(Status::OK(), false, false,
+                                             /*execution_time_us=*/10 * 1000 * 1000));
+  }
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+  ASSERT_TRUE(worker_client->ReplyPushTask(Status::OK(), false, false,
+                                           /*execution_time_us=*/10 * 1000 * 1000));
+  ASSERT_EQ(worker_client->callbacks.size(), 1);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 10);
+  ASSERT_EQ(task_finisher->num_tasks_failed, 0);
+}
+
+TEST(DirectTaskTransportTest, TestAdaptivePipelineDepthShortTasks) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+
+  uint32_t max_tasks_in_flight_per_worker = 10;
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      NodeID::Nil(), kLongTimeout, actor_creator, max_tasks_in_flight_per_worker,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/true);
+
+  std::vector<TaskSpecification> tasks;
+  for (int i = 0; i < 20; i++) {
+    tasks.push_back(BuildEmptyTaskSpec());
+  }
+  for (auto task : tasks) {
+    ASSERT_TRUE(submitter.SubmitTask(task).ok());
+  }
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1000, NodeID::Nil()));
+  ASSERT_EQ(worker_client->callbacks.size(), 10);
+
+  // Tasks that finish instantly keep the pipeline as deep as allowed.
+  ASSERT_TRUE(worker_client->ReplyPushTask());
+  ASSERT_EQ(submitter.GetMaxTasksInFlightPerWorkerPublic(tasks[0]), 10);
+  ASSERT_EQ(worker_client->callbacks.size(), 10);
+}
+
+TEST(DirectTaskTransportTest, TestNoStealingWithAdaptivePipelineDepthOfOne) {
+  rpc::Address address;
+  auto raylet_client = std::make_shared<MockRayletClient>();
+  auto worker_client = std::make_shared<MockWorkerClient>();
+  auto store = std::make_shared<CoreWorkerMemoryStore>();
+  auto client_pool = std::make_shared<rpc::CoreWorkerClientPool>(
+      [&](const rpc::Address &addr) { return worker_client; });
+  auto task_finisher = std::make_shared<MockTaskFinisher>();
+  auto actor_creator = std::make_shared<MockActorCreator>();
+  auto lease_policy = std::make_shared<MockLeasePolicy>();
+
+  uint32_t max_tasks_in_flight_per_worker = 10;
+  CoreWorkerDirectTaskSubmitter submitter(
+      address, raylet_client, client_pool, nullptr, lease_policy, store, task_finisher,
+      NodeID::Nil(), kLongTimeout, actor_creator, max_tasks_in_flight_per_worker,
+      absl::nullopt, /*adaptive_max_tasks_in_flight_per_worker=*/true);
+
+  std::vector<TaskSpecification> tasks;
+  for (int i = 0; i < 20; i++) {
+    tasks.push_back(BuildEmptyTaskSpec());
+  }
+  for (auto task : tasks) {
+    ASSERT_TRUE(submitter.SubmitTask(task).ok());
+  }
+
+  // While the full pipeline depth is used, stealing is enabled and a worker is
+  // requested eagerly after each grant.
+  std::string worker1_id = "worker1_ID_abcdefghijklmnopq";
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1001, NodeID::Nil(), false,
+                                              worker1_id));
+  std::string worker2_id = "worker2_ID_abcdefghijklmnopq";
+  ASSERT_TRUE(raylet_client->GrantWorkerLease("localhost", 1002, NodeID::Nil(), false,
+                                              worker2_id));
+  ASSERT_EQ(raylet_client->num_workers_requested, 3);
+  ASSERT_EQ(worker_client->callbacks.size(), 20);
+
+  // Long tasks shrink the pipeline depth to 1 while the second worker still has 10
+  // tasks in flight.
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(worker_client->ReplyPushTask(Status::OK(), false, false,
+                                             /*execution_time_us=*/10 * 1000 * 1000));
+  }
+  ASSERT_EQ(submitter.GetMaxTasksInFlightPerWorkerPublic(tasks[0]), 1);
+
+  // The idle first worker does not steal from the second one. It is returned, and the
+  // eager lease request is canceled since no new worker could steal either.
+  ASSERT_EQ(worker_client->steal_callbacks.size(), 0);
+  ASSERT_EQ(worker_client->callbacks.size(), 10);
+  ASSERT_EQ(raylet_client->num_workers_returned, 1);
+  ASSERT_EQ(raylet_client->num_leases_canceled, 1);
+  ASSERT_TRUE(raylet_client->ReplyCancelWorkerLease());
+  ASSERT_EQ(raylet_client->num_workers_requested, 3);
+
+  // The second worker drains its own pipeline and is returned too.
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(worker_client->ReplyPushTask(Status::OK(), false, false,
+                                             /*execution_time_us=*/10 * 1000 * 1000));
+  }
+  ASSERT_EQ(worker_client->steal_callbacks.size(), 0);
+  ASSERT_EQ(raylet_client->num_workers_returned, 2);
+  ASSERT_EQ(task_finisher->num_tasks_complete, 20);
+  ASSERT_EQ(task_finisher->num_tasks_failed, 0);
+}
+
 }  // namespace ray
 
 int main(int argc, char **argv) {
@@ -208,4 +208,38 @@ TEST(LocalityAwareLeasePolicyTest, TestBestLocalityFallbackAddrFetchFail) {
   ASSERT_EQ(NodeID::FromBinary(best_node_address.raylet_id()), fallback_node);
 }
 
+TEST(LocalityAwareLeasePolicyTest, TestAddArgObjectLocations) {
+  absl::flat_hash_map<ObjectID, LocalityData> locality_data;
+  NodeID fallback_node = NodeID::FromRandom();
+  rpc::Address fallback_rpc_address = MockNodeAddrFactory(fallback_node).value();
+  NodeID node1 = NodeID::FromRandom();
+  NodeID node2 = NodeID::FromRandom();
+  ObjectID obj1 = ObjectID::FromRandom();
+  ObjectID obj2 = ObjectID::FromRandom();
+  locality_data.emplace(obj1, LocalityData{8, {node1, node2}});
+  locality_data.emplace(obj2, LocalityData{16, {}});
+  auto mock_locality_data_provider =
+      std::make_shared<MockLocalityDataProvider>(locality_data);
+  LocalityAwareLeasePolicy locality_lease_policy(
+      mock_locality_data_provider, MockNodeAddrFactory, fallback_rpc_address);
+  auto task_spec = CreateFakeTask({obj1, obj2});
+  // Pass-by-value arguments are skipped.
+  task_spec.GetMutableMessage().add_args()->set_data("value");
+  locality_lease_policy.AddArgObjectLocations(&task_spec.GetMutableMessage());
+  ASSERT_EQ(mock_locality_data_provider->num_locality_data_fetches, 2);
+  ASSERT_EQ(task_spec.ArgObjectSize(0), 8);
+  auto locations = task_spec.ArgObjectLocations(0);
+  ASSERT_EQ(absl::flat_hash_set<NodeID>(locations.begin(), locations.end()),
+            absl::flat_hash_set<NodeID>({node1, node2}));
+  ASSERT_EQ(task_spec.ArgObjectSize(1), 16);
+  ASSERT_TRUE(task_spec.ArgObjectLocations(1).empty());
+  ASSERT_TRUE(task_spec.HasArgObjectLocations());
+
+  // The local lease policy leaves the spec alone.
+  auto local_task_spec = CreateFakeTask({obj1});
+  LocalLeasePolicy local_lease_policy(fallback_rpc_address);
+  local_lease_policy.AddArgObjectLocations(&local_task_spec.GetMutableMessage());
+  ASSERT_FALSE(local_task_spec.HasArgObjectLocations());
+}
+
 }  // namespace ray
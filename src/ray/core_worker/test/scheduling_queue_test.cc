@@ -14,6 +14,7 @@
 
 #include <thread>
 
+#include "absl/synchronization/notification.h"
 #include "gtest/gtest.h"
 #include "ray/common/asio/instrumented_io_context.h"
 #include "ray/common/test_util.h"
@@ -180,6 +181,86 @@ TEST(SchedulingQueueTest, TestSkipAlreadyProcessedByClient) {
   ASSERT_EQ(n_steal, 0);
 }
 
+TEST(SchedulingQueueTest, TestExecuteInCallerOrder) {
+  instrumented_io_context io_service;
+  MockWaiter waiter;
+  auto pool = std::make_shared<BoundedExecutor>(2);
+  ActorSchedulingQueue queue(io_service, waiter, pool, /*is_asyncio=*/false,
+                             /*max_concurrency=*/2, kMaxReorderWaitSeconds,
+                             /*execute_in_caller_order=*/true);
+  const int kNumTasks = 10;
+  std::atomic<int> n_ok(0);
+  std::atomic<int> n_running(0);
+  std::atomic<bool> overlapped(false);
+  std::vector<int> order;
+  absl::Mutex mu;
+  auto fn_rej = [](rpc::SendReplyCallback callback) { FAIL(); };
+  auto fn_steal = [](rpc::SendReplyCallback callback) { FAIL(); };
+  for (int i = 0; i < kNumTasks; i++) {
+    auto fn_ok = [&, i](rpc::SendReplyCallback callback) {
+      if (n_running.fetch_add(1) != 0) {
+        overlapped = true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      {
+        absl::MutexLock lock(&mu);
+        order.push_back(i);
+      }
+      n_running--;
+      n_ok++;
+    };
+    queue.Add(i, -1, fn_ok, fn_rej, nullptr, fn_steal);
+  }
+  // Only the first task has been handed to the pool.
+  ASSERT_EQ(queue.Size(), kNumTasks - 1);
+  while (n_ok < kNumTasks) {
+    io_service.poll();
+    io_service.restart();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_FALSE(overlapped);
+  ASSERT_EQ(queue.Size(), 0);
+  absl::MutexLock lock(&mu);
+  ASSERT_EQ(order.size(), kNumTasks);
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+}
+
+TEST(SchedulingQueueTest, TestExecuteInCallerOrderAcrossCallers) {
+  instrumented_io_context io_service;
+  MockWaiter waiter;
+  auto pool = std::make_shared<BoundedExecutor>(2);
+  // One queue per caller, sharing the actor's thread pool.
+  ActorSchedulingQueue queue_a(io_service, waiter, pool, false, 2,
+                               kMaxReorderWaitSeconds, true);
+  ActorSchedulingQueue queue_b(io_service, waiter, pool, false, 2,
+                               kMaxReorderWaitSeconds, true);
+  absl::Notification b_started;
+  std::atomic<bool> a_saw_b(false);
+  std::atomic<int> n_ok(0);
+  auto fn_rej = [](rpc::SendReplyCallback callback) { FAIL(); };
+  auto fn_steal = [](rpc::SendReplyCallback callback) { FAIL(); };
+  // Caller A's task can only finish once caller B's task has started, so this
+  // only passes if the two callers' tasks run concurrently.
+  auto fn_a = [&](rpc::SendReplyCallback callback) {
+    a_saw_b = b_started.WaitForNotificationWithTimeout(absl::Seconds(10));
+    n_ok++;
+  };
+  auto fn_b = [&](rpc::SendReplyCallback callback) {
+    b_started.Notify();
+    n_ok++;
+  };
+  queue_a.Add(0, -1, fn_a, fn_rej, nullptr, fn_steal);
+  queue_b.Add(0, -1, fn_b, fn_rej, nullptr, fn_steal);
+  while (n_ok < 2) {
+    io_service.poll();
+    io_service.restart();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(a_saw_b);
+}
+
 TEST(SchedulingQueueTest, TestCancelQueuedTask) {
   NormalSchedulingQueue *queue = new NormalSchedulingQueue();
   ASSERT_TRUE(queue->TaskQueueEmpty());
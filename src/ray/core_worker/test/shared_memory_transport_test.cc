@@ -0,0 +1,316 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/core_worker/transport/shared_memory_transport.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "ray/common/asio/instrumented_io_context.h"
+#include "ray/common/ray_config.h"
+#include "ray/common/test_util.h"
+#include "ray/object_manager/plasma/fling.h"
+
+namespace ray {
+
+class SharedMemoryTransportTest : public ::testing::Test {
+ public:
+  SharedMemoryTransportTest()
+      : work_(io_service_),
+        client_call_manager_(io_service_),
+        worker_id_(WorkerID::FromRandom()) {
+    address_.set_ip_address("127.0.0.1");
+    address_.set_port(1);
+    address_.set_worker_id(worker_id_.Binary());
+  }
+
+  std::unique_ptr<rpc::PushTaskRequest> MakeRequest(const TaskID &task_id) {
+    auto request = std::make_unique<rpc::PushTaskRequest>();
+    request->mutable_task_spec()->set_task_id(task_id.Binary());
+    return request;
+  }
+
+  /// The address of the actor's shared memory socket.
+  socklen_t ActorSocketAddress(struct sockaddr_un *socket_address) {
+    std::memset(socket_address, 0, sizeof(*socket_address));
+    socket_address->sun_family = AF_UNIX;
+    const std::string name = "ray_actor_" + worker_id_.Hex();
+    std::memcpy(socket_address->sun_path + 1, name.data(), name.size());
+    return offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+  }
+
+  /// Listen under the actor's socket address, in place of a SharedMemoryTaskServer.
+  int ListenAsActor() {
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    RAY_CHECK(listen_fd >= 0);
+    struct sockaddr_un socket_address;
+    socklen_t address_size = ActorSocketAddress(&socket_address);
+    RAY_CHECK(bind(listen_fd, reinterpret_cast<struct sockaddr *>(&socket_address),
+                   address_size) == 0);
+    RAY_CHECK(listen(listen_fd, 1) == 0);
+    return listen_fd;
+  }
+
+  /// Whether the peer closed the socket within the timeout.
+  bool WaitForClose(int socket_fd) {
+    struct pollfd fds = {socket_fd, POLLIN, 0};
+    char byte;
+    return poll(&fds, 1, 5000) == 1 && read(socket_fd, &byte, 1) == 0;
+  }
+
+  /// Run reply callbacks until `done` returns true.
+  void RunUntil(std::function<bool()> done) {
+    while (!done()) {
+      io_service_.run_one();
+    }
+  }
+
+ protected:
+  instrumented_io_context io_service_;
+  boost::asio::io_service::work work_;
+  rpc::ClientCallManager client_call_manager_;
+  const WorkerID worker_id_;
+  rpc::Address address_;
+};
+
+TEST_F(SharedMemoryTransportTest, TestPushActorTask) {
+  std::vector<TaskID> received;
+  absl::Mutex mu;
+  SharedMemoryTaskServer server(
+      worker_id_, [&](const rpc::PushTaskRequest &request, rpc::PushTaskReply *reply,
+                      rpc::SendReplyCallback send_reply_callback) {
+        {
+          absl::MutexLock lock(&mu);
+          received.push_back(TaskID::FromBinary(request.task_spec().task_id()));
+        }
+        reply->set_worker_exiting(true);
+        send_reply_callback(Status::OK(), nullptr, nullptr);
+      });
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  ASSERT_TRUE(WaitForCondition([&client]() { return client.IsConnected(); }, 5000));
+
+  std::vector<TaskID> task_ids;
+  int num_replies = 0;
+  for (int i = 0; i < 10; i++) {
+    task_ids.push_back(TaskID::ForFakeTask());
+    client.PushActorTask(MakeRequest(task_ids.back()), /*skip_queue=*/false,
+                         [&num_replies](const Status &status,
+                                        const rpc::PushTaskReply &reply) {
+                           ASSERT_TRUE(status.ok());
+                           ASSERT_TRUE(reply.worker_exiting());
+                           num_replies++;
+                         });
+  }
+  RunUntil([&num_replies]() { return num_replies == 10; });
+  absl::MutexLock lock(&mu);
+  ASSERT_EQ(received, task_ids);
+}
+
+TEST_F(SharedMemoryTransportTest, TestHandshakeDoesNotBlock) {
+  // Listen under the actor's socket address without ever accepting the rings, like
+  // an actor that is busy.
+  int listen_fd = ListenAsActor();
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+    ASSERT_FALSE(client.IsConnected());
+    // Destroying the client interrupts the handshake.
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  ASSERT_LT(elapsed, 500);
+  close(listen_fd);
+}
+
+TEST_F(SharedMemoryTransportTest, TestNoServer) {
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  // Give the handshake time to fail. Tasks would go over gRPC.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_FALSE(client.IsConnected());
+}
+
+TEST_F(SharedMemoryTransportTest, TestServerExit) {
+  std::vector<rpc::SendReplyCallback> unanswered;
+  absl::Mutex mu;
+  auto server = std::make_unique<SharedMemoryTaskServer>(
+      worker_id_, [&](const rpc::PushTaskRequest &request, rpc::PushTaskReply *reply,
+                      rpc::SendReplyCallback send_reply_callback) {
+        absl::MutexLock lock(&mu);
+        unanswered.push_back(send_reply_callback);
+      });
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  ASSERT_TRUE(WaitForCondition([&client]() { return client.IsConnected(); }, 5000));
+
+  int num_failed = 0;
+  for (int i = 0; i < 3; i++) {
+    client.PushActorTask(MakeRequest(TaskID::ForFakeTask()), /*skip_queue=*/false,
+                         [&num_failed](const Status &status,
+                                       const rpc::PushTaskReply &reply) {
+                           ASSERT_TRUE(status.IsIOError());
+                           num_failed++;
+                         });
+  }
+  ASSERT_TRUE(WaitForCondition(
+      [&]() {
+        absl::MutexLock lock(&mu);
+        return unanswered.size() == 3;
+      },
+      5000));
+
+  // The tasks that were not replied to fail once the actor goes away.
+  server.reset();
+  RunUntil([&num_failed]() { return num_failed == 3; });
+  ASSERT_FALSE(client.IsConnected());
+}
+
+TEST_F(SharedMemoryTransportTest, TestMalformedReply) {
+  // Accept the rings like an actor, then reply to a request that was never sent.
+  int listen_fd = ListenAsActor();
+  int actor_fd = -1;
+  std::thread actor([this, listen_fd, &actor_fd]() {
+    actor_fd = accept(listen_fd, nullptr, nullptr);
+    RAY_CHECK(actor_fd >= 0);
+    int fds[4];
+    for (int &fd : fds) {
+      fd = recv_fd(actor_fd);
+      RAY_CHECK(fd >= 0);
+    }
+    auto request_ring = SharedMemoryRing::Attach(fds[0], fds[1]);
+    auto reply_ring = SharedMemoryRing::Attach(fds[2], fds[3]);
+    const char ack = 1;
+    RAY_CHECK(write(actor_fd, &ack, 1) == 1);
+    std::string record;
+    for (int i = 0; i < 2; i++) {
+      RAY_CHECK(request_ring->WaitForMessage(/*spin_us=*/0));
+      RAY_CHECK(request_ring->TryRead(&record));
+    }
+    rpc::SharedMemoryPushTaskReply reply;
+    reply.set_request_id(1000);
+    record.assign(1, 0);
+    reply.AppendToString(&record);
+    RAY_CHECK(reply_ring->TryWrite(record.data(), record.size()));
+  });
+
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  ASSERT_TRUE(WaitForCondition([&client]() { return client.IsConnected(); }, 5000));
+  int num_failed = 0;
+  for (int i = 0; i < 2; i++) {
+    client.PushActorTask(MakeRequest(TaskID::ForFakeTask()), /*skip_queue=*/false,
+                         [&num_failed](const Status &status,
+                                       const rpc::PushTaskReply &reply) {
+                           ASSERT_TRUE(status.IsIOError());
+                           num_failed++;
+                         });
+  }
+  actor.join();
+
+  // The client fails the pending tasks instead of crashing, closes the connection and
+  // sends later tasks over gRPC.
+  RunUntil([&num_failed]() { return num_failed == 2; });
+  ASSERT_FALSE(client.IsConnected());
+  ASSERT_TRUE(WaitForClose(actor_fd));
+  close(actor_fd);
+  close(listen_fd);
+}
+
+TEST_F(SharedMemoryTransportTest, TestMalformedRequest) {
+  int num_handled = 0;
+  SharedMemoryTaskServer server(
+      worker_id_, [&num_handled](const rpc::PushTaskRequest &request,
+                                 rpc::PushTaskReply *reply,
+                                 rpc::SendReplyCallback send_reply_callback) {
+        num_handled++;
+        send_reply_callback(Status::OK(), nullptr, nullptr);
+      });
+
+  // Connect like a caller, then send a record that is not a message fragment.
+  int caller_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  ASSERT_GE(caller_fd, 0);
+  struct sockaddr_un socket_address;
+  socklen_t address_size = ActorSocketAddress(&socket_address);
+  ASSERT_EQ(connect(caller_fd, reinterpret_cast<struct sockaddr *>(&socket_address),
+                    address_size),
+            0);
+  const size_t ring_bytes = RayConfig::instance().actor_shared_memory_ring_bytes();
+  auto request_ring = SharedMemoryRing::Create(ring_bytes);
+  auto reply_ring = SharedMemoryRing::Create(ring_bytes);
+  for (int fd : {request_ring->MemoryFd(), request_ring->EventFd(),
+                 reply_ring->MemoryFd(), reply_ring->EventFd()}) {
+    ASSERT_GE(send_fd(caller_fd, fd), 0);
+  }
+  char ack;
+  ASSERT_EQ(read(caller_fd, &ack, 1), 1);
+  ASSERT_TRUE(request_ring->TryWrite("\x07garbage", 8));
+
+  // The actor drops the connection instead of crashing, and still serves other callers.
+  ASSERT_TRUE(WaitForClose(caller_fd));
+  close(caller_fd);
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  ASSERT_TRUE(WaitForCondition([&client]() { return client.IsConnected(); }, 5000));
+  bool replied = false;
+  client.PushActorTask(
+      MakeRequest(TaskID::ForFakeTask()), /*skip_queue=*/false,
+      [&replied](const Status &status, const rpc::PushTaskReply &reply) {
+        ASSERT_TRUE(status.ok());
+        replied = true;
+      });
+  RunUntil([&replied]() { return replied; });
+  ASSERT_EQ(num_handled, 1);
+}
+
+TEST_F(SharedMemoryTransportTest, TestRoundTripLatency) {
+  SharedMemoryTaskServer server(
+      worker_id_, [](const rpc::PushTaskRequest &request, rpc::PushTaskReply *reply,
+                     rpc::SendReplyCallback send_reply_callback) {
+        send_reply_callback(Status::OK(), nullptr, nullptr);
+      });
+  SharedMemoryCoreWorkerClient client(address_, client_call_manager_);
+  ASSERT_TRUE(WaitForCondition([&client]() { return client.IsConnected(); }, 5000));
+
+  // Push one task at a time, so that each one measures a full round trip including
+  // the hop onto the caller's event loop.
+  const int num_tasks = 1000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_tasks; i++) {
+    bool replied = false;
+    client.PushActorTask(
+        MakeRequest(TaskID::ForFakeTask()), /*skip_queue=*/false,
+        [&replied](const Status &status, const rpc::PushTaskReply &reply) {
+          ASSERT_TRUE(status.ok());
+          replied = true;
+        });
+    RunUntil([&replied]() { return replied; });
+  }
+  auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  RAY_LOG(INFO) << "Shared memory actor task round trip: "
+                << static_cast<double>(elapsed_us) / num_tasks << "us";
+}
+
+}  // namespace ray
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -173,6 +173,8 @@ void CoreWorkerDirectActorTaskSubmitter::ConnectActor(const ActorID &actor_id,
                  << queue->second.caller_starts_at << " to "
                  << queue->second.next_task_reply_position;
   queue->second.caller_starts_at = queue->second.next_task_reply_position;
+  // The new incarnation of the actor has not queued any of our tasks yet.
+  queue->second.num_queued_at_actor = 0;
 
   ResendOutOfOrderTasks(actor_id);
   SendPendingTasks(actor_id);
@@ -271,7 +273,18 @@ void CoreWorkerDirectActorTaskSubmitter::SendPendingTasks(const ActorID &actor_i
     client_queue.pending_force_kill.reset();
   }
 
-  // Submit all pending requests.
+  // Submit all pending requests. Tasks sent for the first time are handed to the
+  // client together, so that it can coalesce them into batched RPCs.
+  std::vector<rpc::PushTaskRequestAndCallback> batch;
+  // Tasks are only batched for actors that run one task at a time, since the actor
+  // replies to a batch once all of its tasks have finished. When batching, let ready
+  // tasks accumulate while a full batch is in flight. They are sent together once a
+  // reply arrives.
+  const bool batching =
+      max_task_batch_size_ > 1 && client_queue.actor_runs_tasks_sequentially;
+  const bool batch_in_flight =
+      batching &&
+      client_queue.num_pending_replies >= static_cast<int64_t>(max_task_batch_size_);
   auto &requests = client_queue.requests;
   auto head = requests.begin();
   while (head != requests.end() &&
@@ -280,13 +293,27 @@ void CoreWorkerDirectActorTaskSubmitter::SendPendingTasks(const ActorID &actor_i
     // If the task has been sent before, skip the other tasks in the send
     // queue.
     bool skip_queue = head->first < client_queue.next_send_position;
+    // Hold back new tasks while the actor reports that too many of ours are
+    // queued. A reply to one of the pending tasks will resume sending.
+    if (!skip_queue && max_tasks_queued_per_caller_ > 0 &&
+        client_queue.num_queued_at_actor >= max_tasks_queued_per_caller_ &&
+        client_queue.num_pending_replies > 0) {
+      break;
+    }
+    if (!skip_queue && batch_in_flight) {
+      break;
+    }
     auto task_spec = std::move(head->second.first);
     head = requests.erase(head);
 
     RAY_CHECK(!client_queue.worker_id.empty());
-    PushActorTask(client_queue, task_spec, skip_queue);
+    PushActorTask(client_queue, task_spec, skip_queue,
+                  skip_queue || !batching ? nullptr : &batch);
     client_queue.next_send_position++;
   }
+  if (!batch.empty()) {
+    client_queue.rpc_client->PushActorTasks(std::move(batch), max_task_batch_size_);
+  }
 }
 
 void CoreWorkerDirectActorTaskSubmitter::ResendOutOfOrderTasks(const ActorID &actor_id) {
@@ -308,9 +335,9 @@ void CoreWorkerDirectActorTaskSubmitter::ResendOutOfOrderTasks(const ActorID &ac
   client_queue.out_of_order_completed_tasks.clear();
 }
 
-void CoreWorkerDirectActorTaskSubmitter::PushActorTask(const ClientQueue &queue,
-                                                       const TaskSpecification &task_spec,
-                                                       bool skip_queue) {
+void CoreWorkerDirectActorTaskSubmitter::PushActorTask(
+    ClientQueue &queue, const TaskSpecification &task_spec, bool skip_queue,
+    std::vector<rpc::PushTaskRequestAndCallback> *batch) {
   auto request = std::make_unique<rpc::PushTaskRequest>();
   // NOTE(swang): CopyFrom is needed because if we use Swap here and the task
   // fails, then the task data will be gone when the TaskManager attempts to
@@ -330,8 +357,8 @@ void CoreWorkerDirectActorTaskSubmitter::PushActorTask(const ClientQueue &queue,
                  << " actor counter " << actor_counter << " seq no "
                  << request->sequence_number();
   rpc::Address addr(queue.rpc_client->Addr());
-  queue.rpc_client->PushActorTask(
-      std::move(request), skip_queue,
+  queue.num_pending_replies++;
+  rpc::ClientCallback<rpc::PushTaskReply> callback =
       [this, addr, task_id, actor_id, actor_counter, task_spec, task_skipped](
           Status status, const rpc::PushTaskReply &reply) {
         bool increment_completed_tasks = true;
@@ -372,12 +399,17 @@ void CoreWorkerDirectActorTaskSubmitter::PushActorTask(const ClientQueue &queue,
           }
         }
 
-        if (increment_completed_tasks) {
-          absl::MutexLock lock(&mu_);
-          auto queue_pair = client_queues_.find(actor_id);
-          RAY_CHECK(queue_pair != client_queues_.end());
-          auto &queue = queue_pair->second;
+        absl::MutexLock lock(&mu_);
+        auto queue_pair = client_queues_.find(actor_id);
+        RAY_CHECK(queue_pair != client_queues_.end());
+        auto &queue = queue_pair->second;
+        queue.num_pending_replies--;
+        if (status.ok()) {
+          queue.num_queued_at_actor = reply.num_queued_caller_tasks();
+          queue.actor_runs_tasks_sequentially = reply.runs_tasks_sequentially();
+        }
 
+        if (increment_completed_tasks) {
           // Try to increment queue.next_task_reply_position consecutively until we
           // cannot. In the case of tasks not received in order, the following block
           // ensure queue.next_task_reply_position are incremented to the max possible
@@ -401,7 +433,18 @@ void CoreWorkerDirectActorTaskSubmitter::PushActorTask(const ClientQueue &queue,
                          << " and size of out_of_order_tasks set is "
                          << queue.out_of_order_completed_tasks.size();
         }
-      });
+
+        if (max_tasks_queued_per_caller_ > 0 || max_task_batch_size_ > 1) {
+          // Resume sending if we held back tasks because of the actor's backlog, or
+          // to batch them.
+          SendPendingTasks(actor_id);
+        }
+      };
+  if (batch != nullptr) {
+    batch->emplace_back(std::move(request), std::move(callback));
+  } else {
+    queue.rpc_client->PushActorTask(std::move(request), skip_queue, callback);
+  }
 }
 
 bool CoreWorkerDirectActorTaskSubmitter::IsActorAlive(const ActorID &actor_id) const {
@@ -458,8 +501,9 @@ void CoreWorkerDirectTaskReceiver::HandleTask(
     }
   }
 
-  auto accept_callback = [this, reply, task_spec,
-                          resource_ids](rpc::SendReplyCallback send_reply_callback) {
+  const int64_t received_time_us = current_time_us();
+  auto accept_callback = [this, reply, task_spec, resource_ids, received_time_us](
+                             rpc::SendReplyCallback send_reply_callback) {
     if (task_spec.GetMessage().skip_execution()) {
       send_reply_callback(Status::OK(), nullptr, nullptr);
       return;
@@ -473,8 +517,14 @@ void CoreWorkerDirectTaskReceiver::HandleTask(
     RAY_CHECK(num_returns >= 0);
 
     std::vector<std::shared_ptr<RayObject>> return_objects;
+    const int64_t start_time_us = current_time_us();
     auto status = task_handler_(task_spec, resource_ids, &return_objects,
                                 reply->mutable_borrowed_refs());
+    // Report how long the task took so that the owner can tune how many tasks it
+    // pipelines to this worker.
+    const int64_t end_time_us = current_time_us();
+    reply->set_task_execution_time_us(end_time_us - start_time_us);
+    reply->set_worker_handling_time_us(end_time_us - received_time_us);
 
     bool objects_valid = return_objects.size() == num_returns;
     if (objects_valid) {
@@ -547,13 +597,27 @@ void CoreWorkerDirectTaskReceiver::HandleTask(
       auto result = actor_scheduling_queues_.emplace(
           task_spec.CallerWorkerId(),
           std::unique_ptr<SchedulingQueue>(new ActorSchedulingQueue(
-              task_main_io_service_, *waiter_, pool_, is_asyncio_, max_concurrency_)));
+              task_main_io_service_, *waiter_, pool_, is_asyncio_, max_concurrency_,
+              kMaxReorderWaitSeconds,
+              RayConfig::instance().threaded_actor_per_caller_ordering())));
       it = result.first;
     }
 
+    // Tell the caller how many of its tasks are still queued here, so that it
+    // can back off if we fall behind.
+    const SchedulingQueue *queue = it->second.get();
+    const bool runs_tasks_sequentially = !is_asyncio_ && max_concurrency_ <= 1;
+    auto reply_with_queue_size = [reply, queue, runs_tasks_sequentially,
+                                  send_reply_callback](Status status,
+                                                       std::function<void()> success,
+                                                       std::function<void()> failure) {
+      reply->set_num_queued_caller_tasks(queue->Size());
+      reply->set_runs_tasks_sequentially(runs_tasks_sequentially);
+      send_reply_callback(status, std::move(success), std::move(failure));
+    };
     it->second->Add(request.sequence_number(), request.client_processed_up_to(),
                     std::move(accept_callback), std::move(reject_callback),
-                    std::move(send_reply_callback), nullptr, task_spec.TaskId(),
+                    std::move(reply_with_queue_size), nullptr, task_spec.TaskId(),
                     dependencies);
   } else {
     // Add the normal task's callbacks to the non-actor scheduling queue.
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/thread.hpp>
 #include <list>
@@ -69,10 +70,15 @@ class CoreWorkerDirectActorTaskSubmitter
   CoreWorkerDirectActorTaskSubmitter(
       std::shared_ptr<rpc::CoreWorkerClientPool> core_worker_client_pool,
       std::shared_ptr<CoreWorkerMemoryStore> store,
-      std::shared_ptr<TaskFinisherInterface> task_finisher)
+      std::shared_ptr<TaskFinisherInterface> task_finisher,
+      int64_t max_tasks_queued_per_caller =
+          RayConfig::instance().max_actor_tasks_queued_per_caller(),
+      uint32_t max_task_batch_size = RayConfig::instance().max_actor_task_batch_size())
       : core_worker_client_pool_(core_worker_client_pool),
         resolver_(store, task_finisher),
-        task_finisher_(task_finisher) {}
+        task_finisher_(task_finisher),
+        max_tasks_queued_per_caller_(max_tasks_queued_per_caller),
+        max_task_batch_size_(max_task_batch_size) {}
 
   /// Add an actor queue. This should be called whenever a reference to an
   /// actor is created in the language frontend.
@@ -219,6 +225,15 @@ class CoreWorkerDirectActorTaskSubmitter
     /// A force-kill request that should be sent to the actor once an RPC
     /// client to the actor is available.
     absl::optional<rpc::KillActorRequest> pending_force_kill;
+
+    /// The number of tasks pushed to the actor that have not replied yet.
+    int64_t num_pending_replies = 0;
+    /// The number of our tasks that the actor last reported as queued and not
+    /// yet started.
+    int64_t num_queued_at_actor = 0;
+    /// Whether the actor last reported that it runs one task at a time. Tasks are
+    /// only batched for such actors.
+    bool actor_runs_tasks_sequentially = false;
   };
 
   /// Push a task to a remote actor via the given client.
@@ -229,9 +244,13 @@ class CoreWorkerDirectActorTaskSubmitter
   /// \param[in] task_spec The task to send.
   /// \param[in] skip_queue Whether to skip the task queue. This will send the
   /// task for execution immediately.
+  /// \param[in] batch If not null, append the request to this batch instead of
+  /// sending it. The caller sends the batch with PushActorTasks.
   /// \return Void.
-  void PushActorTask(const ClientQueue &queue, const TaskSpecification &task_spec,
-                     bool skip_queue) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void PushActorTask(ClientQueue &queue, const TaskSpecification &task_spec,
+                     bool skip_queue,
+                     std::vector<rpc::PushTaskRequestAndCallback> *batch = nullptr)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   /// Send all pending tasks for an actor.
   ///
@@ -269,6 +288,15 @@ class CoreWorkerDirectActorTaskSubmitter
   /// Used to complete tasks.
   std::shared_ptr<TaskFinisherInterface> task_finisher_;
 
+  /// If positive, stop sending new tasks to an actor while it reports at least
+  /// this many of our tasks queued. See max_actor_tasks_queued_per_caller.
+  const int64_t max_tasks_queued_per_caller_;
+
+  /// If greater than 1, new tasks for an actor that runs one task at a time are held
+  /// while this many tasks await replies from it, and sent together when a reply
+  /// arrives. See max_actor_task_batch_size.
+  const uint32_t max_task_batch_size_;
+
   friend class CoreWorkerTest;
 };
 
@@ -367,6 +395,11 @@ class BoundedExecutor {
     });
   }
 
+  /// Posts work to the pool without blocking. If no threads are free, the work
+  /// waits in the pool's queue until one is. Callers are responsible for
+  /// bounding how much work they post.
+  void Post(std::function<void()> fn) { boost::asio::post(pool_, std::move(fn)); }
+
  private:
   bool ThreadsAvailable() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     return num_running_ < max_concurrency_;
@@ -405,16 +438,24 @@ class SchedulingQueue {
 /// See direct_actor.proto for a description of the ordering protocol.
 class ActorSchedulingQueue : public SchedulingQueue {
  public:
+  /// \param[in] execute_in_caller_order If a pool is given, run this caller's
+  /// tasks on the pool one at a time in sequence number order, instead of
+  /// posting each task as soon as its turn comes. Tasks of other callers,
+  /// which have their own queues, still run concurrently. The main thread
+  /// never blocks waiting for a free thread in this mode.
   ActorSchedulingQueue(instrumented_io_context &main_io_service, DependencyWaiter &waiter,
                        std::shared_ptr<BoundedExecutor> pool = nullptr,
                        bool is_asyncio = false, int max_concurrency = 1,
-                       int64_t reorder_wait_seconds = kMaxReorderWaitSeconds)
+                       int64_t reorder_wait_seconds = kMaxReorderWaitSeconds,
+                       bool execute_in_caller_order = false)
       : reorder_wait_seconds_(reorder_wait_seconds),
+        main_io_service_(main_io_service),
         wait_timer_(main_io_service),
         main_thread_id_(boost::this_thread::get_id()),
         waiter_(waiter),
         pool_(pool),
-        is_asyncio_(is_asyncio) {
+        is_asyncio_(is_asyncio),
+        execute_in_caller_order_(pool != nullptr && execute_in_caller_order) {
     if (is_asyncio_) {
       RAY_LOG(INFO) << "Setting actor as async with max_concurrency=" << max_concurrency
                     << ", creating new fiber thread.";
@@ -429,12 +470,9 @@ class ActorSchedulingQueue : public SchedulingQueue {
     return false;
   }
 
-  size_t Size() const {
-    RAY_CHECK(false) << "Size() not implemented for actor queues";
-    // The return instruction will never be executed, but we need to include it
-    // nonetheless because this is a non-void function.
-    return 0;
-  }
+  /// Returns the number of this caller's tasks that are queued and not yet
+  /// started. This is safe to call from any thread.
+  size_t Size() const { return num_queued_tasks_.load(); }
 
   /// Add a new actor task's callbacks to the worker queue.
   void Add(int64_t seq_no, int64_t client_processed_up_to,
@@ -503,11 +541,24 @@ class ActorSchedulingQueue : public SchedulingQueue {
     // Process as many in-order requests as we can.
     while (!pending_actor_tasks_.empty() &&
            pending_actor_tasks_.begin()->first == next_seq_no_ &&
-           pending_actor_tasks_.begin()->second.CanExecute()) {
+           pending_actor_tasks_.begin()->second.CanExecute() && !task_running_) {
       auto head = pending_actor_tasks_.begin();
       auto request = head->second;
 
-      if (is_asyncio_) {
+      if (execute_in_caller_order_) {
+        // Run one task of this caller at a time. The next one is scheduled from
+        // the main thread once this one finishes.
+        task_running_ = true;
+        pool_->Post([this, request]() mutable {
+          request.Accept();
+          main_io_service_.post(
+              [this]() {
+                task_running_ = false;
+                ScheduleRequests();
+              },
+              "ActorSchedulingQueue.ScheduleRequests");
+        });
+      } else if (is_asyncio_) {
         // Process async actor task.
         fiber_state_->EnqueueFiber([request]() mutable { request.Accept(); });
       } else if (pool_ != nullptr) {
@@ -520,10 +571,13 @@ class ActorSchedulingQueue : public SchedulingQueue {
       pending_actor_tasks_.erase(head);
       next_seq_no_++;
     }
+    num_queued_tasks_ = pending_actor_tasks_.size();
 
     if (pending_actor_tasks_.empty() ||
-        !pending_actor_tasks_.begin()->second.CanExecute()) {
-      // No timeout for object dependency waits.
+        !pending_actor_tasks_.begin()->second.CanExecute() ||
+        pending_actor_tasks_.begin()->first == next_seq_no_) {
+      // No timeout for object dependency waits, or while the next task waits
+      // for this caller's running task to finish.
       wait_timer_.cancel();
     } else {
       // Set a timeout on the queued tasks to avoid an infinite wait on failure.
@@ -551,6 +605,7 @@ class ActorSchedulingQueue : public SchedulingQueue {
       next_seq_no_ = std::max(next_seq_no_, head->first + 1);
       pending_actor_tasks_.erase(head);
     }
+    num_queued_tasks_ = 0;
   }
 
   /// Max time in seconds to wait for dependencies to show up.
@@ -559,6 +614,11 @@ class ActorSchedulingQueue : public SchedulingQueue {
   std::map<int64_t, InboundRequest> pending_actor_tasks_;
   /// The next sequence number we are waiting for to arrive.
   int64_t next_seq_no_ = 0;
+  /// The size of pending_actor_tasks_, readable from any thread.
+  std::atomic<size_t> num_queued_tasks_{0};
+  /// The main io service, used to schedule the next task once a task that ran
+  /// on the pool finishes.
+  instrumented_io_context &main_io_service_;
   /// Timer for waiting on dependencies. Note that this is set on the task main
   /// io service, which is fine since it only ever fires if no tasks are running.
   boost::asio::deadline_timer wait_timer_;
@@ -574,6 +634,11 @@ class ActorSchedulingQueue : public SchedulingQueue {
   /// If is_asyncio_ is true, fiber_state_ contains the running state required
   /// to enable continuation and work together with python asyncio.
   std::unique_ptr<FiberState> fiber_state_;
+  /// Whether to run this caller's tasks on the pool one at a time.
+  const bool execute_in_caller_order_;
+  /// Whether a task of this caller is running on the pool. Only used if
+  /// execute_in_caller_order_ is true.
+  bool task_running_ = false;
   friend class SchedulingQueueTest;
 };
 
@@ -18,6 +18,14 @@
 
 namespace ray {
 
+SchedulingKey CoreWorkerDirectTaskSubmitter::GetSchedulingKey(
+    const TaskSpecification &task_spec) {
+  return SchedulingKey(
+      task_spec.GetSchedulingClass(), task_spec.GetDependencyIds(),
+      task_spec.IsActorCreationTask() ? task_spec.ActorCreationId() : ActorID::Nil(),
+      task_spec.GangId(), task_spec.Priority());
+}
+
 Status CoreWorkerDirectTaskSubmitter::SubmitTask(TaskSpecification task_spec) {
   RAY_LOG(DEBUG) << "Submit task " << task_spec.TaskId();
 
@@ -71,27 +79,27 @@ Status CoreWorkerDirectTaskSubmitter::SubmitTask(TaskSpecification task_spec) {
       if (keep_executing) {
         // Note that the dependencies in the task spec are mutated to only contain
         // plasma dependencies after ResolveDependencies finishes.
-        const SchedulingKey scheduling_key(
-            task_spec.GetSchedulingClass(), task_spec.GetDependencyIds(),
-            task_spec.IsActorCreationTask() ? task_spec.ActorCreationId()
-                                            : ActorID::Nil());
+        const SchedulingKey scheduling_key = GetSchedulingKey(task_spec);
         auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
         scheduling_key_entry.task_queue.push_back(task_spec);
         scheduling_key_entry.resource_spec = task_spec;
+        scheduling_key_entry.gang_size = task_spec.GangSize();
 
+        const uint32_t max_tasks_in_flight_per_worker =
+            MaxTasksInFlightPerWorker(scheduling_key_entry);
         if (!scheduling_key_entry.AllPipelinesToWorkersFull(
-                max_tasks_in_flight_per_worker_)) {
+                max_tasks_in_flight_per_worker)) {
           // The pipelines to the current workers are not full yet, so we don't need more
           // workers.
 
           // Find a worker with a number of tasks in flight that is less than the maximum
-          // value (max_tasks_in_flight_per_worker_) and call OnWorkerIdle to send tasks
+          // value (max_tasks_in_flight_per_worker) and call OnWorkerIdle to send tasks
           // to that worker
           for (auto active_worker_addr : scheduling_key_entry.active_workers) {
             RAY_CHECK(worker_to_lease_entry_.find(active_worker_addr) !=
                       worker_to_lease_entry_.end());
             auto &lease_entry = worker_to_lease_entry_[active_worker_addr];
-            if (!lease_entry.PipelineToWorkerFull(max_tasks_in_flight_per_worker_)) {
+            if (!lease_entry.PipelineToWorkerFull(max_tasks_in_flight_per_worker)) {
               OnWorkerIdle(active_worker_addr, scheduling_key, false,
                            lease_entry.assigned_resources);
               // If we find a worker with a non-full pipeline, all we need to do is to
@@ -164,7 +172,7 @@ bool CoreWorkerDirectTaskSubmitter::FindOptimalVictimForStealing(
   // Check that there is at least one worker (other than the thief) with the current
   // SchedulingKey and that there are stealable tasks
   if (scheduling_key_entry.active_workers.size() <= 1 ||
-      !scheduling_key_entry.StealableTasks()) {
+      !HasStealableTasks(scheduling_key_entry)) {
     return false;
   }
 
@@ -248,21 +256,28 @@ void CoreWorkerDirectTaskSubmitter::StealTasksOrReturnWorker(
   RAY_LOG(DEBUG) << "Beginning to steal work now! Thief is worker: "
                  << thief_addr.worker_id;
 
-  // Search for a suitable victim
+  // Search for a suitable victim. No victim is found if the current pipeline depth of
+  // the scheduling key does not allow stealing.
+  auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
   rpc::Address victim_raw_addr;
   if (!FindOptimalVictimForStealing(scheduling_key, thief_addr, &victim_raw_addr)) {
     RAY_LOG(DEBUG) << "Could not find a suitable victim for stealing! Returning worker "
                    << thief_addr.worker_id;
-    // If stealing was enabled, we can now cancel any pending new workeer lease request,
-    // because stealing is now possible this time.
+    // If stealing was enabled when the pending lease request was made, it may have been
+    // requested eagerly for stealing and can now be canceled. This uses the static cap
+    // rather than the current depth, because the adaptive depth may have dropped to 1
+    // since the request was made.
     if (max_tasks_in_flight_per_worker_ > 1) {
       CancelWorkerLeaseIfNeeded(scheduling_key);
     }
+    if (RetargetWorkerLease(thief_addr, scheduling_key)) {
+      return;
+    }
     ReturnWorker(thief_addr, was_error, scheduling_key);
     return;
   }
   // If we get here, stealing must be enabled.
-  RAY_CHECK(max_tasks_in_flight_per_worker_ > 1);
+  RAY_CHECK(WorkStealingEnabled(scheduling_key_entry));
   rpc::WorkerAddress victim_addr = rpc::WorkerAddress(victim_raw_addr);
   RAY_CHECK(worker_to_lease_entry_.find(victim_addr) != worker_to_lease_entry_.end());
 
@@ -320,6 +335,65 @@ void CoreWorkerDirectTaskSubmitter::StealTasksOrReturnWorker(
       }));
 }
 
+bool CoreWorkerDirectTaskSubmitter::RetargetWorkerLease(
+    const rpc::WorkerAddress &addr, const SchedulingKey &scheduling_key) {
+  if (!worker_lease_retargeting_enabled_ || !std::get<2>(scheduling_key).IsNil()) {
+    return false;
+  }
+  auto &lease_entry = worker_to_lease_entry_[addr];
+  RAY_CHECK(lease_entry.tasks_in_flight == 0);
+  auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
+  if (!scheduling_key_entry.task_queue.empty()) {
+    return false;
+  }
+  const auto &leased_spec = scheduling_key_entry.resource_spec;
+
+  for (auto &entry : scheduling_key_entries_) {
+    const SchedulingKey &candidate_key = entry.first;
+    auto &candidate_entry = entry.second;
+    // The scheduling class is the resource shape. Only a key of the same shape can
+    // take the lease over, so that its tasks neither hold resources they don't need
+    // nor run with the resource IDs of another shape.
+    // A gang gets its workers all at once, so it does not take over single leases.
+    if (candidate_key == scheduling_key || candidate_entry.task_queue.empty() ||
+        std::get<0>(candidate_key) != std::get<0>(scheduling_key) ||
+        !std::get<2>(candidate_key).IsNil() || !std::get<3>(candidate_key).IsNil()) {
+      continue;
+    }
+    const auto &candidate_spec = candidate_entry.resource_spec;
+    if (candidate_spec.GetLanguage() != leased_spec.GetLanguage() ||
+        candidate_spec.SerializedRuntimeEnv() != leased_spec.SerializedRuntimeEnv()) {
+      continue;
+    }
+    // Keys of the same shape differ in their dependencies. Only take the lease over if
+    // the candidate's own lease would be requested from the worker's node, so that
+    // tasks still run where the lease policy places their arguments.
+    if (NodeID::FromBinary(
+            lease_policy_->GetBestNodeForTask(candidate_spec).raylet_id()) !=
+        addr.raylet_id) {
+      continue;
+    }
+
+    // Copy the key, since erasing the old entry below may invalidate the references
+    // into scheduling_key_entries_.
+    const SchedulingKey new_scheduling_key = candidate_key;
+    RAY_LOG(DEBUG) << "Handing worker " << addr.worker_id
+                   << " over to another scheduling key with "
+                   << candidate_entry.task_queue.size() << " queued tasks";
+    scheduling_key_entry.active_workers.erase(addr);
+    if (scheduling_key_entry.CanDelete()) {
+      scheduling_key_entries_.erase(scheduling_key);
+    }
+    lease_entry.scheduling_key = new_scheduling_key;
+    RAY_CHECK(
+        scheduling_key_entries_[new_scheduling_key].active_workers.emplace(addr).second);
+    OnWorkerIdle(addr, new_scheduling_key, /*was_error=*/false,
+                 lease_entry.assigned_resources);
+    return true;
+  }
+  return false;
+}
+
 void CoreWorkerDirectTaskSubmitter::OnWorkerIdle(
     const rpc::WorkerAddress &addr, const SchedulingKey &scheduling_key, bool was_error,
     const google::protobuf::RepeatedPtrField<rpc::ResourceMapEntry> &assigned_resources) {
@@ -345,9 +419,11 @@ void CoreWorkerDirectTaskSubmitter::OnWorkerIdle(
     }
   } else {
     auto &client = *client_cache_->GetOrConnect(addr.ToProto());
+    const uint32_t max_tasks_in_flight_per_worker =
+        MaxTasksInFlightPerWorker(scheduling_key_entry);
 
     while (!current_queue.empty() &&
-           !lease_entry.PipelineToWorkerFull(max_tasks_in_flight_per_worker_)) {
+           !lease_entry.PipelineToWorkerFull(max_tasks_in_flight_per_worker)) {
       auto task_spec = current_queue.front();
       // Increment the number of tasks in flight to the worker
       lease_entry.tasks_in_flight++;
@@ -363,7 +439,7 @@ void CoreWorkerDirectTaskSubmitter::OnWorkerIdle(
       current_queue.pop_front();
     }
     // If stealing is not an option, we can cancel the request for new worker leases
-    if (max_tasks_in_flight_per_worker_ == 1) {
+    if (!WorkStealingEnabled(scheduling_key_entry)) {
       CancelWorkerLeaseIfNeeded(scheduling_key);
     }
   }
@@ -374,7 +450,7 @@ void CoreWorkerDirectTaskSubmitter::CancelWorkerLeaseIfNeeded(
     const SchedulingKey &scheduling_key) {
   auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
   auto &task_queue = scheduling_key_entry.task_queue;
-  if (!task_queue.empty() || scheduling_key_entry.StealableTasks()) {
+  if (!task_queue.empty() || HasStealableTasks(scheduling_key_entry)) {
     // There are still pending tasks, or there are tasks that can be stolen by a new
     // worker, so let the worker lease request succeed.
     return;
@@ -384,7 +460,7 @@ void CoreWorkerDirectTaskSubmitter::CancelWorkerLeaseIfNeeded(
       << "Task queue is empty, and there are no stealable tasks; canceling lease request";
 
   auto &pending_lease_request = scheduling_key_entry.pending_lease_request;
-  if (pending_lease_request.first) {
+  if (pending_lease_request.first && !pending_lease_request.second.IsNil()) {
     // There is an in-flight lease request. Cancel it.
     auto &lease_client = pending_lease_request.first;
     auto &lease_id = pending_lease_request.second;
@@ -437,7 +513,8 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
   auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
   auto &pending_lease_request = scheduling_key_entry.pending_lease_request;
 
-  if (pending_lease_request.first) {
+  if (pending_lease_request.first ||
+      scheduling_key_entry.pending_gang_lease_requests > 0) {
     // There's already an outstanding lease request for this type of task.
     return;
   }
@@ -446,8 +523,10 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
   // enough room in an existing worker's pipeline to send the new tasks. If the pipelines
   // are not full, we do not request a new worker (unless work stealing is enabled, in
   // which case we can request a worker under the Eager Worker Requesting mode)
-  if (!scheduling_key_entry.AllPipelinesToWorkersFull(max_tasks_in_flight_per_worker_) &&
-      max_tasks_in_flight_per_worker_ == 1) {
+  const bool is_gang = scheduling_key_entry.gang_size > 0;
+  if (!scheduling_key_entry.AllPipelinesToWorkersFull(
+          MaxTasksInFlightPerWorker(scheduling_key_entry)) &&
+      !WorkStealingEnabled(scheduling_key_entry)) {
     // The pipelines to the current workers are not full yet, so we don't need more
     // workers.
     return;
@@ -461,7 +540,7 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
   // have any tasks to execute on that worker.
   if (task_queue.empty()) {
     // If any worker has more than one task in flight, then that task can be stolen.
-    bool stealable_tasks = scheduling_key_entry.StealableTasks();
+    bool stealable_tasks = HasStealableTasks(scheduling_key_entry);
     if (!stealable_tasks) {
       if (scheduling_key_entry.CanDelete()) {
         // We can safely remove the entry keyed by scheduling_key from the
@@ -472,10 +551,22 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
     }
   }
 
+  if (is_gang && !scheduling_key_entry.gang_queued) {
+    // Wait until the dependencies of every task of the gang are resolved, so that the
+    // raylet reserves workers for all of them at once.
+    if (task_queue.size() < static_cast<size_t>(scheduling_key_entry.gang_size)) {
+      return;
+    }
+    scheduling_key_entry.gang_queued = true;
+  }
+
   // Create a TaskSpecification with an overwritten TaskID to make sure we don't reuse the
   // same TaskID to request a worker
   auto resource_spec_msg = scheduling_key_entry.resource_spec.GetMutableMessage();
   resource_spec_msg.set_task_id(TaskID::ForFakeTask().Binary());
+  if (RayConfig::instance().scheduler_locality_weight() > 0) {
+    lease_policy_->AddArgObjectLocations(&resource_spec_msg);
+  }
   TaskSpecification resource_spec = TaskSpecification(resource_spec_msg);
 
   rpc::Address best_node_address;
@@ -487,6 +578,41 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
 
   auto lease_client = GetOrConnectLeaseClient(raylet_address);
   TaskID task_id = resource_spec.TaskId();
+
+  // Request enough leases for the queued tasks in a single round trip. Actor creation
+  // tasks always request a single lease, and a gang requests a lease for every queued
+  // task at once.
+  uint32_t num_leases = 1;
+  if (is_gang) {
+    num_leases = task_queue.size();
+  } else if (max_worker_leases_per_request_ > 1 && std::get<2>(scheduling_key).IsNil()) {
+    const size_t max_tasks_in_flight_per_worker =
+        MaxTasksInFlightPerWorker(scheduling_key_entry);
+    const size_t num_workers_needed =
+        (task_queue.size() + max_tasks_in_flight_per_worker - 1) /
+        max_tasks_in_flight_per_worker;
+    num_leases = std::max<size_t>(
+        std::min<size_t>(num_workers_needed, max_worker_leases_per_request_), 1);
+  }
+  if (num_leases > 1) {
+    // The first lease ID is the one that is canceled by CancelWorkerLeaseIfNeeded.
+    std::vector<TaskID> lease_ids = {task_id};
+    for (uint32_t i = 1; i < num_leases; i++) {
+      lease_ids.push_back(TaskID::ForFakeTask());
+    }
+    lease_client->RequestWorkerLeases(
+        resource_spec, lease_ids,
+        [this, scheduling_key](const Status &status,
+                               const rpc::RequestWorkerLeasesReply &reply) {
+          absl::MutexLock lock(&mu_);
+          HandleWorkerLeasesReply(scheduling_key, status, reply);
+        },
+        /*backlog_size=*/static_cast<int64_t>(task_queue.size()) - num_leases,
+        /*gang=*/is_gang);
+    pending_lease_request = std::make_pair(lease_client, task_id);
+    return;
+  }
+
   // Subtract 1 so we don't double count the task we are requesting for.
   int64_t queue_size = task_queue.size() - 1;
 
@@ -548,6 +674,117 @@ void CoreWorkerDirectTaskSubmitter::RequestNewWorkerIfNeeded(
   pending_lease_request = std::make_pair(lease_client, task_id);
 }
 
+void CoreWorkerDirectTaskSubmitter::HandleWorkerLeasesReply(
+    const SchedulingKey &scheduling_key, const Status &status,
+    const rpc::RequestWorkerLeasesReply &reply) {
+  auto &pending_lease_request =
+      scheduling_key_entries_[scheduling_key].pending_lease_request;
+  RAY_CHECK(pending_lease_request.first);
+  const auto lease_client = pending_lease_request.first;
+  const auto task_id = pending_lease_request.second;
+
+  if (!status.ok()) {
+    pending_lease_request = std::make_pair(nullptr, TaskID::Nil());
+    if (lease_client != local_lease_client_) {
+      // A lease request to a remote raylet failed. Retry locally if the leases are
+      // still needed.
+      RAY_LOG(ERROR) << "Retrying attempt to schedule tasks at remote node. Error: "
+                     << status.ToString();
+      RequestNewWorkerIfNeeded(scheduling_key);
+      return;
+    }
+    RAY_LOG(ERROR) << "The worker failed to receive a response from the local "
+                      "raylet. This is most likely because the local raylet has "
+                      "crashed.";
+    RAY_LOG(FATAL) << status.ToString();
+  }
+
+  RAY_LOG(DEBUG) << "Batched lease request " << task_id << " returned "
+                 << reply.replies_size() << " replies";
+  // The lease request stays pending while the granted workers are set up, so that
+  // they don't each trigger a new lease request before all the grants are known. Its
+  // ID is cleared since there is nothing left to cancel at the raylet.
+  pending_lease_request.second = TaskID::Nil();
+  absl::optional<rpc::Address> retry_at_raylet_address;
+  // The spilled back leases of a gang, by reservation: the raylet that holds the
+  // reservation and the number of leases in it.
+  absl::flat_hash_map<std::string, std::pair<rpc::Address, int64_t>> gang_reservations;
+  for (const auto &lease_reply : reply.replies()) {
+    if (lease_reply.canceled()) {
+      continue;
+    } else if (!lease_reply.worker_address().raylet_id().empty()) {
+      rpc::WorkerAddress addr(lease_reply.worker_address());
+      AddWorkerLeaseClient(addr, lease_client, lease_reply.resource_mapping(),
+                           scheduling_key);
+      OnWorkerIdle(addr, scheduling_key, /*error=*/false, lease_reply.resource_mapping());
+    } else if (!lease_reply.gang_reservation_id().empty()) {
+      auto &reservation = gang_reservations[lease_reply.gang_reservation_id()];
+      reservation.first = lease_reply.retry_at_raylet_address();
+      reservation.second++;
+    } else if (!retry_at_raylet_address.has_value()) {
+      retry_at_raylet_address = lease_reply.retry_at_raylet_address();
+    }
+  }
+  // Claim the reservations before the lease request is cleared, so that no other lease
+  // request is sent in the meantime.
+  for (const auto &entry : gang_reservations) {
+    RequestReservedGangLeases(scheduling_key, entry.second.first,
+                              TaskID::FromBinary(entry.first), entry.second.second);
+  }
+  scheduling_key_entries_[scheduling_key].pending_lease_request =
+      std::make_pair(nullptr, TaskID::Nil());
+  // Request the leases that are still needed at the first spillback target, if any.
+  RequestNewWorkerIfNeeded(scheduling_key, retry_at_raylet_address.has_value()
+                                               ? &retry_at_raylet_address.value()
+                                               : nullptr);
+}
+
+void CoreWorkerDirectTaskSubmitter::RequestReservedGangLeases(
+    const SchedulingKey &scheduling_key, const rpc::Address &raylet_address,
+    const TaskID &reservation_id, int64_t num_leases) {
+  auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
+  auto lease_client = GetOrConnectLeaseClient(&raylet_address);
+  std::vector<TaskID> lease_ids;
+  for (int64_t i = 0; i < num_leases; i++) {
+    lease_ids.push_back(TaskID::ForFakeTask());
+  }
+  auto resource_spec_msg = scheduling_key_entry.resource_spec.GetMutableMessage();
+  resource_spec_msg.set_task_id(lease_ids[0].Binary());
+  RAY_LOG(DEBUG) << "Claiming " << num_leases << " gang leases reserved under "
+                 << reservation_id;
+  scheduling_key_entry.pending_gang_lease_requests++;
+  lease_client->RequestWorkerLeases(
+      TaskSpecification(resource_spec_msg), lease_ids,
+      [this, scheduling_key, lease_client](const Status &status,
+                                           const rpc::RequestWorkerLeasesReply &reply) {
+        absl::MutexLock lock(&mu_);
+        auto &scheduling_key_entry = scheduling_key_entries_[scheduling_key];
+        RAY_CHECK(scheduling_key_entry.pending_gang_lease_requests > 0);
+        scheduling_key_entry.pending_gang_lease_requests--;
+        if (!status.ok()) {
+          // The reservation expires at the raylet. Request the leases again.
+          RAY_LOG(ERROR) << "Failed to claim reserved gang leases. Error: "
+                         << status.ToString();
+        } else {
+          for (const auto &lease_reply : reply.replies()) {
+            if (lease_reply.worker_address().raylet_id().empty()) {
+              // The reservation expired before it was claimed.
+              continue;
+            }
+            rpc::WorkerAddress addr(lease_reply.worker_address());
+            AddWorkerLeaseClient(addr, lease_client, lease_reply.resource_mapping(),
+                                 scheduling_key);
+            OnWorkerIdle(addr, scheduling_key, /*error=*/false,
+                         lease_reply.resource_mapping());
+          }
+        }
+        RequestNewWorkerIfNeeded(scheduling_key);
+      },
+      /*backlog_size=*/
+      static_cast<int64_t>(scheduling_key_entry.task_queue.size()) - num_leases,
+      /*gang=*/false, reservation_id);
+}
+
 void CoreWorkerDirectTaskSubmitter::PushNormalTask(
     const rpc::WorkerAddress &addr, rpc::CoreWorkerClientInterface &client,
     const SchedulingKey &scheduling_key, const TaskSpecification &task_spec,
@@ -563,10 +800,11 @@ void CoreWorkerDirectTaskSubmitter::PushNormalTask(
   request->mutable_task_spec()->CopyFrom(task_spec.GetMessage());
   request->mutable_resource_mapping()->CopyFrom(assigned_resources);
   request->set_intended_worker_id(addr.worker_id.Binary());
+  const int64_t push_time_us = current_time_us();
   client.PushNormalTask(
       std::move(request),
       [this, task_spec, task_id, is_actor, is_actor_creation, scheduling_key, addr,
-       assigned_resources](Status status, const rpc::PushTaskReply &reply) {
+       assigned_resources, push_time_us](Status status, const rpc::PushTaskReply &reply) {
         {
           absl::MutexLock lock(&mu_);
           executing_tasks_.erase(task_id);
@@ -582,6 +820,12 @@ void CoreWorkerDirectTaskSubmitter::PushNormalTask(
           RAY_CHECK(scheduling_key_entry.active_workers.size() >= 1);
           RAY_CHECK(scheduling_key_entry.total_tasks_in_flight >= 1);
           scheduling_key_entry.total_tasks_in_flight--;
+          if (adaptive_max_tasks_in_flight_per_worker_ && status.ok() &&
+              !reply.task_stolen()) {
+            scheduling_key_entry.RecordTaskLatency(current_time_us() - push_time_us,
+                                                   reply.worker_handling_time_us(),
+                                                   reply.task_execution_time_us());
+          }
 
           if (reply.worker_exiting()) {
             RAY_LOG(DEBUG) << "Worker " << addr.worker_id
@@ -625,9 +869,7 @@ void CoreWorkerDirectTaskSubmitter::PushNormalTask(
 Status CoreWorkerDirectTaskSubmitter::CancelTask(TaskSpecification task_spec,
                                                  bool force_kill, bool recursive) {
   RAY_LOG(INFO) << "Killing task: " << task_spec.TaskId();
-  const SchedulingKey scheduling_key(
-      task_spec.GetSchedulingClass(), task_spec.GetDependencyIds(),
-      task_spec.IsActorCreationTask() ? task_spec.ActorCreationId() : ActorID::Nil());
+  const SchedulingKey scheduling_key = GetSchedulingKey(task_spec);
   std::shared_ptr<rpc::CoreWorkerClientInterface> client = nullptr;
   {
     absl::MutexLock lock(&mu_);
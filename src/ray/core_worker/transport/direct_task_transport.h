@@ -16,6 +16,9 @@
 
 #include <google/protobuf/repeated_field.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "ray/common/id.h"
@@ -45,8 +48,12 @@ typedef std::function<std::shared_ptr<WorkerLeaseInterface>(const std::string &i
 // would always request a new worker lease. We need this to let raylet know about
 // direct actor creation task, and reconstruct the actor if it dies. Otherwise if
 // the actor creation task just reuses an existing worker, then raylet will not
-// be aware of the actor and is not able to manage it.
-using SchedulingKey = std::tuple<SchedulingClass, std::vector<ObjectID>, ActorID>;
+// be aware of the actor and is not able to manage it. It's also keyed on the gang
+// ID, so that the tasks of a gang are leased workers together and apart from other
+// tasks. Finally, it's keyed on the priority, so that a lease request never carries
+// tasks of a lower priority to the head of the raylet's queue.
+using SchedulingKey =
+    std::tuple<SchedulingClass, std::vector<ObjectID>, ActorID, TaskID, int32_t>;
 
 // This class is thread-safe.
 class CoreWorkerDirectTaskSubmitter {
@@ -61,7 +68,13 @@ class CoreWorkerDirectTaskSubmitter {
       int64_t lease_timeout_ms, std::shared_ptr<ActorCreatorInterface> actor_creator,
       uint32_t max_tasks_in_flight_per_worker =
           RayConfig::instance().max_tasks_in_flight_per_worker(),
-      absl::optional<boost::asio::steady_timer> cancel_timer = absl::nullopt)
+      absl::optional<boost::asio::steady_timer> cancel_timer = absl::nullopt,
+      bool adaptive_max_tasks_in_flight_per_worker =
+          RayConfig::instance().adaptive_max_tasks_in_flight_per_worker(),
+      bool worker_lease_retargeting_enabled =
+          RayConfig::instance().worker_lease_retargeting_enabled(),
+      uint32_t max_worker_leases_per_request =
+          RayConfig::instance().max_worker_leases_per_request())
       : rpc_address_(rpc_address),
         local_lease_client_(lease_client),
         lease_client_factory_(lease_client_factory),
@@ -73,6 +86,10 @@ class CoreWorkerDirectTaskSubmitter {
         actor_creator_(std::move(actor_creator)),
         client_cache_(core_worker_client_pool),
         max_tasks_in_flight_per_worker_(max_tasks_in_flight_per_worker),
+        adaptive_max_tasks_in_flight_per_worker_(adaptive_max_tasks_in_flight_per_worker),
+        worker_lease_retargeting_enabled_(worker_lease_retargeting_enabled),
+        max_worker_leases_per_request_(
+            std::max<uint32_t>(max_worker_leases_per_request, 1)),
         cancel_retry_timer_(std::move(cancel_timer)) {}
 
   /// Schedule a task for direct submission to a worker.
@@ -95,7 +112,21 @@ class CoreWorkerDirectTaskSubmitter {
     return scheduling_key_entries_.empty();
   }
 
+  /// Get the number of tasks that may currently be pipelined to a worker leased for the
+  /// given task's scheduling key. Exposed for testing.
+  uint32_t GetMaxTasksInFlightPerWorkerPublic(const TaskSpecification &task_spec) {
+    absl::MutexLock lock(&mu_);
+    auto it = scheduling_key_entries_.find(GetSchedulingKey(task_spec));
+    if (it == scheduling_key_entries_.end()) {
+      return max_tasks_in_flight_per_worker_;
+    }
+    return MaxTasksInFlightPerWorker(it->second);
+  }
+
  private:
+  /// Get the key of the queue that a task waits in for a worker.
+  static SchedulingKey GetSchedulingKey(const TaskSpecification &task_spec);
+
   /// Schedule more work onto an idle worker or return it back to the raylet if
   /// no more tasks are queued for submission. If an error was encountered
   /// processing the worker, we don't attempt to re-use the worker.
@@ -123,6 +154,29 @@ class CoreWorkerDirectTaskSubmitter {
                                 const rpc::Address *raylet_address = nullptr)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  /// Handle the reply to a batched worker lease request: set up the granted workers
+  /// and retry at the first spillback target, if any. There is only one lease request
+  /// in flight per scheduling key, so the leases spilled back to other nodes are
+  /// requested again from the first target, which spills them back further if it
+  /// cannot grant them. Leases that the raylet could not place are returned as
+  /// canceled and are requested again if still needed. The leases of a gang that were
+  /// spilled back are instead claimed from the reservations of their targets.
+  void HandleWorkerLeasesReply(const SchedulingKey &scheduling_key, const Status &status,
+                               const rpc::RequestWorkerLeasesReply &reply)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Request the leases of a gang that a raylet reserved for them on another node.
+  /// No other lease request is sent for the scheduling key until this one returns.
+  ///
+  /// \param scheduling_key The scheduling key of the gang.
+  /// \param raylet_address The raylet that holds the reservation.
+  /// \param reservation_id The ID of the reservation.
+  /// \param num_leases The number of leases in the reservation.
+  void RequestReservedGangLeases(const SchedulingKey &scheduling_key,
+                                 const rpc::Address &raylet_address,
+                                 const TaskID &reservation_id, int64_t num_leases)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   /// Cancel a pending worker lease and retry until the cancellation succeeds
   /// (i.e., the raylet drops the request). This should be called when there
   /// are no more tasks queued with the given scheduling key and there is an
@@ -142,6 +196,19 @@ class CoreWorkerDirectTaskSubmitter {
   void ReturnWorker(const rpc::WorkerAddress addr, bool was_error,
                     const SchedulingKey &scheduling_key) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  /// Hand an idle worker over to another scheduling key with queued tasks that can
+  /// run under the worker's lease: the tasks must not create an actor, must have the
+  /// same language, runtime env and resource shape, and the lease policy must pick
+  /// the worker's node for them. This saves a RequestWorkerLease round trip to the
+  /// raylet for the other scheduling key.
+  ///
+  /// \param[in] addr The address of the idle worker.
+  /// \param[in] scheduling_key The scheduling key the worker is currently leased for.
+  /// \return Whether the worker was handed over to another scheduling key.
+  bool RetargetWorkerLease(const rpc::WorkerAddress &addr,
+                           const SchedulingKey &scheduling_key)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   /// Check that the scheduling_key_entries_ hashmap is empty.
   inline bool CheckNoSchedulingKeyEntries() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     return scheduling_key_entries_.empty();
@@ -225,6 +292,17 @@ class CoreWorkerDirectTaskSubmitter {
   // worker using a single lease.
   const uint32_t max_tasks_in_flight_per_worker_;
 
+  // If true, the number of tasks pipelined to a worker is adapted per SchedulingKey,
+  // with max_tasks_in_flight_per_worker_ as the upper bound.
+  const bool adaptive_max_tasks_in_flight_per_worker_;
+
+  // If true, idle workers may be handed over to compatible scheduling keys instead of
+  // being returned to the raylet.
+  const bool worker_lease_retargeting_enabled_;
+
+  // The maximum number of worker leases requested in one RPC for a SchedulingKey.
+  const uint32_t max_worker_leases_per_request_;
+
   /// A LeaseEntry struct is used to condense the metadata about a single executor:
   /// (1) The lease client through which the worker should be returned
   /// (2) The expiration time of a worker's lease.
@@ -246,15 +324,17 @@ class CoreWorkerDirectTaskSubmitter {
         google::protobuf::RepeatedPtrField<rpc::ResourceMapEntry> assigned_resources =
             google::protobuf::RepeatedPtrField<rpc::ResourceMapEntry>(),
         SchedulingKey scheduling_key = std::make_tuple(0, std::vector<ObjectID>(),
-                                                       ActorID::Nil()))
+                                                       ActorID::Nil(), TaskID::Nil(), 0))
         : lease_client(lease_client),
           lease_expiration_time(lease_expiration_time),
           assigned_resources(assigned_resources),
           scheduling_key(scheduling_key) {}
 
     // Check whether the pipeline to the worker associated with a LeaseEntry is full.
+    // The pipeline depth may shrink while tasks are in flight when it is adapted, so
+    // this also holds if more tasks than the current maximum are in flight.
     inline bool PipelineToWorkerFull(uint32_t max_tasks_in_flight_per_worker) const {
-      return tasks_in_flight == max_tasks_in_flight_per_worker;
+      return tasks_in_flight >= max_tasks_in_flight_per_worker;
     }
 
     // Check whether the worker is a thief who is in the process of stealing tasks.
@@ -296,12 +376,26 @@ class CoreWorkerDirectTaskSubmitter {
         absl::flat_hash_set<rpc::WorkerAddress>();
     // Keep track of how many tasks with this SchedulingKey are in flight, in total
     uint32_t total_tasks_in_flight = 0;
+    // The number of tasks in the gang of this SchedulingKey, or 0 if it is not a gang.
+    int32_t gang_size = 0;
+    // Whether every task of the gang has been queued once. Until then, no worker is
+    // requested for the gang.
+    bool gang_queued = false;
+    // The number of lease requests in flight that claim the reservations of the gang
+    // on the nodes that its leases were spilled back to.
+    uint32_t pending_gang_lease_requests = 0;
+    // Moving averages of the execution time reported by the workers and of the rest of
+    // the PushNormalTask round trip (network, serialization, RPC handling), for tasks
+    // with this SchedulingKey. Negative until the first task has finished.
+    double avg_task_execution_time_us = -1;
+    double avg_rpc_overhead_us = -1;
 
     // Check whether it's safe to delete this SchedulingKeyEntry from the
     // scheduling_key_entries_ hashmap.
     inline bool CanDelete() const {
-      if (!pending_lease_request.first && task_queue.empty() &&
-          active_workers.size() == 0 && total_tasks_in_flight == 0) {
+      if (!pending_lease_request.first && pending_gang_lease_requests == 0 &&
+          task_queue.empty() && active_workers.size() == 0 &&
+          total_tasks_in_flight == 0) {
         return true;
       }
 
@@ -327,8 +421,71 @@ class CoreWorkerDirectTaskSubmitter {
       // If any worker has more than one task in flight, then that task can be stolen.
       return total_tasks_in_flight > active_workers.size();
     }
+
+    // Record the latency breakdown of a finished task.
+    inline void RecordTaskLatency(int64_t round_trip_time_us,
+                                  int64_t worker_handling_time_us,
+                                  int64_t task_execution_time_us) {
+      // Weight of a new sample in the moving averages.
+      static constexpr double kAlpha = 0.2;
+      const double overhead_us =
+          std::max<int64_t>(round_trip_time_us - worker_handling_time_us, 0);
+      const double execution_time_us = std::max<int64_t>(task_execution_time_us, 0);
+      if (avg_rpc_overhead_us < 0) {
+        avg_rpc_overhead_us = overhead_us;
+        avg_task_execution_time_us = execution_time_us;
+      } else {
+        avg_rpc_overhead_us += kAlpha * (overhead_us - avg_rpc_overhead_us);
+        avg_task_execution_time_us +=
+            kAlpha * (execution_time_us - avg_task_execution_time_us);
+      }
+    }
+
+    // Compute the pipeline depth that hides the RPC overhead behind task execution:
+    // while a worker executes one task, the next ones should already be on their way.
+    // Tasks that run much longer than the overhead get a depth of 1; tiny tasks get up
+    // to max_tasks_in_flight_per_worker.
+    inline uint32_t AdaptivePipelineDepth(uint32_t max_tasks_in_flight_per_worker) const {
+      if (avg_rpc_overhead_us < 0 ||
+          avg_task_execution_time_us * max_tasks_in_flight_per_worker <=
+              avg_rpc_overhead_us) {
+        // No measurement yet, or the tasks are too short to ever fill the pipeline.
+        return max_tasks_in_flight_per_worker;
+      }
+      const double depth =
+          1 + std::round(avg_rpc_overhead_us / avg_task_execution_time_us);
+      return std::min<uint32_t>(static_cast<uint32_t>(depth),
+                                max_tasks_in_flight_per_worker);
+    }
   };
 
+  /// Get the current maximum number of tasks in flight to each worker leased for a
+  /// scheduling key.
+  inline uint32_t MaxTasksInFlightPerWorker(const SchedulingKeyEntry &entry) const {
+    if (entry.gang_size > 0) {
+      // Every task of a gang runs on its own worker.
+      return 1;
+    }
+    if (!adaptive_max_tasks_in_flight_per_worker_) {
+      return max_tasks_in_flight_per_worker_;
+    }
+    return entry.AdaptivePipelineDepth(max_tasks_in_flight_per_worker_);
+  }
+
+  /// Whether idle workers leased for a scheduling key may steal tasks pipelined to its
+  /// other workers. Stealing follows the current pipeline depth of the key rather than
+  /// the static cap: once adaptive pipelining has shrunk the depth to a single task,
+  /// tasks that were pipelined earlier are left with their worker, and idle workers are
+  /// retargeted or returned instead.
+  inline bool WorkStealingEnabled(const SchedulingKeyEntry &entry) const {
+    return MaxTasksInFlightPerWorker(entry) > 1;
+  }
+
+  /// Whether an idle or newly leased worker could steal tasks for a scheduling key.
+  inline bool HasStealableTasks(const SchedulingKeyEntry &entry) const {
+    return WorkStealingEnabled(entry) && entry.StealableTasks();
+  }
+
   // For each Scheduling Key, scheduling_key_entries_ contains a SchedulingKeyEntry struct
   // with the queue of tasks belonging to that SchedulingKey, together with the other
   // fields that are needed to orchestrate the execution of those tasks by the workers.
@@ -0,0 +1,517 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/core_worker/transport/shared_memory_transport.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "ray/common/ray_config.h"
+#include "ray/object_manager/plasma/fling.h"
+
+namespace ray {
+
+namespace {
+
+/// Every record in a ring starts with one of these, so that messages larger than a
+/// record can be split into several.
+constexpr char kLastFragment = 0;
+constexpr char kMoreFragments = 1;
+
+/// How long a caller waits for the actor to accept its rings.
+constexpr int kHandshakeTimeoutMs = 1000;
+
+#ifdef __linux__
+
+/// The address of the abstract Unix socket that a worker accepts connections on.
+/// Abstract sockets need no file on disk, and disappear when the worker exits.
+socklen_t MakeSocketAddress(const WorkerID &worker_id, struct sockaddr_un *address) {
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  const std::string name = "ray_actor_" + worker_id.Hex();
+  RAY_CHECK(name.size() + 1 <= sizeof(address->sun_path));
+  // The leading NUL byte puts the socket in the abstract namespace.
+  std::memcpy(address->sun_path + 1, name.data(), name.size());
+  return offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+}
+
+/// Whether the peer at the other end of the socket has gone away.
+bool PeerClosed(int socket_fd) {
+  struct pollfd fds = {socket_fd, POLLIN, 0};
+  return poll(&fds, 1, 0) > 0;
+}
+
+#endif
+
+}  // namespace
+
+#ifdef __linux__
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+  if (socket_fd >= 0) {
+    close(socket_fd);
+  }
+}
+
+bool SharedMemoryChannel::WriteMessage(SharedMemoryRing &ring,
+                                       const std::string &message) {
+  absl::MutexLock lock(&write_mu);
+  const size_t max_fragment_size = ring.MaxMessageSize() - 1;
+  size_t offset = 0;
+  std::string record;
+  do {
+    const size_t fragment_size = std::min(max_fragment_size, message.size() - offset);
+    const bool last = offset + fragment_size == message.size();
+    record.assign(1, last ? kLastFragment : kMoreFragments);
+    record.append(message, offset, fragment_size);
+    while (!ring.TryWrite(record.data(), record.size())) {
+      // The reader is behind. It only stops reading for good if its process exits.
+      if (ring.Corrupted() || PeerClosed(socket_fd)) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    offset += fragment_size;
+  } while (offset < message.size());
+  return true;
+}
+
+bool SharedMemoryChannel::ReadMessage(SharedMemoryRing &ring, std::string *message) {
+  const int64_t spin_us = RayConfig::instance().actor_shared_memory_spin_us();
+  message->clear();
+  std::string record;
+  while (true) {
+    if (!ring.WaitForMessage(spin_us, socket_fd)) {
+      return false;
+    }
+    // The ring has a message, so a failed read means that it is corrupted.
+    if (!ring.TryRead(&record)) {
+      return false;
+    }
+    if (record.empty() || (record[0] != kLastFragment && record[0] != kMoreFragments)) {
+      RAY_LOG(WARNING) << "Received a malformed shared memory message";
+      return false;
+    }
+    message->append(record, 1, std::string::npos);
+    if (record[0] == kLastFragment) {
+      return true;
+    }
+  }
+}
+
+SharedMemoryCoreWorkerClient::SharedMemoryCoreWorkerClient(
+    const rpc::Address &address, rpc::ClientCallManager &client_call_manager)
+    : rpc::CoreWorkerClient(address, client_call_manager),
+      reply_service_(client_call_manager.GetMainService()),
+      channel_(std::make_unique<SharedMemoryChannel>()) {
+  channel_->socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  RAY_CHECK(channel_->socket_fd >= 0)
+      << "Failed to create socket: " << std::strerror(errno);
+  // The handshake waits for the actor, so it runs on the reply thread rather than on
+  // the caller's event loop. Tasks go over gRPC until it completes.
+  reply_thread_ = std::thread([this]() {
+    if (Handshake()) {
+      ReceiveReplies();
+    }
+  });
+}
+
+SharedMemoryCoreWorkerClient::~SharedMemoryCoreWorkerClient() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopped_ = true;
+  }
+  // Wake up the reply thread, whether it is still in the handshake or reading
+  // replies. It never runs reply callbacks itself, so it cannot be the thread
+  // destroying this client.
+  shutdown(channel_->socket_fd, SHUT_RDWR);
+  reply_thread_.join();
+}
+
+bool SharedMemoryCoreWorkerClient::Handshake() {
+  const auto worker_id = WorkerID::FromBinary(Addr().worker_id());
+  const int socket_fd = channel_->socket_fd;
+  struct sockaddr_un socket_address;
+  socklen_t address_size = MakeSocketAddress(worker_id, &socket_address);
+  if (connect(socket_fd, reinterpret_cast<struct sockaddr *>(&socket_address),
+              address_size) != 0) {
+    // The worker is not an actor, or it does not accept shared-memory connections.
+    RAY_LOG(DEBUG) << "Worker " << worker_id
+                   << " is not reachable over shared memory, using gRPC";
+    return false;
+  }
+  {
+    // A shutdown before the socket was connected did not wake anything up.
+    absl::MutexLock lock(&mu_);
+    if (stopped_) {
+      return false;
+    }
+  }
+  const size_t ring_bytes = RayConfig::instance().actor_shared_memory_ring_bytes();
+  auto request_ring = SharedMemoryRing::Create(ring_bytes);
+  auto reply_ring = SharedMemoryRing::Create(ring_bytes);
+  if (request_ring == nullptr || reply_ring == nullptr) {
+    return false;
+  }
+  for (int fd : {request_ring->MemoryFd(), request_ring->EventFd(),
+                 reply_ring->MemoryFd(), reply_ring->EventFd()}) {
+    if (send_fd(socket_fd, fd) < 0) {
+      RAY_LOG(WARNING) << "Failed to send shared memory ring to worker " << worker_id;
+      return false;
+    }
+  }
+  // Wait for the worker to map the rings before sending anything through them.
+  struct pollfd fds = {socket_fd, POLLIN, 0};
+  char ack = 0;
+  if (poll(&fds, 1, kHandshakeTimeoutMs) <= 0 || read(socket_fd, &ack, 1) != 1) {
+    RAY_LOG(WARNING) << "Worker " << worker_id
+                     << " did not accept the shared memory connection, using gRPC";
+    return false;
+  }
+
+  RAY_LOG(DEBUG) << "Pushing actor tasks to worker " << worker_id
+                 << " over shared memory";
+  absl::MutexLock lock(&mu_);
+  if (stopped_) {
+    return false;
+  }
+  channel_->request_ring = std::move(request_ring);
+  channel_->reply_ring = std::move(reply_ring);
+  connected_ = true;
+  return true;
+}
+
+bool SharedMemoryCoreWorkerClient::IsConnected() const {
+  absl::MutexLock lock(&mu_);
+  return connected_;
+}
+
+void SharedMemoryCoreWorkerClient::PushActorTask(
+    std::unique_ptr<rpc::PushTaskRequest> request, bool skip_queue,
+    const rpc::ClientCallback<rpc::PushTaskReply> &callback) {
+  if (!TryPushOverSharedMemory(*request, callback)) {
+    rpc::CoreWorkerClient::PushActorTask(std::move(request), skip_queue, callback);
+  }
+}
+
+void SharedMemoryCoreWorkerClient::PushActorTasks(
+    std::vector<rpc::PushTaskRequestAndCallback> requests, size_t max_batch_size) {
+  std::vector<rpc::PushTaskRequestAndCallback> remaining;
+  for (auto &request : requests) {
+    if (!TryPushOverSharedMemory(*request.first, request.second)) {
+      remaining.push_back(std::move(request));
+    }
+  }
+  if (!remaining.empty()) {
+    rpc::CoreWorkerClient::PushActorTasks(std::move(remaining), max_batch_size);
+  }
+}
+
+bool SharedMemoryCoreWorkerClient::TryPushOverSharedMemory(
+    rpc::PushTaskRequest &request,
+    const rpc::ClientCallback<rpc::PushTaskReply> &callback) {
+  absl::MutexLock lock(&mu_);
+  if (!connected_) {
+    return false;
+  }
+  // The actor orders tasks by sequence number, so tasks that go over gRPC because
+  // the ring is full are still executed in order. Unlike the gRPC path, nothing
+  // tracks which tasks have finished, so the actor must not skip any.
+  const int64_t original_processed_up_to = request.client_processed_up_to();
+  request.set_client_processed_up_to(-1);
+  rpc::SharedMemoryPushTaskRequest message;
+  message.set_request_id(next_request_id_);
+  message.mutable_request()->Swap(&request);
+  std::string record(1, kLastFragment);
+  message.AppendToString(&record);
+  bool written;
+  {
+    absl::MutexLock write_lock(&channel_->write_mu);
+    written = channel_->request_ring->TryWrite(record.data(), record.size());
+  }
+  message.mutable_request()->Swap(&request);
+  if (!written) {
+    // Too large for the ring, or the actor is behind.
+    request.set_client_processed_up_to(original_processed_up_to);
+    return false;
+  }
+  pending_callbacks_.emplace(next_request_id_++, callback);
+  return true;
+}
+
+void SharedMemoryCoreWorkerClient::ReceiveReplies() {
+  std::string data;
+  rpc::SharedMemoryPushTaskReply message;
+  while (channel_->ReadMessage(*channel_->reply_ring, &data)) {
+    if (!message.ParseFromString(data)) {
+      RAY_LOG(WARNING) << "Failed to parse a shared memory reply";
+      break;
+    }
+    rpc::ClientCallback<rpc::PushTaskReply> callback;
+    {
+      absl::MutexLock lock(&mu_);
+      auto it = pending_callbacks_.find(message.request_id());
+      if (it == pending_callbacks_.end()) {
+        RAY_LOG(WARNING) << "Received a shared memory reply for unknown request "
+                         << message.request_id();
+        break;
+      }
+      callback = std::move(it->second);
+      pending_callbacks_.erase(it);
+    }
+    // Report a failed task the same way as a failed PushTask RPC.
+    Status status =
+        message.status().ok()
+            ? Status::OK()
+            : GrpcStatusToRayStatus(
+                  grpc::Status(grpc::StatusCode::UNKNOWN, message.status().message()));
+    reply_service_.post(
+        [callback = std::move(callback), status, reply = message.reply()]() {
+          callback(status, reply);
+        },
+        "SharedMemoryCoreWorkerClient.PushActorTask");
+  }
+
+  // Whether the actor closed the connection or sent something malformed, stop using
+  // the rings. Closing our end tells the actor to stop reading too.
+  shutdown(channel_->socket_fd, SHUT_RDWR);
+  absl::flat_hash_map<int64_t, rpc::ClientCallback<rpc::PushTaskReply>> failed;
+  {
+    absl::MutexLock lock(&mu_);
+    connected_ = false;
+    failed.swap(pending_callbacks_);
+  }
+  if (!failed.empty()) {
+    RAY_LOG(INFO) << "Shared memory connection to worker "
+                  << WorkerID::FromBinary(Addr().worker_id()) << " closed, failing "
+                  << failed.size() << " actor tasks";
+  }
+  for (auto &entry : failed) {
+    reply_service_.post(
+        [callback = std::move(entry.second)]() {
+          callback(Status::IOError("Shared memory connection to the actor closed"),
+                   rpc::PushTaskReply());
+        },
+        "SharedMemoryCoreWorkerClient.PushActorTask");
+  }
+}
+
+SharedMemoryTaskServer::SharedMemoryTaskServer(const WorkerID &worker_id,
+                                               PushTaskHandler handler)
+    : handler_(std::move(handler)) {
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  RAY_CHECK(listen_fd_ >= 0) << "Failed to create socket: " << std::strerror(errno);
+  struct sockaddr_un socket_address;
+  socklen_t address_size = MakeSocketAddress(worker_id, &socket_address);
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&socket_address),
+           address_size) != 0 ||
+      listen(listen_fd_, SOMAXCONN) != 0) {
+    // Callers will fall back to gRPC.
+    RAY_LOG(WARNING) << "Failed to listen for shared memory connections: "
+                     << std::strerror(errno);
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return;
+  }
+  accept_thread_ = std::thread([this]() { AcceptConnections(); });
+}
+
+SharedMemoryTaskServer::~SharedMemoryTaskServer() {
+  if (listen_fd_ < 0) {
+    return;
+  }
+  std::list<std::pair<std::shared_ptr<SharedMemoryChannel>, std::thread>> connections;
+  {
+    absl::MutexLock lock(&mu_);
+    stopped_ = true;
+    connections.swap(connections_);
+  }
+  // Wake up the accepting thread and the threads reading from each connection.
+  shutdown(listen_fd_, SHUT_RDWR);
+  accept_thread_.join();
+  close(listen_fd_);
+  for (auto &connection : connections) {
+    shutdown(connection.first->socket_fd, SHUT_RDWR);
+    connection.second.join();
+  }
+}
+
+void SharedMemoryTaskServer::AcceptConnections() {
+  while (true) {
+    int socket_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (socket_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // The server is shutting down.
+      return;
+    }
+    auto channel = std::make_shared<SharedMemoryChannel>();
+    channel->socket_fd = socket_fd;
+    // Any local process can connect to the abstract socket. Only serve processes of
+    // the same user, like the workers of this node.
+    struct ucred credentials;
+    socklen_t credentials_size = sizeof(credentials);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &credentials,
+                   &credentials_size) != 0 ||
+        credentials.uid != getuid()) {
+      RAY_LOG(WARNING) << "Rejected a shared memory connection from another user";
+      continue;
+    }
+    int fds[4];
+    bool received = true;
+    for (int &fd : fds) {
+      fd = recv_fd(socket_fd);
+      received = received && fd >= 0;
+    }
+    if (received) {
+      channel->request_ring = SharedMemoryRing::Attach(fds[0], fds[1]);
+      channel->reply_ring = SharedMemoryRing::Attach(fds[2], fds[3]);
+    } else {
+      for (int fd : fds) {
+        if (fd >= 0) {
+          close(fd);
+        }
+      }
+    }
+    const char ack = 1;
+    if (channel->request_ring == nullptr || channel->reply_ring == nullptr ||
+        write(socket_fd, &ack, 1) != 1) {
+      RAY_LOG(WARNING) << "Rejected a shared memory connection";
+      continue;
+    }
+
+    absl::MutexLock lock(&mu_);
+    if (stopped_) {
+      return;
+    }
+    // The thread cannot look up its entry before it is added, since it has to take
+    // the lock first.
+    connections_.emplace_back(channel, std::thread());
+    connections_.back().second =
+        std::thread([this, channel]() { ServeConnection(channel); });
+  }
+}
+
+void SharedMemoryTaskServer::ServeConnection(
+    std::shared_ptr<SharedMemoryChannel> channel) {
+  std::string data;
+  while (channel->ReadMessage(*channel->request_ring, &data)) {
+    auto message = std::make_shared<rpc::SharedMemoryPushTaskRequest>();
+    if (!message->ParseFromString(data)) {
+      RAY_LOG(WARNING) << "Failed to parse a shared memory request";
+      break;
+    }
+    auto reply = std::make_shared<rpc::SharedMemoryPushTaskReply>();
+    reply->set_request_id(message->request_id());
+    // The request and reply must outlive the handler, which may reply from any thread.
+    handler_(message->request(), reply->mutable_reply(),
+             [message, reply, channel](Status status, std::function<void()> success,
+                                       std::function<void()> failure) {
+               reply->mutable_status()->set_ok(status.ok());
+               if (!status.ok()) {
+                 reply->mutable_status()->set_message(status.message());
+               }
+               const bool sent = channel->WriteMessage(*channel->reply_ring,
+                                                       reply->SerializeAsString());
+               if (sent && success != nullptr) {
+                 success();
+               } else if (!sent && failure != nullptr) {
+                 failure();
+               }
+             });
+  }
+
+  // The caller went away or sent something malformed. Close our end, so that a caller
+  // that is still there fails its pending tasks and goes back to gRPC. Unless the
+  // server is shutting down and joins this thread, drop the connection here.
+  shutdown(channel->socket_fd, SHUT_RDWR);
+  absl::MutexLock lock(&mu_);
+  if (stopped_) {
+    return;
+  }
+  for (auto it = connections_.begin(); it != connections_.end(); it++) {
+    if (it->first == channel) {
+      it->second.detach();
+      connections_.erase(it);
+      break;
+    }
+  }
+}
+
+#else
+
+SharedMemoryChannel::~SharedMemoryChannel() {}
+
+bool SharedMemoryChannel::WriteMessage(SharedMemoryRing &ring,
+                                       const std::string &message) {
+  return false;
+}
+
+bool SharedMemoryChannel::ReadMessage(SharedMemoryRing &ring, std::string *message) {
+  return false;
+}
+
+SharedMemoryCoreWorkerClient::SharedMemoryCoreWorkerClient(
+    const rpc::Address &address, rpc::ClientCallManager &client_call_manager)
+    : rpc::CoreWorkerClient(address, client_call_manager),
+      reply_service_(client_call_manager.GetMainService()) {}
+
+SharedMemoryCoreWorkerClient::~SharedMemoryCoreWorkerClient() {}
+
+bool SharedMemoryCoreWorkerClient::Handshake() { return false; }
+
+bool SharedMemoryCoreWorkerClient::IsConnected() const { return false; }
+
+void SharedMemoryCoreWorkerClient::PushActorTask(
+    std::unique_ptr<rpc::PushTaskRequest> request, bool skip_queue,
+    const rpc::ClientCallback<rpc::PushTaskReply> &callback) {
+  rpc::CoreWorkerClient::PushActorTask(std::move(request), skip_queue, callback);
+}
+
+void SharedMemoryCoreWorkerClient::PushActorTasks(
+    std::vector<rpc::PushTaskRequestAndCallback> requests, size_t max_batch_size) {
+  rpc::CoreWorkerClient::PushActorTasks(std::move(requests), max_batch_size);
+}
+
+bool SharedMemoryCoreWorkerClient::TryPushOverSharedMemory(
+    rpc::PushTaskRequest &request,
+    const rpc::ClientCallback<rpc::PushTaskReply> &callback) {
+  return false;
+}
+
+void SharedMemoryCoreWorkerClient::ReceiveReplies() {}
+
+SharedMemoryTaskServer::SharedMemoryTaskServer(const WorkerID &worker_id,
+                                               PushTaskHandler handler)
+    : handler_(std::move(handler)) {}
+
+SharedMemoryTaskServer::~SharedMemoryTaskServer() {}
+
+void SharedMemoryTaskServer::AcceptConnections() {}
+
+void SharedMemoryTaskServer::ServeConnection(
+    std::shared_ptr<SharedMemoryChannel> channel) {}
+
+#endif
+
+}  // namespace ray
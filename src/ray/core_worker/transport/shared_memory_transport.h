@@ -0,0 +1,163 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "ray/common/id.h"
+#include "ray/rpc/server_call.h"
+#include "ray/rpc/worker/core_worker_client.h"
+#include "ray/util/shared_memory_ring.h"
+
+namespace ray {
+
+/// The two directions of a shared-memory connection between a caller and an actor on
+/// the same node. The caller creates both rings and passes them to the actor over a
+/// Unix socket. The socket stays open for the lifetime of the connection, so that each
+/// side notices when the other process exits.
+struct SharedMemoryChannel {
+  ~SharedMemoryChannel();
+
+  /// Write a message, splitting it into several records if it is larger than the
+  /// ring's max message size. Blocks while the ring is full. This is thread-safe.
+  ///
+  /// \return False if the peer closed the connection.
+  bool WriteMessage(SharedMemoryRing &ring, const std::string &message)
+      LOCKS_EXCLUDED(write_mu);
+
+  /// Read the next message, blocking until one is available.
+  ///
+  /// \return False if the peer closed the connection or sent a malformed message.
+  bool ReadMessage(SharedMemoryRing &ring, std::string *message);
+
+  /// The connection to the peer.
+  int socket_fd = -1;
+  /// Carries PushTask requests from the caller to the actor.
+  std::unique_ptr<SharedMemoryRing> request_ring;
+  /// Carries PushTask replies from the actor to the caller.
+  std::unique_ptr<SharedMemoryRing> reply_ring;
+  /// Serializes writers, since each ring allows only one at a time.
+  absl::Mutex write_mu;
+};
+
+/// A client for a worker on the same node that pushes actor tasks over shared memory
+/// and everything else over gRPC. If the worker cannot be reached over shared memory,
+/// or a request does not fit into the ring, the request goes over gRPC.
+///
+/// The client connects in the background: actor tasks go over gRPC until the actor
+/// has accepted the shared-memory connection. Replies that arrive over shared memory
+/// are read on a thread of this client and handled on the same event loop as gRPC
+/// replies.
+class SharedMemoryCoreWorkerClient : public rpc::CoreWorkerClient {
+ public:
+  /// Connect to the worker over gRPC, and start connecting over shared memory. This
+  /// does not wait for the worker.
+  SharedMemoryCoreWorkerClient(const rpc::Address &address,
+                               rpc::ClientCallManager &client_call_manager);
+
+  ~SharedMemoryCoreWorkerClient();
+
+  void PushActorTask(std::unique_ptr<rpc::PushTaskRequest> request, bool skip_queue,
+                     const rpc::ClientCallback<rpc::PushTaskReply> &callback) override;
+
+  void PushActorTasks(std::vector<rpc::PushTaskRequestAndCallback> requests,
+                      size_t max_batch_size) override;
+
+  /// Whether actor tasks currently go over shared memory.
+  bool IsConnected() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  /// Try to push the task over shared memory.
+  ///
+  /// \return False if the task should go over gRPC instead. In that case the
+  /// request is left untouched.
+  bool TryPushOverSharedMemory(rpc::PushTaskRequest &request,
+                               const rpc::ClientCallback<rpc::PushTaskReply> &callback)
+      LOCKS_EXCLUDED(mu_);
+
+  /// Pass the rings to the actor and wait until it has mapped them.
+  ///
+  /// \return Whether actor tasks can go over shared memory from now on.
+  bool Handshake() LOCKS_EXCLUDED(mu_);
+
+  /// Handle replies until the actor closes the connection or sends a malformed reply,
+  /// then close the connection and fail the tasks that are still waiting for a reply.
+  /// Later tasks go over gRPC.
+  void ReceiveReplies();
+
+  /// The event loop that reply callbacks are posted to.
+  instrumented_io_context &reply_service_;
+
+  std::unique_ptr<SharedMemoryChannel> channel_;
+
+  mutable absl::Mutex mu_;
+
+  /// Whether the shared-memory connection is usable.
+  bool connected_ GUARDED_BY(mu_) = false;
+
+  /// Whether the client is being destroyed.
+  bool stopped_ GUARDED_BY(mu_) = false;
+
+  int64_t next_request_id_ GUARDED_BY(mu_) = 0;
+
+  /// The callbacks of the tasks sent over shared memory that have not been replied to.
+  absl::flat_hash_map<int64_t, rpc::ClientCallback<rpc::PushTaskReply>>
+      pending_callbacks_ GUARDED_BY(mu_);
+
+  std::thread reply_thread_;
+};
+
+/// Accepts shared-memory connections from callers on the same node, see
+/// SharedMemoryCoreWorkerClient, and hands the actor tasks they push to the handler.
+class SharedMemoryTaskServer {
+ public:
+  using PushTaskHandler = std::function<void(
+      const rpc::PushTaskRequest &, rpc::PushTaskReply *, rpc::SendReplyCallback)>;
+
+  /// Start listening for connections.
+  ///
+  /// \param worker_id The ID of this worker, which callers use to find the server.
+  /// \param handler Called on a connection's thread for every pushed task.
+  SharedMemoryTaskServer(const WorkerID &worker_id, PushTaskHandler handler);
+
+  /// Close all connections and wait for their threads to exit.
+  ~SharedMemoryTaskServer();
+
+ private:
+  void AcceptConnections();
+
+  void ServeConnection(std::shared_ptr<SharedMemoryChannel> channel);
+
+  const PushTaskHandler handler_;
+
+  int listen_fd_ = -1;
+
+  std::thread accept_thread_;
+
+  absl::Mutex mu_;
+
+  /// The open connections and the threads that serve them.
+  std::list<std::pair<std::shared_ptr<SharedMemoryChannel>, std::thread>> connections_
+      GUARDED_BY(mu_);
+
+  bool stopped_ GUARDED_BY(mu_) = false;
+};
+
+}  // namespace ray
@@ -19,18 +19,22 @@ namespace gcs {
 
 double LeastResourceScorer::Score(const ResourceSet &required_resources,
                                   const SchedulingResources &node_resources) {
-  const auto &available_resources = node_resources.GetAvailableResources();
-  const auto &available_resource_amount_map = available_resources.GetResourceAmountMap();
+  const auto &available_resources =
+      node_resources.GetAvailableResources().GetInternedResources();
 
+  // Both resource lists are sorted by id, so walk them together.
+  auto available_it = available_resources.begin();
   double node_score = 0.0;
-  for (const auto &entry : required_resources.GetResourceAmountMap()) {
-    auto available_resource_amount_iter = available_resource_amount_map.find(entry.first);
-    if (available_resource_amount_iter == available_resource_amount_map.end()) {
+  for (const auto &entry : required_resources.GetInternedResources()) {
+    while (available_it != available_resources.end() &&
+           available_it->first < entry.first) {
+      available_it++;
+    }
+    if (available_it == available_resources.end() || available_it->first != entry.first) {
       return -1;
     }
 
-    auto calculated_score =
-        Calculate(entry.second, available_resource_amount_iter->second);
+    auto calculated_score = Calculate(entry.second, available_it->second);
     if (calculated_score < 0) {
       return -1;
     }
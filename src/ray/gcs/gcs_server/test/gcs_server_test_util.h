@@ -78,6 +78,14 @@ struct GcsServerMocker {
       callbacks.push_back(callback);
     }
 
+    /// WorkerLeaseInterface
+    void RequestWorkerLeases(
+        const ray::TaskSpecification &resource_spec,
+        const std::vector<TaskID> &lease_ids,
+        const rpc::ClientCallback<rpc::RequestWorkerLeasesReply> &callback,
+        const int64_t backlog_size = -1, bool gang = false,
+        const TaskID &gang_reservation_id = TaskID::Nil()) override {}
+
     /// WorkerLeaseInterface
     void ReleaseUnusedWorkers(
         const std::vector<WorkerID> &workers_in_use,
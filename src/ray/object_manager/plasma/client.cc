@@ -22,8 +22,10 @@
 #include <cstring>
 
 #include <algorithm>
+#include <condition_variable>
 #include <deque>
 #include <mutex>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
@@ -140,6 +142,21 @@ class PlasmaClient::Impl : public std::enable_shared_from_this<PlasmaClient::Imp
 
   Status Seal(const ObjectID &object_id);
 
+  void CreateAsync(const ObjectID &object_id, const ray::rpc::Address &owner_address,
+                   int64_t data_size, const uint8_t *metadata, int64_t metadata_size,
+                   fb::ObjectSource source, int device_num,
+                   instrumented_io_context &callback_service, CreateCallback callback);
+
+  void GetAsync(const std::vector<ObjectID> &object_ids, int64_t timeout_ms,
+                bool is_from_worker, instrumented_io_context &callback_service,
+                GetCallback callback);
+
+  void SealAsync(const ObjectID &object_id, instrumented_io_context &callback_service,
+                 StatusCallback callback);
+
+  void ReleaseAsync(const ObjectID &object_id, instrumented_io_context &callback_service,
+                    StatusCallback callback);
+
   Status Delete(const std::vector<ObjectID> &object_ids);
 
   Status Evict(int64_t num_bytes, int64_t &num_bytes_evicted);
@@ -152,6 +169,9 @@ class PlasmaClient::Impl : public std::enable_shared_from_this<PlasmaClient::Imp
 
   int64_t store_capacity() { return store_capacity_; }
 
+  /// Run the requests that are still queued for async_thread_, then stop the thread.
+  void StopAsyncThread();
+
  private:
   /// Helper method to read and process the reply of a create request.
   Status HandleCreateReply(const ObjectID &object_id, const uint8_t *metadata,
@@ -166,6 +186,17 @@ class PlasmaClient::Impl : public std::enable_shared_from_this<PlasmaClient::Imp
   /// \return The pointer corresponding to store_fd.
   uint8_t *GetStoreFdAndMmap(MEMFD_TYPE store_fd, int64_t map_size);
 
+  /// Send the releases that were batched up to the store. This must be called before
+  /// sending any other request, so that the store sees requests in order.
+  Status FlushReleases();
+
+  /// Send batched releases once they have waited for the batch timeout. This runs on
+  /// release_flusher_.
+  void FlushReleasesPeriodically();
+
+  /// Run a request on async_thread_, starting the thread if it is not running.
+  void PostAsyncRequest(std::function<void()> request, const std::string &name);
+
   /// This is a helper method for marking an object as unused by this client.
   ///
   /// \param object_id The object ID we mark unused.
@@ -187,6 +218,9 @@ class PlasmaClient::Impl : public std::enable_shared_from_this<PlasmaClient::Imp
   instrumented_io_context main_service_;
   /// The connection to the store service.
   std::shared_ptr<StoreConn> store_conn_;
+  /// The ring on which Release requests are queued for the store, if the store
+  /// accepted one. Requests that do not fit are sent over store_conn_.
+  std::unique_ptr<ray::SharedMemoryRing> command_ring_;
   /// Table of dlmalloc buffer files that have been memory mapped so far. This
   /// is a hash table mapping a file descriptor to a struct containing the
   /// address of the corresponding memory-mapped file.
@@ -206,13 +240,44 @@ class PlasmaClient::Impl : public std::enable_shared_from_this<PlasmaClient::Imp
   std::unordered_set<ObjectID> deletion_cache_;
   /// A mutex which protects this class.
   std::recursive_mutex client_mutex_;
+  /// Send pending releases to the store once this many have been batched.
+  const uint32_t release_batch_size_;
+  /// The objects that this client no longer uses, but has not told the store about.
+  std::vector<ObjectID> pending_releases_;
+  /// Notifies release_flusher_ of the first pending release, or that it should exit.
+  std::condition_variable_any release_cv_;
+  /// Sends pending releases that have waited for the batch timeout. This is started by
+  /// the first release that is batched.
+  std::thread release_flusher_;
+  /// Whether release_flusher_ should exit.
+  bool stop_release_flusher_ = false;
+  /// The event loop on which async_thread_ runs the asynchronous requests.
+  instrumented_io_context async_service_;
+  /// Keeps async_service_ running while async_thread_ waits for requests.
+  std::unique_ptr<boost::asio::io_service::work> async_work_;
+  /// Sends the asynchronous requests to the store, one at a time.
+  std::thread async_thread_;
+  /// Protects starting and stopping async_thread_. This is separate from
+  /// client_mutex_, which the requests on async_thread_ take.
+  std::mutex async_mutex_;
 };
 
 PlasmaBuffer::~PlasmaBuffer() { RAY_UNUSED(client_->Release(object_id_)); }
 
-PlasmaClient::Impl::Impl() : store_capacity_(0) {}
+PlasmaClient::Impl::Impl()
+    : store_capacity_(0),
+      release_batch_size_(RayConfig::instance().plasma_release_batch_size()) {}
 
-PlasmaClient::Impl::~Impl() {}
+PlasmaClient::Impl::~Impl() {
+  if (release_flusher_.joinable()) {
+    {
+      std::lock_guard<std::recursive_mutex> guard(client_mutex_);
+      stop_release_flusher_ = true;
+    }
+    release_cv_.notify_one();
+    release_flusher_.join();
+  }
+}
 
 // If the file descriptor fd has been mmapped in this client process before,
 // return the pointer that was returned by mmap, otherwise mmap it and store the
@@ -342,6 +407,7 @@ Status PlasmaClient::Impl::CreateAndSpillIfNeeded(
 
   RAY_LOG(DEBUG) << "called plasma_create on conn " << store_conn_ << " with size "
                  << data_size << " and metadata size " << metadata_size;
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendCreateRequest(store_conn_, object_id, owner_address, data_size,
                                       metadata_size, source, device_num,
                                       /*try_immediately=*/false));
@@ -367,6 +433,7 @@ Status PlasmaClient::Impl::RetryCreate(const ObjectID &object_id, uint64_t reque
                                        uint64_t *retry_with_request_id,
                                        std::shared_ptr<Buffer> *data) {
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendCreateRetryRequest(store_conn_, object_id, request_id));
   return HandleCreateReply(object_id, metadata, retry_with_request_id, data);
 }
@@ -379,6 +446,7 @@ Status PlasmaClient::Impl::TryCreateImmediately(
 
   RAY_LOG(DEBUG) << "called plasma_create on conn " << store_conn_ << " with size "
                  << data_size << " and metadata size " << metadata_size;
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendCreateRequest(store_conn_, object_id, owner_address, data_size,
                                       metadata_size, source, device_num,
                                       /*try_immediately=*/true));
@@ -436,6 +504,7 @@ Status PlasmaClient::Impl::GetBuffers(
 
   // If we get here, then the objects aren't all currently in use by this
   // client, so we need to send a request to the plasma store.
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendGetRequest(store_conn_, &object_ids[0], num_objects, timeout_ms,
                                    is_from_worker));
   std::vector<uint8_t> buffer;
@@ -549,7 +618,23 @@ Status PlasmaClient::Impl::Release(const ObjectID &object_id) {
   if (object_entry->second->count == 0) {
     // Tell the store that the client no longer needs the object.
     RAY_RETURN_NOT_OK(MarkObjectUnused(object_id));
-    RAY_RETURN_NOT_OK(SendReleaseRequest(store_conn_, object_id));
+    if (release_batch_size_ > 1) {
+      pending_releases_.push_back(object_id);
+      if (pending_releases_.size() == 1) {
+        if (release_flusher_.joinable()) {
+          release_cv_.notify_one();
+        } else {
+          // Start the flusher once there is something to flush, so clients that
+          // never batch a release do not run it.
+          release_flusher_ = std::thread([this] { FlushReleasesPeriodically(); });
+        }
+      } else if (pending_releases_.size() >= release_batch_size_) {
+        RAY_RETURN_NOT_OK(FlushReleases());
+      }
+    } else if (command_ring_ == nullptr ||
+               !WriteReleaseCommand(*command_ring_, object_id)) {
+      RAY_RETURN_NOT_OK(SendReleaseRequest(store_conn_, object_id));
+    }
     auto iter = deletion_cache_.find(object_id);
     if (iter != deletion_cache_.end()) {
       deletion_cache_.erase(object_id);
@@ -559,6 +644,45 @@ Status PlasmaClient::Impl::Release(const ObjectID &object_id) {
   return Status::OK();
 }
 
+Status PlasmaClient::Impl::FlushReleases() {
+  if (pending_releases_.empty() || !store_conn_) {
+    return Status::OK();
+  }
+  std::vector<ObjectID> object_ids;
+  object_ids.swap(pending_releases_);
+  auto unsent = object_ids.begin();
+  if (command_ring_ != nullptr) {
+    // The store drains the ring in one go, so there is no need to batch there.
+    while (unsent != object_ids.end() && WriteReleaseCommand(*command_ring_, *unsent)) {
+      unsent++;
+    }
+  }
+  if (unsent != object_ids.end()) {
+    object_ids.erase(object_ids.begin(), unsent);
+    RAY_RETURN_NOT_OK(SendReleaseBatchRequest(store_conn_, object_ids));
+  }
+  return Status::OK();
+}
+
+void PlasmaClient::Impl::FlushReleasesPeriodically() {
+  const auto timeout =
+      std::chrono::milliseconds(RayConfig::instance().plasma_release_batch_timeout_ms());
+  std::unique_lock<std::recursive_mutex> guard(client_mutex_);
+  while (!stop_release_flusher_) {
+    if (pending_releases_.empty()) {
+      release_cv_.wait(guard);
+      continue;
+    }
+    // Give the batch a chance to fill up before sending it.
+    release_cv_.wait_for(guard, timeout, [this] { return stop_release_flusher_; });
+    Status status = FlushReleases();
+    if (!status.ok()) {
+      RAY_LOG(WARNING) << "Failed to send batched releases to the plasma store: "
+                       << status.ToString();
+    }
+  }
+}
+
 // This method is used to query whether the plasma store contains an object.
 Status PlasmaClient::Impl::Contains(const ObjectID &object_id, bool *has_object) {
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
@@ -569,6 +693,7 @@ Status PlasmaClient::Impl::Contains(const ObjectID &object_id, bool *has_object)
   } else {
     // If we don't already have a reference to the object, check with the store
     // to see if we have the object.
+    RAY_RETURN_NOT_OK(FlushReleases());
     RAY_RETURN_NOT_OK(SendContainsRequest(store_conn_, object_id));
     std::vector<uint8_t> buffer;
     RAY_RETURN_NOT_OK(
@@ -597,6 +722,7 @@ Status PlasmaClient::Impl::Seal(const ObjectID &object_id) {
 
   object_entry->second->is_sealed = true;
   /// Send the seal request to Plasma.
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendSealRequest(store_conn_, object_id));
   std::vector<uint8_t> buffer;
   RAY_RETURN_NOT_OK(PlasmaReceive(store_conn_, MessageType::PlasmaSealReply, &buffer));
@@ -627,6 +753,7 @@ Status PlasmaClient::Impl::Abort(const ObjectID &object_id) {
   }
 
   // Send the abort request.
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendAbortRequest(store_conn_, object_id));
   // Decrease the reference count to zero, then remove the object.
   object_entry->second->count--;
@@ -651,6 +778,7 @@ Status PlasmaClient::Impl::Delete(const std::vector<ObjectID> &object_ids) {
     }
   }
   if (not_in_use_ids.size() > 0) {
+    RAY_RETURN_NOT_OK(FlushReleases());
     RAY_RETURN_NOT_OK(SendDeleteRequest(store_conn_, not_in_use_ids));
     std::vector<uint8_t> buffer;
     RAY_RETURN_NOT_OK(
@@ -668,6 +796,7 @@ Status PlasmaClient::Impl::Evict(int64_t num_bytes, int64_t &num_bytes_evicted)
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
 
   // Send a request to the store to evict objects.
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendEvictRequest(store_conn_, num_bytes));
   // Wait for a response with the number of bytes actually evicted.
   std::vector<uint8_t> buffer;
@@ -684,17 +813,31 @@ Status PlasmaClient::Impl::Connect(const std::string &store_socket_name,
   ray::local_stream_socket socket(main_service_);
   RAY_RETURN_NOT_OK(ray::ConnectSocketRetry(socket, store_socket_name));
   store_conn_.reset(new StoreConn(std::move(socket)));
+  if (RayConfig::instance().plasma_command_ring_enabled()) {
+    command_ring_ = ray::SharedMemoryRing::Create(
+        RayConfig::instance().plasma_command_ring_bytes());
+  }
   // Send a ConnectRequest to the store to get its memory capacity.
-  RAY_RETURN_NOT_OK(SendConnectRequest(store_conn_));
+  RAY_RETURN_NOT_OK(SendConnectRequest(store_conn_, command_ring_ != nullptr));
+  if (command_ring_ != nullptr) {
+    RAY_RETURN_NOT_OK(store_conn_->SendFd(command_ring_->MemoryFd()));
+    RAY_RETURN_NOT_OK(store_conn_->SendFd(command_ring_->EventFd()));
+  }
   std::vector<uint8_t> buffer;
   RAY_RETURN_NOT_OK(PlasmaReceive(store_conn_, MessageType::PlasmaConnectReply, &buffer));
-  RAY_RETURN_NOT_OK(ReadConnectReply(buffer.data(), buffer.size(), &store_capacity_));
+  bool command_ring_accepted;
+  RAY_RETURN_NOT_OK(ReadConnectReply(buffer.data(), buffer.size(), &store_capacity_,
+                                     &command_ring_accepted));
+  if (!command_ring_accepted) {
+    command_ring_.reset();
+  }
   return Status::OK();
 }
 
 Status PlasmaClient::Impl::SetClientOptions(const std::string &client_name,
                                             int64_t output_memory_quota) {
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
+  RAY_RETURN_NOT_OK(FlushReleases());
   RAY_RETURN_NOT_OK(SendSetOptionsRequest(store_conn_, client_name, output_memory_quota));
   std::vector<uint8_t> buffer;
   RAY_RETURN_NOT_OK(
@@ -703,21 +846,120 @@ Status PlasmaClient::Impl::SetClientOptions(const std::string &client_name,
 }
 
 Status PlasmaClient::Impl::Disconnect() {
+  // Send the queued asynchronous requests first. This must happen without holding
+  // client_mutex_, since the requests take it.
+  StopAsyncThread();
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
 
   // NOTE: We purposefully do not finish sending release calls for objects in
   // use, so that we don't duplicate PlasmaClient::Release calls (when handling
-  // a SIGTERM, for example).
+  // a SIGTERM, for example). The batched releases are for objects that are no longer
+  // in use, so they are sent.
+  Status status = FlushReleases();
+  if (!status.ok()) {
+    RAY_LOG(WARNING) << "Failed to send batched releases to the plasma store: "
+                     << status.ToString();
+  }
 
   // Close the connections to Plasma. The Plasma store will release the objects
   // that were in use by us when handling the SIGPIPE.
   store_conn_.reset();
+  command_ring_.reset();
+  pending_releases_.clear();
   return Status::OK();
 }
 
+void PlasmaClient::Impl::PostAsyncRequest(std::function<void()> request,
+                                          const std::string &name) {
+  std::lock_guard<std::mutex> guard(async_mutex_);
+  if (!async_thread_.joinable()) {
+    async_service_.restart();
+    async_work_.reset(new boost::asio::io_service::work(async_service_));
+    async_thread_ = std::thread([this] { async_service_.run(); });
+  }
+  async_service_.post(std::move(request), name);
+}
+
+void PlasmaClient::Impl::StopAsyncThread() {
+  std::lock_guard<std::mutex> guard(async_mutex_);
+  if (!async_thread_.joinable()) {
+    return;
+  }
+  RAY_CHECK(async_thread_.get_id() != std::this_thread::get_id());
+  // Once there is no more work, run() returns after the queued requests are done.
+  async_work_.reset();
+  async_thread_.join();
+}
+
+void PlasmaClient::Impl::CreateAsync(const ObjectID &object_id,
+                                     const ray::rpc::Address &owner_address,
+                                     int64_t data_size, const uint8_t *metadata,
+                                     int64_t metadata_size, fb::ObjectSource source,
+                                     int device_num,
+                                     instrumented_io_context &callback_service,
+                                     CreateCallback callback) {
+  std::string metadata_copy;
+  if (metadata != nullptr) {
+    metadata_copy.assign(reinterpret_cast<const char *>(metadata), metadata_size);
+  }
+  PostAsyncRequest(
+      [this, object_id, owner_address, data_size, metadata_copy, source, device_num,
+       &callback_service, callback]() {
+        std::shared_ptr<Buffer> data;
+        Status status = CreateAndSpillIfNeeded(
+            object_id, owner_address, data_size,
+            reinterpret_cast<const uint8_t *>(metadata_copy.data()),
+            metadata_copy.size(), &data, source, device_num);
+        callback_service.post([callback, status, data]() { callback(status, data); },
+                              "PlasmaClient.CreateAsync.Callback");
+      },
+      "PlasmaClient.CreateAsync");
+}
+
+void PlasmaClient::Impl::GetAsync(const std::vector<ObjectID> &object_ids,
+                                  int64_t timeout_ms, bool is_from_worker,
+                                  instrumented_io_context &callback_service,
+                                  GetCallback callback) {
+  PostAsyncRequest(
+      [this, object_ids, timeout_ms, is_from_worker, &callback_service, callback]() {
+        auto object_buffers = std::make_shared<std::vector<ObjectBuffer>>();
+        Status status = Get(object_ids, timeout_ms, object_buffers.get(), is_from_worker);
+        callback_service.post(
+            [callback, status, object_buffers]() {
+              callback(status, std::move(*object_buffers));
+            },
+            "PlasmaClient.GetAsync.Callback");
+      },
+      "PlasmaClient.GetAsync");
+}
+
+void PlasmaClient::Impl::SealAsync(const ObjectID &object_id,
+                                   instrumented_io_context &callback_service,
+                                   StatusCallback callback) {
+  PostAsyncRequest(
+      [this, object_id, &callback_service, callback]() {
+        Status status = Seal(object_id);
+        callback_service.post([callback, status]() { callback(status); },
+                              "PlasmaClient.SealAsync.Callback");
+      },
+      "PlasmaClient.SealAsync");
+}
+
+void PlasmaClient::Impl::ReleaseAsync(const ObjectID &object_id,
+                                      instrumented_io_context &callback_service,
+                                      StatusCallback callback) {
+  PostAsyncRequest(
+      [this, object_id, &callback_service, callback]() {
+        Status status = Release(object_id);
+        callback_service.post([callback, status]() { callback(status); },
+                              "PlasmaClient.ReleaseAsync.Callback");
+      },
+      "PlasmaClient.ReleaseAsync");
+}
+
 std::string PlasmaClient::Impl::DebugString() {
   std::lock_guard<std::recursive_mutex> guard(client_mutex_);
-  if (!SendGetDebugStringRequest(store_conn_).ok()) {
+  if (!FlushReleases().ok() || !SendGetDebugStringRequest(store_conn_).ok()) {
     return "error sending request";
   }
   std::vector<uint8_t> buffer;
@@ -736,7 +978,11 @@ std::string PlasmaClient::Impl::DebugString() {
 
 PlasmaClient::PlasmaClient() : impl_(std::make_shared<PlasmaClient::Impl>()) {}
 
-PlasmaClient::~PlasmaClient() {}
+PlasmaClient::~PlasmaClient() {
+  // The asynchronous requests use impl_ through a raw pointer, so finish them while this
+  // handle still keeps it alive.
+  impl_->StopAsyncThread();
+}
 
 Status PlasmaClient::Connect(const std::string &store_socket_name,
                              const std::string &manager_socket_name, int release_delay,
@@ -793,6 +1039,36 @@ Status PlasmaClient::Abort(const ObjectID &object_id) { return impl_->Abort(obje
 
 Status PlasmaClient::Seal(const ObjectID &object_id) { return impl_->Seal(object_id); }
 
+void PlasmaClient::CreateAsync(const ObjectID &object_id,
+                               const ray::rpc::Address &owner_address, int64_t data_size,
+                               const uint8_t *metadata, int64_t metadata_size,
+                               fb::ObjectSource source, int device_num,
+                               instrumented_io_context &callback_service,
+                               CreateCallback callback) {
+  impl_->CreateAsync(object_id, owner_address, data_size, metadata, metadata_size,
+                     source, device_num, callback_service, std::move(callback));
+}
+
+void PlasmaClient::GetAsync(const std::vector<ObjectID> &object_ids, int64_t timeout_ms,
+                            bool is_from_worker,
+                            instrumented_io_context &callback_service,
+                            GetCallback callback) {
+  impl_->GetAsync(object_ids, timeout_ms, is_from_worker, callback_service,
+                  std::move(callback));
+}
+
+void PlasmaClient::SealAsync(const ObjectID &object_id,
+                             instrumented_io_context &callback_service,
+                             StatusCallback callback) {
+  impl_->SealAsync(object_id, callback_service, std::move(callback));
+}
+
+void PlasmaClient::ReleaseAsync(const ObjectID &object_id,
+                                instrumented_io_context &callback_service,
+                                StatusCallback callback) {
+  impl_->ReleaseAsync(object_id, callback_service, std::move(callback));
+}
+
 Status PlasmaClient::Delete(const ObjectID &object_id) {
   return impl_->Delete(std::vector<ObjectID>{object_id});
 }
@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "ray/common/asio/instrumented_io_context.h"
 #include "ray/common/buffer.h"
 #include "ray/common/status.h"
 #include "ray/object_manager/plasma/common.h"
@@ -44,6 +45,14 @@ struct ObjectBuffer {
   int device_num;
 };
 
+/// Callback for PlasmaClient::CreateAsync. On success, the buffer is the mutable object
+/// buffer, as with CreateAndSpillIfNeeded.
+using CreateCallback = std::function<void(Status, std::shared_ptr<Buffer>)>;
+/// Callback for PlasmaClient::GetAsync, with one ObjectBuffer per requested object.
+using GetCallback = std::function<void(Status, std::vector<ObjectBuffer>)>;
+/// Callback for PlasmaClient::SealAsync and PlasmaClient::ReleaseAsync.
+using StatusCallback = std::function<void(Status)>;
+
 class PlasmaClient {
  public:
   PlasmaClient();
@@ -207,6 +216,36 @@ class PlasmaClient {
   /// \return The return status.
   Status Seal(const ObjectID &object_id);
 
+  /// The asynchronous variants below send their request from a background thread of
+  /// this client, which is started on first use. The calling thread never waits on the
+  /// store, so they can be called from an event loop. Requests run one at a time in the
+  /// order they were made, and each callback is posted to callback_service once its
+  /// request has completed. Requests that are still queued when the client disconnects
+  /// are sent before the connection is closed.
+
+  /// Asynchronous version of CreateAndSpillIfNeeded(). The metadata is copied, so it
+  /// need not outlive this call.
+  void CreateAsync(const ObjectID &object_id, const ray::rpc::Address &owner_address,
+                   int64_t data_size, const uint8_t *metadata, int64_t metadata_size,
+                   plasma::flatbuf::ObjectSource source, int device_num,
+                   instrumented_io_context &callback_service, CreateCallback callback);
+
+  /// Asynchronous version of Get(). A timeout of 0 only returns the objects that are
+  /// already sealed in the store. With a longer timeout, the background thread holds
+  /// this client's lock while it waits, so synchronous calls from other threads wait
+  /// for it as they would for a blocking Get().
+  void GetAsync(const std::vector<ObjectID> &object_ids, int64_t timeout_ms,
+                bool is_from_worker, instrumented_io_context &callback_service,
+                GetCallback callback);
+
+  /// Asynchronous version of Seal().
+  void SealAsync(const ObjectID &object_id, instrumented_io_context &callback_service,
+                 StatusCallback callback);
+
+  /// Asynchronous version of Release().
+  void ReleaseAsync(const ObjectID &object_id, instrumented_io_context &callback_service,
+                    StatusCallback callback);
+
   /// Delete an object from the object store. This currently assumes that the
   /// object is present, has been sealed and not used by another client. Otherwise,
   /// it is a no operation.
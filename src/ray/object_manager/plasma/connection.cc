@@ -126,6 +126,18 @@ Status Client::SendFd(MEMFD_TYPE fd) {
   return Status::OK();
 }
 
+Status Client::RecvFd(int *fd) {
+#ifdef _WIN32
+  return Status::NotImplemented("Receiving fds from clients is not supported.");
+#else
+  *fd = recv_fd(GetNativeHandle());
+  if (*fd < 0) {
+    return Status::IOError("Failed to receive the fd.");
+  }
+  return Status::OK();
+#endif
+}
+
 StoreConn::StoreConn(ray::local_stream_socket &&socket)
     : ray::ServerConnection(std::move(socket)) {}
 
@@ -149,4 +161,15 @@ Status StoreConn::RecvFd(MEMFD_TYPE_NON_UNIQUE *fd) {
   return Status::OK();
 }
 
+Status StoreConn::SendFd(int fd) {
+#ifdef _WIN32
+  return Status::NotImplemented("Sending fds to the store is not supported.");
+#else
+  if (send_fd(GetNativeHandle(), fd) <= 0) {
+    return Status::IOError("Failed to send the fd.");
+  }
+  return Status::OK();
+#endif
+}
+
 }  // namespace plasma
@@ -4,6 +4,7 @@
 #include "ray/common/id.h"
 #include "ray/common/status.h"
 #include "ray/object_manager/plasma/compat.h"
+#include "ray/util/shared_memory_ring.h"
 
 #include "absl/container/flat_hash_set.h"
 
@@ -31,11 +32,25 @@ class Client : public ray::ClientConnection, public ClientInterface {
 
   ray::Status SendFd(MEMFD_TYPE fd);
 
+  /// Receive a file descriptor from the client.
+  ///
+  /// \param fd The received file descriptor.
+  ray::Status RecvFd(int *fd);
+
   /// Object ids that are used by this client.
   std::unordered_set<ray::ObjectID> object_ids;
 
   std::string name = "anonymous_client";
 
+  /// The ring on which the client queues requests that need no reply, if it set one
+  /// up. See PlasmaStore::ProcessRingCommands.
+  std::unique_ptr<ray::SharedMemoryRing> command_ring;
+
+#ifndef _WIN32
+  /// Becomes readable when the client queues a request while the store waits.
+  std::unique_ptr<boost::asio::posix::stream_descriptor> command_ring_doorbell;
+#endif
+
  private:
   Client(ray::MessageHandler &message_handler, ray::local_stream_socket &&socket);
   /// File descriptors that are used by this client.
@@ -54,6 +69,11 @@ class StoreConn : public ray::ServerConnection {
   ///
   /// \return A file descriptor.
   ray::Status RecvFd(MEMFD_TYPE_NON_UNIQUE *fd);
+
+  /// Send a file descriptor to the store.
+  ///
+  /// \param fd The file descriptor to send.
+  ray::Status SendFd(int fd);
 };
 
 std::ostream &operator<<(std::ostream &os, const std::shared_ptr<StoreConn> &store_conn);
@@ -17,22 +17,35 @@
 #include <stdlib.h>
 
 #include <memory>
+#include <sstream>
 
 #include "ray/common/asio/instrumented_io_context.h"
 #include "ray/object_manager/plasma/common.h"
+#include "ray/stats/stats.h"
 #include "ray/util/util.h"
 
 namespace plasma {
 
+constexpr std::array<int64_t, 5> CreateRequestQueue::kWaitTimeBucketsMs;
+
 uint64_t CreateRequestQueue::AddRequest(const ObjectID &object_id,
                                         const std::shared_ptr<ClientInterface> &client,
                                         const CreateObjectCallback &create_callback,
                                         size_t object_size) {
   auto req_id = next_req_id_++;
   fulfilled_requests_[req_id] = nullptr;
-  queue_.emplace_back(
+  auto it = client_queue_index_.find(client);
+  if (it == client_queue_index_.end()) {
+    client_queues_.emplace_back(client, ClientQueue());
+    it = client_queue_index_.emplace(client, std::prev(client_queues_.end())).first;
+  }
+  auto &queue = it->second->second;
+  queue.emplace_back(
       new CreateRequest(object_id, req_id, client, create_callback, object_size));
+  auto &request = queue.back();
+  request->queued_time_ns = get_time_();
   num_bytes_pending_ += object_size;
+  num_pending_requests_++;
   return req_id;
 }
 
@@ -70,7 +83,7 @@ std::pair<PlasmaObject, PlasmaError> CreateRequestQueue::TryRequestImmediately(
     return {result, error};
   }
 
-  if (!queue_.empty()) {
+  if (num_pending_requests_ > 0) {
     // There are other requests queued. Return an out-of-memory error
     // immediately because this request cannot be served.
     return {result, PlasmaError::OutOfMemory};
@@ -79,10 +92,10 @@ std::pair<PlasmaObject, PlasmaError> CreateRequestQueue::TryRequestImmediately(
   auto req_id = AddRequest(object_id, client, create_callback, object_size);
   if (!ProcessRequests().ok()) {
     // If the request was not immediately fulfillable, finish it.
-    if (!queue_.empty()) {
+    if (num_pending_requests_ > 0) {
       // Some errors such as a transient OOM error doesn't finish the request, so we
       // should finish it here.
-      FinishRequest(queue_.begin());
+      FinishRequest(client_queues_.begin());
     }
   }
   PlasmaError error;
@@ -105,20 +118,25 @@ Status CreateRequestQueue::ProcessRequest(bool fallback_allocator,
 Status CreateRequestQueue::ProcessRequests() {
   // Suppress OOM dump to once per grace period.
   bool logged_oom = false;
-  while (!queue_.empty()) {
-    auto request_it = queue_.begin();
+  while (!client_queues_.empty()) {
+    auto client_it = client_queues_.begin();
+    auto request_it = client_it->second.begin();
     bool spilling_required = false;
     auto status =
         ProcessRequest(/*fallback_allocator=*/false, *request_it, &spilling_required);
     if (spilling_required) {
       spill_objects_callback_();
     }
-    auto now = get_time_();
     if (status.ok()) {
-      FinishRequest(request_it);
+      FinishRequest(client_it);
       // Reset the oom start time since the creation succeeds.
       oom_start_time_ns_ = -1;
     } else {
+      // Smaller requests may still fit, so they do not have to wait until this one
+      // is resolved. This does not reset the oom start time, so that a stream of
+      // small requests does not keep this one waiting forever.
+      ProcessSmallerRequests((*request_it)->object_size);
+      auto now = get_time_();
       if (trigger_global_gc_) {
         trigger_global_gc_();
       }
@@ -155,44 +173,95 @@ Status CreateRequestQueue::ProcessRequests() {
                         << (*request_it)->object_size / 1024 / 1024 << "MB\n"
                         << dump;
         }
-        FinishRequest(request_it);
+        FinishRequest(client_it);
       }
     }
   }
   return Status::OK();
 }
 
-void CreateRequestQueue::FinishRequest(
-    std::list<std::unique_ptr<CreateRequest>>::iterator request_it) {
+void CreateRequestQueue::ProcessSmallerRequests(size_t blocked_object_size) {
+  auto client_it = std::next(client_queues_.begin());
+  while (client_it != client_queues_.end()) {
+    auto current_it = client_it++;
+    auto &request = current_it->second.front();
+    if (request->object_size >= blocked_object_size) {
+      continue;
+    }
+    bool spilling_required = false;
+    auto status =
+        ProcessRequest(/*fallback_allocator=*/false, request, &spilling_required);
+    if (spilling_required) {
+      spill_objects_callback_();
+    }
+    if (status.ok()) {
+      FinishRequest(current_it);
+    }
+  }
+}
+
+void CreateRequestQueue::FinishRequest(ClientQueueList::iterator client_it) {
   // Fulfill the request.
-  auto &request = *request_it;
+  auto &request = client_it->second.front();
   auto it = fulfilled_requests_.find(request->request_id);
   RAY_CHECK(it != fulfilled_requests_.end());
   RAY_CHECK(it->second == nullptr);
+  const int64_t wait_time_ms = (get_time_() - request->queued_time_ns) / 1000000;
+  size_t bucket = 0;
+  while (bucket < kWaitTimeBucketsMs.size() &&
+         wait_time_ms >= kWaitTimeBucketsMs[bucket]) {
+    bucket++;
+  }
+  wait_time_histogram_[bucket]++;
+  ray::stats::ObjectStoreCreateRequestWaitMs.Record(wait_time_ms);
   it->second = std::move(request);
   RAY_CHECK(num_bytes_pending_ >= it->second->object_size);
   num_bytes_pending_ -= it->second->object_size;
-  queue_.erase(request_it);
+  num_pending_requests_--;
+  client_it->second.pop_front();
+  if (client_it->second.empty()) {
+    client_queue_index_.erase(client_it->first);
+    client_queues_.erase(client_it);
+  } else {
+    // Let the other clients take their turn first.
+    client_queues_.splice(client_queues_.end(), client_queues_, client_it);
+  }
+}
+
+std::string CreateRequestQueue::WaitTimeDebugString() const {
+  std::stringstream buffer;
+  buffer << "create request wait times:";
+  for (size_t i = 0; i < wait_time_histogram_.size(); i++) {
+    if (i < kWaitTimeBucketsMs.size()) {
+      buffer << " <" << kWaitTimeBucketsMs[i] << "ms: ";
+    } else {
+      buffer << " >=" << kWaitTimeBucketsMs.back() << "ms: ";
+    }
+    buffer << wait_time_histogram_[i];
+  }
+  return buffer.str();
 }
 
 void CreateRequestQueue::RemoveDisconnectedClientRequests(
     const std::shared_ptr<ClientInterface> &client) {
-  for (auto it = queue_.begin(); it != queue_.end();) {
-    if ((*it)->client == client) {
-      fulfilled_requests_.erase((*it)->request_id);
-      RAY_CHECK(num_bytes_pending_ >= (*it)->object_size);
-      num_bytes_pending_ -= (*it)->object_size;
-      it = queue_.erase(it);
-    } else {
-      it++;
+  auto client_it = client_queue_index_.find(client);
+  if (client_it != client_queue_index_.end()) {
+    for (const auto &request : client_it->second->second) {
+      fulfilled_requests_.erase(request->request_id);
+      RAY_CHECK(num_bytes_pending_ >= request->object_size);
+      num_bytes_pending_ -= request->object_size;
+      num_pending_requests_--;
     }
+    client_queues_.erase(client_it->second);
+    client_queue_index_.erase(client_it);
   }
 
   for (auto it = fulfilled_requests_.begin(); it != fulfilled_requests_.end();) {
     if (it->second && it->second->client == client) {
-      fulfilled_requests_.erase(it);
+      fulfilled_requests_.erase(it++);
+    } else {
+      it++;
     }
-    it++;
   }
 }
 
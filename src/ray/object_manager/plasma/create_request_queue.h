@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <array>
+#include <deque>
+#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,6 +32,12 @@
 
 namespace plasma {
 
+/// Queues the requests to create objects that the store cannot serve right away.
+///
+/// Each client has its own FIFO queue, and clients are served round-robin. If the
+/// request at the head is blocked because the store is full, smaller requests of other
+/// clients are still served when there is space for them, so that small creates do not
+/// wait behind a large one until spilling or the OOM grace period resolves it.
 class CreateRequestQueue {
  public:
   using CreateObjectCallback = std::function<PlasmaError(
@@ -98,9 +107,10 @@ class CreateRequestQueue {
 
   /// Process requests in the queue.
   ///
-  /// This will try to process as many requests in the queue as possible, in
-  /// FIFO order. If the first request is not serviceable, this will break and
-  /// the caller should try again later.
+  /// This will try to process as many requests in the queue as possible, taking
+  /// turns between clients. If the first request is not serviceable, this serves the
+  /// smaller requests of other clients that fit, and then breaks, and the caller
+  /// should try again later.
   ///
   /// \return Bad status for the first request in the queue if it failed to be
   /// serviced, or OK if all requests were fulfilled.
@@ -111,10 +121,22 @@ class CreateRequestQueue {
   /// \param client The client that was disconnected.
   void RemoveDisconnectedClientRequests(const std::shared_ptr<ClientInterface> &client);
 
-  size_t NumPendingRequests() const { return queue_.size(); }
+  size_t NumPendingRequests() const { return num_pending_requests_; }
 
   size_t NumPendingBytes() const { return num_bytes_pending_; }
 
+  /// The number of requests that finished after waiting in the queue for each range
+  /// of time. Bucket i counts the waits below kWaitTimeBucketsMs[i] that are not
+  /// counted in an earlier bucket, and the last bucket counts the longer ones.
+  const std::vector<int64_t> &WaitTimeHistogram() const { return wait_time_histogram_; }
+
+  /// A line listing the buckets of WaitTimeHistogram(), for debug dumps.
+  std::string WaitTimeDebugString() const;
+
+  /// The upper bounds in milliseconds of the buckets of WaitTimeHistogram().
+  static constexpr std::array<int64_t, 5> kWaitTimeBucketsMs = {1, 10, 100, 1000,
+                                                                10000};
+
  private:
   struct CreateRequest {
     CreateRequest(const ObjectID &object_id, uint64_t request_id,
@@ -142,6 +164,9 @@ class CreateRequestQueue {
 
     const size_t object_size;
 
+    // When the request was queued, as returned by get_time_.
+    int64_t queued_time_ns = 0;
+
     // The results of the creation call. These should be sent back to the
     // client once ready.
     PlasmaError error = PlasmaError::OK;
@@ -154,8 +179,20 @@ class CreateRequestQueue {
   Status ProcessRequest(bool fallback_allocator, std::unique_ptr<CreateRequest> &request,
                         bool *spilling_required);
 
-  /// Finish a queued request and remove it from the queue.
-  void FinishRequest(std::list<std::unique_ptr<CreateRequest>>::iterator request_it);
+  /// The queued requests of a client, in the order that the client made them.
+  using ClientQueue = std::deque<std::unique_ptr<CreateRequest>>;
+  using ClientQueueList =
+      std::list<std::pair<std::shared_ptr<ClientInterface>, ClientQueue>>;
+
+  /// Finish the request at the head of a client's queue and remove it from the queue.
+  /// The client then moves to the back of the line if it has more requests.
+  void FinishRequest(ClientQueueList::iterator client_it);
+
+  /// Serve the requests of other clients that are smaller than the blocked request at
+  /// the head of the queue, as far as they fit. Larger requests would not fit either.
+  ///
+  /// \param blocked_object_size The size of the blocked request.
+  void ProcessSmallerRequests(size_t blocked_object_size);
 
   /// The next request ID to assign, so that the caller can get the results of
   /// a request by retrying. Start at 1 because 0 means "do not retry".
@@ -183,18 +220,22 @@ class CreateRequestQueue {
   /// Sink for debug info.
   const std::function<std::string()> dump_debug_info_callback_;
 
-  /// Queue of object creation requests to respond to. Requests will be placed
-  /// on this queue if the object store does not have enough room at the time
-  /// that the client made the creation request, but space may be made through
-  /// object spilling. Once the raylet notifies us that objects have been
-  /// spilled, we will attempt to process these requests again and respond to
-  /// the client if successful or out of memory. If more objects must be
-  /// spilled, the request will be replaced at the head of the queue.
+  /// Queues of object creation requests to respond to, one per client, in the order
+  /// in which the clients are served next. Requests will be placed on these queues if
+  /// the object store does not have enough room at the time that the client made the
+  /// creation request, but space may be made through object spilling. Once the
+  /// raylet notifies us that objects have been spilled, we will attempt to process
+  /// these requests again and respond to the client if successful or out of memory.
+  /// If more objects must be spilled, the request stays at the head of the queue.
   /// TODO(swang): We should also queue objects here even if there is no room
   /// in the object store. Then, the client does not need to poll on an
   /// OutOfMemory error and we can just respond to them once there is enough
   /// space made, or after a timeout.
-  std::list<std::unique_ptr<CreateRequest>> queue_;
+  ClientQueueList client_queues_;
+
+  /// The entry of each client in client_queues_.
+  absl::flat_hash_map<std::shared_ptr<ClientInterface>, ClientQueueList::iterator>
+      client_queue_index_;
 
   /// A buffer of the results of fulfilled requests. The value will be null
   /// while the request is pending and will be set once the request has
@@ -209,6 +250,12 @@ class CreateRequestQueue {
 
   size_t num_bytes_pending_ = 0;
 
+  size_t num_pending_requests_ = 0;
+
+  /// See WaitTimeHistogram().
+  std::vector<int64_t> wait_time_histogram_ =
+      std::vector<int64_t>(kWaitTimeBucketsMs.size() + 1, 0);
+
   friend class CreateRequestQueueTest;
 };
 
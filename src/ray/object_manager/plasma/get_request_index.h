@@ -0,0 +1,156 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "ray/common/id.h"
+#include "ray/util/logging.h"
+#include "ray/util/ordered_set.h"
+
+namespace plasma {
+
+using ray::ObjectID;
+
+/// The get requests that wait for objects to be sealed, indexed both by the objects
+/// that they wait for and by the client that sent them. Adding a request, removing
+/// it, and sealing an object all take time proportional to the number of objects or
+/// requests involved, independent of how many other requests are outstanding.
+///
+/// \tparam Request The type of a get request.
+/// \tparam ClientKey Identifies the client that sent a request.
+template <typename Request, typename ClientKey>
+class GetRequestIndex {
+ public:
+  using RequestPtr = std::shared_ptr<Request>;
+
+  /// Add a request that waits for objects.
+  ///
+  /// \param request The request, which must not be in the index yet.
+  /// \param client The client that sent the request.
+  /// \param object_ids The objects that the request waits for, without duplicates.
+  void AddRequest(const RequestPtr &request, const ClientKey &client,
+                  const std::vector<ObjectID> &object_ids) {
+    auto inserted = requests_.emplace(request, RequestState{client, {}});
+    RAY_CHECK(inserted.second) << "The get request is already indexed";
+    auto &waiting_for = inserted.first->second.waiting_for;
+    waiting_for.reserve(object_ids.size());
+    for (const auto &object_id : object_ids) {
+      if (waiting_for.insert(object_id).second) {
+        object_waiters_[object_id].push_back(request);
+      }
+    }
+    client_requests_[client].insert(request);
+  }
+
+  /// Remove a request, e.g. because it timed out. This does nothing if the request is
+  /// not in the index.
+  void RemoveRequest(const RequestPtr &request) {
+    auto it = requests_.find(request);
+    if (it == requests_.end()) {
+      return;
+    }
+    for (const auto &object_id : it->second.waiting_for) {
+      auto waiters_it = object_waiters_.find(object_id);
+      RAY_CHECK(waiters_it != object_waiters_.end());
+      waiters_it->second.erase(request);
+      if (waiters_it->second.size() == 0) {
+        object_waiters_.erase(waiters_it);
+      }
+    }
+    auto client_it = client_requests_.find(it->second.client);
+    RAY_CHECK(client_it != client_requests_.end());
+    client_it->second.erase(request);
+    if (client_it->second.empty()) {
+      client_requests_.erase(client_it);
+    }
+    requests_.erase(it);
+  }
+
+  /// Stop waiting for an object, e.g. because it was sealed.
+  ///
+  /// \param object_id The object.
+  /// \return The requests that waited for the object, in the order that they were
+  /// added, each with the number of objects that it still waits for. Requests that no
+  /// longer wait for any object are removed from the index.
+  std::vector<std::pair<RequestPtr, size_t>> PopWaiters(const ObjectID &object_id) {
+    std::vector<std::pair<RequestPtr, size_t>> waiters;
+    auto waiters_it = object_waiters_.find(object_id);
+    if (waiters_it == object_waiters_.end()) {
+      return waiters;
+    }
+    waiters.reserve(waiters_it->second.size());
+    for (const auto &request : waiters_it->second) {
+      auto it = requests_.find(request);
+      RAY_CHECK(it != requests_.end());
+      it->second.waiting_for.erase(object_id);
+      waiters.emplace_back(request, it->second.waiting_for.size());
+    }
+    object_waiters_.erase(waiters_it);
+    for (const auto &waiter : waiters) {
+      if (waiter.second == 0) {
+        RemoveRequest(waiter.first);
+      }
+    }
+    return waiters;
+  }
+
+  /// Get the requests that a client sent and that are still waiting.
+  std::vector<RequestPtr> GetRequestsForClient(const ClientKey &client) const {
+    auto it = client_requests_.find(client);
+    if (it == client_requests_.end()) {
+      return {};
+    }
+    return std::vector<RequestPtr>(it->second.begin(), it->second.end());
+  }
+
+  /// The number of objects that a request still waits for, or 0 if it is not in the
+  /// index.
+  size_t NumObjectsRemaining(const RequestPtr &request) const {
+    auto it = requests_.find(request);
+    return it == requests_.end() ? 0 : it->second.waiting_for.size();
+  }
+
+  /// The number of requests in the index.
+  size_t NumRequests() const { return requests_.size(); }
+
+  /// The number of objects that at least one request waits for.
+  size_t NumObjectsWaitedFor() const { return object_waiters_.size(); }
+
+ private:
+  struct RequestState {
+    /// The client that sent the request.
+    ClientKey client;
+    /// The objects that the request still waits for.
+    absl::flat_hash_set<ObjectID> waiting_for;
+  };
+
+  /// The requests that wait for each object, in the order that they were added. This
+  /// is node-based, because ordered_set cannot be moved.
+  std::unordered_map<ObjectID, ordered_set<RequestPtr>> object_waiters_;
+
+  /// The requests that each client sent.
+  absl::flat_hash_map<ClientKey, absl::flat_hash_set<RequestPtr>> client_requests_;
+
+  /// The state of every request in the index.
+  absl::flat_hash_map<RequestPtr, RequestState> requests_;
+};
+
+}  // namespace plasma
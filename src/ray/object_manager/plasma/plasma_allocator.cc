@@ -20,6 +20,7 @@
 
 #include "ray/object_manager/plasma/malloc.h"
 #include "ray/object_manager/plasma/plasma_allocator.h"
+#include "ray/object_manager/plasma/slab_allocator.h"
 
 namespace plasma {
 
@@ -36,10 +37,29 @@ size_t MAX_SIZE_T = (size_t)-1;
 const int M_MMAP_THRESHOLD = -3;
 
 int64_t PlasmaAllocator::footprint_limit_ = 0;
+SlabAllocator *PlasmaAllocator::slabs_ = nullptr;
 int64_t PlasmaAllocator::allocated_ = 0;
 int64_t PlasmaAllocator::fallback_allocated_ = 0;
 
 void *PlasmaAllocator::Memalign(size_t alignment, size_t bytes) {
+  auto &slabs = Slabs();
+  if (slabs.Handles(alignment, bytes)) {
+    void *mem = slabs.Allocate(bytes);
+    if (mem) {
+      return mem;
+    }
+    // There is no room for another slab, but the object itself may still fit.
+  }
+  void *mem = RegionMemalign(alignment, bytes);
+  if (!mem && slabs.SlabBytes() > 0) {
+    // Retry without the slabs that are only kept around for future small objects.
+    slabs.ReleaseEmptySlabs();
+    mem = RegionMemalign(alignment, bytes);
+  }
+  return mem;
+}
+
+void *PlasmaAllocator::RegionMemalign(size_t alignment, size_t bytes) {
   if (!RayConfig::instance().plasma_unlimited()) {
     // We only check against the footprint limit in limited allocation mode.
     // In limited mode: the check is done here; dlmemalign never returns nullptr.
@@ -75,6 +95,9 @@ void *PlasmaAllocator::DiskMemalignUnlimited(size_t alignment, size_t bytes) {
 }
 
 void PlasmaAllocator::Free(void *mem, size_t bytes) {
+  if (Slabs().Free(mem, bytes)) {
+    return;
+  }
   dlfree(mem);
   allocated_ -= bytes;
   if (RayConfig::instance().plasma_unlimited() && IsOutsideInitialAllocation(mem)) {
@@ -88,8 +111,42 @@ void PlasmaAllocator::SetFootprintLimit(size_t bytes) {
 
 int64_t PlasmaAllocator::GetFootprintLimit() { return footprint_limit_; }
 
-int64_t PlasmaAllocator::Allocated() { return allocated_; }
+void PlasmaAllocator::SetSlabLimits(size_t max_object_bytes, size_t slab_bytes) {
+  if (slabs_ != nullptr) {
+    RAY_CHECK(slabs_->UsedBytes() == 0) << "Replacing slabs that still hold objects";
+    // This frees the empty slabs.
+    delete slabs_;
+  }
+  // Slabs are carved out of the shared memory region like any other object, so that
+  // clients map them in the same way. They are never destroyed at exit, because the
+  // store's memory may be gone by the time that static objects are destroyed.
+  slabs_ = new SlabAllocator(
+      max_object_bytes, slab_bytes,
+      [](size_t alignment, size_t bytes) { return RegionMemalign(alignment, bytes); },
+      [](void *mem, size_t bytes) {
+        dlfree(mem);
+        allocated_ -= bytes;
+      });
+}
+
+int64_t PlasmaAllocator::Allocated() {
+  // The free slots of a slab are only available to objects of the slab's size class,
+  // but they are counted as free like any other fragmentation within dlmalloc. Empty
+  // slabs are given back to dlmalloc when a larger allocation needs their space.
+  auto &slabs = Slabs();
+  return allocated_ - slabs.SlabBytes() + slabs.UsedBytes();
+}
 
 int64_t PlasmaAllocator::FallbackAllocated() { return fallback_allocated_; }
 
+std::string PlasmaAllocator::SlabDebugString() { return Slabs().DebugString(); }
+
+SlabAllocator &PlasmaAllocator::Slabs() {
+  if (slabs_ == nullptr) {
+    SetSlabLimits(RayConfig::instance().plasma_slab_max_object_bytes(),
+                  RayConfig::instance().plasma_slab_bytes());
+  }
+  return *slabs_;
+}
+
 }  // namespace plasma
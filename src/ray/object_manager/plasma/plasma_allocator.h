@@ -19,13 +19,17 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 namespace plasma {
 
+class SlabAllocator;
+
 class PlasmaAllocator {
  public:
   /// Allocates size bytes and returns a pointer to the allocated memory. The
   /// memory address will be a multiple of alignment, which must be a power of two.
+  /// Small allocations are served from slabs, see plasma_slab_max_object_bytes.
   ///
   /// \param alignment Memory alignment.
   /// \param bytes Number of bytes.
@@ -54,7 +58,16 @@ class PlasmaAllocator {
   /// \return Plasma memory footprint limit in bytes.
   static int64_t GetFootprintLimit();
 
-  /// Get the number of bytes allocated by Plasma so far.
+  /// Sets up the slabs for small objects. Any previous slabs must not hold objects.
+  ///
+  /// \param max_object_bytes The largest object that is allocated from slabs. 0
+  /// disables the slabs.
+  /// \param slab_bytes The size of each slab, which must be a power of two.
+  static void SetSlabLimits(size_t max_object_bytes, size_t slab_bytes);
+
+  /// Get the number of bytes allocated by Plasma so far. An object in a slab counts
+  /// with the size of its slot, so that freeing it is visible here even while the
+  /// rest of its slab is in use.
   /// \return Number of bytes allocated by Plasma so far.
   static int64_t Allocated();
 
@@ -62,7 +75,20 @@ class PlasmaAllocator {
   /// \return Number of bytes fallback allocated by Plasma so far.
   static int64_t FallbackAllocated();
 
+  /// Get the usage and fragmentation of the slabs for small objects.
+  /// \return A human-readable description of the slabs.
+  static std::string SlabDebugString();
+
  private:
+  /// Allocates memory from dlmalloc, enforcing the footprint limit.
+  static void *RegionMemalign(size_t alignment, size_t bytes);
+
+  /// The slabs for small objects.
+  static SlabAllocator &Slabs();
+
+  /// The slabs for small objects, or nullptr before they are first used.
+  static SlabAllocator *slabs_;
+  /// The number of bytes allocated from dlmalloc, including whole slabs.
   static int64_t allocated_;
   static int64_t fallback_allocated_;
   static int64_t footprint_limit_;
@@ -17,6 +17,7 @@
 
 #include "ray/object_manager/plasma/protocol.h"
 
+#include <cstring>
 #include <utility>
 
 #include "flatbuffers/flatbuffers.h"
@@ -411,6 +412,50 @@ Status ReadReleaseReply(uint8_t *data, size_t size, ObjectID *object_id) {
   return PlasmaErrorStatus(message->error());
 }
 
+Status SendReleaseBatchRequest(const std::shared_ptr<StoreConn> &store_conn,
+                               const std::vector<ObjectID> &object_ids) {
+  flatbuffers::FlatBufferBuilder fbb;
+  auto message = fb::CreatePlasmaReleaseBatchRequest(
+      fbb, ToFlatbuffer(&fbb, object_ids.data(), object_ids.size()));
+  return PlasmaSend(store_conn, MessageType::PlasmaReleaseBatchRequest, &fbb, message);
+}
+
+Status ReadReleaseBatchRequest(uint8_t *data, size_t size,
+                               std::vector<ObjectID> *object_ids) {
+  RAY_DCHECK(data);
+  auto message = flatbuffers::GetRoot<fb::PlasmaReleaseBatchRequest>(data);
+  RAY_DCHECK(VerifyFlatbuffer(message, data, size));
+  ConvertToVector(message->object_ids(), object_ids,
+                  [](const flatbuffers::String &element) {
+                    return ObjectID::FromBinary(element.str());
+                  });
+  return Status::OK();
+}
+
+// Command ring messages. Each record holds the message type followed by the binary
+// object ID.
+
+bool WriteReleaseCommand(ray::SharedMemoryRing &ring, const ObjectID &object_id) {
+  char record[sizeof(int64_t) + ObjectID::Size()];
+  const int64_t type = static_cast<int64_t>(MessageType::PlasmaReleaseRequest);
+  std::memcpy(record, &type, sizeof(type));
+  std::memcpy(record + sizeof(type), object_id.Data(), object_id.Size());
+  return ring.TryWrite(record, sizeof(type) + object_id.Size());
+}
+
+Status ReadRingCommand(const std::string &record, MessageType *type,
+                       ObjectID *object_id) {
+  int64_t type_value;
+  if (record.size() != sizeof(type_value) + ObjectID::Size()) {
+    return Status::IOError("Malformed command ring record of " +
+                           std::to_string(record.size()) + " bytes");
+  }
+  std::memcpy(&type_value, record.data(), sizeof(type_value));
+  *type = static_cast<MessageType>(type_value);
+  *object_id = ObjectID::FromBinary(record.substr(sizeof(type_value)));
+  return Status::OK();
+}
+
 // Delete objects messages.
 
 Status SendDeleteRequest(const std::shared_ptr<StoreConn> &store_conn,
@@ -504,25 +549,36 @@ Status ReadContainsReply(uint8_t *data, size_t size, ObjectID *object_id,
 
 // Connect messages.
 
-Status SendConnectRequest(const std::shared_ptr<StoreConn> &store_conn) {
+Status SendConnectRequest(const std::shared_ptr<StoreConn> &store_conn,
+                          bool has_command_ring) {
   flatbuffers::FlatBufferBuilder fbb;
-  auto message = fb::CreatePlasmaConnectRequest(fbb);
+  auto message = fb::CreatePlasmaConnectRequest(fbb, has_command_ring);
   return PlasmaSend(store_conn, MessageType::PlasmaConnectRequest, &fbb, message);
 }
 
-Status ReadConnectRequest(uint8_t *data) { return Status::OK(); }
+Status ReadConnectRequest(uint8_t *data, size_t size, bool *has_command_ring) {
+  RAY_DCHECK(data);
+  auto message = flatbuffers::GetRoot<fb::PlasmaConnectRequest>(data);
+  RAY_DCHECK(VerifyFlatbuffer(message, data, size));
+  *has_command_ring = message->has_command_ring();
+  return Status::OK();
+}
 
-Status SendConnectReply(const std::shared_ptr<Client> &client, int64_t memory_capacity) {
+Status SendConnectReply(const std::shared_ptr<Client> &client, int64_t memory_capacity,
+                        bool command_ring_accepted) {
   flatbuffers::FlatBufferBuilder fbb;
-  auto message = fb::CreatePlasmaConnectReply(fbb, memory_capacity);
+  auto message =
+      fb::CreatePlasmaConnectReply(fbb, memory_capacity, command_ring_accepted);
   return PlasmaSend(client, MessageType::PlasmaConnectReply, &fbb, message);
 }
 
-Status ReadConnectReply(uint8_t *data, size_t size, int64_t *memory_capacity) {
+Status ReadConnectReply(uint8_t *data, size_t size, int64_t *memory_capacity,
+                        bool *command_ring_accepted) {
   RAY_DCHECK(data);
   auto message = flatbuffers::GetRoot<fb::PlasmaConnectReply>(data);
   RAY_DCHECK(VerifyFlatbuffer(message, data, size));
   *memory_capacity = message->memory_capacity();
+  *command_ring_accepted = message->command_ring_accepted();
   return Status::OK();
 }
 
@@ -587,6 +643,7 @@ Status SendGetReply(const std::shared_ptr<Client> &client, ObjectID object_ids[]
                     const std::vector<int64_t> &mmap_sizes) {
   flatbuffers::FlatBufferBuilder fbb;
   std::vector<PlasmaObjectSpec> objects;
+  objects.reserve(num_objects);
 
   std::vector<flatbuffers::Offset<fb::CudaHandle>> handles;
   for (int64_t i = 0; i < num_objects; ++i) {
@@ -598,6 +655,8 @@ Status SendGetReply(const std::shared_ptr<Client> &client, ObjectID object_ids[]
   }
   std::vector<int> store_fds_as_int;
   std::vector<int64_t> unique_fd_ids;
+  store_fds_as_int.reserve(store_fds.size());
+  unique_fd_ids.reserve(store_fds.size());
   for (MEMFD_TYPE store_fd : store_fds) {
     store_fds_as_int.push_back(FD2INT(store_fd.first));
     unique_fd_ids.push_back(store_fd.second);
@@ -25,6 +25,7 @@
 #include "ray/common/status.h"
 #include "ray/object_manager/plasma/plasma.h"
 #include "ray/object_manager/plasma/plasma_generated.h"
+#include "ray/util/shared_memory_ring.h"
 #include "src/ray/protobuf/common.pb.h"
 
 namespace plasma {
@@ -158,6 +159,24 @@ Status SendReleaseReply(const std::shared_ptr<Client> &client, ObjectID object_i
 
 Status ReadReleaseReply(uint8_t *data, size_t size, ObjectID *object_id);
 
+Status SendReleaseBatchRequest(const std::shared_ptr<StoreConn> &store_conn,
+                               const std::vector<ObjectID> &object_ids);
+
+Status ReadReleaseBatchRequest(uint8_t *data, size_t size,
+                               std::vector<ObjectID> *object_ids);
+
+/* Plasma command ring functions. A client queues requests that need no reply on its
+ * command ring, and the store processes them before the client's next message. */
+
+/// Queue a Release request on a command ring.
+///
+/// \return False if the ring is full, in which case the request must be sent over the
+/// socket instead.
+bool WriteReleaseCommand(ray::SharedMemoryRing &ring, const ObjectID &object_id);
+
+Status ReadRingCommand(const std::string &record, MessageType *type,
+                       ObjectID *object_id);
+
 /* Plasma Delete objects message functions. */
 
 Status SendDeleteRequest(const std::shared_ptr<StoreConn> &store_conn,
@@ -187,13 +206,16 @@ Status ReadContainsReply(uint8_t *data, size_t size, ObjectID *object_id,
 
 /* Plasma Connect message functions. */
 
-Status SendConnectRequest(const std::shared_ptr<StoreConn> &store_conn);
+Status SendConnectRequest(const std::shared_ptr<StoreConn> &store_conn,
+                          bool has_command_ring);
 
-Status ReadConnectRequest(uint8_t *data, size_t size);
+Status ReadConnectRequest(uint8_t *data, size_t size, bool *has_command_ring);
 
-Status SendConnectReply(const std::shared_ptr<Client> &client, int64_t memory_capacity);
+Status SendConnectReply(const std::shared_ptr<Client> &client, int64_t memory_capacity,
+                        bool command_ring_accepted);
 
-Status ReadConnectReply(uint8_t *data, size_t size, int64_t *memory_capacity);
+Status ReadConnectReply(uint8_t *data, size_t size, int64_t *memory_capacity,
+                        bool *command_ring_accepted);
 
 /* Plasma Evict message functions (no reply so far). */
 
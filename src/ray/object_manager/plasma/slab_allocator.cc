@@ -0,0 +1,217 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/object_manager/plasma/slab_allocator.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "ray/util/logging.h"
+
+namespace plasma {
+
+constexpr size_t SlabAllocator::kSlotAlignment;
+
+namespace {
+
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+size_t HighestPowerOfTwo(size_t value) {
+  size_t power = 1;
+  while (power <= value / 2) {
+    power *= 2;
+  }
+  return power;
+}
+
+int Percent(int64_t part, int64_t total) {
+  return total == 0 ? 0 : static_cast<int>(100 * part / total);
+}
+
+}  // namespace
+
+SlabAllocator::SlabAllocator(size_t max_object_bytes, size_t slab_bytes,
+                             AllocateSlab allocate_slab, FreeSlab free_slab)
+    // Every slab holds at least 8 objects, so that the slabs of the largest class do
+    // not waste most of their space.
+    : max_object_bytes_(std::min(max_object_bytes, slab_bytes / 8)),
+      slab_bytes_(slab_bytes),
+      allocate_slab_(std::move(allocate_slab)),
+      free_slab_(std::move(free_slab)) {
+  if (max_object_bytes_ == 0) {
+    return;
+  }
+  RAY_CHECK(slab_bytes_ >= kSlotAlignment && (slab_bytes_ & (slab_bytes_ - 1)) == 0)
+      << "The slab size " << slab_bytes_ << " must be a power of two";
+  // Four size classes per power of two, so that an object wastes at most about a
+  // fifth of its slot.
+  size_t size = kSlotAlignment;
+  while (size < max_object_bytes_) {
+    size_classes_.push_back(size);
+    size += std::max(kSlotAlignment, HighestPowerOfTwo(size) / 4);
+  }
+  size_classes_.push_back(RoundUp(max_object_bytes_, kSlotAlignment));
+  for (size_t slot_bytes : size_classes_) {
+    SizeClass size_class;
+    size_class.slot_bytes = slot_bytes;
+    size_class.slots_per_slab = slab_bytes_ / slot_bytes;
+    classes_.push_back(std::move(size_class));
+  }
+}
+
+SlabAllocator::~SlabAllocator() {
+  for (const auto &entry : slabs_) {
+    free_slab_(entry.second->base, slab_bytes_);
+  }
+}
+
+size_t SlabAllocator::SizeClassIndex(size_t bytes) const {
+  auto it = std::lower_bound(size_classes_.begin(), size_classes_.end(), bytes);
+  RAY_CHECK(it != size_classes_.end()) << bytes << " bytes is too large for a slab";
+  return it - size_classes_.begin();
+}
+
+void *SlabAllocator::Allocate(size_t bytes) {
+  const size_t index = SizeClassIndex(bytes);
+  auto &size_class = classes_[index];
+  Slab *slab;
+  if (!size_class.partial_slabs.empty()) {
+    slab = size_class.partial_slabs.back();
+  } else if (size_class.empty_slab != nullptr) {
+    slab = size_class.empty_slab;
+    size_class.empty_slab = nullptr;
+    AddPartialSlab(slab);
+  } else {
+    slab = NewSlab(index);
+    if (slab == nullptr) {
+      return nullptr;
+    }
+    AddPartialSlab(slab);
+  }
+  const uint32_t slot = slab->free_slots.back();
+  slab->free_slots.pop_back();
+  if (slab->free_slots.empty()) {
+    RemovePartialSlab(slab);
+  }
+  size_class.num_used_slots++;
+  size_class.requested_bytes += bytes;
+  used_bytes_ += size_class.slot_bytes;
+  requested_bytes_ += bytes;
+  return slab->base + slot * size_class.slot_bytes;
+}
+
+bool SlabAllocator::Free(void *mem, size_t bytes) {
+  auto it = slabs_.find(reinterpret_cast<uintptr_t>(mem) & ~(slab_bytes_ - 1));
+  if (it == slabs_.end()) {
+    return false;
+  }
+  Slab *slab = it->second.get();
+  auto &size_class = classes_[slab->size_class];
+  const size_t offset = static_cast<uint8_t *>(mem) - slab->base;
+  RAY_CHECK(offset % size_class.slot_bytes == 0) << "Freeing a pointer into a slot";
+  const bool was_full = slab->free_slots.empty();
+  slab->free_slots.push_back(offset / size_class.slot_bytes);
+  size_class.num_used_slots--;
+  size_class.requested_bytes -= bytes;
+  used_bytes_ -= size_class.slot_bytes;
+  requested_bytes_ -= bytes;
+
+  if (slab->free_slots.size() == size_class.slots_per_slab) {
+    if (!was_full) {
+      RemovePartialSlab(slab);
+    }
+    if (size_class.empty_slab == nullptr) {
+      size_class.empty_slab = slab;
+    } else {
+      DeleteSlab(slab);
+    }
+  } else if (was_full) {
+    AddPartialSlab(slab);
+  }
+  return true;
+}
+
+void SlabAllocator::ReleaseEmptySlabs() {
+  for (auto &size_class : classes_) {
+    if (size_class.empty_slab != nullptr) {
+      DeleteSlab(size_class.empty_slab);
+      size_class.empty_slab = nullptr;
+    }
+  }
+}
+
+SlabAllocator::Slab *SlabAllocator::NewSlab(size_t size_class) {
+  auto base = static_cast<uint8_t *>(allocate_slab_(slab_bytes_, slab_bytes_));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  RAY_CHECK(reinterpret_cast<uintptr_t>(base) % slab_bytes_ == 0);
+  auto slab = std::make_unique<Slab>();
+  slab->size_class = size_class;
+  slab->base = base;
+  // Hand out the slots in address order.
+  const uint32_t num_slots = classes_[size_class].slots_per_slab;
+  slab->free_slots.reserve(num_slots);
+  for (uint32_t slot = num_slots; slot > 0; slot--) {
+    slab->free_slots.push_back(slot - 1);
+  }
+  classes_[size_class].num_slabs++;
+  Slab *result = slab.get();
+  slabs_.emplace(reinterpret_cast<uintptr_t>(base), std::move(slab));
+  return result;
+}
+
+void SlabAllocator::DeleteSlab(Slab *slab) {
+  classes_[slab->size_class].num_slabs--;
+  free_slab_(slab->base, slab_bytes_);
+  slabs_.erase(reinterpret_cast<uintptr_t>(slab->base));
+}
+
+void SlabAllocator::AddPartialSlab(Slab *slab) {
+  auto &partial_slabs = classes_[slab->size_class].partial_slabs;
+  slab->partial_index = partial_slabs.size();
+  partial_slabs.push_back(slab);
+}
+
+void SlabAllocator::RemovePartialSlab(Slab *slab) {
+  auto &partial_slabs = classes_[slab->size_class].partial_slabs;
+  RAY_CHECK(partial_slabs[slab->partial_index] == slab);
+  partial_slabs[slab->partial_index] = partial_slabs.back();
+  partial_slabs[slab->partial_index]->partial_index = slab->partial_index;
+  partial_slabs.pop_back();
+}
+
+std::string SlabAllocator::DebugString() const {
+  std::stringstream result;
+  result << "small object slabs: " << slabs_.size() << " slabs of " << slab_bytes_
+         << " bytes, " << Percent(used_bytes_, SlabBytes()) << "% of slab bytes in use, "
+         << Percent(used_bytes_ - requested_bytes_, used_bytes_)
+         << "% of used bytes wasted by rounding up to a slot";
+  for (const auto &size_class : classes_) {
+    if (size_class.num_slabs == 0) {
+      continue;
+    }
+    const int64_t used_bytes = size_class.num_used_slots * size_class.slot_bytes;
+    result << "\n  - " << size_class.slot_bytes << " byte slots: "
+           << size_class.num_slabs << " slabs, " << size_class.num_used_slots << " / "
+           << size_class.num_slabs * size_class.slots_per_slab << " slots in use, "
+           << Percent(used_bytes - size_class.requested_bytes, used_bytes)
+           << "% wasted";
+  }
+  return result.str();
+}
+
+}  // namespace plasma
@@ -0,0 +1,151 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace plasma {
+
+/// Packs small objects into slabs. Every slab is carved out of the underlying
+/// allocator in one piece and is split into equally sized slots of one size class,
+/// so that allocating and freeing a small object only pushes or pops a per-class free
+/// list. Slabs are aligned to their size, which lets Free find the slab of a pointer
+/// with a single hash lookup.
+///
+/// This class is not thread-safe.
+class SlabAllocator {
+ public:
+  /// Allocates a slab of bytes bytes, aligned to alignment. Returns nullptr if there
+  /// is not enough memory.
+  using AllocateSlab = std::function<void *(size_t alignment, size_t bytes)>;
+  /// Frees a slab that was returned by AllocateSlab.
+  using FreeSlab = std::function<void(void *mem, size_t bytes)>;
+
+  /// The alignment of every slot.
+  static constexpr size_t kSlotAlignment = 64;
+
+  /// Create a slab allocator.
+  ///
+  /// \param max_object_bytes The largest object that is allocated from slabs. 0
+  /// disables the allocator.
+  /// \param slab_bytes The size of each slab, which must be a power of two.
+  /// \param allocate_slab Allocates the memory of a slab.
+  /// \param free_slab Frees the memory of a slab.
+  SlabAllocator(size_t max_object_bytes, size_t slab_bytes, AllocateSlab allocate_slab,
+                FreeSlab free_slab);
+
+  ~SlabAllocator();
+
+  /// Whether an allocation of this size and alignment should come from a slab.
+  bool Handles(size_t alignment, size_t bytes) const {
+    return max_object_bytes_ > 0 && bytes <= max_object_bytes_ &&
+           alignment <= kSlotAlignment;
+  }
+
+  /// Allocate a slot for an object. The caller must check Handles first.
+  ///
+  /// \param bytes The size of the object.
+  /// \return The slot, or nullptr if a new slab was needed but could not be allocated.
+  void *Allocate(size_t bytes);
+
+  /// Free a slot.
+  ///
+  /// \param mem The pointer that may have been returned by Allocate.
+  /// \param bytes The size of the object that mem was allocated for.
+  /// \return False if mem does not belong to a slab, in which case nothing is done.
+  bool Free(void *mem, size_t bytes);
+
+  /// Free the slabs that do not hold any objects.
+  void ReleaseEmptySlabs();
+
+  /// The number of bytes in all slabs.
+  int64_t SlabBytes() const { return slabs_.size() * slab_bytes_; }
+
+  /// The number of bytes that objects asked for.
+  int64_t RequestedBytes() const { return requested_bytes_; }
+
+  /// The number of bytes in the slots that hold objects.
+  int64_t UsedBytes() const { return used_bytes_; }
+
+  /// The size classes, in increasing order.
+  const std::vector<size_t> &SizeClasses() const { return size_classes_; }
+
+  /// Slab usage and fragmentation, overall and per size class.
+  std::string DebugString() const;
+
+ private:
+  struct Slab {
+    /// The index of the slab's size class.
+    size_t size_class;
+    /// The first byte of the slab.
+    uint8_t *base;
+    /// The slots that are not in use.
+    std::vector<uint32_t> free_slots;
+    /// The position of the slab in its class's partial_slabs, if it is there.
+    size_t partial_index;
+  };
+
+  struct SizeClass {
+    /// The size of every slot.
+    size_t slot_bytes;
+    /// The number of slots in a slab.
+    uint32_t slots_per_slab;
+    /// The slabs with at least one free slot and at least one object.
+    std::vector<Slab *> partial_slabs;
+    /// A slab without objects that is kept, so that an object that is created and
+    /// deleted over and over does not allocate a new slab every time.
+    Slab *empty_slab = nullptr;
+    /// The number of slabs of this class.
+    int64_t num_slabs = 0;
+    /// The number of slots in use.
+    int64_t num_used_slots = 0;
+    /// The number of bytes that the objects in this class asked for.
+    int64_t requested_bytes = 0;
+  };
+
+  /// The index of the smallest size class that fits bytes.
+  size_t SizeClassIndex(size_t bytes) const;
+
+  Slab *NewSlab(size_t size_class);
+
+  void DeleteSlab(Slab *slab);
+
+  void AddPartialSlab(Slab *slab);
+
+  void RemovePartialSlab(Slab *slab);
+
+  const size_t max_object_bytes_;
+  const size_t slab_bytes_;
+  const AllocateSlab allocate_slab_;
+  const FreeSlab free_slab_;
+
+  std::vector<size_t> size_classes_;
+  std::vector<SizeClass> classes_;
+
+  /// Every slab, keyed by its base address.
+  absl::flat_hash_map<uintptr_t, std::unique_ptr<Slab>> slabs_;
+
+  int64_t requested_bytes_ = 0;
+  int64_t used_bytes_ = 0;
+};
+
+}  // namespace plasma
@@ -31,6 +31,9 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include <boost/bind.hpp>
 #include <chrono>
@@ -78,11 +81,6 @@ struct GetRequest {
   /// The object information for the objects in this request. This is used in
   /// the reply.
   std::unordered_map<ObjectID, PlasmaObject> objects;
-  /// The minimum number of objects to wait for in this request.
-  int64_t num_objects_to_wait_for;
-  /// The number of object requests in this wait request that are already
-  /// satisfied.
-  int64_t num_satisfied;
   /// Whether or not the request comes from the core worker. It is used to track the size
   /// of total objects that are consumed by core worker.
   bool is_from_worker;
@@ -124,12 +122,8 @@ GetRequest::GetRequest(instrumented_io_context &io_context,
     : client(client),
       object_ids(object_ids.begin(), object_ids.end()),
       objects(object_ids.size()),
-      num_satisfied(0),
       is_from_worker(is_from_worker),
-      timer_(io_context) {
-  std::unordered_set<ObjectID> unique_ids(object_ids.begin(), object_ids.end());
-  num_objects_to_wait_for = unique_ids.size();
-}
+      timer_(io_context) {}
 
 PlasmaStore::PlasmaStore(instrumented_io_context &main_service, std::string directory,
                          std::string fallback_directory, bool hugepages_enabled,
@@ -405,7 +399,7 @@ PlasmaError PlasmaStore::CreateObject(const ObjectID &object_id,
   // eviction policy does not have an opportunity to evict the object.
   eviction_policy_.ObjectCreated(object_id, client.get(), true);
   // Record that this client is using this object.
-  AddToClientObjectIds(object_id, store_info_.objects[object_id].get(), client);
+  AddToClientObjectIds(object_id, entry, client);
   num_objects_unsealed_++;
   num_bytes_unsealed_ += data_size + metadata_size;
   num_bytes_created_total_ += data_size + metadata_size;
@@ -425,39 +419,17 @@ void PlasmaObject_init(PlasmaObject *object, ObjectTableEntry *entry) {
 }
 
 void PlasmaStore::RemoveGetRequest(const std::shared_ptr<GetRequest> &get_request) {
-  // Remove the get request from each of the relevant object_get_requests hash
-  // tables if it is present there. It should only be present there if the get
-  // request timed out or if it was issued by a client that has disconnected.
-  for (ObjectID &object_id : get_request->object_ids) {
-    auto object_request_iter = object_get_requests_.find(object_id);
-    if (object_request_iter != object_get_requests_.end()) {
-      auto &get_requests = object_request_iter->second;
-      // Erase get_req from the vector.
-      auto it = std::find(get_requests.begin(), get_requests.end(), get_request);
-      if (it != get_requests.end()) {
-        get_requests.erase(it);
-        // If the vector is empty, remove the object ID from the map.
-        if (get_requests.empty()) {
-          object_get_requests_.erase(object_request_iter);
-        }
-      }
-    }
-  }
+  // Remove the get request from the index if it is present there. It should only be
+  // present there if the get request timed out or if it was issued by a client that
+  // has disconnected.
+  get_requests_.RemoveRequest(get_request);
   // Remove the get request.
   get_request->CancelTimer();
   get_request->MarkRemoved();
 }
 
 void PlasmaStore::RemoveGetRequestsForClient(const std::shared_ptr<Client> &client) {
-  std::unordered_set<std::shared_ptr<GetRequest>> get_requests_to_remove;
-  for (auto const &pair : object_get_requests_) {
-    for (const auto &get_request : pair.second) {
-      if (get_request->client == client) {
-        get_requests_to_remove.insert(get_request);
-      }
-    }
-  }
-
+  auto get_requests_to_remove = get_requests_.GetRequestsForClient(client.get());
   // It shouldn't be possible for a given client to be in the middle of multiple get
   // requests.
   RAY_CHECK(get_requests_to_remove.size() <= 1);
@@ -477,6 +449,9 @@ void PlasmaStore::ReturnFromGet(const std::shared_ptr<GetRequest> &get_req) {
   absl::flat_hash_set<MEMFD_TYPE> fds_to_send;
   std::vector<MEMFD_TYPE> store_fds;
   std::vector<int64_t> mmap_sizes;
+  fds_to_send.reserve(get_req->objects.size());
+  store_fds.reserve(get_req->objects.size());
+  mmap_sizes.reserve(get_req->objects.size());
   for (const auto &object_id : get_req->object_ids) {
     PlasmaObject &object = get_req->objects[object_id];
     MEMFD_TYPE fd = object.store_fd;
@@ -507,54 +482,32 @@ void PlasmaStore::ReturnFromGet(const std::shared_ptr<GetRequest> &get_req) {
     RAY_LOG(ERROR) << "Failed to send Get reply to client on fd " << get_req->client;
   }
 
-  // Remove the get request from each of the relevant object_get_requests hash
-  // tables if it is present there. It should only be present there if the get
-  // request timed out.
+  // Remove the get request from the index if it is present there. It should only be
+  // present there if the get request timed out.
   RemoveGetRequest(get_req);
 }
 
 void PlasmaStore::UpdateObjectGetRequests(const ObjectID &object_id) {
-  auto it = object_get_requests_.find(object_id);
+  auto get_requests = get_requests_.PopWaiters(object_id);
   // If there are no get requests involving this object, then return.
-  if (it == object_get_requests_.end()) {
+  if (get_requests.empty()) {
     return;
   }
+  auto entry = GetObjectTableEntry(&store_info_, object_id);
+  RAY_CHECK(entry != nullptr);
 
-  auto &get_requests = it->second;
-
-  // After finishing the loop below, get_requests and it will have been
-  // invalidated by the removal of object_id from object_get_requests_.
-  size_t index = 0;
-  size_t num_requests = get_requests.size();
-  for (size_t i = 0; i < num_requests; ++i) {
-    auto get_req = get_requests[index];
-    auto entry = GetObjectTableEntry(&store_info_, object_id);
-    RAY_CHECK(entry != nullptr);
-
+  for (const auto &waiter : get_requests) {
+    const auto &get_req = waiter.first;
     PlasmaObject_init(&get_req->objects[object_id], entry);
-    get_req->num_satisfied += 1;
     // Record the fact that this client will be using this object and will
     // be responsible for releasing this object.
     AddToClientObjectIds(object_id, entry, get_req->client);
 
     // If this get request is done, reply to the client.
-    if (get_req->num_satisfied == get_req->num_objects_to_wait_for) {
+    if (waiter.second == 0) {
       ReturnFromGet(get_req);
-    } else {
-      // The call to ReturnFromGet will remove the current element in the
-      // array, so we only increment the counter in the else branch.
-      index += 1;
     }
   }
-
-  // No get requests should be waiting for this object anymore. The object ID
-  // may have been removed from the object_get_requests_ by ReturnFromGet, but
-  // if the get request has not returned yet, then remove the object ID from the
-  // map here.
-  it = object_get_requests_.find(object_id);
-  if (it != object_get_requests_.end()) {
-    object_get_requests_.erase(object_id);
-  }
 }
 
 void PlasmaStore::ProcessGetRequest(const std::shared_ptr<Client> &client,
@@ -563,14 +516,18 @@ void PlasmaStore::ProcessGetRequest(const std::shared_ptr<Client> &client,
   // Create a get request for this object.
   auto get_req = std::make_shared<GetRequest>(
       GetRequest(io_context_, client, object_ids, is_from_worker));
-  for (auto object_id : object_ids) {
+  std::vector<ObjectID> missing_object_ids;
+  for (const auto &object_id : object_ids) {
+    if (get_req->objects.count(object_id) > 0) {
+      // The object was requested more than once.
+      continue;
+    }
     // Check if this object is already present
     // locally. If so, record that the object is being used and mark it as accounted for.
     auto entry = GetObjectTableEntry(&store_info_, object_id);
     if (entry && entry->state == ObjectState::PLASMA_SEALED) {
       // Update the get request to take into account the present object.
       PlasmaObject_init(&get_req->objects[object_id], entry);
-      get_req->num_satisfied += 1;
       // If necessary, record that this client is using this object. In the case
       // where entry == NULL, this will be called from SealObject.
       AddToClientObjectIds(object_id, entry, client);
@@ -579,16 +536,19 @@ void PlasmaStore::ProcessGetRequest(const std::shared_ptr<Client> &client,
       // object is not present. This will be parsed by the client. We set the
       // data size to -1 to indicate that the object is not present.
       get_req->objects[object_id].data_size = -1;
-      // Add the get request to the relevant data structures.
-      object_get_requests_[object_id].push_back(get_req);
+      missing_object_ids.push_back(object_id);
     }
   }
 
   // If all of the objects are present already or if the timeout is 0, return to
   // the client.
-  if (get_req->num_satisfied == get_req->num_objects_to_wait_for || timeout_ms == 0) {
+  if (missing_object_ids.empty() || timeout_ms == 0) {
     ReturnFromGet(get_req);
-  } else if (timeout_ms != -1) {
+    return;
+  }
+  // Wait for the missing objects to be sealed.
+  get_requests_.AddRequest(get_req, client.get(), missing_object_ids);
+  if (timeout_ms != -1) {
     // Set a timer that will cause the get request to return to the client. Note
     // that a timeout of -1 is used to indicate that no timer should be set.
     get_req->AsyncWait(timeout_ms, [this, get_req](const boost::system::error_code &ec) {
@@ -809,6 +769,102 @@ void PlasmaStore::DisconnectClient(const std::shared_ptr<Client> &client) {
   }
 
   create_request_queue_.RemoveDisconnectedClientRequests(client);
+
+#ifndef _WIN32
+  // Cancels the wait for the doorbell.
+  client->command_ring_doorbell.reset();
+#endif
+  client->command_ring.reset();
+}
+
+Status PlasmaStore::AcceptCommandRing(const std::shared_ptr<Client> &client,
+                                      bool *accepted) {
+  *accepted = false;
+#ifdef _WIN32
+  return Status::NotImplemented("Command rings are not supported.");
+#else
+  int memory_fd;
+  RAY_RETURN_NOT_OK(client->RecvFd(&memory_fd));
+  int event_fd;
+  Status status = client->RecvFd(&event_fd);
+  if (!status.ok()) {
+    close(memory_fd);
+    return status;
+  }
+  auto ring = ray::SharedMemoryRing::Attach(memory_fd, event_fd);
+  if (ring == nullptr) {
+    return Status::OK();
+  }
+  // The descriptor closes its fd, so give it a copy of the ring's.
+  int doorbell_fd = dup(ring->EventFd());
+  if (doorbell_fd < 0) {
+    RAY_LOG(WARNING) << "Failed to dup the command ring's eventfd: "
+                     << strerror(errno);
+    return Status::OK();
+  }
+  client->command_ring = std::move(ring);
+  client->command_ring_doorbell =
+      std::make_unique<boost::asio::posix::stream_descriptor>(io_context_, doorbell_fd);
+  *accepted = true;
+  WaitForRingCommands(client);
+  return Status::OK();
+#endif
+}
+
+Status PlasmaStore::ProcessRingCommands(const std::shared_ptr<Client> &client) {
+  std::string record;
+  fb::MessageType type;
+  ObjectID object_id;
+  while (client->command_ring->TryRead(&record)) {
+    RAY_RETURN_NOT_OK(ReadRingCommand(record, &type, &object_id));
+    switch (type) {
+    case fb::MessageType::PlasmaReleaseRequest:
+      ReleaseObject(object_id, client);
+      break;
+    default:
+      return Status::Invalid("Unexpected message type on command ring: " +
+                             std::to_string(static_cast<int64_t>(type)));
+    }
+  }
+  if (client->command_ring->Corrupted()) {
+    return Status::Invalid("The client corrupted its command ring");
+  }
+  return Status::OK();
+}
+
+void PlasmaStore::WaitForRingCommands(const std::shared_ptr<Client> &client) {
+#ifndef _WIN32
+  // The client only rings the doorbell once the store waits for it, so requests that
+  // are queued while the store is busy are processed in one go.
+  while (true) {
+    Status status = ProcessRingCommands(client);
+    if (!status.ok()) {
+      RAY_LOG(ERROR) << "Fail to process client command ring. " << status.ToString();
+      client->Close();
+      return;
+    }
+    if (client->command_ring->PrepareToWait()) {
+      break;
+    }
+    client->command_ring->FinishWait();
+  }
+  std::weak_ptr<Client> weak_client = client;
+  client->command_ring_doorbell->async_wait(
+      boost::asio::posix::stream_descriptor::wait_read,
+      [this, weak_client](const boost::system::error_code &error) {
+        auto client = weak_client.lock();
+        if (error || client == nullptr) {
+          // The client disconnected.
+          return;
+        }
+        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        if (client->command_ring == nullptr) {
+          return;
+        }
+        client->command_ring->FinishWait();
+        WaitForRingCommands(client);
+      });
+#endif
 }
 
 Status PlasmaStore::ProcessMessage(const std::shared_ptr<Client> &client,
@@ -822,6 +878,10 @@ Status PlasmaStore::ProcessMessage(const std::shared_ptr<Client> &client,
   size_t input_size = message.size();
   ObjectID object_id;
 
+  if (client->command_ring != nullptr) {
+    RAY_RETURN_NOT_OK(ProcessRingCommands(client));
+  }
+
   // Process the different types of requests.
   switch (type) {
   case fb::MessageType::PlasmaCreateRequest: {
@@ -882,6 +942,13 @@ Status PlasmaStore::ProcessMessage(const std::shared_ptr<Client> &client,
     RAY_RETURN_NOT_OK(ReadReleaseRequest(input, input_size, &object_id));
     ReleaseObject(object_id, client);
   } break;
+  case fb::MessageType::PlasmaReleaseBatchRequest: {
+    std::vector<ObjectID> object_ids;
+    RAY_RETURN_NOT_OK(ReadReleaseBatchRequest(input, input_size, &object_ids));
+    for (const auto &object_id : object_ids) {
+      ReleaseObject(object_id, client);
+    }
+  } break;
   case fb::MessageType::PlasmaDeleteRequest: {
     std::vector<ObjectID> object_ids;
     std::vector<PlasmaError> error_codes;
@@ -916,7 +983,14 @@ Status PlasmaStore::ProcessMessage(const std::shared_ptr<Client> &client,
     RAY_RETURN_NOT_OK(SendEvictReply(client, num_bytes_evicted));
   } break;
   case fb::MessageType::PlasmaConnectRequest: {
-    RAY_RETURN_NOT_OK(SendConnectReply(client, PlasmaAllocator::GetFootprintLimit()));
+    bool has_command_ring;
+    RAY_RETURN_NOT_OK(ReadConnectRequest(input, input_size, &has_command_ring));
+    bool command_ring_accepted = false;
+    if (has_command_ring) {
+      RAY_RETURN_NOT_OK(AcceptCommandRing(client, &command_ring_accepted));
+    }
+    RAY_RETURN_NOT_OK(SendConnectReply(client, PlasmaAllocator::GetFootprintLimit(),
+                                       command_ring_accepted));
   } break;
   case fb::MessageType::PlasmaDisconnectClient:
     RAY_LOG(DEBUG) << "Disconnecting client on fd " << client;
@@ -1077,6 +1151,8 @@ std::string PlasmaStore::GetDebugDump() const {
   auto num_pending_bytes = create_request_queue_.NumPendingBytes();
   buffer << num_pending_requests << " pending objects of total size "
          << num_pending_bytes / 1024 / 1024 << "MB\n";
+  buffer << "- " << create_request_queue_.WaitTimeDebugString() << "\n";
+  buffer << "- " << PlasmaAllocator::SlabDebugString() << "\n";
   buffer << "- objects spillable: " << num_objects_spillable << "\n";
   buffer << "- bytes spillable: " << num_bytes_spillable << "\n";
   buffer << "- objects unsealed: " << num_objects_unsealed << "\n";
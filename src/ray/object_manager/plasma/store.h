@@ -31,6 +31,7 @@
 #include "ray/object_manager/plasma/common.h"
 #include "ray/object_manager/plasma/connection.h"
 #include "ray/object_manager/plasma/create_request_queue.h"
+#include "ray/object_manager/plasma/get_request_index.h"
 #include "ray/object_manager/plasma/plasma.h"
 #include "ray/object_manager/plasma/plasma_allocator.h"
 #include "ray/object_manager/plasma/protocol.h"
@@ -252,6 +253,21 @@ class PlasmaStore {
                           ptrdiff_t *offset, const std::shared_ptr<Client> &client,
                           bool is_create, bool fallback_allocator, PlasmaError *error);
 
+  /// Receive the fds of a client's command ring and start serving it.
+  ///
+  /// \param client The client that sent the ring.
+  /// \param[out] accepted Whether the ring is usable.
+  /// \return An error if the client did not send the fds.
+  Status AcceptCommandRing(const std::shared_ptr<Client> &client, bool *accepted);
+
+  /// Process the requests that a client queued on its command ring. This must run
+  /// before any message from the same client, so that requests are processed in the
+  /// order that the client sent them.
+  Status ProcessRingCommands(const std::shared_ptr<Client> &client);
+
+  /// Drain a client's command ring, then wait for the client to ring the doorbell.
+  void WaitForRingCommands(const std::shared_ptr<Client> &client);
+
   // Start listening for clients.
   void DoAccept();
 
@@ -269,10 +285,9 @@ class PlasmaStore {
   PlasmaStoreInfo store_info_;
   /// The state that is managed by the eviction policy.
   QuotaAwarePolicy eviction_policy_;
-  /// A hash table mapping object IDs to a vector of the get requests that are
-  /// waiting for the object to arrive.
-  std::unordered_map<ObjectID, std::vector<std::shared_ptr<GetRequest>>>
-      object_get_requests_;
+  /// The get requests that are waiting for objects to arrive, indexed by object and by
+  /// client.
+  GetRequestIndex<GetRequest, const Client *> get_requests_;
 
   std::unordered_set<ObjectID> deletion_cache_;
 
@@ -92,6 +92,8 @@ void PlasmaStoreRunner::Start(ray::SpillObjectsCallback spill_objects_callback,
         RayConfig::instance().object_spilling_threshold(), spill_objects_callback,
         object_store_full_callback, add_object_callback, delete_object_callback));
     plasma_config = store_->GetPlasmaStoreInfo();
+    PlasmaAllocator::SetSlabLimits(RayConfig::instance().plasma_slab_max_object_bytes(),
+                                   RayConfig::instance().plasma_slab_bytes());
 
     // We are using a single memory-mapped file by mallocing and freeing a single
     // large amount of space up front. According to the documentation,
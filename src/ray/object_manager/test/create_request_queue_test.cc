@@ -57,7 +57,8 @@ class CreateRequestQueueTest : public ::testing::Test {
             /*plasma_unlimited=*/plasma_unlimited) {}
 
   void AssertNoLeaks() {
-    ASSERT_TRUE(queue_.queue_.empty());
+    ASSERT_TRUE(queue_.client_queues_.empty());
+    ASSERT_TRUE(queue_.client_queue_index_.empty());
     ASSERT_TRUE(queue_.fulfilled_requests_.empty());
   }
 
@@ -458,6 +459,104 @@ TEST_F(CreateRequestQueueTest, TestTryRequestImmediately) {
   AssertNoLeaks();
 }
 
+TEST_F(CreateRequestQueueTest, TestSmallRequestsBypassBlockedRequest) {
+  auto oom_request = [&](bool fallback, PlasmaObject *result, bool *spill_requested) {
+    return PlasmaError::OutOfMemory;
+  };
+  auto request = [&](bool fallback, PlasmaObject *result, bool *spill_requested) {
+    result->data_size = 1234;
+    return PlasmaError::OK;
+  };
+  int num_large_tries = 0;
+  auto large_request = [&](bool fallback, PlasmaObject *result,
+                           bool *spill_requested) {
+    num_large_tries++;
+    result->data_size = 1234;
+    return PlasmaError::OK;
+  };
+
+  auto client1 = std::make_shared<MockClient>();
+  auto client2 = std::make_shared<MockClient>();
+  auto client3 = std::make_shared<MockClient>();
+  auto req_id1 = queue_.AddRequest(ObjectID::Nil(), client1, oom_request, 1000);
+  auto req_id2 = queue_.AddRequest(ObjectID::Nil(), client1, request, 10);
+  auto req_id3 = queue_.AddRequest(ObjectID::Nil(), client2, request, 10);
+  auto req_id4 = queue_.AddRequest(ObjectID::Nil(), client3, large_request, 2000);
+  auto req_id5 = queue_.AddRequest(ObjectID::Nil(), client2, request, 10);
+
+  // The small requests of other clients get served. The client's own request and the
+  // larger request stay queued behind the blocked one.
+  ASSERT_TRUE(queue_.ProcessRequests().IsObjectStoreFull());
+  ASSERT_REQUEST_UNFINISHED(queue_, req_id1);
+  ASSERT_REQUEST_UNFINISHED(queue_, req_id2);
+  ASSERT_REQUEST_FINISHED(queue_, req_id3, PlasmaError::OK);
+  ASSERT_REQUEST_UNFINISHED(queue_, req_id4);
+  ASSERT_REQUEST_FINISHED(queue_, req_id5, PlasmaError::OK);
+  ASSERT_EQ(num_large_tries, 0);
+  ASSERT_EQ(queue_.NumPendingRequests(), 3);
+  ASSERT_EQ(queue_.NumPendingBytes(), 3010);
+
+  // The smaller requests do not extend the grace period of the blocked request.
+  current_time_ns_ += oom_grace_period_s_ * 2e9;
+  ASSERT_TRUE(queue_.ProcessRequests().ok());
+  ASSERT_REQUEST_FINISHED(queue_, req_id1, PlasmaError::OutOfMemory);
+  ASSERT_REQUEST_FINISHED(queue_, req_id2, PlasmaError::OK);
+  ASSERT_REQUEST_FINISHED(queue_, req_id4, PlasmaError::OK);
+  ASSERT_EQ(num_large_tries, 1);
+  AssertNoLeaks();
+}
+
+TEST_F(CreateRequestQueueTest, TestClientsTakeTurns) {
+  std::vector<int> order;
+  auto request = [&](int id) {
+    return [&order, id](bool fallback, PlasmaObject *result, bool *spill_requested) {
+      order.push_back(id);
+      result->data_size = 1234;
+      return PlasmaError::OK;
+    };
+  };
+
+  auto client1 = std::make_shared<MockClient>();
+  auto client2 = std::make_shared<MockClient>();
+  std::vector<uint64_t> req_ids;
+  req_ids.push_back(queue_.AddRequest(ObjectID::Nil(), client1, request(1), 1234));
+  req_ids.push_back(queue_.AddRequest(ObjectID::Nil(), client1, request(2), 1234));
+  req_ids.push_back(queue_.AddRequest(ObjectID::Nil(), client1, request(3), 1234));
+  req_ids.push_back(queue_.AddRequest(ObjectID::Nil(), client2, request(4), 1234));
+  ASSERT_TRUE(queue_.ProcessRequests().ok());
+  ASSERT_EQ(order, std::vector<int>({1, 4, 2, 3}));
+  for (auto req_id : req_ids) {
+    ASSERT_REQUEST_FINISHED(queue_, req_id, PlasmaError::OK);
+  }
+  AssertNoLeaks();
+}
+
+TEST_F(CreateRequestQueueTest, TestWaitTimeHistogram) {
+  auto request = [&](bool fallback, PlasmaObject *result, bool *spill_requested) {
+    result->data_size = 1234;
+    return PlasmaError::OK;
+  };
+  auto client = std::make_shared<MockClient>();
+  auto req_id1 = queue_.AddRequest(ObjectID::Nil(), client, request, 1234);
+  ASSERT_TRUE(queue_.ProcessRequests().ok());
+  auto req_id2 = queue_.AddRequest(ObjectID::Nil(), client, request, 1234);
+  current_time_ns_ += 50e6;
+  ASSERT_TRUE(queue_.ProcessRequests().ok());
+  auto req_id3 = queue_.AddRequest(ObjectID::Nil(), client, request, 1234);
+  current_time_ns_ += 20e9;
+  ASSERT_TRUE(queue_.ProcessRequests().ok());
+
+  // One request each waited for 0ms, 50ms and 20s.
+  ASSERT_EQ(queue_.WaitTimeHistogram(), std::vector<int64_t>({1, 0, 1, 0, 0, 1}));
+  ASSERT_EQ(queue_.WaitTimeDebugString(),
+            "create request wait times: <1ms: 1 <10ms: 0 <100ms: 1 <1000ms: 0 "
+            "<10000ms: 0 >=10000ms: 1");
+  ASSERT_REQUEST_FINISHED(queue_, req_id1, PlasmaError::OK);
+  ASSERT_REQUEST_FINISHED(queue_, req_id2, PlasmaError::OK);
+  ASSERT_REQUEST_FINISHED(queue_, req_id3, PlasmaError::OK);
+  AssertNoLeaks();
+}
+
 }  // namespace plasma
 
 int main(int argc, char **argv) {
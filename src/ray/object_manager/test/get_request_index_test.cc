@@ -0,0 +1,133 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/object_manager/plasma/get_request_index.h"
+
+#include "gtest/gtest.h"
+#include "ray/util/util.h"
+
+namespace plasma {
+
+struct MockGetRequest {
+  explicit MockGetRequest(int id) : id(id) {}
+  int id;
+};
+
+using TestIndex = GetRequestIndex<MockGetRequest, int>;
+
+TEST(GetRequestIndexTest, TestPopWaiters) {
+  TestIndex index;
+  auto object1 = ObjectID::FromRandom();
+  auto object2 = ObjectID::FromRandom();
+  auto request1 = std::make_shared<MockGetRequest>(1);
+  auto request2 = std::make_shared<MockGetRequest>(2);
+  index.AddRequest(request1, /*client=*/0, {object1, object2});
+  index.AddRequest(request2, /*client=*/1, {object1});
+  ASSERT_EQ(index.NumRequests(), 2);
+  ASSERT_EQ(index.NumObjectsWaitedFor(), 2);
+
+  // Waiters are returned in order, with the number of objects they still wait for.
+  auto waiters = index.PopWaiters(object1);
+  ASSERT_EQ(waiters.size(), 2);
+  ASSERT_EQ(waiters[0].first, request1);
+  ASSERT_EQ(waiters[0].second, 1);
+  ASSERT_EQ(waiters[1].first, request2);
+  ASSERT_EQ(waiters[1].second, 0);
+  // Finished requests leave the index.
+  ASSERT_EQ(index.NumRequests(), 1);
+  ASSERT_TRUE(index.GetRequestsForClient(1).empty());
+  ASSERT_TRUE(index.PopWaiters(object1).empty());
+
+  waiters = index.PopWaiters(object2);
+  ASSERT_EQ(waiters.size(), 1);
+  ASSERT_EQ(waiters[0].second, 0);
+  ASSERT_EQ(index.NumRequests(), 0);
+  ASSERT_EQ(index.NumObjectsWaitedFor(), 0);
+}
+
+TEST(GetRequestIndexTest, TestRemoveRequest) {
+  TestIndex index;
+  auto object1 = ObjectID::FromRandom();
+  auto object2 = ObjectID::FromRandom();
+  auto request1 = std::make_shared<MockGetRequest>(1);
+  auto request2 = std::make_shared<MockGetRequest>(2);
+  // Duplicate objects are only waited for once.
+  index.AddRequest(request1, /*client=*/0, {object1, object2, object1});
+  index.AddRequest(request2, /*client=*/0, {object2});
+  ASSERT_EQ(index.NumObjectsRemaining(request1), 2);
+  ASSERT_EQ(index.GetRequestsForClient(0).size(), 2);
+
+  index.RemoveRequest(request1);
+  ASSERT_EQ(index.NumObjectsRemaining(request1), 0);
+  ASSERT_EQ(index.GetRequestsForClient(0).size(), 1);
+  ASSERT_TRUE(index.PopWaiters(object1).empty());
+  // Removing a request twice is a no-op.
+  index.RemoveRequest(request1);
+
+  auto waiters = index.PopWaiters(object2);
+  ASSERT_EQ(waiters.size(), 1);
+  ASSERT_EQ(waiters[0].first, request2);
+  ASSERT_TRUE(index.GetRequestsForClient(0).empty());
+}
+
+// Performance benchmark for 10k outstanding gets of 16 objects each, drawn from a pool
+// of 1000 objects, so that each object has about 160 waiters. Half of the requests
+// are removed as if they timed out, and the objects are then sealed one by one.
+TEST(GetRequestIndexTest, TestManyMultiObjectGetsPerf) {
+  const int num_requests = 10000;
+  const int num_objects_per_request = 16;
+  const int num_objects = 1000;
+  std::vector<ObjectID> object_ids;
+  for (int i = 0; i < num_objects; i++) {
+    object_ids.push_back(ObjectID::FromRandom());
+  }
+  std::vector<std::shared_ptr<MockGetRequest>> requests;
+  for (int i = 0; i < num_requests; i++) {
+    requests.push_back(std::make_shared<MockGetRequest>(i));
+  }
+
+  TestIndex index;
+  int64_t start_ms = current_time_ms();
+  for (int i = 0; i < num_requests; i++) {
+    std::vector<ObjectID> request_object_ids;
+    for (int j = 0; j < num_objects_per_request; j++) {
+      request_object_ids.push_back(object_ids[(i * 7 + j * 13) % num_objects]);
+    }
+    index.AddRequest(requests[i], /*client=*/i, request_object_ids);
+  }
+  int64_t added_ms = current_time_ms();
+  for (int i = 0; i < num_requests; i += 2) {
+    for (const auto &request : index.GetRequestsForClient(i)) {
+      index.RemoveRequest(request);
+    }
+  }
+  int64_t removed_ms = current_time_ms();
+  size_t num_finished = 0;
+  for (const auto &object_id : object_ids) {
+    for (const auto &waiter : index.PopWaiters(object_id)) {
+      if (waiter.second == 0) {
+        num_finished++;
+      }
+    }
+  }
+  int64_t end_ms = current_time_ms();
+  ASSERT_EQ(num_finished, num_requests / 2);
+  ASSERT_EQ(index.NumRequests(), 0);
+  RAY_LOG(INFO) << num_requests << " gets of " << num_objects_per_request
+                << " objects: add " << added_ms - start_ms << " ms, remove half "
+                << removed_ms - added_ms << " ms, seal all " << end_ms - removed_ms
+                << " ms";
+}
+
+}  // namespace plasma
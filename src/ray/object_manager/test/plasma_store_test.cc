@@ -0,0 +1,396 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ray/common/asio/instrumented_io_context.h"
+#include "ray/common/ray_config.h"
+#include "ray/common/test_util.h"
+#include "ray/object_manager/plasma/client.h"
+#include "ray/object_manager/plasma/plasma_allocator.h"
+#include "ray/object_manager/plasma/store_runner.h"
+#include "ray/util/util.h"
+
+namespace plasma {
+
+/// Runs a plasma store on its own thread for the lifetime of the object.
+class TestStore {
+ public:
+  explicit TestStore(uint64_t slab_max_object_bytes = 0)
+      : socket_name_("/tmp/plasma_store_test_" +
+                     ObjectID::FromRandom().Hex().substr(0, 16)) {
+    RayConfig::instance().initialize("plasma_slab_max_object_bytes," +
+                                     std::to_string(slab_max_object_bytes));
+    runner_.reset(new PlasmaStoreRunner(socket_name_, /*system_memory=*/100 << 20,
+                                        /*hugepages_enabled=*/false, "/dev/shm", "/tmp"));
+    thread_ = std::thread([this]() {
+      runner_->Start([]() { return false; }, []() {}, [](const ray::ObjectInfo &) {},
+                     [](const ObjectID &) {});
+    });
+  }
+
+  ~TestStore() {
+    runner_->Stop();
+    thread_.join();
+  }
+
+  const std::string &SocketName() const { return socket_name_; }
+
+ private:
+  const std::string socket_name_;
+  std::unique_ptr<PlasmaStoreRunner> runner_;
+  std::thread thread_;
+};
+
+/// Run num_clients clients, each on its own thread, that create, seal, get, release
+/// and delete num_objects objects.
+void RunClients(const std::string &socket_name, int num_clients, int num_objects) {
+  const int64_t object_size = 1024;
+  std::vector<std::thread> clients;
+  for (int i = 0; i < num_clients; i++) {
+    clients.emplace_back([&socket_name, num_objects, i]() {
+      PlasmaClient client;
+      RAY_CHECK_OK(client.Connect(socket_name, "", 0, /*num_retries=*/100));
+      for (int j = 0; j < num_objects; j++) {
+        const uint8_t value = i * num_objects + j;
+        auto object_id = ObjectID::FromRandom();
+        std::shared_ptr<Buffer> data;
+        RAY_CHECK_OK(client.CreateAndSpillIfNeeded(
+            object_id, ray::rpc::Address(), object_size, nullptr, 0, &data,
+            flatbuf::ObjectSource::CreatedByWorker));
+        std::memset(data->Data(), value, object_size);
+        RAY_CHECK_OK(client.Seal(object_id));
+        RAY_CHECK_OK(client.Release(object_id));
+        {
+          std::vector<ObjectBuffer> buffers;
+          RAY_CHECK_OK(client.Get({object_id}, /*timeout_ms=*/-1, &buffers,
+                                  /*is_from_worker=*/false));
+          RAY_CHECK(buffers[0].data != nullptr);
+          RAY_CHECK(buffers[0].data->Data()[object_size - 1] == value);
+        }
+        bool has_object;
+        RAY_CHECK_OK(client.Contains(object_id, &has_object));
+        RAY_CHECK(has_object);
+        RAY_CHECK_OK(client.Delete(object_id));
+        RAY_CHECK_OK(client.Contains(object_id, &has_object));
+        RAY_CHECK(!has_object);
+      }
+      RAY_CHECK_OK(client.Disconnect());
+    });
+  }
+  for (auto &client : clients) {
+    client.join();
+  }
+}
+
+TEST(PlasmaStoreTest, TestConcurrentClients) {
+  TestStore store;
+  RunClients(store.SocketName(), /*num_clients=*/8, /*num_objects=*/100);
+
+  // Clients on different threads see each other's objects.
+  PlasmaClient creator;
+  PlasmaClient getter;
+  RAY_CHECK_OK(creator.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  RAY_CHECK_OK(getter.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  auto object_id = ObjectID::FromRandom();
+  std::vector<ObjectBuffer> buffers;
+  std::thread get_thread([&]() {
+    RAY_CHECK_OK(getter.Get({object_id}, /*timeout_ms=*/-1, &buffers,
+                            /*is_from_worker=*/false));
+  });
+  std::shared_ptr<Buffer> data;
+  RAY_CHECK_OK(creator.CreateAndSpillIfNeeded(object_id, ray::rpc::Address(), 8,
+                                              nullptr, 0, &data,
+                                              flatbuf::ObjectSource::CreatedByWorker));
+  std::memset(data->Data(), 7, 8);
+  RAY_CHECK_OK(creator.Seal(object_id));
+  RAY_CHECK_OK(creator.Release(object_id));
+  get_thread.join();
+  ASSERT_NE(buffers[0].data, nullptr);
+  ASSERT_EQ(buffers[0].data->Data()[0], 7);
+  // Free the object, so that the next store in this process can use all of the memory.
+  buffers.clear();
+  RAY_CHECK_OK(getter.Delete(object_id));
+  RAY_CHECK_OK(creator.Disconnect());
+  RAY_CHECK_OK(getter.Disconnect());
+}
+
+TEST(PlasmaStoreTest, TestSmallObjectEviction) {
+  TestStore store(/*slab_max_object_bytes=*/64 * 1024);
+  PlasmaClient client;
+  RAY_CHECK_OK(client.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  const int64_t small_size = 48 * 1024;
+  const int64_t large_size = 40 << 20;
+
+  // Fill 80% of the store with small objects that can be evicted.
+  std::vector<ObjectID> object_ids;
+  while (PlasmaAllocator::Allocated() + small_size <= (80 << 20)) {
+    auto object_id = ObjectID::FromRandom();
+    std::shared_ptr<Buffer> data;
+    RAY_CHECK_OK(client.CreateAndSpillIfNeeded(object_id, ray::rpc::Address(),
+                                               small_size, nullptr, 0, &data,
+                                               flatbuf::ObjectSource::CreatedByWorker));
+    RAY_CHECK_OK(client.Seal(object_id));
+    RAY_CHECK_OK(client.Release(object_id));
+    object_ids.push_back(object_id);
+  }
+
+  // Deleting an object gives back its slot, although the rest of its slab is in use.
+  const int64_t allocated = PlasmaAllocator::Allocated();
+  RAY_CHECK_OK(client.Delete(object_ids.back()));
+  object_ids.pop_back();
+  ASSERT_EQ(PlasmaAllocator::Allocated(), allocated - small_size);
+
+  // A large object fits after evicting the oldest small objects, but not all of them.
+  auto large_id = ObjectID::FromRandom();
+  std::shared_ptr<Buffer> data;
+  RAY_CHECK_OK(client.CreateAndSpillIfNeeded(large_id, ray::rpc::Address(), large_size,
+                                             nullptr, 0, &data,
+                                             flatbuf::ObjectSource::CreatedByWorker));
+  RAY_CHECK_OK(client.Seal(large_id));
+  RAY_CHECK_OK(client.Release(large_id));
+  bool has_object;
+  RAY_CHECK_OK(client.Contains(object_ids.front(), &has_object));
+  ASSERT_FALSE(has_object);
+  RAY_CHECK_OK(client.Contains(object_ids.back(), &has_object));
+  ASSERT_TRUE(has_object);
+  ASSERT_LE(PlasmaAllocator::Allocated(), PlasmaAllocator::GetFootprintLimit());
+
+  object_ids.push_back(large_id);
+  RAY_CHECK_OK(client.Delete(object_ids));
+  RAY_CHECK_OK(client.Disconnect());
+}
+
+/// Create and seal an object. The client uses the object until it releases it.
+ObjectID CreateObject(PlasmaClient &client) {
+  auto object_id = ObjectID::FromRandom();
+  std::shared_ptr<Buffer> data;
+  RAY_CHECK_OK(client.CreateAndSpillIfNeeded(object_id, ray::rpc::Address(), 8, nullptr,
+                                             0, &data,
+                                             flatbuf::ObjectSource::CreatedByWorker));
+  RAY_CHECK_OK(client.Seal(object_id));
+  return object_id;
+}
+
+/// Release batching tests. Each one creates objects with one client and deletes them
+/// with another, so that the store only deletes an object once the release of the
+/// creating client has reached it.
+class PlasmaReleaseBatchTest : public ::testing::Test {
+ public:
+  PlasmaReleaseBatchTest()
+      : default_batch_size_(RayConfig::instance().plasma_release_batch_size()),
+        default_timeout_ms_(RayConfig::instance().plasma_release_batch_timeout_ms()) {}
+
+  ~PlasmaReleaseBatchTest() {
+    RayConfig::instance().initialize(
+        "plasma_release_batch_size," + std::to_string(default_batch_size_) +
+        ";plasma_release_batch_timeout_ms," + std::to_string(default_timeout_ms_));
+  }
+
+  /// Connect the clients with the given batching configuration.
+  void Connect(uint32_t batch_size, uint64_t timeout_ms) {
+    RayConfig::instance().initialize(
+        "plasma_release_batch_size," + std::to_string(batch_size) +
+        ";plasma_release_batch_timeout_ms," + std::to_string(timeout_ms));
+    client_.reset(new PlasmaClient());
+    RAY_CHECK_OK(client_->Connect(store_.SocketName(), "", 0, /*num_retries=*/100));
+    RAY_CHECK_OK(deleter_.Connect(store_.SocketName(), "", 0, /*num_retries=*/100));
+  }
+
+  /// Create objects with the client and ask the store to delete them once they are
+  /// released.
+  std::vector<ObjectID> CreateObjects(int num_objects) {
+    std::vector<ObjectID> object_ids;
+    for (int i = 0; i < num_objects; i++) {
+      object_ids.push_back(CreateObject(*client_));
+    }
+    RAY_CHECK_OK(deleter_.Delete(object_ids));
+    return object_ids;
+  }
+
+  bool StoreContains(const ObjectID &object_id) {
+    bool has_object;
+    RAY_CHECK_OK(deleter_.Contains(object_id, &has_object));
+    return has_object;
+  }
+
+  bool WaitForRelease(const ObjectID &object_id) {
+    return ray::WaitForCondition(
+        [this, &object_id]() { return !StoreContains(object_id); }, 5000);
+  }
+
+ protected:
+  TestStore store_;
+  const uint32_t default_batch_size_;
+  const uint64_t default_timeout_ms_;
+  std::unique_ptr<PlasmaClient> client_;
+  PlasmaClient deleter_;
+};
+
+TEST_F(PlasmaReleaseBatchTest, TestFlushOnBatchSize) {
+  Connect(/*batch_size=*/4, /*timeout_ms=*/60000);
+  auto object_ids = CreateObjects(4);
+  for (int i = 0; i < 3; i++) {
+    RAY_CHECK_OK(client_->Release(object_ids[i]));
+  }
+  // The releases wait for the batch to fill up.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(StoreContains(object_ids[i]));
+  }
+  RAY_CHECK_OK(client_->Release(object_ids[3]));
+  for (const auto &object_id : object_ids) {
+    ASSERT_TRUE(WaitForRelease(object_id));
+  }
+  RAY_CHECK_OK(client_->Disconnect());
+  RAY_CHECK_OK(deleter_.Disconnect());
+}
+
+TEST_F(PlasmaReleaseBatchTest, TestFlushOnTimeout) {
+  Connect(/*batch_size=*/100, /*timeout_ms=*/50);
+  auto object_ids = CreateObjects(2);
+  auto start = std::chrono::steady_clock::now();
+  RAY_CHECK_OK(client_->Release(object_ids[0]));
+  RAY_CHECK_OK(client_->Release(object_ids[1]));
+  // The client sends nothing else, so the releases go out once the first one has
+  // waited for the timeout.
+  for (const auto &object_id : object_ids) {
+    ASSERT_TRUE(WaitForRelease(object_id));
+  }
+  ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+  RAY_CHECK_OK(client_->Disconnect());
+  RAY_CHECK_OK(deleter_.Disconnect());
+}
+
+TEST_F(PlasmaReleaseBatchTest, TestFlushOnRequest) {
+  Connect(/*batch_size=*/100, /*timeout_ms=*/60000);
+  auto object_ids = CreateObjects(1);
+  RAY_CHECK_OK(client_->Release(object_ids[0]));
+  // Any other request sends the pending releases first.
+  bool has_object;
+  RAY_CHECK_OK(client_->Contains(ObjectID::FromRandom(), &has_object));
+  ASSERT_TRUE(WaitForRelease(object_ids[0]));
+  RAY_CHECK_OK(client_->Disconnect());
+  RAY_CHECK_OK(deleter_.Disconnect());
+}
+
+TEST_F(PlasmaReleaseBatchTest, TestFlushOnDisconnect) {
+  Connect(/*batch_size=*/100, /*timeout_ms=*/60000);
+  auto object_ids = CreateObjects(1);
+  RAY_CHECK_OK(client_->Release(object_ids[0]));
+  RAY_CHECK_OK(client_->Disconnect());
+  // Destroying the client also stops its flusher thread without waiting for the
+  // timeout.
+  client_.reset();
+  ASSERT_TRUE(WaitForRelease(object_ids[0]));
+  RAY_CHECK_OK(deleter_.Disconnect());
+}
+
+TEST(PlasmaStoreTest, TestAsyncRequests) {
+  TestStore store;
+  PlasmaClient client;
+  RAY_CHECK_OK(client.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  instrumented_io_context io_service;
+  boost::asio::io_service::work work(io_service);
+  const auto test_thread = std::this_thread::get_id();
+  const auto object_id = ObjectID::FromRandom();
+  const std::string metadata = "meta";
+  std::vector<ObjectBuffer> buffers;
+
+  // Each request is made from the callback of the previous one, as on an event loop.
+  client.CreateAsync(
+      object_id, ray::rpc::Address(), 8,
+      reinterpret_cast<const uint8_t *>(metadata.data()), metadata.size(),
+      flatbuf::ObjectSource::CreatedByWorker, /*device_num=*/0, io_service,
+      [&](Status create_status, std::shared_ptr<Buffer> data) {
+        RAY_CHECK_OK(create_status);
+        RAY_CHECK(std::this_thread::get_id() == test_thread);
+        std::memset(data->Data(), 7, 8);
+        client.SealAsync(object_id, io_service, [&](Status seal_status) {
+          RAY_CHECK_OK(seal_status);
+          client.ReleaseAsync(object_id, io_service, [&](Status release_status) {
+            RAY_CHECK_OK(release_status);
+            client.GetAsync({object_id}, /*timeout_ms=*/0, /*is_from_worker=*/false,
+                            io_service,
+                            [&](Status get_status, std::vector<ObjectBuffer> results) {
+                              RAY_CHECK_OK(get_status);
+                              buffers = std::move(results);
+                              io_service.stop();
+                            });
+          });
+        });
+      });
+  io_service.run();
+
+  ASSERT_EQ(buffers.size(), 1);
+  ASSERT_NE(buffers[0].data, nullptr);
+  ASSERT_EQ(buffers[0].data->Data()[7], 7);
+  ASSERT_EQ(std::string(reinterpret_cast<const char *>(buffers[0].metadata->Data()),
+                        buffers[0].metadata->Size()),
+            metadata);
+  buffers.clear();
+  RAY_CHECK_OK(client.Delete(object_id));
+  RAY_CHECK_OK(client.Disconnect());
+}
+
+TEST(PlasmaStoreTest, TestAsyncGetDoesNotBlockCaller) {
+  TestStore store;
+  PlasmaClient getter;
+  PlasmaClient creator;
+  RAY_CHECK_OK(getter.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  RAY_CHECK_OK(creator.Connect(store.SocketName(), "", 0, /*num_retries=*/100));
+  instrumented_io_context io_service;
+  boost::asio::io_service::work work(io_service);
+  const auto object_id = ObjectID::FromRandom();
+
+  // An object that is not in the store yet is missing from a get with no timeout.
+  std::vector<ObjectBuffer> missing;
+  getter.GetAsync({object_id}, /*timeout_ms=*/0, /*is_from_worker=*/false, io_service,
+                  [&](Status status, std::vector<ObjectBuffer> results) {
+                    RAY_CHECK_OK(status);
+                    missing = std::move(results);
+                    io_service.stop();
+                  });
+  io_service.run();
+  ASSERT_EQ(missing.size(), 1);
+  ASSERT_EQ(missing[0].data, nullptr);
+
+  // A get that waits for the object returns to the caller right away, so the caller can
+  // go on to create the object. The callback runs once the object is sealed.
+  bool got_object = false;
+  getter.GetAsync({object_id}, /*timeout_ms=*/-1, /*is_from_worker=*/false, io_service,
+                  [&](Status status, std::vector<ObjectBuffer> results) {
+                    RAY_CHECK_OK(status);
+                    got_object = results[0].data != nullptr;
+                    io_service.stop();
+                  });
+  std::shared_ptr<Buffer> data;
+  RAY_CHECK_OK(creator.CreateAndSpillIfNeeded(object_id, ray::rpc::Address(), 8, nullptr,
+                                              0, &data,
+                                              flatbuf::ObjectSource::CreatedByWorker));
+  RAY_CHECK_OK(creator.Seal(object_id));
+  RAY_CHECK_OK(creator.Release(object_id));
+  io_service.restart();
+  io_service.run();
+  ASSERT_TRUE(got_object);
+  RAY_CHECK_OK(creator.Delete(object_id));
+  RAY_CHECK_OK(getter.Disconnect());
+  RAY_CHECK_OK(creator.Disconnect());
+}
+
+}  // namespace plasma
@@ -0,0 +1,183 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/object_manager/plasma/slab_allocator.h"
+
+#include <cstdlib>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "ray/util/logging.h"
+#include "ray/util/util.h"
+
+namespace plasma {
+
+void *AlignedAlloc(size_t alignment, size_t bytes) {
+  void *mem = nullptr;
+  return posix_memalign(&mem, alignment, bytes) == 0 ? mem : nullptr;
+}
+
+/// Hands out slabs from the heap, up to a limit.
+class MockSlabSource {
+ public:
+  explicit MockSlabSource(int64_t max_slabs) : max_slabs_(max_slabs) {}
+
+  SlabAllocator::AllocateSlab Allocator() {
+    return [this](size_t alignment, size_t bytes) -> void * {
+      if (num_slabs_ == max_slabs_) {
+        return nullptr;
+      }
+      num_slabs_++;
+      return AlignedAlloc(alignment, bytes);
+    };
+  }
+
+  SlabAllocator::FreeSlab Freer() {
+    return [this](void *mem, size_t bytes) {
+      num_slabs_--;
+      std::free(mem);
+    };
+  }
+
+  int64_t NumSlabs() const { return num_slabs_; }
+
+ private:
+  const int64_t max_slabs_;
+  int64_t num_slabs_ = 0;
+};
+
+TEST(SlabAllocatorTest, TestSizeClasses) {
+  MockSlabSource source(/*max_slabs=*/1);
+  SlabAllocator slabs(/*max_object_bytes=*/100 * 1024, /*slab_bytes=*/1 << 20,
+                      source.Allocator(), source.Freer());
+  ASSERT_TRUE(slabs.Handles(64, 0));
+  ASSERT_TRUE(slabs.Handles(64, 100 * 1024));
+  ASSERT_FALSE(slabs.Handles(64, 100 * 1024 + 1));
+  ASSERT_FALSE(slabs.Handles(128, 64));
+  const auto &size_classes = slabs.SizeClasses();
+  ASSERT_EQ(size_classes.front(), 64u);
+  ASSERT_EQ(size_classes.back(), 100u * 1024);
+  for (size_t i = 1; i < size_classes.size(); i++) {
+    ASSERT_EQ(size_classes[i] % SlabAllocator::kSlotAlignment, 0u);
+    // Objects waste at most a fifth of their slot, apart from the smallest ones.
+    ASSERT_LE(size_classes[i] - size_classes[i - 1],
+              std::max<size_t>(64, size_classes[i] / 5));
+  }
+
+  // Small slabs hold at least 8 objects of the largest class.
+  SlabAllocator small_slabs(/*max_object_bytes=*/100 * 1024, /*slab_bytes=*/64 * 1024,
+                            source.Allocator(), source.Freer());
+  ASSERT_TRUE(small_slabs.Handles(64, 8 * 1024));
+  ASSERT_FALSE(small_slabs.Handles(64, 8 * 1024 + 1));
+
+  SlabAllocator disabled(/*max_object_bytes=*/0, /*slab_bytes=*/1 << 20,
+                         source.Allocator(), source.Freer());
+  ASSERT_FALSE(disabled.Handles(64, 0));
+}
+
+TEST(SlabAllocatorTest, TestAllocateAndFree) {
+  const int64_t slab_bytes = 64 * 1024;
+  MockSlabSource source(/*max_slabs=*/3);
+  {
+    SlabAllocator slabs(/*max_object_bytes=*/1024, slab_bytes, source.Allocator(),
+                        source.Freer());
+    // Fill two slabs of 1KB slots.
+    std::set<void *> objects;
+    for (int64_t i = 0; i < 2 * slab_bytes / 1024; i++) {
+      void *mem = slabs.Allocate(1000);
+      ASSERT_NE(mem, nullptr);
+      ASSERT_EQ(reinterpret_cast<uintptr_t>(mem) % SlabAllocator::kSlotAlignment, 0u);
+      ASSERT_TRUE(objects.insert(mem).second);
+    }
+    ASSERT_EQ(source.NumSlabs(), 2);
+    ASSERT_EQ(slabs.SlabBytes(), 2 * slab_bytes);
+    ASSERT_EQ(slabs.UsedBytes(), 2 * slab_bytes);
+    ASSERT_EQ(slabs.RequestedBytes(), 2 * slab_bytes / 1024 * 1000);
+    // Another size class gets its own slab, until there is no memory left.
+    void *small = slabs.Allocate(10);
+    ASSERT_NE(small, nullptr);
+    ASSERT_EQ(source.NumSlabs(), 3);
+    ASSERT_EQ(slabs.Allocate(1000), nullptr);
+
+    // Pointers from elsewhere are not freed.
+    int not_in_slab;
+    ASSERT_FALSE(slabs.Free(&not_in_slab, sizeof(not_in_slab)));
+
+    // Freed slots are reused.
+    void *freed = *objects.begin();
+    ASSERT_TRUE(slabs.Free(freed, 1000));
+    ASSERT_EQ(slabs.Allocate(1000), freed);
+
+    // An empty slab is kept for the next object of its class, but a second one is not.
+    for (void *mem : objects) {
+      ASSERT_TRUE(slabs.Free(mem, 1000));
+    }
+    ASSERT_EQ(source.NumSlabs(), 2);
+    ASSERT_EQ(slabs.UsedBytes(), 64);
+    ASSERT_EQ(slabs.RequestedBytes(), 10);
+    ASSERT_NE(slabs.Allocate(1000), nullptr);
+    ASSERT_EQ(source.NumSlabs(), 2);
+    RAY_LOG(INFO) << slabs.DebugString();
+
+    ASSERT_TRUE(slabs.Free(small, 10));
+    slabs.ReleaseEmptySlabs();
+    ASSERT_EQ(source.NumSlabs(), 1);
+  }
+  // The remaining slabs are freed with the allocator.
+  ASSERT_EQ(source.NumSlabs(), 0);
+}
+
+// Performance benchmark for allocating and freeing 1M small objects, comparing slabs
+// with the system allocator.
+TEST(SlabAllocatorTest, TestSmallObjectsPerf) {
+  const int num_objects = 1000000;
+  const int num_live = 10000;
+  MockSlabSource source(/*max_slabs=*/1000);
+  SlabAllocator slabs(/*max_object_bytes=*/64 * 1024, /*slab_bytes=*/1 << 20,
+                      source.Allocator(), source.Freer());
+  std::vector<std::pair<void *, size_t>> live(num_live, {nullptr, 0});
+
+  int64_t start_ms = current_time_ms();
+  for (int64_t i = 0; i < num_objects; i++) {
+    auto &object = live[(i * 7919) % num_live];
+    if (object.first != nullptr) {
+      RAY_CHECK(slabs.Free(object.first, object.second));
+    }
+    object.second = (i * 131) % (8 * 1024);
+    object.first = slabs.Allocate(object.second);
+    RAY_CHECK(object.first != nullptr);
+  }
+  int64_t slab_ms = current_time_ms() - start_ms;
+  RAY_LOG(INFO) << slabs.DebugString();
+  for (auto &object : live) {
+    RAY_CHECK(slabs.Free(object.first, object.second));
+    object.first = nullptr;
+  }
+
+  start_ms = current_time_ms();
+  for (int64_t i = 0; i < num_objects; i++) {
+    auto &object = live[(i * 7919) % num_live];
+    std::free(object.first);
+    object.second = (i * 131) % (8 * 1024);
+    object.first = AlignedAlloc(64, (object.second + 63) / 64 * 64 + 64);
+  }
+  int64_t malloc_ms = current_time_ms() - start_ms;
+  for (auto &object : live) {
+    std::free(object.first);
+  }
+  RAY_LOG(INFO) << num_objects << " small objects: slabs " << slab_ms << " ms, malloc "
+                << malloc_ms << " ms";
+}
+
+}  // namespace plasma
@@ -317,7 +317,73 @@ NodeManager::NodeManager(instrumented_io_context &io_service, const NodeID &self
              std::vector<std::unique_ptr<RayObject>> *results) {
         return GetObjectsFromPlasma(object_ids, results);
       },
-      max_task_args_memory));
+      max_task_args_memory,
+      /*delay_executor=*/
+      [this](std::function<void()> fn, int64_t delay_ms) {
+        execute_after(io_service_, fn, delay_ms);
+      },
+      /*get_time_ms=*/[]() { return current_time_ms(); },
+      /*preempt_worker=*/
+      RayConfig::instance().preempt_lower_priority_tasks()
+          ? [this](std::shared_ptr<WorkerInterface> worker) {
+              // Don't destroy the worker from inside the scheduling loop, which
+              // iterates over the leased workers. The exit is reported like the
+              // workers killed to release placement group bundles, which the owner
+              // treats as a worker failure and retries the task.
+              io_service_.post(
+                  [this, worker]() {
+                    if (leased_workers_.count(worker->WorkerId()) > 0 &&
+                        !worker->IsDead()) {
+                      DestroyWorker(worker,
+                                    rpc::WorkerExitType::UNUSED_RESOURCE_RELEASED);
+                    }
+                  },
+                  "NodeManager.PreemptWorker");
+            }
+          : std::function<void(std::shared_ptr<WorkerInterface>)>(nullptr),
+      /*prepare_gang_leases=*/
+      [this](const NodeID &node_id, const TaskID &reservation_id,
+             const TaskSpecification &resource_spec, int64_t num_leases,
+             std::function<void(bool)> callback) {
+        auto client = GetRemoteNodeManagerClient(node_id);
+        if (client == nullptr) {
+          // The node is gone. Fail asynchronously, like the RPC would.
+          io_service_.post([callback]() { callback(false); },
+                           "NodeManager.PrepareGangLeases");
+          return;
+        }
+        rpc::PrepareGangLeasesRequest request;
+        request.set_reservation_id(reservation_id.Binary());
+        request.mutable_resource_spec()->CopyFrom(resource_spec.GetMessage());
+        request.set_num_leases(num_leases);
+        client->PrepareGangLeases(
+            request, [client, node_id, callback](
+                         const Status &status, const rpc::PrepareGangLeasesReply &reply) {
+              if (!status.ok()) {
+                RAY_LOG(WARNING) << "Failed to reserve gang leases on node " << node_id
+                                 << ": " << status;
+              }
+              callback(status.ok() && reply.success());
+            });
+      },
+      /*cancel_gang_leases=*/
+      [this](const NodeID &node_id, const TaskID &reservation_id) {
+        auto client = GetRemoteNodeManagerClient(node_id);
+        if (client == nullptr) {
+          return;
+        }
+        rpc::CancelGangLeasesRequest request;
+        request.set_reservation_id(reservation_id.Binary());
+        client->CancelGangLeases(
+            request, [client, node_id](const Status &status,
+                                       const rpc::CancelGangLeasesReply &reply) {
+              if (!status.ok()) {
+                // The reservation expires on its own.
+                RAY_LOG(WARNING) << "Failed to release gang leases on node " << node_id
+                                 << ": " << status;
+              }
+            });
+      }));
   placement_group_resource_manager_ = std::make_shared<NewPlacementGroupResourceManager>(
       std::dynamic_pointer_cast<ClusterResourceScheduler>(cluster_resource_scheduler_),
       // TODO (Alex): Ideally we could do these in a more robust way (retry
@@ -511,6 +577,7 @@ void NodeManager::DestroyWorker(std::shared_ptr<WorkerInterface> worker,
 void NodeManager::HandleJobStarted(const JobID &job_id, const JobTableData &job_data) {
   RAY_LOG(DEBUG) << "HandleJobStarted " << job_id;
   worker_pool_.HandleJobStarted(job_id, job_data.config());
+  cluster_task_manager_->HandleJobStarted(job_id, job_data.config());
   // NOTE: Technically `HandleJobStarted` isn't idempotent because we'll
   // increment the ref count multiple times. This is fine because
   // `HandleJobFinisehd` will also decrement the ref count multiple times.
@@ -525,6 +592,7 @@ void NodeManager::HandleJobFinished(const JobID &job_id, const JobTableData &job
   RAY_LOG(DEBUG) << "HandleJobFinished " << job_id;
   RAY_CHECK(job_data.is_dead());
   worker_pool_.HandleJobFinished(job_id);
+  cluster_task_manager_->HandleJobFinished(job_id);
 
   auto workers = worker_pool_.GetWorkersRunningTasksForJob(job_id);
   // Kill all the workers. The actual cleanup for these workers is done
@@ -551,8 +619,8 @@ void NodeManager::FillNormalTaskResourceUsage(rpc::ResourcesData &resources_data
     RAY_LOG(DEBUG) << "normal_task_resources = " << normal_task_resources.ToString();
     resources_data.set_resources_normal_task_changed(true);
     auto &normal_task_map = *(resources_data.mutable_resources_normal_task());
-    normal_task_map = {normal_task_resources.GetResourceMap().begin(),
-                       normal_task_resources.GetResourceMap().end()};
+    const auto resource_map = normal_task_resources.GetResourceMap();
+    normal_task_map = {resource_map.begin(), resource_map.end()};
     last_heartbeat_resources->SetNormalTaskResources(normal_task_resources);
   }
 }
@@ -1633,6 +1701,77 @@ void NodeManager::HandleRequestWorkerLease(const rpc::RequestWorkerLeaseRequest
   cluster_task_manager_->QueueAndScheduleTask(task, reply, send_reply_callback);
 }
 
+void NodeManager::HandleRequestWorkerLeases(
+    const rpc::RequestWorkerLeasesRequest &request, rpc::RequestWorkerLeasesReply *reply,
+    rpc::SendReplyCallback send_reply_callback) {
+  if (request.lease_ids().empty() ||
+      request.resource_spec().type() == TaskType::ACTOR_CREATION_TASK) {
+    send_reply_callback(
+        Status::Invalid("A batched lease request needs at least one lease ID and "
+                        "cannot be used for actor creation tasks."),
+        nullptr, nullptr);
+    return;
+  }
+  auto backlog_size = -1;
+  if (RayConfig::instance().report_worker_backlog()) {
+    backlog_size = request.backlog_size();
+  }
+  // Each lease is queued as its own task, with the lease ID as the task ID, so that it
+  // goes through the same scheduling, dispatch and spillback path as a single lease.
+  std::vector<Task> tasks;
+  tasks.reserve(request.lease_ids_size());
+  for (const auto &lease_id : request.lease_ids()) {
+    rpc::Task task_message;
+    task_message.mutable_task_spec()->CopyFrom(request.resource_spec());
+    task_message.mutable_task_spec()->set_task_id(lease_id);
+    tasks.emplace_back(task_message, backlog_size);
+  }
+  metrics_num_task_scheduled_ += tasks.size();
+
+  if (RayConfig::instance().enable_worker_prestart()) {
+    worker_pool_.PrestartWorkers(tasks[0].GetTaskSpecification(),
+                                 request.backlog_size() + tasks.size());
+  }
+
+  if (!request.gang_reservation_id().empty()) {
+    cluster_task_manager_->QueueAndScheduleReservedGang(
+        TaskID::FromBinary(request.gang_reservation_id()), tasks, reply,
+        send_reply_callback);
+  } else if (request.gang()) {
+    const int64_t timeout_ms = request.gang_timeout_ms() > 0
+                                   ? request.gang_timeout_ms()
+                                   : RayConfig::instance().gang_lease_timeout_ms();
+    cluster_task_manager_->QueueAndScheduleGang(tasks, timeout_ms, reply,
+                                                send_reply_callback);
+  } else {
+    cluster_task_manager_->QueueAndScheduleTasks(tasks, reply, send_reply_callback);
+  }
+}
+
+void NodeManager::HandlePrepareGangLeases(const rpc::PrepareGangLeasesRequest &request,
+                                          rpc::PrepareGangLeasesReply *reply,
+                                          rpc::SendReplyCallback send_reply_callback) {
+  const auto reservation_id = TaskID::FromBinary(request.reservation_id());
+  RAY_LOG(DEBUG) << "Request to reserve " << request.num_leases()
+                 << " gang leases is received, reservation " << reservation_id;
+  reply->set_success(cluster_task_manager_->PrepareGangLeases(
+      reservation_id, TaskSpecification(request.resource_spec()),
+      request.num_leases()));
+  send_reply_callback(Status::OK(), nullptr, nullptr);
+}
+
+void NodeManager::HandleCancelGangLeases(const rpc::CancelGangLeasesRequest &request,
+                                         rpc::CancelGangLeasesReply *reply,
+                                         rpc::SendReplyCallback send_reply_callback) {
+  const auto reservation_id = TaskID::FromBinary(request.reservation_id());
+  RAY_LOG(DEBUG) << "Request to release gang reservation " << reservation_id
+                 << " is received";
+  cluster_task_manager_->CancelGangLeases(reservation_id);
+  send_reply_callback(Status::OK(), nullptr, nullptr);
+  // The released resources may fit queued tasks.
+  cluster_task_manager_->ScheduleAndDispatchTasks();
+}
+
 void NodeManager::HandlePrepareBundleResources(
     const rpc::PrepareBundleResourcesRequest &request,
     rpc::PrepareBundleResourcesReply *reply, rpc::SendReplyCallback send_reply_callback) {
@@ -2080,6 +2219,16 @@ std::string compact_tag_string(const opencensus::stats::ViewDescriptor &view,
   return result.str();
 }
 
+std::shared_ptr<rpc::NodeManagerClient> NodeManager::GetRemoteNodeManagerClient(
+    const NodeID &node_id) {
+  auto it = remote_node_manager_addresses_.find(node_id);
+  if (it == remote_node_manager_addresses_.end()) {
+    return nullptr;
+  }
+  return std::make_shared<rpc::NodeManagerClient>(it->second.first, it->second.second,
+                                                  client_call_manager_);
+}
+
 bool NodeManager::GetObjectsFromPlasma(const std::vector<ObjectID> &object_ids,
                                        std::vector<std::unique_ptr<RayObject>> *results) {
   // Pin the objects in plasma by getting them and holding a reference to
@@ -504,6 +504,21 @@ class NodeManager : public rpc::NodeManagerServiceHandler {
                                 rpc::RequestWorkerLeaseReply *reply,
                                 rpc::SendReplyCallback send_reply_callback) override;
 
+  /// Handle a batched `WorkerLease` request.
+  void HandleRequestWorkerLeases(const rpc::RequestWorkerLeasesRequest &request,
+                                 rpc::RequestWorkerLeasesReply *reply,
+                                 rpc::SendReplyCallback send_reply_callback) override;
+
+  /// Handle a `PrepareGangLeases` request.
+  void HandlePrepareGangLeases(const rpc::PrepareGangLeasesRequest &request,
+                               rpc::PrepareGangLeasesReply *reply,
+                               rpc::SendReplyCallback send_reply_callback) override;
+
+  /// Handle a `CancelGangLeases` request.
+  void HandleCancelGangLeases(const rpc::CancelGangLeasesRequest &request,
+                              rpc::CancelGangLeasesReply *reply,
+                              rpc::SendReplyCallback send_reply_callback) override;
+
   /// Handle a `ReturnWorker` request.
   void HandleReturnWorker(const rpc::ReturnWorkerRequest &request,
                           rpc::ReturnWorkerReply *reply,
@@ -593,6 +608,13 @@ class NodeManager : public rpc::NodeManagerServiceHandler {
   bool GetObjectsFromPlasma(const std::vector<ObjectID> &object_ids,
                             std::vector<std::unique_ptr<RayObject>> *results);
 
+  /// Connect to the node manager of a remote node.
+  ///
+  /// \param[in] node_id The remote node.
+  /// \return The client, or null if the node is not alive.
+  std::shared_ptr<rpc::NodeManagerClient> GetRemoteNodeManagerClient(
+      const NodeID &node_id);
+
   /// Populate the relevant parts of the heartbeat table. This is intended for
   /// sending raylet <-> gcs heartbeats. In particular, this should fill in
   /// resource_load and resource_load_by_shape.
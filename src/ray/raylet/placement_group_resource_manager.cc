@@ -64,7 +64,7 @@ bool NewPlacementGroupResourceManager::PrepareBundle(
   std::shared_ptr<TaskResourceInstances> resource_instances =
       std::make_shared<TaskResourceInstances>();
   bool allocated = cluster_resource_scheduler_->AllocateLocalTaskResources(
-      bundle_spec.GetRequiredResources().GetResourceMap(), resource_instances);
+      bundle_spec.GetRequiredResources(), resource_instances);
 
   if (!allocated) {
     return false;
@@ -39,6 +39,75 @@ std::string UnorderedMapToString(const std::unordered_map<std::string, double> &
   return buffer.str();
 }
 
+namespace {
+
+/// \return The index of the lowest set bit of a nonzero word.
+int LowestSetBit(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  int index = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+}  // namespace
+
+void UnitInstanceBitset::Reset(const std::vector<FixedPoint> &available) {
+  size_ = available.size();
+  num_full_ = 0;
+  full_.assign((size_ + 63) / 64, 0);
+  partial_.assign(full_.size(), 0);
+  for (size_t i = 0; i < size_; i++) {
+    Update(i, available[i]);
+  }
+}
+
+void UnitInstanceBitset::Update(size_t index, const FixedPoint &available) {
+  RAY_CHECK(index < size_);
+  uint64_t bit = uint64_t(1) << (index % 64);
+  uint64_t &full = full_[index / 64];
+  uint64_t &partial = partial_[index / 64];
+  num_full_ -= (full & bit) != 0;
+  full &= ~bit;
+  partial &= ~bit;
+  if (available == 1.) {
+    full |= bit;
+    num_full_++;
+  } else if (available != 0.) {
+    partial |= bit;
+  }
+}
+
+FixedPoint UnitInstanceBitset::SumAvailable(
+    const std::vector<FixedPoint> &available) const {
+  FixedPoint sum(num_full_);
+  for (int64_t i = NextPartial(0); i != -1; i = NextPartial(i + 1)) {
+    sum += available[i];
+  }
+  return sum;
+}
+
+int64_t UnitInstanceBitset::NextSetBit(const std::vector<uint64_t> &words, size_t from) {
+  size_t word_index = from / 64;
+  if (word_index >= words.size()) {
+    return -1;
+  }
+  // Skip the bits below "from" in its word.
+  uint64_t word = words[word_index] & (~uint64_t(0) << (from % 64));
+  while (word == 0) {
+    if (++word_index == words.size()) {
+      return -1;
+    }
+    word = words[word_index];
+  }
+  return static_cast<int64_t>(word_index * 64 + LowestSetBit(word));
+}
+
 /// Convert a vector of doubles to a vector of resource units.
 std::vector<FixedPoint> VectorDoubleToVectorFixedPoint(
     const std::vector<double> &vector) {
@@ -367,7 +436,7 @@ std::string NodeResources::DictString(StringIdMap string_to_in_map) const {
   return buffer.str();
 }
 
-bool NodeResourceInstances::operator==(const NodeResourceInstances &other) {
+bool NodeResourceInstances::operator==(const NodeResourceInstances &other) const {
   for (size_t i = 0; i < PredefinedResources_MAX; i++) {
     if (!EqualVectors(this->predefined_resources[i].total,
                       other.predefined_resources[i].total)) {
@@ -440,7 +509,7 @@ std::string NodeResourceInstances::DebugString(StringIdMap string_to_int_map) co
   return buffer.str();
 };
 
-TaskResourceInstances NodeResourceInstances::GetAvailableResourceInstances() {
+TaskResourceInstances NodeResourceInstances::GetAvailableResourceInstances() const {
   TaskResourceInstances task_resources;
   task_resources.predefined_resources.resize(PredefinedResources_MAX);
 
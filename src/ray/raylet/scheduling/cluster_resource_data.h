@@ -47,10 +47,58 @@ struct ResourceCapacity {
       : total(_total), available(_available) {}
 };
 
+/// An index over the available capacities of the instances of a resource. It keeps
+/// one bit per instance for the instances that are fully available (capacity 1) and one
+/// for the instances that are partially available, so that allocating whole unit
+/// instances and summing the available capacity take time proportional to the number
+/// of 64-bit words and of fractional instances, instead of the number of instances.
+/// Instances with no capacity left have neither bit set.
+class UnitInstanceBitset {
+ public:
+  /// Rebuild the index from the available capacity of each instance.
+  void Reset(const std::vector<FixedPoint> &available);
+
+  /// Rebuild the index if it was built for a different number of instances, e.g.,
+  /// because the instances were changed without it.
+  void ResetIfResized(const std::vector<FixedPoint> &available) {
+    if (size_ != available.size()) {
+      Reset(available);
+    }
+  }
+
+  /// Update the index after the available capacity of an instance changed.
+  void Update(size_t index, const FixedPoint &available);
+
+  size_t Size() const { return size_; }
+
+  /// \return The number of fully available instances.
+  int64_t NumFull() const { return num_full_; }
+
+  /// \return The first fully available instance at or after "from", or -1 if none.
+  int64_t NextFull(size_t from) const { return NextSetBit(full_, from); }
+
+  /// \return The first partially available instance at or after "from", or -1 if none.
+  int64_t NextPartial(size_t from) const { return NextSetBit(partial_, from); }
+
+  /// \param available: The capacities that the index was built from.
+  /// \return The sum of the available capacities.
+  FixedPoint SumAvailable(const std::vector<FixedPoint> &available) const;
+
+ private:
+  static int64_t NextSetBit(const std::vector<uint64_t> &words, size_t from);
+
+  size_t size_ = 0;
+  int64_t num_full_ = 0;
+  std::vector<uint64_t> full_;
+  std::vector<uint64_t> partial_;
+};
+
 /// Capacities of each instance of a resource.
 struct ResourceInstanceCapacities {
   std::vector<FixedPoint> total;
   std::vector<FixedPoint> available;
+  /// Index of "available". Code that changes "available" must update it.
+  UnitInstanceBitset available_index;
 };
 
 // Data structure specifying the capacity of each resource requested by a task.
@@ -66,6 +114,14 @@ class ResourceRequest {
   std::string DebugString() const;
 };
 
+/// The bytes of a task's arguments that each node already holds.
+struct ArgumentLocality {
+  /// The argument bytes on each node that holds any of the arguments, by node id.
+  absl::flat_hash_map<int64_t, uint64_t> node_bytes;
+  /// The bytes of all the arguments whose locations are known.
+  uint64_t total_bytes = 0;
+};
+
 // Data structure specifying the capacity of each instance of each resource
 // allocated to a task.
 class TaskResourceInstances {
@@ -173,9 +229,9 @@ class NodeResourceInstances {
   /// custom resource ID.
   absl::flat_hash_map<int64_t, ResourceInstanceCapacities> custom_resources;
   /// Extract available resource instances.
-  TaskResourceInstances GetAvailableResourceInstances();
+  TaskResourceInstances GetAvailableResourceInstances() const;
   /// Returns if this equals another node resources.
-  bool operator==(const NodeResourceInstances &other);
+  bool operator==(const NodeResourceInstances &other) const;
   /// Returns human-readable string for these resources.
   std::string DebugString(StringIdMap string_to_int_map) const;
 };
@@ -22,7 +22,8 @@ namespace ray {
 
 ClusterResourceScheduler::ClusterResourceScheduler()
     : hybrid_spillback_(RayConfig::instance().scheduler_hybrid_scheduling()),
-      spread_threshold_(RayConfig::instance().scheduler_spread_threshold())
+      spread_threshold_(RayConfig::instance().scheduler_spread_threshold()),
+      locality_weight_(RayConfig::instance().scheduler_locality_weight())
 
           {};
 
@@ -30,6 +31,7 @@ ClusterResourceScheduler::ClusterResourceScheduler(
     int64_t local_node_id, const NodeResources &local_node_resources)
     : hybrid_spillback_(RayConfig::instance().scheduler_hybrid_scheduling()),
       spread_threshold_(RayConfig::instance().scheduler_spread_threshold()),
+      locality_weight_(RayConfig::instance().scheduler_locality_weight()),
       local_node_id_(local_node_id),
       gen_(std::chrono::high_resolution_clock::now().time_since_epoch().count()) {
   AddOrUpdateNode(local_node_id_, local_node_resources);
@@ -41,7 +43,8 @@ ClusterResourceScheduler::ClusterResourceScheduler(
     const std::unordered_map<std::string, double> &local_node_resources,
     std::function<int64_t(void)> get_used_object_store_memory)
     : hybrid_spillback_(RayConfig::instance().scheduler_hybrid_scheduling()),
-      spread_threshold_(RayConfig::instance().scheduler_spread_threshold()) {
+      spread_threshold_(RayConfig::instance().scheduler_spread_threshold()),
+      locality_weight_(RayConfig::instance().scheduler_locality_weight()) {
   local_node_id_ = string_to_int_map_.Insert(local_node_id);
   NodeResources node_resources = ResourceMapToNodeResources(
       string_to_int_map_, local_node_resources, local_node_resources);
@@ -70,6 +73,7 @@ void ClusterResourceScheduler::AddOrUpdateNode(int64_t node_id,
     // This node exists, so update its resources.
     it->second = Node(node_resources);
   }
+  resource_view_.AddOrUpdateNode(node_id, node_resources);
 }
 
 bool ClusterResourceScheduler::UpdateNode(const std::string &node_id_string,
@@ -117,6 +121,7 @@ bool ClusterResourceScheduler::RemoveNode(int64_t node_id) {
     return false;
   } else {
     nodes_.erase(it);
+    resource_view_.RemoveNode(node_id);
     string_to_int_map_.Remove(node_id);
     return true;
   }
@@ -280,7 +285,7 @@ int64_t ClusterResourceScheduler::GetBestSchedulableNodeSimpleBinPack(
 
 int64_t ClusterResourceScheduler::GetBestSchedulableNode(
     const ResourceRequest &resource_request, bool actor_creation, bool force_spillback,
-    int64_t *total_violations, bool *is_infeasible) {
+    int64_t *total_violations, bool *is_infeasible, const ArgumentLocality *locality) {
   // The zero cpu actor is a special case that must be handled the same way by all
   // scheduling policies.
   if (actor_creation && resource_request.IsEmpty()) {
@@ -307,8 +312,8 @@ int64_t ClusterResourceScheduler::GetBestSchedulableNode(
   // TODO (Alex): Setting require_available == force_spillback is a hack in order to
   // remain bug compatible with the legacy scheduling algorithms.
   int64_t best_node_id = raylet_scheduling_policy::HybridPolicy(
-      resource_request, local_node_id_, nodes_, spread_threshold_, force_spillback,
-      force_spillback);
+      resource_request, local_node_id_, resource_view_, spread_threshold_,
+      force_spillback, force_spillback, locality, locality_weight_);
   *is_infeasible = best_node_id == -1 ? true : false;
   if (!*is_infeasible) {
     // TODO (Alex): Support soft constraints if needed later.
@@ -339,6 +344,54 @@ std::string ClusterResourceScheduler::GetBestSchedulableNode(
   return string_to_int_map_.Get(node_id);
 }
 
+std::string ClusterResourceScheduler::GetBestSchedulableNode(
+    const ResourceSet &task_resources, bool actor_creation, bool force_spillback,
+    int64_t *total_violations, bool *is_infeasible) {
+  int64_t node_id =
+      GetBestSchedulableNode(ResourceSetToResourceRequest(task_resources), actor_creation,
+                             force_spillback, total_violations, is_infeasible);
+  if (node_id == -1) {
+    // This is not a schedulable node, so return empty string.
+    return "";
+  }
+  // Return the string name of the node.
+  return string_to_int_map_.Get(node_id);
+}
+
+std::string ClusterResourceScheduler::GetBestSchedulableNode(
+    const TaskSpecification &task_spec, bool force_spillback, int64_t *total_violations,
+    bool *is_infeasible) {
+  ResourceRequest resource_request =
+      ResourceSetToResourceRequest(task_spec.GetRequiredPlacementResources());
+  ArgumentLocality locality;
+  if (locality_weight_ > 0) {
+    for (size_t i = 0; i < task_spec.NumArgs(); i++) {
+      if (!task_spec.ArgByRef(i)) {
+        continue;
+      }
+      const auto locations = task_spec.ArgObjectLocations(i);
+      if (locations.empty()) {
+        continue;
+      }
+      const uint64_t object_size = task_spec.ArgObjectSize(i);
+      locality.total_bytes += object_size;
+      for (const auto &node_id : locations) {
+        const int64_t id = string_to_int_map_.Get(node_id.Binary());
+        if (id != -1) {
+          locality.node_bytes[id] += object_size;
+        }
+      }
+    }
+  }
+  int64_t node_id = GetBestSchedulableNode(
+      resource_request, task_spec.IsActorCreationTask(), force_spillback,
+      total_violations, is_infeasible, &locality);
+  if (node_id == -1) {
+    return "";
+  }
+  return string_to_int_map_.Get(node_id);
+}
+
 bool ClusterResourceScheduler::SubtractRemoteNodeAvailableResources(
     int64_t node_id, const ResourceRequest &resource_request) {
   RAY_CHECK(node_id != local_node_id_);
@@ -369,6 +422,7 @@ bool ClusterResourceScheduler::SubtractRemoteNodeAvailableResources(
           std::max(FixedPoint(0), it->second.available - task_req_custom_resource.second);
     }
   }
+  resource_view_.AddOrUpdateNode(node_id, *resources);
   return true;
 }
 
@@ -423,6 +477,7 @@ void ClusterResourceScheduler::AddLocalResourceInstances(
     node_instances->total[i] =
         std::max(node_instances->total[i], node_instances->available[i]);
   }
+  node_instances->available_index.Reset(node_instances->available);
   UpdateLocalAvailableResourcesFromResourceInstances();
 }
 
@@ -516,6 +571,7 @@ void ClusterResourceScheduler::UpdateResourceCapacity(const std::string &node_id
       local_view->custom_resources.emplace(resource_id, resource_capacity);
     }
   }
+  resource_view_.AddOrUpdateNode(node_id, *local_view);
 }
 
 void ClusterResourceScheduler::DeleteLocalResource(const std::string &resource_name) {
@@ -548,6 +604,7 @@ void ClusterResourceScheduler::DeleteResource(const std::string &node_id_string,
     if (node_id == local_node_id_) {
       local_resources_.predefined_resources[idx].total.clear();
       local_resources_.predefined_resources[idx].available.clear();
+      local_resources_.predefined_resources[idx].available_index.Reset({});
     }
   } else {
     int64_t resource_id = string_to_int_map_.Get(resource_name);
@@ -555,6 +612,9 @@ void ClusterResourceScheduler::DeleteResource(const std::string &node_id_string,
     if (itr != local_view->custom_resources.end()) {
       string_to_int_map_.Remove(resource_id);
       local_view->custom_resources.erase(itr);
+      // The id may be reused for another name.
+      interned_resource_ids_.clear();
+      counted_resource_ids_.clear();
     }
 
     auto c_itr = local_resources_.custom_resources.find(resource_id);
@@ -564,6 +624,7 @@ void ClusterResourceScheduler::DeleteResource(const std::string &node_id_string,
       local_resources_.custom_resources.erase(c_itr);
     }
   }
+  resource_view_.AddOrUpdateNode(node_id, *local_view);
 }
 
 std::string ClusterResourceScheduler::DebugString(void) const {
@@ -591,6 +652,7 @@ void ClusterResourceScheduler::InitResourceInstances(
     instance_list->available.resize(1);
     instance_list->total[0] = instance_list->available[0] = total;
   }
+  instance_list->available_index.Reset(instance_list->available);
 }
 
 std::string ClusterResourceScheduler::GetLocalResourceViewString() const {
@@ -620,29 +682,39 @@ void ClusterResourceScheduler::InitLocalResources(const NodeResources &node_reso
     if (it->second.total > 0) {
       ResourceInstanceCapacities instance_list;
       InitResourceInstances(it->second.total, false, &instance_list);
-      local_resources_.custom_resources.emplace(it->first, instance_list);
+      local_resources_.custom_resources.emplace(it->first, std::move(instance_list));
     }
   }
 }
 
 std::vector<FixedPoint> ClusterResourceScheduler::AddAvailableResourceInstances(
-    std::vector<FixedPoint> available, ResourceInstanceCapacities *resource_instances) {
+    const std::vector<FixedPoint> &available,
+    ResourceInstanceCapacities *resource_instances) {
+  auto &index = resource_instances->available_index;
+  index.ResetIfResized(resource_instances->available);
   std::vector<FixedPoint> overflow(available.size(), 0.);
   for (size_t i = 0; i < available.size(); i++) {
+    if (available[i] == 0.) {
+      // Most allocations of a unit resource use few of its instances.
+      continue;
+    }
     resource_instances->available[i] = resource_instances->available[i] + available[i];
     if (resource_instances->available[i] > resource_instances->total[i]) {
       overflow[i] = (resource_instances->available[i] - resource_instances->total[i]);
       resource_instances->available[i] = resource_instances->total[i];
     }
+    index.Update(i, resource_instances->available[i]);
   }
 
   return overflow;
 }
 
 std::vector<FixedPoint> ClusterResourceScheduler::SubtractAvailableResourceInstances(
-    std::vector<FixedPoint> available, ResourceInstanceCapacities *resource_instances,
-    bool allow_going_negative) {
+    const std::vector<FixedPoint> &available,
+    ResourceInstanceCapacities *resource_instances, bool allow_going_negative) {
   RAY_CHECK(available.size() == resource_instances->available.size());
+  auto &index = resource_instances->available_index;
+  index.ResetIfResized(resource_instances->available);
 
   std::vector<FixedPoint> underflow(available.size(), 0.);
   for (size_t i = 0; i < available.size(); i++) {
@@ -660,13 +732,17 @@ std::vector<FixedPoint> ClusterResourceScheduler::SubtractAvailableResourceInsta
         resource_instances->available[i] = 0;
       }
     }
+    index.Update(i, resource_instances->available[i]);
   }
   return underflow;
 }
 
 bool ClusterResourceScheduler::AllocateResourceInstances(
-    FixedPoint demand, std::vector<FixedPoint> &available,
+    FixedPoint demand, ResourceInstanceCapacities *resource_instances,
     std::vector<FixedPoint> *allocation) {
+  auto &available = resource_instances->available;
+  auto &index = resource_instances->available_index;
+  index.ResetIfResized(available);
   allocation->resize(available.size());
   FixedPoint remaining_demand = demand;
 
@@ -675,6 +751,7 @@ bool ClusterResourceScheduler::AllocateResourceInstances(
     if (available[0] >= remaining_demand) {
       available[0] -= remaining_demand;
       (*allocation)[0] = remaining_demand;
+      index.Update(0, available[0]);
       return true;
     } else {
       // Not enough capacity.
@@ -693,17 +770,17 @@ bool ClusterResourceScheduler::AllocateResourceInstances(
   // If resource constraint is soft, allocate as many full unit-capacity resources and
   // then distribute remaining_demand across remaining instances. Note that in case we can
   // overallocate this resource.
+  //
+  // The index finds the full instances a word at a time, and the best fit only has to
+  // look at the partially available instances and the first full one.
   if (remaining_demand >= 1.) {
-    for (size_t i = 0; i < available.size(); i++) {
-      if (available[i] == 1.) {
-        // Allocate a full unit-capacity instance.
-        (*allocation)[i] = 1.;
-        available[i] = 0;
-        remaining_demand -= 1.;
-      }
-      if (remaining_demand < 1.) {
-        break;
-      }
+    for (int64_t i = index.NextFull(0); i != -1 && remaining_demand >= 1.;
+         i = index.NextFull(i + 1)) {
+      // Allocate a full unit-capacity instance.
+      (*allocation)[i] = 1.;
+      available[i] = 0;
+      index.Update(i, available[i]);
+      remaining_demand -= 1.;
     }
   }
 
@@ -716,20 +793,31 @@ bool ClusterResourceScheduler::AllocateResourceInstances(
   if (remaining_demand > 0.) {
     int64_t idx_best_fit = -1;
     FixedPoint available_best_fit = 1.;
-    for (size_t i = 0; i < available.size(); i++) {
+    for (int64_t i = index.NextPartial(0); i != -1; i = index.NextPartial(i + 1)) {
       if (available[i] >= remaining_demand) {
         if (idx_best_fit == -1 ||
             (available[i] - remaining_demand < available_best_fit)) {
           available_best_fit = available[i] - remaining_demand;
-          idx_best_fit = static_cast<int64_t>(i);
+          idx_best_fit = i;
         }
       }
     }
+    // All full instances fit equally well, so only the first one can beat the best
+    // partial instance, which it does on a tie if it comes first.
+    int64_t idx_full = index.NextFull(0);
+    if (idx_full != -1) {
+      FixedPoint available_full = available[idx_full] - remaining_demand;
+      if (idx_best_fit == -1 || available_full < available_best_fit ||
+          (available_full == available_best_fit && idx_full < idx_best_fit)) {
+        idx_best_fit = idx_full;
+      }
+    }
     if (idx_best_fit == -1) {
       return false;
     } else {
       (*allocation)[idx_best_fit] = remaining_demand;
       available[idx_best_fit] -= remaining_demand;
+      index.Update(idx_best_fit, available[idx_best_fit]);
     }
   }
   return true;
@@ -747,7 +835,7 @@ bool ClusterResourceScheduler::AllocateTaskResourceInstances(
   for (size_t i = 0; i < PredefinedResources_MAX; i++) {
     if (resource_request.predefined_resources[i] > 0) {
       if (!AllocateResourceInstances(resource_request.predefined_resources[i],
-                                     local_resources_.predefined_resources[i].available,
+                                     &local_resources_.predefined_resources[i],
                                      &task_allocation->predefined_resources[i])) {
         // Allocation failed. Restore node's local resources by freeing the resources
         // of the failed allocation.
@@ -762,11 +850,12 @@ bool ClusterResourceScheduler::AllocateTaskResourceInstances(
     if (it != local_resources_.custom_resources.end()) {
       if (task_req_custom_resource.second > 0) {
         std::vector<FixedPoint> allocation;
-        bool success = AllocateResourceInstances(task_req_custom_resource.second,
-                                                 it->second.available, &allocation);
+        bool success =
+            AllocateResourceInstances(task_req_custom_resource.second, &it->second,
+                                      &allocation);
         // Even if allocation failed we need to remember partial allocations to correctly
         // free resources.
-        task_allocation->custom_resources.emplace(it->first, allocation);
+        task_allocation->custom_resources.emplace(it->first, std::move(allocation));
         if (!success) {
           // Allocation failed. Restore node's local resources by freeing the resources
           // of the failed allocation.
@@ -787,26 +876,25 @@ void ClusterResourceScheduler::UpdateLocalAvailableResourcesFromResourceInstance
 
   auto local_view = it_local_node->second.GetMutableLocalView();
   for (size_t i = 0; i < PredefinedResources_MAX; i++) {
-    local_view->predefined_resources[i].available = 0;
-    for (size_t j = 0; j < local_resources_.predefined_resources[i].available.size();
-         j++) {
-      local_view->predefined_resources[i].available +=
-          local_resources_.predefined_resources[i].available[j];
-    }
+    auto &instances = local_resources_.predefined_resources[i];
+    instances.available_index.ResetIfResized(instances.available);
+    local_view->predefined_resources[i].available =
+        instances.available_index.SumAvailable(instances.available);
   }
 
   for (auto &custom_resource : local_resources_.custom_resources) {
     int64_t resource_name = custom_resource.first;
     auto &instances = custom_resource.second;
 
-    FixedPoint available = std::accumulate(instances.available.begin(),
-                                           instances.available.end(), FixedPoint());
+    instances.available_index.ResetIfResized(instances.available);
+    FixedPoint available = instances.available_index.SumAvailable(instances.available);
     FixedPoint total =
         std::accumulate(instances.total.begin(), instances.total.end(), FixedPoint());
 
     local_view->custom_resources[resource_name].available = available;
     local_view->custom_resources[resource_name].total = total;
   }
+  resource_view_.AddOrUpdateNode(local_node_id_, *local_view);
 }
 
 void ClusterResourceScheduler::FreeTaskResourceInstances(
@@ -914,6 +1002,41 @@ bool ClusterResourceScheduler::AllocateLocalTaskResources(
   return AllocateLocalTaskResources(resource_request, task_allocation);
 }
 
+bool ClusterResourceScheduler::AllocateLocalTaskResources(
+    const ResourceSet &task_resources,
+    std::shared_ptr<TaskResourceInstances> task_allocation) {
+  RAY_CHECK(task_allocation != nullptr);
+  return AllocateLocalTaskResources(ResourceSetToResourceRequest(task_resources),
+                                    task_allocation);
+}
+
+ResourceRequest ClusterResourceScheduler::ResourceSetToResourceRequest(
+    const ResourceSet &resource_set) {
+  ResourceRequest resource_request;
+  resource_request.predefined_resources.resize(PredefinedResources_MAX);
+  for (const auto &resource : resource_set.GetInternedResources()) {
+    // The interned ids of the predefined resources are their indexes.
+    if (resource.first < PredefinedResources_MAX) {
+      resource_request.predefined_resources[resource.first] = resource.second;
+      continue;
+    }
+    int64_t *id;
+    if (ResourceNameTable::IsReferenceCounted(resource.first)) {
+      id = &counted_resource_ids_.emplace(resource.first, -1).first->second;
+    } else {
+      if (static_cast<size_t>(resource.first) >= interned_resource_ids_.size()) {
+        interned_resource_ids_.resize(resource.first + 1, -1);
+      }
+      id = &interned_resource_ids_[resource.first];
+    }
+    if (*id == -1) {
+      *id = string_to_int_map_.Insert(ResourceNameTable::Name(resource.first));
+    }
+    resource_request.custom_resources[*id] = resource.second;
+  }
+  return resource_request;
+}
+
 std::string ClusterResourceScheduler::GetResourceNameFromIndex(int64_t res_idx) {
   if (res_idx == CPU) {
     return ray::kCPU_ResourceLabel;
@@ -928,16 +1051,150 @@ std::string ClusterResourceScheduler::GetResourceNameFromIndex(int64_t res_idx)
   }
 }
 
+bool ClusterResourceScheduler::CanBackfillLocally(
+    const std::unordered_map<std::string, double> &task_resources,
+    const std::unordered_map<std::string, double> &reserved_resources) {
+  return CanBackfillLocally(
+      ResourceMapToResourceRequest(string_to_int_map_, task_resources),
+      ResourceMapToResourceRequest(string_to_int_map_, reserved_resources));
+}
+
+bool ClusterResourceScheduler::CanBackfillLocally(const ResourceSet &task_resources,
+                                                  const ResourceSet &reserved_resources) {
+  return CanBackfillLocally(ResourceSetToResourceRequest(task_resources),
+                            ResourceSetToResourceRequest(reserved_resources));
+}
+
+bool ClusterResourceScheduler::CanBackfillLocally(const ResourceRequest &resource_request,
+                                                  const ResourceRequest &reservation) {
+  auto it = nodes_.find(local_node_id_);
+  RAY_CHECK(it != nodes_.end());
+  const NodeResources &local_resources = it->second.GetLocalView();
+  // The part of a resource that is available beyond the reservation.
+  auto spare = [](const FixedPoint &available, const FixedPoint &reserved) {
+    return reserved < available ? available - reserved : FixedPoint(0.);
+  };
+
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    if (resource_request.predefined_resources[i] == 0) {
+      continue;
+    }
+    if (i >= local_resources.predefined_resources.size() ||
+        resource_request.predefined_resources[i] >
+            spare(local_resources.predefined_resources[i].available,
+                  reservation.predefined_resources[i])) {
+      return false;
+    }
+  }
+  for (const auto &task_req_custom_resource : resource_request.custom_resources) {
+    auto local_it = local_resources.custom_resources.find(task_req_custom_resource.first);
+    if (local_it == local_resources.custom_resources.end()) {
+      return false;
+    }
+    FixedPoint reserved(0.);
+    auto reserved_it = reservation.custom_resources.find(task_req_custom_resource.first);
+    if (reserved_it != reservation.custom_resources.end()) {
+      reserved = reserved_it->second;
+    }
+    if (task_req_custom_resource.second > spare(local_it->second.available, reserved)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ClusterResourceScheduler::CanRunLocallyAfterRelease(
+    const ResourceSet &task_resources, const ResourceSet &released_resources) {
+  ResourceRequest resource_request = ResourceSetToResourceRequest(task_resources);
+  ResourceRequest release = ResourceSetToResourceRequest(released_resources);
+  auto it = nodes_.find(local_node_id_);
+  RAY_CHECK(it != nodes_.end());
+  const NodeResources &local_resources = it->second.GetLocalView();
+
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    if (resource_request.predefined_resources[i] == 0) {
+      continue;
+    }
+    if (i >= local_resources.predefined_resources.size() ||
+        resource_request.predefined_resources[i] >
+            local_resources.predefined_resources[i].available +
+                release.predefined_resources[i]) {
+      return false;
+    }
+  }
+  for (const auto &task_req_custom_resource : resource_request.custom_resources) {
+    auto local_it = local_resources.custom_resources.find(task_req_custom_resource.first);
+    if (local_it == local_resources.custom_resources.end()) {
+      return false;
+    }
+    FixedPoint released(0.);
+    auto released_it = release.custom_resources.find(task_req_custom_resource.first);
+    if (released_it != release.custom_resources.end()) {
+      released = released_it->second;
+    }
+    if (task_req_custom_resource.second > local_it->second.available + released) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool ClusterResourceScheduler::AllocateRemoteTaskResources(
     const std::string &node_string,
     const std::unordered_map<std::string, double> &task_resources) {
-  ResourceRequest resource_request =
-      ResourceMapToResourceRequest(string_to_int_map_, task_resources);
+  return AllocateRemoteTaskResources(
+      node_string, ResourceMapToResourceRequest(string_to_int_map_, task_resources));
+}
+
+bool ClusterResourceScheduler::AllocateRemoteTaskResources(
+    const std::string &node_string, const ResourceSet &task_resources) {
+  return AllocateRemoteTaskResources(node_string,
+                                     ResourceSetToResourceRequest(task_resources));
+}
+
+bool ClusterResourceScheduler::AllocateRemoteTaskResources(
+    const std::string &node_string, const ResourceRequest &resource_request) {
   auto node_id = string_to_int_map_.Insert(node_string);
   RAY_CHECK(node_id != local_node_id_);
   return SubtractRemoteNodeAvailableResources(node_id, resource_request);
 }
 
+void ClusterResourceScheduler::ReleaseRemoteTaskResources(
+    const std::string &node_string,
+    const std::unordered_map<std::string, double> &task_resources) {
+  ReleaseRemoteTaskResources(
+      node_string, ResourceMapToResourceRequest(string_to_int_map_, task_resources));
+}
+
+void ClusterResourceScheduler::ReleaseRemoteTaskResources(
+    const std::string &node_string, const ResourceSet &task_resources) {
+  ReleaseRemoteTaskResources(node_string, ResourceSetToResourceRequest(task_resources));
+}
+
+void ClusterResourceScheduler::ReleaseRemoteTaskResources(
+    const std::string &node_string, const ResourceRequest &resource_request) {
+  auto node_id = string_to_int_map_.Get(node_string);
+  RAY_CHECK(node_id != local_node_id_);
+  auto it = nodes_.find(node_id);
+  if (it == nodes_.end()) {
+    return;
+  }
+  NodeResources *resources = it->second.GetMutableLocalView();
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    auto &capacity = resources->predefined_resources[i];
+    capacity.available = std::min(
+        capacity.total, capacity.available + resource_request.predefined_resources[i]);
+  }
+  for (const auto &task_req_custom_resource : resource_request.custom_resources) {
+    auto it = resources->custom_resources.find(task_req_custom_resource.first);
+    if (it != resources->custom_resources.end()) {
+      it->second.available = std::min(
+          it->second.total, it->second.available + task_req_custom_resource.second);
+    }
+  }
+  resource_view_.AddOrUpdateNode(node_id, *resources);
+}
+
 void ClusterResourceScheduler::ReleaseWorkerResources(
     std::shared_ptr<TaskResourceInstances> task_allocation) {
   if (task_allocation == nullptr || task_allocation->IsEmpty()) {
@@ -976,6 +1233,7 @@ void ClusterResourceScheduler::FillResourceUsage(rpc::ResourcesData &resources_d
   for (auto &node : nodes_) {
     if (node.first != local_node_id_) {
       node.second.ResetLocalView();
+      resource_view_.AddOrUpdateNode(node.first, node.second.GetLocalView());
     }
   }
 
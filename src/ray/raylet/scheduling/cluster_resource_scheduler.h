@@ -21,9 +21,11 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "ray/common/task/scheduling_resources.h"
+#include "ray/common/task/task_spec.h"
 #include "ray/gcs/accessor.h"
 #include "ray/raylet/scheduling/cluster_resource_data.h"
 #include "ray/raylet/scheduling/cluster_resource_scheduler_interface.h"
+#include "ray/raylet/scheduling/cluster_resource_view.h"
 #include "ray/raylet/scheduling/fixed_point.h"
 #include "ray/raylet/scheduling/scheduling_ids.h"
 #include "ray/util/logging.h"
@@ -167,12 +169,15 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   ///                     a node that can schedule resource_request is found).
   ///  \param is_infeasible[in]: It is set true if the task is not schedulable because it
   ///  is infeasible.
+  ///  \param locality: The bytes of the task's arguments that each node holds. In
+  ///  hybrid mode, these nodes are preferred, see scheduler_locality_weight.
   ///
   ///  \return -1, if no node can schedule the current request; otherwise,
   ///          return the ID of a node that can schedule the resource request.
   int64_t GetBestSchedulableNode(const ResourceRequest &resource_request,
                                  bool actor_creation, bool force_spillback,
-                                 int64_t *violations, bool *is_infeasible);
+                                 int64_t *violations, bool *is_infeasible,
+                                 const ArgumentLocality *locality = nullptr);
 
   /// Similar to
   ///    int64_t GetBestSchedulableNode(const ResourceRequest &resource_request, int64_t
@@ -186,6 +191,17 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
       bool actor_creation, bool force_spillback, int64_t *violations,
       bool *is_infeasible);
 
+  /// Same as above, for a resource set.
+  std::string GetBestSchedulableNode(const ResourceSet &resource_request,
+                                     bool actor_creation, bool force_spillback,
+                                     int64_t *violations, bool *is_infeasible);
+
+  /// Same as above, for the placement resources of a task. The nodes that hold the
+  /// task's arguments, as recorded in the task spec by the owner, are preferred.
+  std::string GetBestSchedulableNode(const TaskSpecification &task_spec,
+                                     bool force_spillback, int64_t *violations,
+                                     bool *is_infeasible);
+
   /// Return resources associated to the given node_id in ret_resources.
   /// If node_id not found, return false; otherwise return true.
   bool GetNodeResources(int64_t node_id, NodeResources *ret_resources) const;
@@ -233,7 +249,7 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
                       const std::string &resource_name) override;
 
   /// Return local resources.
-  NodeResourceInstances GetLocalResources() { return local_resources_; };
+  const NodeResourceInstances &GetLocalResources() const { return local_resources_; };
 
   /// Return local resources in human-readable string form.
   std::string GetLocalResourceViewString() const override;
@@ -280,13 +296,15 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   /// (0., 0., 0., 0.)
   ///
   /// \param demand: The resource amount to be allocated.
-  /// \param available: List of available capacities of the instances of the resource.
+  /// \param resource_instances: The instances of the resource, whose available
+  /// capacities are decreased by the allocation.
   /// \param allocation: List of instance capacities allocated to satisfy the demand.
   /// This is a return parameter.
   ///
   /// \return true, if allocation successful. In this case, the sum of the elements in
   /// "allocation" is equal to "demand".
-  bool AllocateResourceInstances(FixedPoint demand, std::vector<FixedPoint> &available,
+  bool AllocateResourceInstances(FixedPoint demand,
+                                 ResourceInstanceCapacities *resource_instances,
                                  std::vector<FixedPoint> *allocation);
 
   /// Allocate local resources to satisfy a given request (resource_request).
@@ -316,7 +334,8 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   /// capacities in "available", i.e.,
   /// min(available + resource_instances.available, resource_instances.total)
   std::vector<FixedPoint> AddAvailableResourceInstances(
-      std::vector<FixedPoint> available, ResourceInstanceCapacities *resource_instances);
+      const std::vector<FixedPoint> &available,
+      ResourceInstanceCapacities *resource_instances);
 
   /// Decrease the available capacities of the instances of a given resource.
   ///
@@ -327,8 +346,8 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   /// capacities in "available", i.e.,.
   /// max(available - reasource_instances.available, 0)
   std::vector<FixedPoint> SubtractAvailableResourceInstances(
-      std::vector<FixedPoint> available, ResourceInstanceCapacities *resource_instances,
-      bool allow_going_negative = false);
+      const std::vector<FixedPoint> &available,
+      ResourceInstanceCapacities *resource_instances, bool allow_going_negative = false);
 
   /// Increase the available CPU instances of this node.
   ///
@@ -381,6 +400,41 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   bool AllocateLocalTaskResources(const ResourceRequest &resource_request,
                                   std::shared_ptr<TaskResourceInstances> task_allocation);
 
+  bool AllocateLocalTaskResources(const ResourceSet &task_resources,
+                                  std::shared_ptr<TaskResourceInstances> task_allocation);
+
+  /// Convert a resource set to a resource request. Unlike ResourceMapToResourceRequest,
+  /// this does not hash the resource names, except the first time that a custom
+  /// resource is seen.
+  ///
+  /// \param resource_set The resources to convert.
+  /// \return The resource request with the ids of this scheduler.
+  ResourceRequest ResourceSetToResourceRequest(const ResourceSet &resource_set);
+
+  /// Check whether a task can run on the local node without the resources that are
+  /// reserved for a waiting task of a higher priority. For every resource that the
+  /// waiting task needs, the task may only use what is available beyond the
+  /// reservation, so that it does not delay the waiting task.
+  ///
+  /// \param task_resources The resources that the task requires.
+  /// \param reserved_resources The resources that the waiting task requires.
+  /// \return True if the local node has enough resources besides the reservation.
+  bool CanBackfillLocally(
+      const std::unordered_map<std::string, double> &task_resources,
+      const std::unordered_map<std::string, double> &reserved_resources);
+
+  /// Check whether a task could run on the local node if another task released its
+  /// resources, i.e., whether the available resources plus the released ones cover
+  /// every resource that the task requires.
+  ///
+  /// \param task_resources The resources that the task requires.
+  /// \param released_resources The resources that the other task holds.
+  /// \return True if the local node would have enough resources for the task.
+  bool CanRunLocallyAfterRelease(const ResourceSet &task_resources,
+                                 const ResourceSet &released_resources);
+  bool CanBackfillLocally(const ResourceSet &task_resources,
+                          const ResourceSet &reserved_resources);
+
   /// Subtract the resources required by a given resource request (resource_request) from
   /// a given remote node.
   ///
@@ -391,6 +445,19 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   bool AllocateRemoteTaskResources(
       const std::string &node_id,
       const std::unordered_map<std::string, double> &task_resources);
+  bool AllocateRemoteTaskResources(const std::string &node_id,
+                                   const ResourceSet &task_resources);
+
+  /// Give back resources that were subtracted from a remote node with
+  /// AllocateRemoteTaskResources, if the task was not sent to the node after all.
+  ///
+  /// \param node_id Remote node whose resources we release.
+  /// \param task_resources The resources that were allocated for the task.
+  void ReleaseRemoteTaskResources(
+      const std::string &node_id,
+      const std::unordered_map<std::string, double> &task_resources);
+  void ReleaseRemoteTaskResources(const std::string &node_id,
+                                  const ResourceSet &task_resources);
 
   void ReleaseWorkerResources(std::shared_ptr<TaskResourceInstances> task_allocation);
 
@@ -427,6 +494,13 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   std::string DebugString() const;
 
  private:
+  bool CanBackfillLocally(const ResourceRequest &resource_request,
+                          const ResourceRequest &reservation);
+  bool AllocateRemoteTaskResources(const std::string &node_id,
+                                   const ResourceRequest &resource_request);
+  void ReleaseRemoteTaskResources(const std::string &node_id,
+                                  const ResourceRequest &resource_request);
+
   /// Decrease the available resources of a node when a resource request is
   /// scheduled on the given node.
   ///
@@ -442,9 +516,14 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   const bool hybrid_spillback_;
   /// The threshold at which to switch from packing to spreading.
   const float spread_threshold_;
+  /// How much the hybrid policy prefers the nodes that hold a task's arguments.
+  const float locality_weight_;
   /// List of nodes in the clusters and their resources organized as a map.
   /// The key of the map is the node ID.
   absl::flat_hash_map<int64_t, Node> nodes_;
+  /// A columnar copy of the local view of every node in nodes_, which the hybrid policy
+  /// scans. It must be updated whenever a node or its local view changes.
+  ClusterResourceView resource_view_;
   /// Identifier of local node.
   int64_t local_node_id_;
   /// Internally maintained random number generator.
@@ -454,6 +533,12 @@ class ClusterResourceScheduler : public ClusterResourceSchedulerInterface {
   /// Keep the mapping between node and resource IDs in string representation
   /// to integer representation. Used for improving map performance.
   StringIdMap string_to_int_map_;
+  /// The ids in string_to_int_map_ of the custom resources, indexed by their ids in
+  /// ResourceNameTable, or -1 if not looked up yet.
+  std::vector<int64_t> interned_resource_ids_;
+  /// The same for the reference counted ids in ResourceNameTable, i.e., the placement
+  /// group resources, whose ids are not dense.
+  absl::flat_hash_map<int64_t, int64_t> counted_resource_ids_;
   /// Cached resources, used to compare with newest one in light heartbeat mode.
   std::unique_ptr<NodeResources> last_report_resources_;
   /// Function to get used object store memory.
@@ -14,6 +14,7 @@
 
 #include "ray/raylet/scheduling/cluster_resource_scheduler.h"
 
+#include <random>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -21,9 +22,11 @@
 #include "ray/common/ray_config.h"
 #include "ray/common/task/scheduling_resources.h"
 #include "ray/raylet/scheduling/scheduling_ids.h"
+#include "ray/util/util.h"
 
 #ifdef UNORDERED_VS_ABSL_MAPS_EVALUATION
 #include <chrono>
+#include <deque>
 
 #include "absl/container/flat_hash_map.h"
 #endif  // UNORDERED_VS_ABSL_MAPS_EVALUATION
@@ -1121,6 +1124,297 @@ TEST_F(ClusterResourceSchedulerTest, TestForceSpillback) {
             "51");
 }
 
+TEST_F(ClusterResourceSchedulerTest, UnitInstanceBitsetTest) {
+  std::vector<FixedPoint> available(130, 1.);
+  available[3] = 0.5;
+  available[64] = 0.;
+  available[100] = -1.;
+  UnitInstanceBitset index;
+  index.Reset(available);
+  ASSERT_EQ(index.Size(), 130);
+  ASSERT_EQ(index.NumFull(), 127);
+  ASSERT_EQ(index.NextFull(0), 0);
+  ASSERT_EQ(index.NextFull(3), 4);
+  ASSERT_EQ(index.NextFull(63), 63);
+  ASSERT_EQ(index.NextFull(64), 65);
+  ASSERT_EQ(index.NextFull(130), -1);
+  ASSERT_EQ(index.NextPartial(0), 3);
+  ASSERT_EQ(index.NextPartial(4), 100);
+  ASSERT_EQ(index.NextPartial(101), -1);
+  ASSERT_EQ(index.SumAvailable(available), 126.5);
+
+  for (size_t i = 0; i < available.size(); i++) {
+    available[i] = 0.;
+    index.Update(i, available[i]);
+  }
+  available[129] = 1.;
+  index.Update(129, available[129]);
+  ASSERT_EQ(index.NumFull(), 1);
+  ASSERT_EQ(index.NextFull(0), 129);
+  ASSERT_EQ(index.NextPartial(0), -1);
+  ASSERT_EQ(index.SumAvailable(available), 1.);
+}
+
+/// The linear scan that AllocateResourceInstances used before the instances were
+/// indexed, to check that the index does not change which instances are allocated.
+bool ScanAllocateResourceInstances(FixedPoint demand, std::vector<FixedPoint> &available,
+                                   std::vector<FixedPoint> *allocation) {
+  allocation->resize(available.size());
+  FixedPoint remaining_demand = demand;
+  if (available.size() == 1) {
+    if (available[0] >= remaining_demand) {
+      available[0] -= remaining_demand;
+      (*allocation)[0] = remaining_demand;
+      return true;
+    }
+    return false;
+  }
+  for (size_t i = 0; i < available.size() && remaining_demand >= 1.; i++) {
+    if (available[i] == 1.) {
+      (*allocation)[i] = 1.;
+      available[i] = 0;
+      remaining_demand -= 1.;
+    }
+  }
+  if (remaining_demand >= 1.) {
+    return false;
+  }
+  if (remaining_demand > 0.) {
+    int64_t idx_best_fit = -1;
+    FixedPoint available_best_fit = 1.;
+    for (size_t i = 0; i < available.size(); i++) {
+      if (available[i] >= remaining_demand &&
+          (idx_best_fit == -1 || available[i] - remaining_demand < available_best_fit)) {
+        available_best_fit = available[i] - remaining_demand;
+        idx_best_fit = i;
+      }
+    }
+    if (idx_best_fit == -1) {
+      return false;
+    }
+    (*allocation)[idx_best_fit] = remaining_demand;
+    available[idx_best_fit] -= remaining_demand;
+  }
+  return true;
+}
+
+TEST_F(ClusterResourceSchedulerTest, IndexedResourceInstancesTest) {
+  NodeResources node_resources;
+  vector<FixedPoint> pred_capacities{1 /* CPU */};
+  initNodeResources(node_resources, pred_capacities, EmptyIntVector,
+                    EmptyFixedPointVector);
+  ClusterResourceScheduler cluster(0, node_resources);
+
+  ResourceInstanceCapacities instances;
+  cluster.InitResourceInstances(70, true, &instances);
+  std::vector<FixedPoint> expected_available = instances.available;
+  std::vector<std::vector<FixedPoint>> allocations;
+  std::mt19937 gen(0);
+  std::vector<FixedPoint> demands{0.1, 0.25, 0.5, 0.75, 1., 1.5, 2., 3.25, 8.};
+  for (int i = 0; i < 10000; i++) {
+    if (allocations.empty() || gen() % 3 != 0) {
+      FixedPoint demand = demands[gen() % demands.size()];
+      std::vector<FixedPoint> allocation;
+      std::vector<FixedPoint> expected_allocation;
+      bool success = cluster.AllocateResourceInstances(demand, &instances, &allocation);
+      ASSERT_EQ(success, ScanAllocateResourceInstances(demand, expected_available,
+                                                       &expected_allocation));
+      ASSERT_TRUE(EqualVectors(allocation, expected_allocation));
+      allocations.push_back(allocation);
+    } else {
+      size_t victim = gen() % allocations.size();
+      cluster.AddAvailableResourceInstances(allocations[victim], &instances);
+      for (size_t j = 0; j < expected_available.size(); j++) {
+        expected_available[j] += allocations[victim][j];
+      }
+      allocations.erase(allocations.begin() + victim);
+    }
+    ASSERT_TRUE(EqualVectors(instances.available, expected_available));
+    FixedPoint expected_sum;
+    for (const auto &available : expected_available) {
+      expected_sum += available;
+    }
+    ASSERT_EQ(instances.available_index.SumAvailable(instances.available), expected_sum);
+  }
+}
+
+#ifdef UNORDERED_VS_ABSL_MAPS_EVALUATION
+// Performance benchmark for allocating and freeing the resources of tasks on a large
+// node.
+TEST_F(ClusterResourceSchedulerTest, ResourceInstanceAllocationPerf) {
+  const int num_custom_resources = 1000;
+  const int num_tasks = 100000;
+  NodeResources node_resources;
+  vector<FixedPoint> pred_capacities{128 /* CPU */, 1024 /* MEM */, 8 /* GPU */};
+  vector<int64_t> cust_ids;
+  vector<FixedPoint> cust_capacities;
+  for (int i = 0; i < num_custom_resources; i++) {
+    cust_ids.push_back(i);
+    cust_capacities.push_back(4);
+  }
+  initNodeResources(node_resources, pred_capacities, cust_ids, cust_capacities);
+  ClusterResourceScheduler cluster(0, node_resources);
+
+  std::vector<ResourceRequest> requests;
+  for (int i = 0; i < num_custom_resources; i++) {
+    ResourceRequest request;
+    vector<FixedPoint> pred_demands{FixedPoint(1 + i % 4), 1, i % 8 == 0 ? 0.5 : 0};
+    vector<int64_t> request_cust_ids{i};
+    vector<FixedPoint> cust_demands{1};
+    initResourceRequest(request, pred_demands, request_cust_ids, cust_demands);
+    requests.push_back(request);
+  }
+
+  // Keep 32 tasks running and free the oldest one first, so that the CPU instances are
+  // fragmented.
+  std::deque<std::shared_ptr<TaskResourceInstances>> running;
+  int64_t num_allocated = 0;
+  int64_t start_ms = current_time_ms();
+  for (int task = 0; task < num_tasks; task++) {
+    if (running.size() == 32) {
+      cluster.FreeTaskResourceInstances(running.front());
+      running.pop_front();
+    }
+    auto allocation = std::make_shared<TaskResourceInstances>();
+    if (cluster.AllocateTaskResourceInstances(requests[task % requests.size()],
+                                              allocation)) {
+      running.push_back(allocation);
+      num_allocated++;
+    }
+  }
+  int64_t elapsed_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+  RAY_LOG(INFO) << num_tasks * 1000 / elapsed_ms
+                << " allocations and frees/s on a node with 128 CPUs and "
+                << num_custom_resources << " custom resources";
+  ASSERT_EQ(num_allocated, num_tasks);
+}
+#endif  // UNORDERED_VS_ABSL_MAPS_EVALUATION
+
+ResourceSet MakeResourceSet(const std::unordered_map<std::string, double> &resources) {
+  return ResourceSet(resources);
+}
+
+TEST_F(ClusterResourceSchedulerTest, ResourceSetTest) {
+  ResourceSet a = MakeResourceSet({{"CPU", 2}, {"custom1", 1}, {"GPU", 1}});
+  ResourceSet b({"custom1", "CPU", "GPU"}, {1, 2, 1});
+  ASSERT_TRUE(a == b);
+  ASSERT_EQ(std::hash<ResourceSet>()(a), std::hash<ResourceSet>()(b));
+  ASSERT_EQ(a.GetInternedResources()[0].first, CPU);
+  ASSERT_EQ(a.GetResource("CPU"), 2);
+  ASSERT_EQ(a.GetResource("never_used"), 0);
+  ASSERT_EQ(a.GetNumCpus().GetResourceMap(),
+            (std::unordered_map<std::string, double>{{"CPU", 2}}));
+
+  ResourceSet c = MakeResourceSet({{"CPU", 1}, {"custom2", 3}});
+  ASSERT_FALSE(c.IsSubset(a));
+  a.AddResources(c);
+  ASSERT_TRUE(c.IsSubset(a));
+  ASSERT_EQ(a.GetResourceMap(),
+            (std::unordered_map<std::string, double>{
+                {"CPU", 3}, {"GPU", 1}, {"custom1", 1}, {"custom2", 3}}));
+
+  a.SubtractResources(MakeResourceSet({{"CPU", 1}, {"custom2", 3}, {"custom3", 1}}));
+  ASSERT_TRUE(a.IsEqual(b));
+  a.SubtractResourcesStrict(MakeResourceSet({{"GPU", 1}, {"custom1", 0.5}}));
+  ASSERT_EQ(a.GetResourceMap(),
+            (std::unordered_map<std::string, double>{{"CPU", 2}, {"custom1", 0.5}}));
+
+  a.AddResourcesCapacityConstrained(MakeResourceSet({{"GPU", 2}, {"custom1", 1}}), b);
+  ASSERT_TRUE(a.IsEqual(b));
+  ASSERT_TRUE(a.DeleteResource("custom1"));
+  ASSERT_FALSE(a.DeleteResource("custom1"));
+  ASSERT_FALSE(a.DeleteResource("never_used"));
+  a.AddOrUpdateResource("CPU", 4);
+  ASSERT_EQ(a.ToString(), "{CPU: 4.000000}, {GPU: 1.000000}");
+}
+
+TEST_F(ClusterResourceSchedulerTest, PlacementGroupResourceNameTest) {
+  const size_t num_names = ResourceNameTable::Size();
+  {
+    ResourceSet bundle = MakeResourceSet(
+        {{"CPU_group_4482dec0faaf5ead891ff1659a9501000000", 1},
+         {"CPU_group_0_4482dec0faaf5ead891ff1659a9501000000", 1}});
+    ResourceSet copy = bundle;
+    ASSERT_EQ(ResourceNameTable::Size(), num_names + 2);
+    ResourceSet same = MakeResourceSet(
+        {{"CPU_group_4482dec0faaf5ead891ff1659a9501000000", 2}});
+    ASSERT_EQ(ResourceNameTable::Size(), num_names + 2);
+    ASSERT_EQ(same.GetResource("CPU_group_4482dec0faaf5ead891ff1659a9501000000"), 2);
+    bundle = ResourceSet();
+    ASSERT_EQ(copy.GetResource("CPU_group_0_4482dec0faaf5ead891ff1659a9501000000"), 1);
+  }
+  // The names of the placement group resources are freed with the last resource set
+  // that uses them, while the names of other resources stay interned.
+  ASSERT_EQ(ResourceNameTable::Size(), num_names);
+  ASSERT_EQ(MakeResourceSet({{"CPU_group_4482dec0faaf5ead891ff1659a9501000000", 1}})
+                .GetResource("CPU_group_4482dec0faaf5ead891ff1659a9501000000"),
+            1);
+  ASSERT_EQ(ResourceNameTable::Size(), num_names);
+}
+
+TEST_F(ClusterResourceSchedulerTest, ResourceSetToResourceRequestTest) {
+  ClusterResourceScheduler resource_scheduler("local", {{"CPU", 4}, {"custom1", 2}});
+  StringIdMap string_to_int_map;
+  std::unordered_map<std::string, double> resource_map{
+      {"CPU", 1}, {"memory", 2}, {"custom1", 1}, {"custom2", 1}};
+  ResourceRequest request =
+      resource_scheduler.ResourceSetToResourceRequest(ResourceSet(resource_map));
+  ASSERT_EQ(request.predefined_resources,
+            ResourceMapToResourceRequest(string_to_int_map, resource_map)
+                .predefined_resources);
+  ASSERT_EQ(request.custom_resources.size(), 2);
+  ASSERT_EQ(request.custom_resources.at(
+                resource_scheduler.GetStringIdMap().Get(std::string("custom1"))),
+            1);
+
+  auto allocation = std::make_shared<TaskResourceInstances>();
+  ASSERT_TRUE(resource_scheduler.AllocateLocalTaskResources(
+      MakeResourceSet({{"CPU", 1}, {"custom1", 2}}), allocation));
+  ASSERT_FALSE(resource_scheduler.CanBackfillLocally(MakeResourceSet({{"CPU", 2}}),
+                                                     MakeResourceSet({{"CPU", 2}})));
+  resource_scheduler.ReleaseWorkerResources(allocation);
+
+  // The resource is looked up again after it was deleted.
+  resource_scheduler.DeleteLocalResource("custom1");
+  resource_scheduler.AddLocalResourceInstances("custom1", {1.});
+  request = resource_scheduler.ResourceSetToResourceRequest(ResourceSet(resource_map));
+  ASSERT_EQ(request.custom_resources.at(
+                resource_scheduler.GetStringIdMap().Get(std::string("custom1"))),
+            1);
+}
+
+#ifdef UNORDERED_VS_ABSL_MAPS_EVALUATION
+// Performance benchmark for converting the resources of tasks to resource requests,
+// from resource maps and from resource sets.
+TEST_F(ClusterResourceSchedulerTest, ResourceRequestConversionPerf) {
+  const int num_tasks = 100000;
+  ClusterResourceScheduler resource_scheduler("local", {{"CPU", 4}});
+  std::vector<ResourceSet> resource_sets;
+  for (int i = 0; i < 100; i++) {
+    resource_sets.push_back(MakeResourceSet({{"CPU", 1},
+                                             {"memory", 100},
+                                             {"accelerator_type:V100", 0.001},
+                                             {"custom" + std::to_string(i), 1}}));
+  }
+
+  int64_t start_ms = current_time_ms();
+  for (int task = 0; task < num_tasks; task++) {
+    resource_scheduler.ResourceSetToResourceRequest(
+        resource_sets[task % resource_sets.size()]);
+  }
+  int64_t set_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+  StringIdMap string_to_int_map;
+  start_ms = current_time_ms();
+  for (int task = 0; task < num_tasks; task++) {
+    ResourceMapToResourceRequest(
+        string_to_int_map, resource_sets[task % resource_sets.size()].GetResourceMap());
+  }
+  int64_t map_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+  RAY_LOG(INFO) << num_tasks * 1000 / set_ms << " conversions/s from resource sets, "
+                << num_tasks * 1000 / map_ms << " conversions/s from resource maps";
+}
+#endif  // UNORDERED_VS_ABSL_MAPS_EVALUATION
+
 }  // namespace ray
 
 int main(int argc, char **argv) {
@@ -0,0 +1,143 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/raylet/scheduling/cluster_resource_view.h"
+
+#include <algorithm>
+
+namespace ray {
+
+ClusterResourceView::ClusterResourceView(
+    const absl::flat_hash_map<int64_t, Node> &nodes) {
+  for (const auto &pair : nodes) {
+    AddOrUpdateNode(pair.first, pair.second.GetLocalView());
+  }
+}
+
+void ClusterResourceView::AddOrUpdateNode(int64_t node_id,
+                                          const NodeResources &resources) {
+  auto it = std::lower_bound(node_ids_.begin(), node_ids_.end(), node_id);
+  const size_t index = it - node_ids_.begin();
+  if (it == node_ids_.end() || *it != node_id) {
+    node_ids_.insert(it, node_id);
+    for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+      predefined_total_[i].insert(predefined_total_[i].begin() + index, 0);
+      predefined_available_[i].insert(predefined_available_[i].begin() + index, 0);
+    }
+    utilization_.insert(utilization_.begin() + index, 0);
+    node_custom_resources_.emplace(node_custom_resources_.begin() + index);
+  }
+  SetColumns(index, resources);
+}
+
+void ClusterResourceView::RemoveNode(int64_t node_id) {
+  const int64_t index = Find(node_id);
+  if (index == -1) {
+    return;
+  }
+  RemoveCustomResources(node_id, index);
+  node_ids_.erase(node_ids_.begin() + index);
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    predefined_total_[i].erase(predefined_total_[i].begin() + index);
+    predefined_available_[i].erase(predefined_available_[i].begin() + index);
+  }
+  utilization_.erase(utilization_.begin() + index);
+  node_custom_resources_.erase(node_custom_resources_.begin() + index);
+}
+
+int64_t ClusterResourceView::Find(int64_t node_id) const {
+  auto it = std::lower_bound(node_ids_.begin(), node_ids_.end(), node_id);
+  if (it == node_ids_.end() || *it != node_id) {
+    return -1;
+  }
+  return it - node_ids_.begin();
+}
+
+void ClusterResourceView::Evaluate(const ResourceRequest &resource_request,
+                                   std::vector<uint8_t> *result) const {
+  const size_t num_nodes = node_ids_.size();
+  result->assign(num_nodes, kFeasible | kAvailable);
+  uint8_t *flags = result->data();
+  // A node without a predefined resource has a capacity of 0, which satisfies only a
+  // demand of 0. The loops below have no branches, so that they are vectorized.
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    const int64_t demand = i < resource_request.predefined_resources.size()
+                               ? resource_request.predefined_resources[i].Raw()
+                               : 0;
+    const int64_t *total = predefined_total_[i].data();
+    const int64_t *available = predefined_available_[i].data();
+    for (size_t j = 0; j < num_nodes; j++) {
+      flags[j] &= static_cast<uint8_t>((total[j] >= demand) |
+                                       ((available[j] >= demand) << 1));
+    }
+  }
+
+  if (resource_request.custom_resources.empty()) {
+    return;
+  }
+  // A node without a requested custom resource can never run the task.
+  std::vector<uint8_t> mask(num_nodes);
+  for (const auto &custom_resource : resource_request.custom_resources) {
+    std::fill(mask.begin(), mask.end(), 0);
+    auto it = custom_resources_.find(custom_resource.first);
+    if (it != custom_resources_.end()) {
+      const int64_t demand = custom_resource.second.Raw();
+      for (const auto &entry : it->second) {
+        mask[Find(entry.first)] =
+            static_cast<uint8_t>((entry.second.total >= demand) |
+                                 ((entry.second.available >= demand) << 1));
+      }
+    }
+    for (size_t j = 0; j < num_nodes; j++) {
+      flags[j] &= mask[j];
+    }
+  }
+}
+
+void ClusterResourceView::SetColumns(size_t index, const NodeResources &resources) {
+  for (size_t i = 0; i < PredefinedResources_MAX; i++) {
+    if (i < resources.predefined_resources.size()) {
+      predefined_total_[i][index] = resources.predefined_resources[i].total.Raw();
+      predefined_available_[i][index] =
+          resources.predefined_resources[i].available.Raw();
+    } else {
+      predefined_total_[i][index] = 0;
+      predefined_available_[i][index] = 0;
+    }
+  }
+  utilization_[index] = resources.CalculateCriticalResourceUtilization();
+
+  const int64_t node_id = node_ids_[index];
+  RemoveCustomResources(node_id, index);
+  auto &node_custom_resources = node_custom_resources_[index];
+  for (const auto &custom_resource : resources.custom_resources) {
+    custom_resources_[custom_resource.first][node_id] = {
+        custom_resource.second.total.Raw(), custom_resource.second.available.Raw()};
+    node_custom_resources.push_back(custom_resource.first);
+  }
+}
+
+void ClusterResourceView::RemoveCustomResources(int64_t node_id, size_t index) {
+  for (int64_t resource_id : node_custom_resources_[index]) {
+    auto it = custom_resources_.find(resource_id);
+    RAY_CHECK(it != custom_resources_.end());
+    it->second.erase(node_id);
+    if (it->second.empty()) {
+      custom_resources_.erase(it);
+    }
+  }
+  node_custom_resources_[index].clear();
+}
+
+}  // namespace ray
@@ -0,0 +1,102 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ray/raylet/scheduling/cluster_resource_data.h"
+
+namespace ray {
+
+/// A columnar copy of the resources of every node in the cluster, with the nodes in
+/// increasing ID order. Each predefined resource is stored as one contiguous array of
+/// raw fixed point values across all nodes, so that a resource request is checked
+/// against every node with a few branch-free loops that the compiler vectorizes,
+/// instead of by looking at one NodeResources after the other. Custom resources are
+/// stored per resource, with an entry for each node that has the resource, because
+/// most custom resources (such as "node:<ip>") exist on only a few nodes.
+///
+/// The owner of the nodes must update the view whenever a node's resources change.
+class ClusterResourceView {
+ public:
+  /// Set in the result of Evaluate if a node's total resources fit the request.
+  static constexpr uint8_t kFeasible = 1;
+  /// Set in the result of Evaluate if a node's available resources fit the request.
+  static constexpr uint8_t kAvailable = 2;
+
+  ClusterResourceView() = default;
+
+  /// Create a view of the local views of all the nodes in a map.
+  explicit ClusterResourceView(const absl::flat_hash_map<int64_t, Node> &nodes);
+
+  /// Add a node, or replace the resources of a node that is already in the view.
+  ///
+  /// \param node_id: The id of the node.
+  /// \param resources: The node's resources.
+  void AddOrUpdateNode(int64_t node_id, const NodeResources &resources);
+
+  /// Remove a node. This does nothing if the node is not in the view.
+  void RemoveNode(int64_t node_id);
+
+  /// The ids of the nodes in the view, in increasing order. The position of a node in
+  /// this list is its index in the view.
+  const std::vector<int64_t> &NodeIds() const { return node_ids_; }
+
+  /// Find a node in O(log N).
+  ///
+  /// \return The index of the node, or -1 if it is not in the view.
+  int64_t Find(int64_t node_id) const;
+
+  /// Check a resource request against every node. This is equivalent to calling
+  /// NodeResources::IsFeasible and NodeResources::IsAvailable for each node.
+  ///
+  /// \param resource_request: The request to check.
+  /// \param[out] result: For each node index, kFeasible and kAvailable bits.
+  void Evaluate(const ResourceRequest &resource_request,
+                std::vector<uint8_t> *result) const;
+
+  /// The critical resource utilization of a node, see
+  /// NodeResources::CalculateCriticalResourceUtilization.
+  float CriticalResourceUtilization(size_t index) const { return utilization_[index]; }
+
+ private:
+  struct CustomResourceEntry {
+    int64_t total;
+    int64_t available;
+  };
+
+  /// Write a node's resources into the columns at index.
+  void SetColumns(size_t index, const NodeResources &resources);
+
+  /// Remove a node from the entries of the custom resources that it has.
+  void RemoveCustomResources(int64_t node_id, size_t index);
+
+  std::vector<int64_t> node_ids_;
+  /// The total and available capacity of each predefined resource, per node index.
+  std::array<std::vector<int64_t>, PredefinedResources_MAX> predefined_total_;
+  std::array<std::vector<int64_t>, PredefinedResources_MAX> predefined_available_;
+  /// The critical resource utilization per node index.
+  std::vector<float> utilization_;
+  /// The custom resources that each node has, per node index.
+  std::vector<std::vector<int64_t>> node_custom_resources_;
+  /// For each custom resource, the capacity of each node that has it, by node id.
+  absl::flat_hash_map<int64_t, absl::flat_hash_map<int64_t, CustomResourceEntry>>
+      custom_resources_;
+};
+
+}  // namespace ray
@@ -0,0 +1,107 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/raylet/scheduling/cluster_resource_view.h"
+
+#include "gtest/gtest.h"
+
+namespace ray {
+
+class ClusterResourceViewTest : public ::testing::Test {
+ public:
+  /// Check that the view agrees with the nodes on every request.
+  void AssertMatchesNodes(const ClusterResourceView &view,
+                          const absl::flat_hash_map<int64_t, NodeResources> &nodes,
+                          const std::vector<ResourceRequest> &requests) {
+    ASSERT_EQ(view.NodeIds().size(), nodes.size());
+    ASSERT_TRUE(std::is_sorted(view.NodeIds().begin(), view.NodeIds().end()));
+    for (const auto &request : requests) {
+      std::vector<uint8_t> fits;
+      view.Evaluate(request, &fits);
+      ASSERT_EQ(fits.size(), nodes.size());
+      for (size_t i = 0; i < fits.size(); i++) {
+        const auto &node = nodes.at(view.NodeIds()[i]);
+        ASSERT_EQ(view.Find(view.NodeIds()[i]), static_cast<int64_t>(i));
+        ASSERT_EQ((fits[i] & ClusterResourceView::kFeasible) != 0,
+                  node.IsFeasible(request));
+        ASSERT_EQ((fits[i] & ClusterResourceView::kAvailable) != 0,
+                  node.IsAvailable(request));
+        ASSERT_EQ(view.CriticalResourceUtilization(i),
+                  node.CalculateCriticalResourceUtilization());
+      }
+    }
+  }
+};
+
+TEST_F(ClusterResourceViewTest, TestEvaluate) {
+  StringIdMap map;
+  std::vector<ResourceRequest> requests = {
+      ResourceMapToResourceRequest(map, {}),
+      ResourceMapToResourceRequest(map, {{"CPU", 1}}),
+      ResourceMapToResourceRequest(map, {{"CPU", 1.5}, {"GPU", 1}}),
+      ResourceMapToResourceRequest(map, {{"object_store_memory", 10}}),
+      ResourceMapToResourceRequest(map, {{"a", 1}}),
+      ResourceMapToResourceRequest(map, {{"CPU", 1}, {"a", 0.5}, {"b", 1}}),
+      ResourceMapToResourceRequest(map, {{"never", 1}}),
+  };
+  const int64_t a = map.Get("a");
+  const int64_t b = map.Get("b");
+
+  absl::flat_hash_map<int64_t, NodeResources> nodes;
+  ClusterResourceView view;
+  for (int i = 0; i < 50; i++) {
+    NodeResources resources;
+    resources.predefined_resources = {{i % 3 * 0.5, 1.5}, {1, 1}, {i % 2, 1}};
+    // Some nodes know about all predefined resources, others do not.
+    if (i % 5 == 0) {
+      resources.predefined_resources.resize(PredefinedResources_MAX);
+      resources.predefined_resources[OBJECT_STORE_MEM] = {i, 40};
+    }
+    if (i % 3 == 0) {
+      resources.custom_resources[a] = {i % 2, 1};
+    }
+    if (i % 4 == 0) {
+      resources.custom_resources[b] = {1, 1};
+    }
+    const int64_t node_id = i * 17 % 50;
+    nodes[node_id] = resources;
+    view.AddOrUpdateNode(node_id, resources);
+  }
+  AssertMatchesNodes(view, nodes, requests);
+
+  // Update and remove some of the nodes.
+  for (int i = 0; i < 50; i += 3) {
+    auto &resources = nodes[i];
+    resources.predefined_resources[CPU].available = 0;
+    resources.custom_resources.erase(a);
+    resources.custom_resources[b] = {0, 2};
+    view.AddOrUpdateNode(i, resources);
+  }
+  for (int i = 0; i < 50; i += 7) {
+    nodes.erase(i);
+    view.RemoveNode(i);
+  }
+  // Removing a node that is not in the view does nothing.
+  view.RemoveNode(1000);
+  ASSERT_EQ(view.Find(1000), -1);
+  AssertMatchesNodes(view, nodes, requests);
+
+  for (const auto &node : nodes) {
+    view.RemoveNode(node.first);
+  }
+  nodes.clear();
+  AssertMatchesNodes(view, nodes, requests);
+}
+
+}  // namespace ray
@@ -1,6 +1,6 @@
 #include <google/protobuf/map.h>
 
-#include <boost/range/join.hpp>
+#include <algorithm>
 
 #include "ray/raylet/scheduling/cluster_task_manager.h"
 #include "ray/stats/stats.h"
@@ -12,6 +12,34 @@ namespace raylet {
 // The max number of pending actors to report in node stats.
 const int kMaxPendingActorsToReport = 20;
 
+namespace {
+
+/// Add the CPU, memory and GPU instances that a worker holds to the usage of its job.
+void AddJobUsage(const TaskResourceInstances &instances,
+                 std::array<double, PredefinedResources_MAX> *usage,
+                 bool include_cpu = true) {
+  for (int resource : {CPU, MEM, GPU}) {
+    if ((resource == CPU && !include_cpu) ||
+        static_cast<size_t>(resource) >= instances.predefined_resources.size()) {
+      continue;
+    }
+    for (const auto &instance : instances.predefined_resources[resource]) {
+      (*usage)[resource] += instance.Double();
+    }
+  }
+}
+
+/// The number of lease requests in the dispatch queues of a shape.
+size_t NumQueued(const JobQueues &job_queues) {
+  size_t num_queued = 0;
+  for (const auto &job_queue : job_queues) {
+    num_queued += job_queue.second.size();
+  }
+  return num_queued;
+}
+
+}  // namespace
+
 ClusterTaskManager::ClusterTaskManager(
     const NodeID &self_node_id,
     std::shared_ptr<ClusterResourceScheduler> cluster_resource_scheduler,
@@ -24,7 +52,11 @@ ClusterTaskManager::ClusterTaskManager(
     std::function<bool(const std::vector<ObjectID> &object_ids,
                        std::vector<std::unique_ptr<RayObject>> *results)>
         get_task_arguments,
-    size_t max_pinned_task_arguments_bytes)
+    size_t max_pinned_task_arguments_bytes,
+    std::function<void(std::function<void()>, int64_t)> delay_executor,
+    std::function<int64_t()> get_time_ms,
+    std::function<void(std::shared_ptr<WorkerInterface>)> preempt_worker,
+    PrepareGangLeasesFn prepare_gang_leases, CancelGangLeasesFn cancel_gang_leases)
     : self_node_id_(self_node_id),
       cluster_resource_scheduler_(cluster_resource_scheduler),
       task_dependency_manager_(task_dependency_manager),
@@ -34,6 +66,15 @@ ClusterTaskManager::ClusterTaskManager(
       max_resource_shapes_per_load_report_(
           RayConfig::instance().max_resource_shapes_per_load_report()),
       report_worker_backlog_(RayConfig::instance().report_worker_backlog()),
+      delay_executor_(delay_executor),
+      get_time_ms_(get_time_ms),
+      gang_initial_backoff_ms_(RayConfig::instance().gang_lease_initial_backoff_ms()),
+      gang_max_backoff_ms_(RayConfig::instance().gang_lease_max_backoff_ms()),
+      gang_reservation_timeout_ms_(
+          RayConfig::instance().gang_lease_reservation_timeout_ms()),
+      prepare_gang_leases_(prepare_gang_leases),
+      cancel_gang_leases_(cancel_gang_leases),
+      preempt_worker_(preempt_worker),
       worker_pool_(worker_pool),
       leased_workers_(leased_workers),
       get_task_arguments_(get_task_arguments),
@@ -50,6 +91,13 @@ bool ClusterTaskManager::SchedulePendingTasks() {
        shapes_it != tasks_to_schedule_.end();) {
     auto &work_queue = shapes_it->second;
     bool is_infeasible = false;
+    // Scheduling a task on the local node does not change the resources of any node, so
+    // once the local node is the best node for this shape, it stays the best node for
+    // the rest of the round, and the remaining tasks of the shape skip the policy.
+    // Actor creation tasks that need no resources are placed randomly, and tasks whose
+    // argument locations are known may prefer other nodes, so those tasks are always
+    // scheduled one by one.
+    bool schedule_locally = false;
     for (auto work_it = work_queue.begin(); work_it != work_queue.end();) {
       // Check every task in task_to_schedule queue to see
       // whether it can be scheduled. This avoids head-of-line
@@ -57,23 +105,26 @@ bool ClusterTaskManager::SchedulePendingTasks() {
       // there are not enough available resources blocks other
       // tasks from being scheduled.
       const Work &work = *work_it;
-      Task task = std::get<0>(work);
-      RAY_LOG(DEBUG) << "Scheduling pending task "
-                     << task.GetTaskSpecification().TaskId();
-      auto placement_resources =
-          task.GetTaskSpecification().GetRequiredPlacementResources().GetResourceMap();
-      // This argument is used to set violation, which is an unsupported feature now.
-      int64_t _unused;
-      std::string node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
-          placement_resources, task.GetTaskSpecification().IsActorCreationTask(),
-          /*force_spillback=*/false, &_unused, &is_infeasible);
+      const Task &task = std::get<0>(work);
+      const auto &spec = task.GetTaskSpecification();
+      RAY_LOG(DEBUG) << "Scheduling pending task " << spec.TaskId();
+      std::string node_id_string;
+      const bool one_by_one = spec.IsActorCreationTask() || spec.HasArgObjectLocations();
+      if (schedule_locally && !one_by_one) {
+        node_id_string = self_node_id_.Binary();
+      } else {
+        // This argument is used to set violation, which is an unsupported feature now.
+        int64_t _unused;
+        node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
+            spec, /*force_spillback=*/false, &_unused, &is_infeasible);
+        schedule_locally = node_id_string == self_node_id_.Binary() && !one_by_one;
+      }
 
       // There is no node that has available resources to run the request.
       // Move on to the next shape.
       if (node_id_string.empty()) {
-        RAY_LOG(DEBUG) << "No node found to schedule a task "
-                       << task.GetTaskSpecification().TaskId() << " is infeasible?"
-                       << is_infeasible;
+        RAY_LOG(DEBUG) << "No node found to schedule a task " << spec.TaskId()
+                       << " is infeasible?" << is_infeasible;
         break;
       }
 
@@ -121,7 +172,7 @@ bool ClusterTaskManager::WaitForTaskArgsRequests(Work work) {
         task_dependency_manager_.RequestTaskDependencies(task_id, task.GetDependencies());
     if (args_ready) {
       RAY_LOG(DEBUG) << "Args already ready, task can be dispatched " << task_id;
-      tasks_to_dispatch_[scheduling_key].push_back(work);
+      QueueForDispatch(work);
     } else {
       RAY_LOG(DEBUG) << "Waiting for args for task: "
                      << task.GetTaskSpecification().TaskId();
@@ -132,7 +183,7 @@ bool ClusterTaskManager::WaitForTaskArgsRequests(Work work) {
   } else {
     RAY_LOG(DEBUG) << "No args, task can be dispatched "
                    << task.GetTaskSpecification().TaskId();
-    tasks_to_dispatch_[scheduling_key].push_back(work);
+    QueueForDispatch(work);
   }
   return can_dispatch;
 }
@@ -145,117 +196,212 @@ void ClusterTaskManager::DispatchScheduledTasksToWorkers(
   // blocking where a task which cannot be dispatched because
   // there are not enough available resources blocks other
   // tasks from being dispatched.
-  for (auto shapes_it = tasks_to_dispatch_.begin();
-       shapes_it != tasks_to_dispatch_.end();) {
-    auto &dispatch_queue = shapes_it->second;
-    bool is_infeasible = false;
-    for (auto work_it = dispatch_queue.begin(); work_it != dispatch_queue.end();) {
-      auto &work = *work_it;
-      const auto &task = std::get<0>(work);
-      const auto &spec = task.GetTaskSpecification();
-      TaskID task_id = spec.TaskId();
-
-      bool args_missing = false;
-      bool success = PinTaskArgsIfMemoryAvailable(spec, &args_missing);
-      // An argument was evicted since this task was added to the dispatch
-      // queue. Move it back to the waiting queue. The caller is responsible
-      // for notifying us when the task is unblocked again.
-      if (!success) {
-        if (args_missing) {
-          // Insert the task at the head of the waiting queue because we
-          // prioritize spilling from the end of the queue.
-          auto it = waiting_task_queue_.insert(waiting_task_queue_.begin(),
-                                               std::move(*work_it));
-          RAY_CHECK(waiting_tasks_index_.emplace(task_id, it).second);
-          work_it = dispatch_queue.erase(work_it);
-        } else {
-          // The task's args cannot be pinned due to lack of memory. We should
-          // retry dispatching the task once another task finishes and releases
-          // its arguments.
-          RAY_LOG(INFO) << "Dispatching task " << task_id
-                        << " would put this node over the max memory allowed for "
-                           "arguments of executing tasks ("
-                        << max_pinned_task_arguments_bytes_
-                        << "). Waiting to dispatch task until other tasks complete";
-          RAY_CHECK(!executing_task_args_.empty() && !pinned_task_arguments_.empty())
-              << "Cannot dispatch task " << task_id
-              << " until another task finishes and releases its arguments, but no other "
-                 "task is running";
-          work_it++;
-        }
+  //
+  // Each shape has one queue per job, sorted by priority. The next task to dispatch is
+  // the head of the queue with the highest priority and, among those, of the job with
+  // the lowest weighted dominant share of this node, so that jobs that compete for the
+  // node get it in proportion to their weights.
+  struct JobCursor {
+    SchedulingClass scheduling_class;
+    JobID job_id;
+    std::deque<Work> *queue;
+    std::deque<Work>::iterator next;
+  };
+  std::vector<JobCursor> cursors;
+  for (auto &shape : tasks_to_dispatch_) {
+    for (auto &job_queue : shape.second) {
+      cursors.push_back(
+          {shape.first, job_queue.first, &job_queue.second, job_queue.second.begin()});
+    }
+  }
+  // The shares only matter if more than one job has tasks to dispatch.
+  bool fair_share = false;
+  absl::flat_hash_map<JobID, JobUsage> job_usage;
+  for (const auto &cursor : cursors) {
+    if (cursor.job_id != cursors.front().job_id) {
+      fair_share = true;
+      job_usage = GetJobUsage();
+      break;
+    }
+  }
+  // The first task that cannot get resources on any node reserves them on this node:
+  // tasks of lower priorities are only backfilled into the resources that it does not
+  // need, so that they do not delay it. Tasks of the same priority are not held back.
+  bool has_reservation = false;
+  int32_t reservation_priority = 0;
+  ResourceSet reserved_resources;
+  // The shapes that cannot be dispatched for the rest of this call.
+  absl::flat_hash_set<SchedulingClass> blocked_shapes;
+  absl::flat_hash_set<SchedulingClass> infeasible_shapes;
+  while (true) {
+    JobCursor *cursor = nullptr;
+    int32_t cursor_priority = 0;
+    double cursor_share = 0;
+    for (auto &candidate : cursors) {
+      if (candidate.next == candidate.queue->end() ||
+          blocked_shapes.contains(candidate.scheduling_class)) {
         continue;
       }
+      const int32_t priority =
+          std::get<0>(*candidate.next).GetTaskSpecification().Priority();
+      const double share =
+          fair_share ? DominantShare(candidate.job_id, job_usage[candidate.job_id]) : 0;
+      if (cursor == nullptr || priority > cursor_priority ||
+          (priority == cursor_priority && share < cursor_share)) {
+        cursor = &candidate;
+        cursor_priority = priority;
+        cursor_share = share;
+      }
+    }
+    if (cursor == nullptr) {
+      break;
+    }
 
-      const auto owner_worker_id = WorkerID::FromBinary(spec.CallerAddress().worker_id());
-      const auto owner_node_id = NodeID::FromBinary(spec.CallerAddress().raylet_id());
-
-      // If the owner has died since this task was queued, cancel the task by
-      // killing the worker (unless this task is for a detached actor).
-      if (!spec.IsDetachedActor() && !is_owner_alive_(owner_worker_id, owner_node_id)) {
-        RAY_LOG(WARNING) << "Task: " << task.GetTaskSpecification().TaskId()
-                         << "'s caller is no longer running. Cancelling task.";
-        if (!spec.GetDependencies().empty()) {
-          task_dependency_manager_.RemoveTaskDependencies(task_id);
-        }
-        ReleaseTaskArgs(task_id);
+    auto &dispatch_queue = *cursor->queue;
+    auto &work_it = cursor->next;
+    auto &work = *work_it;
+    const auto &task = std::get<0>(work);
+    const auto &spec = task.GetTaskSpecification();
+    TaskID task_id = spec.TaskId();
+
+    bool args_missing = false;
+    bool success = PinTaskArgsIfMemoryAvailable(spec, &args_missing);
+    // An argument was evicted since this task was added to the dispatch
+    // queue. Move it back to the waiting queue. The caller is responsible
+    // for notifying us when the task is unblocked again.
+    if (!success) {
+      if (args_missing) {
+        // Insert the task at the head of the waiting queue because we
+        // prioritize spilling from the end of the queue.
+        auto it = waiting_task_queue_.insert(waiting_task_queue_.begin(),
+                                             std::move(*work_it));
+        RAY_CHECK(waiting_tasks_index_.emplace(task_id, it).second);
         work_it = dispatch_queue.erase(work_it);
-        continue;
+      } else {
+        // The task's args cannot be pinned due to lack of memory. We should
+        // retry dispatching the task once another task finishes and releases
+        // its arguments.
+        RAY_LOG(INFO) << "Dispatching task " << task_id
+                      << " would put this node over the max memory allowed for "
+                         "arguments of executing tasks ("
+                      << max_pinned_task_arguments_bytes_
+                      << "). Waiting to dispatch task until other tasks complete";
+        RAY_CHECK(!executing_task_args_.empty() && !pinned_task_arguments_.empty())
+            << "Cannot dispatch task " << task_id
+            << " until another task finishes and releases its arguments, but no other "
+               "task is running";
+        work_it++;
       }
+      continue;
+    }
 
-      // Check if the node is still schedulable. It may not be if dependency resolution
-      // took a long time.
-      std::shared_ptr<TaskResourceInstances> allocated_instances(
-          new TaskResourceInstances());
-      bool schedulable = cluster_resource_scheduler_->AllocateLocalTaskResources(
-          spec.GetRequiredResources().GetResourceMap(), allocated_instances);
+    const auto owner_worker_id = WorkerID::FromBinary(spec.CallerAddress().worker_id());
+    const auto owner_node_id = NodeID::FromBinary(spec.CallerAddress().raylet_id());
 
-      if (!schedulable) {
-        ReleaseTaskArgs(task_id);
-        // The local node currently does not have the resources to run the task, so we
-        // should try spilling to another node.
-        bool did_spill = TrySpillback(work, is_infeasible);
-        if (!did_spill) {
-          // There must not be any other available nodes in the cluster, so the task
-          // should stay on this node. We can skip the reest of the shape because the
-          // scheduler will make the same decision.
-          break;
-        }
-      } else {
-        // The local node has the available resources to run the task, so we should run
-        // it.
-        std::shared_ptr<WorkerInterface> worker = worker_pool_.PopWorker(spec);
-        if (!worker) {
-          RAY_LOG(DEBUG) << "This node has available resources, but no worker processes "
-                            "to grant the lease.";
-          // We've already acquired resources so we need to release them to avoid
-          // double-acquiring when the next invocation of this function tries to schedule
-          // this task.
-          cluster_resource_scheduler_->ReleaseWorkerResources(allocated_instances);
-          ReleaseTaskArgs(task_id);
-          // It may be that no worker was available with the correct runtime env or
-          // correct job ID.  However, another task with a different env or job ID
-          // might have a worker available, so continue iterating through the queue.
-          work_it++;
-          continue;
-        }
+    // If the owner has died since this task was queued, cancel the task by
+    // killing the worker (unless this task is for a detached actor).
+    if (!spec.IsDetachedActor() && !is_owner_alive_(owner_worker_id, owner_node_id)) {
+      RAY_LOG(WARNING) << "Task: " << task.GetTaskSpecification().TaskId()
+                       << "'s caller is no longer running. Cancelling task.";
+      if (!spec.GetDependencies().empty()) {
+        task_dependency_manager_.RemoveTaskDependencies(task_id);
+      }
+      ReleaseTaskArgs(task_id);
+      work_it = dispatch_queue.erase(work_it);
+      continue;
+    }
 
-        RAY_LOG(DEBUG) << "Dispatching task " << task_id << " to worker "
-                       << worker->WorkerId();
-        auto reply = std::get<1>(*work_it);
-        auto callback = std::get<2>(*work_it);
-        Dispatch(worker, leased_workers_, allocated_instances, task, reply, callback);
+    // Check if the node is still schedulable. It may not be if dependency resolution
+    // took a long time.
+    std::shared_ptr<TaskResourceInstances> allocated_instances(
+        new TaskResourceInstances());
+    const auto &required_resources = spec.GetRequiredResources();
+    const bool held_back = has_reservation && spec.Priority() < reservation_priority &&
+                           !cluster_resource_scheduler_->CanBackfillLocally(
+                               required_resources, reserved_resources);
+    bool schedulable =
+        !held_back && cluster_resource_scheduler_->AllocateLocalTaskResources(
+                          required_resources, allocated_instances);
+
+    if (!schedulable) {
+      ReleaseTaskArgs(task_id);
+      // The local node currently does not have the resources to run the task, so we
+      // should try spilling to another node.
+      bool is_infeasible = false;
+      bool did_spill = TrySpillback(work, is_infeasible);
+      if (is_infeasible) {
+        infeasible_shapes.insert(cursor->scheduling_class);
+        blocked_shapes.insert(cursor->scheduling_class);
+        continue;
+      }
+      if (!did_spill) {
+        if (!has_reservation && !held_back) {
+          has_reservation = true;
+          reservation_priority = spec.Priority();
+          reserved_resources = required_resources;
+          PreemptLowerPriorityTask(spec);
+        }
+        // There must not be any other available nodes in the cluster, so the task
+        // should stay on this node. We can skip the reest of the shape because the
+        // scheduler will make the same decision.
+        blocked_shapes.insert(cursor->scheduling_class);
+        continue;
+      }
+    } else {
+      // The local node has the available resources to run the task, so we should run
+      // it.
+      std::shared_ptr<WorkerInterface> worker = worker_pool_.PopWorker(spec);
+      if (!worker) {
+        RAY_LOG(DEBUG) << "This node has available resources, but no worker processes "
+                          "to grant the lease.";
+        // We've already acquired resources so we need to release them to avoid
+        // double-acquiring when the next invocation of this function tries to schedule
+        // this task.
+        cluster_resource_scheduler_->ReleaseWorkerResources(allocated_instances);
+        ReleaseTaskArgs(task_id);
+        // It may be that no worker was available with the correct runtime env or
+        // correct job ID.  However, another task with a different env or job ID
+        // might have a worker available, so continue iterating through the queue.
+        work_it++;
+        continue;
       }
 
-      if (!spec.GetDependencies().empty()) {
-        task_dependency_manager_.RemoveTaskDependencies(
-            task.GetTaskSpecification().TaskId());
+      RAY_LOG(DEBUG) << "Dispatching task " << task_id << " to worker "
+                     << worker->WorkerId();
+      if (fair_share) {
+        AddJobUsage(*allocated_instances, &job_usage[cursor->job_id]);
       }
-      work_it = dispatch_queue.erase(work_it);
+      auto reply = std::get<1>(*work_it);
+      auto callback = std::get<2>(*work_it);
+      Dispatch(worker, leased_workers_, allocated_instances, task, reply, callback);
     }
-    if (is_infeasible) {
-      infeasible_tasks_[shapes_it->first] = std::move(shapes_it->second);
+
+    if (!spec.GetDependencies().empty()) {
+      task_dependency_manager_.RemoveTaskDependencies(
+          task.GetTaskSpecification().TaskId());
+    }
+    work_it = dispatch_queue.erase(work_it);
+  }
+
+  for (auto shapes_it = tasks_to_dispatch_.begin();
+       shapes_it != tasks_to_dispatch_.end();) {
+    auto &job_queues = shapes_it->second;
+    if (infeasible_shapes.contains(shapes_it->first)) {
+      auto &infeasible_queue = infeasible_tasks_[shapes_it->first];
+      for (auto &job_queue : job_queues) {
+        for (auto &work : job_queue.second) {
+          InsertByPriority(infeasible_queue, work);
+        }
+      }
       shapes_it = tasks_to_dispatch_.erase(shapes_it);
-    } else if (dispatch_queue.empty()) {
+      continue;
+    }
+    job_queues.erase(std::remove_if(job_queues.begin(), job_queues.end(),
+                                    [](const std::pair<JobID, std::deque<Work>> &entry) {
+                                      return entry.second.empty();
+                                    }),
+                     job_queues.end());
+    if (job_queues.empty()) {
       shapes_it = tasks_to_dispatch_.erase(shapes_it);
     } else {
       shapes_it++;
@@ -263,13 +409,114 @@ void ClusterTaskManager::DispatchScheduledTasksToWorkers(
   }
 }
 
+void ClusterTaskManager::InsertByPriority(std::deque<Work> &queue, const Work &work) {
+  // Most tasks have the default priority, so this is usually a push to the back.
+  const int32_t priority = std::get<0>(work).GetTaskSpecification().Priority();
+  auto it = queue.end();
+  while (it != queue.begin() &&
+         std::get<0>(*std::prev(it)).GetTaskSpecification().Priority() < priority) {
+    it--;
+  }
+  queue.insert(it, work);
+}
+
+void ClusterTaskManager::QueueForDispatch(const Work &work) {
+  const auto &spec = std::get<0>(work).GetTaskSpecification();
+  auto &job_queues = tasks_to_dispatch_[spec.GetSchedulingClass()];
+  const auto job_id = spec.JobId();
+  auto it = std::find_if(job_queues.begin(), job_queues.end(),
+                         [&job_id](const std::pair<JobID, std::deque<Work>> &entry) {
+                           return entry.first == job_id;
+                         });
+  if (it == job_queues.end()) {
+    job_queues.emplace_back(job_id, std::deque<Work>());
+    it = std::prev(job_queues.end());
+  }
+  InsertByPriority(it->second, work);
+}
+
+absl::flat_hash_map<JobID, ClusterTaskManager::JobUsage> ClusterTaskManager::GetJobUsage()
+    const {
+  absl::flat_hash_map<JobID, JobUsage> job_usage;
+  for (const auto &entry : leased_workers_) {
+    const auto &worker = entry.second;
+    const auto &job_id = worker->GetAssignedTask().GetTaskSpecification().JobId();
+    auto &usage = job_usage[job_id];
+    for (const auto &instances :
+         {worker->GetAllocatedInstances(), worker->GetLifetimeAllocatedInstances()}) {
+      if (instances != nullptr) {
+        AddJobUsage(*instances, &usage, /*include_cpu=*/!worker->IsBlocked());
+      }
+    }
+  }
+  return job_usage;
+}
+
+double ClusterTaskManager::DominantShare(const JobID &job_id,
+                                         const JobUsage &usage) const {
+  const auto &local_resources = cluster_resource_scheduler_->GetLocalNodeResources();
+  double share = 0;
+  for (int resource : {CPU, MEM, GPU}) {
+    const double total = local_resources.predefined_resources[resource].total.Double();
+    if (total > 0) {
+      share = std::max(share, usage[resource] / total);
+    }
+  }
+  auto weight_it = job_weights_.find(job_id);
+  return weight_it == job_weights_.end() ? share : share / weight_it->second;
+}
+
+void ClusterTaskManager::PreemptLowerPriorityTask(const TaskSpecification &spec) {
+  if (!preempt_worker_) {
+    return;
+  }
+  // Wait until the worker preempted last has returned its resources.
+  for (auto it = preempted_workers_.begin(); it != preempted_workers_.end();) {
+    if (leased_workers_.count(*it) == 0) {
+      preempted_workers_.erase(it++);
+    } else {
+      it++;
+    }
+  }
+  if (!preempted_workers_.empty()) {
+    return;
+  }
+
+  // Preempt the task of the lowest priority that can be retried and whose resources,
+  // together with the available ones, are enough for the waiting task. Killing a task
+  // that would leave the waiting task blocked only wastes its work.
+  const auto &required_resources = spec.GetRequiredResources();
+  std::shared_ptr<WorkerInterface> victim;
+  int32_t victim_priority = spec.Priority();
+  for (const auto &entry : leased_workers_) {
+    const auto &worker = entry.second;
+    const auto &running_spec = worker->GetAssignedTask().GetTaskSpecification();
+    if (running_spec.Priority() >= victim_priority || !running_spec.IsNormalTask() ||
+        running_spec.GetMessage().max_retries() == 0 ||
+        worker->GetAllocatedInstances() == nullptr) {
+      continue;
+    }
+    if (cluster_resource_scheduler_->CanRunLocallyAfterRelease(
+            required_resources, running_spec.GetRequiredResources())) {
+      victim = worker;
+      victim_priority = running_spec.Priority();
+    }
+  }
+  if (victim != nullptr) {
+    RAY_LOG(INFO) << "Preempting task "
+                  << victim->GetAssignedTask().GetTaskSpecification().TaskId()
+                  << " of priority " << victim_priority << " for task " << spec.TaskId()
+                  << " of priority " << spec.Priority();
+    preempted_workers_.insert(victim->WorkerId());
+    preempt_worker_(victim);
+  }
+}
+
 bool ClusterTaskManager::TrySpillback(const Work &work, bool &is_infeasible) {
   const auto &spec = std::get<0>(work).GetTaskSpecification();
   int64_t _unused;
-  auto placement_resources = spec.GetRequiredPlacementResources().GetResourceMap();
   std::string node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
-      placement_resources, spec.IsActorCreationTask(), /*force_spillback=*/false,
-      &_unused, &is_infeasible);
+      spec, /*force_spillback=*/false, &_unused, &is_infeasible);
 
   if (is_infeasible || node_id_string == self_node_id_.Binary() ||
       node_id_string.empty()) {
@@ -290,16 +537,449 @@ void ClusterTaskManager::QueueAndScheduleTask(
   Work work = std::make_tuple(task, reply, [send_reply_callback] {
     send_reply_callback(Status::OK(), nullptr, nullptr);
   });
-  const auto &scheduling_class = task.GetTaskSpecification().GetSchedulingClass();
+  QueueWork(work);
+  AddToBacklogTracker(task);
+  ScheduleAndDispatchTasks();
+}
+
+namespace {
+
+void ReplyCancelled(Work &work) {
+  auto reply = std::get<1>(work);
+  auto callback = std::get<2>(work);
+  reply->set_canceled(true);
+  callback();
+}
+
+/// Add one reply per task to a batched lease reply, and return the callback for each
+/// task. The batched reply is sent once every task has been granted, spilled back or
+/// canceled.
+std::function<void(void)> PrepareBatchedReply(
+    size_t num_tasks, rpc::RequestWorkerLeasesReply *reply,
+    rpc::SendReplyCallback send_reply_callback) {
+  // Add all the replies up front, so that the pointers to them stay valid.
+  for (size_t i = 0; i < num_tasks; i++) {
+    reply->add_replies();
+  }
+  auto num_pending = std::make_shared<size_t>(num_tasks);
+  return [num_pending, send_reply_callback] {
+    RAY_CHECK(*num_pending > 0);
+    if (--(*num_pending) == 0) {
+      send_reply_callback(Status::OK(), nullptr, nullptr);
+    }
+  };
+}
+
+}  // namespace
+
+void ClusterTaskManager::QueueAndScheduleTasks(
+    const std::vector<Task> &tasks, rpc::RequestWorkerLeasesReply *reply,
+    rpc::SendReplyCallback send_reply_callback) {
+  RAY_CHECK(!tasks.empty());
+  RAY_LOG(DEBUG) << "Queuing and scheduling " << tasks.size() << " tasks starting at "
+                 << tasks[0].GetTaskSpecification().TaskId();
+  auto callback = PrepareBatchedReply(tasks.size(), reply, send_reply_callback);
+  for (size_t i = 0; i < tasks.size(); i++) {
+    metric_tasks_queued_++;
+    QueueWork(std::make_tuple(tasks[i], reply->mutable_replies(i), callback));
+    AddToBacklogTracker(tasks[i]);
+  }
+  ScheduleAndDispatchTasks();
+
+  // The first task stays queued like a regular lease request. The other tasks that
+  // are not granted or spilled back by now stay queued only if this node has the
+  // resources for them and they just wait for a worker to start. The rest are
+  // returned as canceled: the leases granted in this batch are held back until every
+  // task is resolved, so a task that waits for resources or arguments could wait for
+  // the leases of its own batch. Resources are allocated tentatively, in queue order,
+  // so that no more tasks stay queued than the node can run at once.
+  std::vector<std::shared_ptr<TaskResourceInstances>> tentative_allocations;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    const auto &spec = tasks[i].GetTaskSpecification();
+    if (IsQueuedForDispatch(spec)) {
+      auto allocated_instances = std::make_shared<TaskResourceInstances>();
+      if (cluster_resource_scheduler_->AllocateLocalTaskResources(
+              spec.GetRequiredResources(), allocated_instances)) {
+        tentative_allocations.push_back(std::move(allocated_instances));
+        continue;
+      }
+    }
+    if (i > 0) {
+      CancelRecentlyQueuedTask(tasks[i]);
+    }
+  }
+  for (auto &allocated_instances : tentative_allocations) {
+    cluster_resource_scheduler_->ReleaseWorkerResources(allocated_instances);
+  }
+}
+
+void ClusterTaskManager::QueueAndScheduleGang(
+    const std::vector<Task> &tasks, int64_t timeout_ms,
+    rpc::RequestWorkerLeasesReply *reply, rpc::SendReplyCallback send_reply_callback) {
+  RAY_CHECK(!tasks.empty());
+  RAY_LOG(DEBUG) << "Queuing a gang of " << tasks.size() << " tasks starting at "
+                 << tasks[0].GetTaskSpecification().TaskId();
+  auto callback = PrepareBatchedReply(tasks.size(), reply, send_reply_callback);
+  const int64_t now_ms = get_time_ms_();
+  Gang gang;
+  gang.deadline_ms = now_ms + timeout_ms;
+  gang.next_attempt_ms = now_ms;
+  gang.backoff_ms = gang_initial_backoff_ms_;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    metric_tasks_queued_++;
+    gang.work.emplace_back(tasks[i], reply->mutable_replies(i), callback);
+    AddToBacklogTracker(tasks[i]);
+  }
+  pending_gangs_.push_back(std::move(gang));
+  ScheduleAndDispatchTasks();
+}
+
+void ClusterTaskManager::ScheduleGangs() {
+  if (pending_gangs_.empty()) {
+    return;
+  }
+  const int64_t now_ms = get_time_ms_();
+  for (auto gang_it = pending_gangs_.begin(); gang_it != pending_gangs_.end();) {
+    auto &gang = *gang_it;
+    if (now_ms >= gang.deadline_ms) {
+      RAY_LOG(DEBUG) << "Timed out reserving a gang of " << gang.work.size()
+                     << " tasks starting at "
+                     << std::get<0>(gang.work[0]).GetTaskSpecification().TaskId();
+      AbortGangAttempt(gang);
+      CancelGang(gang);
+      gang_it = pending_gangs_.erase(gang_it);
+      continue;
+    }
+    if (gang.num_pending_prepares > 0 || now_ms < gang.next_attempt_ms) {
+      gang_it++;
+      continue;
+    }
+    if (!TryReserveGang(gang)) {
+      // Back off, so that a gang that does not fit yet does not reserve and release
+      // resources on every scheduling pass.
+      BackOffGang(gang, now_ms);
+      gang_it++;
+      continue;
+    }
+    if (gang.num_pending_prepares == 0) {
+      CommitGang(gang);
+      gang_it = pending_gangs_.erase(gang_it);
+      continue;
+    }
+    // Wait for the remote nodes to reserve their leases.
+    gang_it++;
+  }
+}
+
+void ClusterTaskManager::BackOffGang(Gang &gang, int64_t now_ms) {
+  // Make sure the gang is retried, or canceled at its deadline, even if nothing else
+  // triggers scheduling.
+  const int64_t delay_ms = std::min(gang.backoff_ms, gang.deadline_ms - now_ms);
+  gang.next_attempt_ms = now_ms + delay_ms;
+  gang.backoff_ms = std::min(2 * gang.backoff_ms, gang_max_backoff_ms_);
+  if (delay_executor_) {
+    delay_executor_([this] { ScheduleAndDispatchTasks(); }, delay_ms);
+  }
+}
+
+bool ClusterTaskManager::TryReserveGang(Gang &gang) {
+  // Pick a node for every task, and allocate its resources right away so that the
+  // next tasks see what is left.
+  auto &allocations = gang.allocations;
+  auto &remote_nodes = gang.remote_nodes;
+  RAY_CHECK(allocations.empty() && gang.reservations.empty());
+  for (const auto &work : gang.work) {
+    const auto &spec = std::get<0>(work).GetTaskSpecification();
+    const auto &required_resources = spec.GetRequiredResources();
+    std::string node_id_string = self_node_id_.Binary();
+    if (prepare_gang_leases_) {
+      // This argument is used to set violation, which is an unsupported feature now.
+      int64_t _unused;
+      bool is_infeasible;
+      node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
+          spec, /*force_spillback=*/false, &_unused, &is_infeasible);
+    }
+    bool allocated = false;
+    if (node_id_string == self_node_id_.Binary()) {
+      auto allocation = std::make_shared<TaskResourceInstances>();
+      allocated = cluster_resource_scheduler_->AllocateLocalTaskResources(
+          required_resources, allocation);
+      if (allocated) {
+        allocations.push_back(allocation);
+        remote_nodes.emplace_back();
+      }
+    } else if (!node_id_string.empty()) {
+      // The policy returns a node without available resources if there is no other
+      // choice, which the allocation rejects.
+      allocated = cluster_resource_scheduler_->AllocateRemoteTaskResources(
+          node_id_string, required_resources);
+      if (allocated) {
+        allocations.push_back(nullptr);
+        remote_nodes.push_back(node_id_string);
+      }
+    }
+    if (!allocated) {
+      break;
+    }
+  }
+
+  if (allocations.size() < gang.work.size()) {
+    // Some task does not fit, so release what the others got.
+    AbortGangAttempt(gang);
+    return false;
+  }
+
+  // Ask every remote node to reserve its leases, since this node's view of the remote
+  // resources may be stale. Count all the requests first, so that the gang is only
+  // committed once every node has replied.
+  absl::flat_hash_map<std::string, int64_t> num_remote_leases;
+  for (const auto &node_id : remote_nodes) {
+    if (!node_id.empty()) {
+      num_remote_leases[node_id]++;
+    }
+  }
+  gang.attempt_id = TaskID::ForFakeTask();
+  gang.num_pending_prepares = num_remote_leases.size();
+  for (const auto &entry : num_remote_leases) {
+    gang.reservations[entry.first] = std::make_pair(TaskID::ForFakeTask(), false);
+  }
+  const auto &resource_spec = std::get<0>(gang.work[0]).GetTaskSpecification();
+  for (const auto &entry : num_remote_leases) {
+    const auto attempt_id = gang.attempt_id;
+    const auto node_id = entry.first;
+    const auto reservation_id = gang.reservations[node_id].first;
+    prepare_gang_leases_(NodeID::FromBinary(node_id), reservation_id, resource_spec,
+                         entry.second,
+                         [this, attempt_id, node_id, reservation_id](bool success) {
+                           HandleGangLeasesPrepared(attempt_id, node_id,
+                                                    reservation_id, success);
+                         });
+  }
+  return true;
+}
+
+void ClusterTaskManager::HandleGangLeasesPrepared(const TaskID &attempt_id,
+                                                  const std::string &node_id,
+                                                  const TaskID &reservation_id,
+                                                  bool success) {
+  auto gang_it = std::find_if(
+      pending_gangs_.begin(), pending_gangs_.end(),
+      [&attempt_id](const Gang &gang) { return gang.attempt_id == attempt_id; });
+  if (gang_it == pending_gangs_.end() || gang_it->num_pending_prepares == 0) {
+    // The gang was canceled, timed out or already failed on another node while this
+    // node prepared its leases, which are no longer needed.
+    if (success) {
+      cancel_gang_leases_(NodeID::FromBinary(node_id), reservation_id);
+    }
+    return;
+  }
+  auto &gang = *gang_it;
+  auto &reservation = gang.reservations[node_id];
+  reservation.second = success;
+  gang.num_pending_prepares--;
+  if (!success) {
+    RAY_LOG(DEBUG) << "Node " << NodeID::FromBinary(node_id)
+                    << " could not reserve its leases of the gang starting at "
+                    << std::get<0>(gang.work[0]).GetTaskSpecification().TaskId();
+    gang.num_pending_prepares = 0;
+    AbortGangAttempt(gang);
+    BackOffGang(gang, get_time_ms_());
+    ScheduleAndDispatchTasks();
+    return;
+  }
+  if (gang.num_pending_prepares == 0) {
+    CommitGang(gang);
+    pending_gangs_.erase(gang_it);
+    ScheduleAndDispatchTasks();
+  }
+}
+
+void ClusterTaskManager::CommitGang(Gang &gang) {
+  RAY_LOG(DEBUG) << "Reserved a gang of " << gang.work.size() << " tasks starting at "
+                 << std::get<0>(gang.work[0]).GetTaskSpecification().TaskId();
+  for (size_t i = 0; i < gang.work.size(); i++) {
+    if (gang.allocations[i] != nullptr) {
+      QueueReservedGangWork(gang.work[i], gang.allocations[i]);
+    } else {
+      // Set the reservation before the spillback, which may send the reply.
+      std::get<1>(gang.work[i])
+          ->set_gang_reservation_id(
+              gang.reservations[gang.remote_nodes[i]].first.Binary());
+      Spillback(NodeID::FromBinary(gang.remote_nodes[i]), gang.work[i],
+                /*allocate_remote_resources=*/false);
+    }
+  }
+  gang.allocations.clear();
+  gang.remote_nodes.clear();
+  gang.reservations.clear();
+}
+
+void ClusterTaskManager::AbortGangAttempt(Gang &gang) {
+  for (size_t i = 0; i < gang.allocations.size(); i++) {
+    if (gang.allocations[i] != nullptr) {
+      cluster_resource_scheduler_->ReleaseWorkerResources(gang.allocations[i]);
+    } else {
+      cluster_resource_scheduler_->ReleaseRemoteTaskResources(
+          gang.remote_nodes[i],
+          std::get<0>(gang.work[i]).GetTaskSpecification().GetRequiredResources());
+    }
+  }
+  // The nodes that have not replied yet release their reservations once they do.
+  for (const auto &entry : gang.reservations) {
+    if (entry.second.second) {
+      cancel_gang_leases_(NodeID::FromBinary(entry.first), entry.second.first);
+    }
+  }
+  gang.allocations.clear();
+  gang.remote_nodes.clear();
+  gang.reservations.clear();
+}
+
+void ClusterTaskManager::QueueReservedGangWork(
+    const Work &work, std::shared_ptr<TaskResourceInstances> allocation) {
+  const auto &task = std::get<0>(work);
+  if (!task.GetDependencies().empty()) {
+    // Fetch the arguments. The lease is granted once they are local.
+    task_dependency_manager_.RequestTaskDependencies(
+        task.GetTaskSpecification().TaskId(), task.GetDependencies());
+  }
+  reserved_gang_work_.emplace_back(work, allocation);
+}
+
+bool ClusterTaskManager::PrepareGangLeases(const TaskID &reservation_id,
+                                           const TaskSpecification &resource_spec,
+                                           int64_t num_leases) {
+  if (gang_reservations_.contains(reservation_id)) {
+    return true;
+  }
+  std::vector<std::shared_ptr<TaskResourceInstances>> allocations;
+  for (int64_t i = 0; i < num_leases; i++) {
+    auto allocation = std::make_shared<TaskResourceInstances>();
+    if (!cluster_resource_scheduler_->AllocateLocalTaskResources(
+            resource_spec.GetRequiredResources(), allocation)) {
+      for (auto &allocated : allocations) {
+        cluster_resource_scheduler_->ReleaseWorkerResources(allocated);
+      }
+      return false;
+    }
+    allocations.push_back(allocation);
+  }
+  RAY_LOG(DEBUG) << "Reserved " << num_leases << " gang leases under "
+                 << reservation_id;
+  gang_reservations_.emplace(reservation_id, std::move(allocations));
+  if (delay_executor_) {
+    // Don't hold the resources forever if the owner never claims them.
+    delay_executor_(
+        [this, reservation_id] {
+          if (gang_reservations_.contains(reservation_id)) {
+            RAY_LOG(DEBUG) << "Gang reservation " << reservation_id << " expired";
+            CancelGangLeases(reservation_id);
+            ScheduleAndDispatchTasks();
+          }
+        },
+        gang_reservation_timeout_ms_);
+  }
+  return true;
+}
+
+void ClusterTaskManager::CancelGangLeases(const TaskID &reservation_id) {
+  auto it = gang_reservations_.find(reservation_id);
+  if (it == gang_reservations_.end()) {
+    return;
+  }
+  for (auto &allocation : it->second) {
+    cluster_resource_scheduler_->ReleaseWorkerResources(allocation);
+  }
+  gang_reservations_.erase(it);
+}
+
+void ClusterTaskManager::QueueAndScheduleReservedGang(
+    const TaskID &reservation_id, const std::vector<Task> &tasks,
+    rpc::RequestWorkerLeasesReply *reply, rpc::SendReplyCallback send_reply_callback) {
+  RAY_CHECK(!tasks.empty());
+  auto callback = PrepareBatchedReply(tasks.size(), reply, send_reply_callback);
+  auto reservation_it = gang_reservations_.find(reservation_id);
+  size_t num_reserved = 0;
+  if (reservation_it != gang_reservations_.end()) {
+    num_reserved = reservation_it->second.size();
+  } else {
+    RAY_LOG(INFO) << "Gang leases claimed reservation " << reservation_id
+                  << ", which was released. Canceling the leases.";
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    metric_tasks_queued_++;
+    Work work(tasks[i], reply->mutable_replies(i), callback);
+    if (i >= num_reserved) {
+      ReplyCancelled(work);
+      continue;
+    }
+    AddToBacklogTracker(tasks[i]);
+    QueueReservedGangWork(work, reservation_it->second[i]);
+  }
+  if (reservation_it != gang_reservations_.end()) {
+    // Release what the leases did not claim.
+    for (size_t i = tasks.size(); i < num_reserved; i++) {
+      cluster_resource_scheduler_->ReleaseWorkerResources(reservation_it->second[i]);
+    }
+    gang_reservations_.erase(reservation_it);
+  }
+  ScheduleAndDispatchTasks();
+}
+
+void ClusterTaskManager::DispatchReservedGangWork() {
+  for (auto work_it = reserved_gang_work_.begin();
+       work_it != reserved_gang_work_.end();) {
+    const auto &work = work_it->first;
+    const auto &task = std::get<0>(work);
+    const auto &spec = task.GetTaskSpecification();
+    const auto task_id = spec.TaskId();
+    const auto owner_worker_id = WorkerID::FromBinary(spec.CallerAddress().worker_id());
+    const auto owner_node_id = NodeID::FromBinary(spec.CallerAddress().raylet_id());
+    if (!spec.IsDetachedActor() && !is_owner_alive_(owner_worker_id, owner_node_id)) {
+      RAY_LOG(WARNING) << "Task: " << task_id
+                       << "'s caller is no longer running. Cancelling task.";
+      if (!spec.GetDependencies().empty()) {
+        task_dependency_manager_.RemoveTaskDependencies(task_id);
+      }
+      cluster_resource_scheduler_->ReleaseWorkerResources(work_it->second);
+      RemoveFromBacklogTracker(task);
+      work_it = reserved_gang_work_.erase(work_it);
+      continue;
+    }
+    // The lease keeps its resources while its arguments are fetched, or while other
+    // tasks release the memory to pin them.
+    bool args_missing = false;
+    if (!PinTaskArgsIfMemoryAvailable(spec, &args_missing)) {
+      work_it++;
+      continue;
+    }
+    std::shared_ptr<WorkerInterface> worker = worker_pool_.PopWorker(spec);
+    if (!worker) {
+      ReleaseTaskArgs(task_id);
+      work_it++;
+      continue;
+    }
+    RAY_LOG(DEBUG) << "Dispatching gang task " << task_id << " to worker "
+                   << worker->WorkerId();
+    Dispatch(worker, leased_workers_, work_it->second, task, std::get<1>(work),
+             std::get<2>(work));
+    if (!spec.GetDependencies().empty()) {
+      task_dependency_manager_.RemoveTaskDependencies(task_id);
+    }
+    work_it = reserved_gang_work_.erase(work_it);
+  }
+}
+
+void ClusterTaskManager::QueueWork(const Work &work) {
+  const auto &scheduling_class =
+      std::get<0>(work).GetTaskSpecification().GetSchedulingClass();
   // If the scheduling class is infeasible, just add the work to the infeasible queue
   // directly.
   if (infeasible_tasks_.count(scheduling_class) > 0) {
-    infeasible_tasks_[scheduling_class].push_back(work);
+    InsertByPriority(infeasible_tasks_[scheduling_class], work);
   } else {
-    tasks_to_schedule_[scheduling_class].push_back(work);
+    InsertByPriority(tasks_to_schedule_[scheduling_class], work);
   }
-  AddToBacklogTracker(task);
-  ScheduleAndDispatchTasks();
 }
 
 void ClusterTaskManager::TasksUnblocked(const std::vector<TaskID> &ready_ids) {
@@ -315,7 +995,7 @@ void ClusterTaskManager::TasksUnblocked(const std::vector<TaskID> &ready_ids) {
       const auto &scheduling_key = task.GetTaskSpecification().GetSchedulingClass();
       RAY_LOG(DEBUG) << "Args ready, task can be dispatched "
                      << task.GetTaskSpecification().TaskId();
-      tasks_to_dispatch_[scheduling_key].push_back(work);
+      QueueForDispatch(work);
       waiting_task_queue_.erase(it->second);
       waiting_tasks_index_.erase(it);
     }
@@ -441,16 +1121,131 @@ void ClusterTaskManager::ReturnWorkerResources(std::shared_ptr<WorkerInterface>
   ReleaseWorkerResources(worker);
 }
 
-void ReplyCancelled(Work &work) {
-  auto reply = std::get<1>(work);
-  auto callback = std::get<2>(work);
-  reply->set_canceled(true);
-  callback();
+void ClusterTaskManager::CancelGang(const Gang &gang) {
+  for (auto work : gang.work) {
+    RemoveFromBacklogTracker(std::get<0>(work));
+    ReplyCancelled(work);
+  }
+}
+
+bool ClusterTaskManager::IsQueuedForDispatch(const TaskSpecification &spec) const {
+  auto dispatch_it = tasks_to_dispatch_.find(spec.GetSchedulingClass());
+  if (dispatch_it == tasks_to_dispatch_.end()) {
+    return false;
+  }
+  const auto &task_id = spec.TaskId();
+  for (const auto &job_queue : dispatch_it->second) {
+    if (job_queue.first != spec.JobId()) {
+      continue;
+    }
+    // Search from the back, since the task was queued recently.
+    return std::any_of(job_queue.second.rbegin(), job_queue.second.rend(),
+                       [&task_id](const Work &work) {
+                         return std::get<0>(work).GetTaskSpecification().TaskId() ==
+                                task_id;
+                       });
+  }
+  return false;
+}
+
+bool ClusterTaskManager::CancelRecentlyQueuedTask(const Task &task) {
+  const auto &spec = task.GetTaskSpecification();
+  const auto &task_id = spec.TaskId();
+  auto dispatch_it = tasks_to_dispatch_.find(spec.GetSchedulingClass());
+  if (dispatch_it != tasks_to_dispatch_.end()) {
+    for (auto job_it = dispatch_it->second.begin(); job_it != dispatch_it->second.end();
+         job_it++) {
+      if (job_it->first != spec.JobId()) {
+        continue;
+      }
+      auto &work_queue = job_it->second;
+      auto work_it = std::find_if(
+          work_queue.rbegin(), work_queue.rend(), [&task_id](const Work &work) {
+            return std::get<0>(work).GetTaskSpecification().TaskId() == task_id;
+          });
+      if (work_it != work_queue.rend()) {
+        RemoveFromBacklogTracker(task);
+        ReplyCancelled(*work_it);
+        if (!spec.GetDependencies().empty()) {
+          task_dependency_manager_.RemoveTaskDependencies(task_id);
+        }
+        work_queue.erase(std::next(work_it).base());
+        if (work_queue.empty()) {
+          dispatch_it->second.erase(job_it);
+          if (dispatch_it->second.empty()) {
+            tasks_to_dispatch_.erase(dispatch_it);
+          }
+        }
+        return true;
+      }
+    }
+  }
+  for (auto *queues : {&tasks_to_schedule_, &infeasible_tasks_}) {
+    auto shapes_it = queues->find(spec.GetSchedulingClass());
+    if (shapes_it == queues->end()) {
+      continue;
+    }
+    // Search from the back, since the task was queued recently.
+    auto &work_queue = shapes_it->second;
+    auto work_it = std::find_if(
+        work_queue.rbegin(), work_queue.rend(), [&task_id](const Work &work) {
+          return std::get<0>(work).GetTaskSpecification().TaskId() == task_id;
+        });
+    if (work_it != work_queue.rend()) {
+      RemoveFromBacklogTracker(task);
+      ReplyCancelled(*work_it);
+      work_queue.erase(std::next(work_it).base());
+      if (work_queue.empty()) {
+        queues->erase(shapes_it);
+      }
+      return true;
+    }
+  }
+
+  auto iter = waiting_tasks_index_.find(task_id);
+  if (iter != waiting_tasks_index_.end()) {
+    RemoveFromBacklogTracker(task);
+    ReplyCancelled(*iter->second);
+    if (!spec.GetDependencies().empty()) {
+      task_dependency_manager_.RemoveTaskDependencies(task_id);
+    }
+    waiting_task_queue_.erase(iter->second);
+    waiting_tasks_index_.erase(iter);
+    return true;
+  }
+  return false;
 }
 
 bool ClusterTaskManager::CancelTask(const TaskID &task_id) {
   // TODO(sang): There are lots of repetitive code around task backlogs. We should
   // refactor them.
+  // Canceling any task of a pending gang cancels the whole gang.
+  for (auto gang_it = pending_gangs_.begin(); gang_it != pending_gangs_.end();
+       gang_it++) {
+    for (const auto &work : gang_it->work) {
+      if (std::get<0>(work).GetTaskSpecification().TaskId() == task_id) {
+        RAY_LOG(DEBUG) << "Canceling the gang of task " << task_id;
+        AbortGangAttempt(*gang_it);
+        CancelGang(*gang_it);
+        pending_gangs_.erase(gang_it);
+        return true;
+      }
+    }
+  }
+  for (auto work_it = reserved_gang_work_.begin(); work_it != reserved_gang_work_.end();
+       work_it++) {
+    const auto &task = std::get<0>(work_it->first);
+    if (task.GetTaskSpecification().TaskId() == task_id) {
+      if (!task.GetDependencies().empty()) {
+        task_dependency_manager_.RemoveTaskDependencies(task_id);
+      }
+      cluster_resource_scheduler_->ReleaseWorkerResources(work_it->second);
+      RemoveFromBacklogTracker(task);
+      ReplyCancelled(work_it->first);
+      reserved_gang_work_.erase(work_it);
+      return true;
+    }
+  }
   for (auto shapes_it = tasks_to_schedule_.begin(); shapes_it != tasks_to_schedule_.end();
        shapes_it++) {
     auto &work_queue = shapes_it->second;
@@ -470,21 +1265,27 @@ bool ClusterTaskManager::CancelTask(const TaskID &task_id) {
   }
   for (auto shapes_it = tasks_to_dispatch_.begin(); shapes_it != tasks_to_dispatch_.end();
        shapes_it++) {
-    auto &work_queue = shapes_it->second;
-    for (auto work_it = work_queue.begin(); work_it != work_queue.end(); work_it++) {
-      const auto &task = std::get<0>(*work_it);
-      if (task.GetTaskSpecification().TaskId() == task_id) {
-        RemoveFromBacklogTracker(task);
-        ReplyCancelled(*work_it);
-        if (!task.GetTaskSpecification().GetDependencies().empty()) {
-          task_dependency_manager_.RemoveTaskDependencies(
-              task.GetTaskSpecification().TaskId());
+    auto &job_queues = shapes_it->second;
+    for (auto job_it = job_queues.begin(); job_it != job_queues.end(); job_it++) {
+      auto &work_queue = job_it->second;
+      for (auto work_it = work_queue.begin(); work_it != work_queue.end(); work_it++) {
+        const auto &task = std::get<0>(*work_it);
+        if (task.GetTaskSpecification().TaskId() == task_id) {
+          RemoveFromBacklogTracker(task);
+          ReplyCancelled(*work_it);
+          if (!task.GetTaskSpecification().GetDependencies().empty()) {
+            task_dependency_manager_.RemoveTaskDependencies(
+                task.GetTaskSpecification().TaskId());
+          }
+          work_queue.erase(work_it);
+          if (work_queue.empty()) {
+            job_queues.erase(job_it);
+            if (job_queues.empty()) {
+              tasks_to_dispatch_.erase(shapes_it);
+            }
+          }
+          return true;
         }
-        work_queue.erase(work_it);
-        if (work_queue.empty()) {
-          tasks_to_dispatch_.erase(shapes_it);
-        }
-        return true;
       }
     }
   }
@@ -542,9 +1343,17 @@ void ClusterTaskManager::FillPendingActorInfo(rpc::GetNodeStatsReply *reply) con
   }
   // Report actors blocked on resources.
   num_reported = 0;
-  for (const auto &shapes_it : boost::join(tasks_to_dispatch_, tasks_to_schedule_)) {
-    auto &work_queue = shapes_it.second;
-    for (const auto &work_it : work_queue) {
+  std::vector<const std::deque<Work> *> work_queues;
+  for (const auto &shapes_it : tasks_to_dispatch_) {
+    for (const auto &job_queue : shapes_it.second) {
+      work_queues.push_back(&job_queue.second);
+    }
+  }
+  for (const auto &shapes_it : tasks_to_schedule_) {
+    work_queues.push_back(&shapes_it.second);
+  }
+  for (const auto *work_queue : work_queues) {
+    for (const auto &work_it : *work_queue) {
       Task task = std::get<0>(work_it);
       if (task.GetTaskSpecification().IsActorCreationTask()) {
         if (num_reported++ > kMaxPendingActorsToReport) {
@@ -582,9 +1391,9 @@ void ClusterTaskManager::FillResourceUsage(rpc::ResourcesData &data) {
     if (it != tasks_to_schedule_.end()) {
       count += it->second.size();
     }
-    it = tasks_to_dispatch_.find(one_cpu_scheduling_cls);
-    if (it != tasks_to_dispatch_.end()) {
-      count += it->second.size();
+    auto dispatch_it = tasks_to_dispatch_.find(one_cpu_scheduling_cls);
+    if (dispatch_it != tasks_to_dispatch_.end()) {
+      count += NumQueued(dispatch_it->second);
     }
 
     if (count > 0) {
@@ -664,8 +1473,7 @@ void ClusterTaskManager::FillResourceUsage(rpc::ResourcesData &data) {
     const auto &resources =
         TaskSpecification::GetSchedulingClassDescriptor(scheduling_class)
             .GetResourceMap();
-    const auto &queue = pair.second;
-    const auto &count = queue.size();
+    const auto count = NumQueued(pair.second);
 
     auto by_shape_entry = resource_load_by_shape->Add();
 
@@ -732,8 +1540,7 @@ bool ClusterTaskManager::AnyPendingTasks(Task *exemplar, bool *any_pending,
   // We are guaranteed that these tasks are blocked waiting for resources after a
   // call to ScheduleAndDispatchTasks(). They may be waiting for workers as well, but
   // this should be a transient condition only.
-  for (const auto &shapes_it : boost::join(tasks_to_dispatch_, tasks_to_schedule_)) {
-    auto &work_queue = shapes_it.second;
+  auto count_pending = [&](const std::deque<Work> &work_queue) {
     for (const auto &work_it : work_queue) {
       const auto &task = std::get<0>(work_it);
       if (task.GetTaskSpecification().IsActorCreationTask()) {
@@ -747,6 +1554,14 @@ bool ClusterTaskManager::AnyPendingTasks(Task *exemplar, bool *any_pending,
         *any_pending = true;
       }
     }
+  };
+  for (const auto &shapes_it : tasks_to_dispatch_) {
+    for (const auto &job_queue : shapes_it.second) {
+      count_pending(job_queue.second);
+    }
+  }
+  for (const auto &shapes_it : tasks_to_schedule_) {
+    count_pending(shapes_it.second);
   }
   // If there's any pending task, at this point, there's no progress being made.
   return *any_pending;
@@ -762,14 +1577,20 @@ std::string ClusterTaskManager::DebugStr() const {
       infeasible_tasks_.begin(), infeasible_tasks_.end(), (size_t)0, accumulator);
   size_t num_tasks_to_schedule = std::accumulate(
       tasks_to_schedule_.begin(), tasks_to_schedule_.end(), (size_t)0, accumulator);
-  size_t num_tasks_to_dispatch = std::accumulate(
-      tasks_to_dispatch_.begin(), tasks_to_dispatch_.end(), (size_t)0, accumulator);
+  size_t num_tasks_to_dispatch = 0;
+  for (const auto &pair : tasks_to_dispatch_) {
+    num_tasks_to_dispatch += NumQueued(pair.second);
+  }
   std::stringstream buffer;
   buffer << "========== Node: " << self_node_id_ << " =================\n";
   buffer << "Infeasible queue length: " << num_infeasible_tasks << "\n";
   buffer << "Schedule queue length: " << num_tasks_to_schedule << "\n";
   buffer << "Dispatch queue length: " << num_tasks_to_dispatch << "\n";
   buffer << "Waiting tasks size: " << waiting_tasks_index_.size() << "\n";
+  buffer << "Pending gangs: " << pending_gangs_.size() << "\n";
+  buffer << "Reserved gang tasks waiting for workers: " << reserved_gang_work_.size()
+         << "\n";
+  buffer << "Gang reservations for other nodes: " << gang_reservations_.size() << "\n";
   buffer << "Number of executing tasks: " << executing_task_args_.size() << "\n";
   buffer << "Number of pinned task arguments: " << pinned_task_arguments_.size() << "\n";
   buffer << "cluster_resource_scheduler state: "
@@ -792,6 +1613,44 @@ void ClusterTaskManager::RecordMetrics() {
     num_infeasible_tasks += pair.second.size();
   }
   stats::NumInfeasibleTasks.Record(num_infeasible_tasks);
+
+  // Also report the running jobs that hold no resources, so that their usage drops to
+  // zero once their workers return.
+  auto job_usage = GetJobUsage();
+  for (const auto &entry : job_weights_) {
+    job_usage[entry.first];
+  }
+  for (const auto &entry : job_usage) {
+    RecordJobMetrics(entry.first, entry.second, DominantShare(entry.first, entry.second));
+  }
+}
+
+void ClusterTaskManager::RecordJobMetrics(const JobID &job_id, const JobUsage &usage,
+                                          double dominant_share) const {
+  const auto job_id_hex = job_id.Hex();
+  for (int resource : {CPU, MEM, GPU}) {
+    stats::JobResourceUsage.Record(
+        usage[resource],
+        {{stats::JobIdKey, job_id_hex},
+         {stats::ResourceNameKey,
+          ResourceEnumToString(static_cast<PredefinedResources>(resource))}});
+  }
+  stats::JobDominantShare.Record(dominant_share, {{stats::JobIdKey, job_id_hex}});
+}
+
+void ClusterTaskManager::HandleJobStarted(const JobID &job_id,
+                                          const rpc::JobConfig &job_config) {
+  if (job_config.scheduling_weight() > 0) {
+    job_weights_[job_id] = job_config.scheduling_weight();
+  } else {
+    job_weights_[job_id] = 1;
+  }
+}
+
+void ClusterTaskManager::HandleJobFinished(const JobID &job_id) {
+  // The gauges keep their last values, so reset them for the job that is gone.
+  RecordJobMetrics(job_id, JobUsage{}, 0);
+  job_weights_.erase(job_id);
 }
 
 void ClusterTaskManager::TryLocalInfeasibleTaskScheduling() {
@@ -806,14 +1665,12 @@ void ClusterTaskManager::TryLocalInfeasibleTaskScheduling() {
     Task task = std::get<0>(work);
     RAY_LOG(DEBUG) << "Check if the infeasible task is schedulable in any node. task_id:"
                    << task.GetTaskSpecification().TaskId();
-    auto placement_resources =
-        task.GetTaskSpecification().GetRequiredPlacementResources().GetResourceMap();
     // This argument is used to set violation, which is an unsupported feature now.
     int64_t _unused;
     bool is_infeasible;
     std::string node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
-        placement_resources, task.GetTaskSpecification().IsActorCreationTask(),
-        /*force_spillback=*/false, &_unused, &is_infeasible);
+        task.GetTaskSpecification(), /*force_spillback=*/false, &_unused,
+        &is_infeasible);
 
     // There is no node that has available resources to run the request.
     // Move on to the next shape.
@@ -910,15 +1767,17 @@ void ClusterTaskManager::Dispatch(
   send_reply_callback();
 }
 
-void ClusterTaskManager::Spillback(const NodeID &spillback_to, const Work &work) {
+void ClusterTaskManager::Spillback(const NodeID &spillback_to, const Work &work,
+                                   bool allocate_remote_resources) {
   metric_tasks_spilled_++;
   const auto &task = std::get<0>(work);
   const auto &task_spec = task.GetTaskSpecification();
   RemoveFromBacklogTracker(task);
   RAY_LOG(DEBUG) << "Spilling task " << task_spec.TaskId() << " to node " << spillback_to;
 
-  if (!cluster_resource_scheduler_->AllocateRemoteTaskResources(
-          spillback_to.Binary(), task_spec.GetRequiredResources().GetResourceMap())) {
+  if (allocate_remote_resources &&
+      !cluster_resource_scheduler_->AllocateRemoteTaskResources(
+          spillback_to.Binary(), task_spec.GetRequiredResources())) {
     RAY_LOG(INFO) << "Tried to allocate resources for request " << task_spec.TaskId()
                   << " on a remote node that are no longer available";
   }
@@ -1024,6 +1883,9 @@ bool ClusterTaskManager::ReturnCpuResourcesToBlockedWorker(
 }
 
 void ClusterTaskManager::ScheduleAndDispatchTasks() {
+  // Gangs go first, since they need room for all of their tasks at once.
+  ScheduleGangs();
+  DispatchReservedGangWork();
   SchedulePendingTasks();
   DispatchScheduledTasksToWorkers(worker_pool_, leased_workers_);
   // TODO(swang): Spill from waiting queue first? Otherwise, we may end up
@@ -1057,16 +1919,14 @@ void ClusterTaskManager::SpillWaitingTasks() {
     bool force_spillback = task_dependency_manager_.TaskDependenciesBlocked(task_id);
     RAY_LOG(DEBUG) << "Attempting to spill back waiting task " << task_id
                    << " to remote node. Force spillback? " << force_spillback;
-    auto placement_resources =
-        task.GetTaskSpecification().GetRequiredPlacementResources().GetResourceMap();
     int64_t _unused;
     bool is_infeasible;
     // TODO(swang): The policy currently does not account for object store
     // memory availability. Ideally, we should pick the node with the most
     // memory availability.
     std::string node_id_string = cluster_resource_scheduler_->GetBestSchedulableNode(
-        placement_resources, task.GetTaskSpecification().IsActorCreationTask(),
-        /*force_spillback=*/force_spillback, &_unused, &is_infeasible);
+        task.GetTaskSpecification(), /*force_spillback=*/force_spillback, &_unused,
+        &is_infeasible);
     if (!node_id_string.empty() && node_id_string != self_node_id_.Binary()) {
       NodeID node_id = NodeID::FromBinary(node_id_string);
       Spillback(node_id, *it);
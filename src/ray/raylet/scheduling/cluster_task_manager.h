@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "ray/common/ray_object.h"
@@ -13,6 +15,7 @@
 #include "ray/rpc/grpc_client.h"
 #include "ray/rpc/node_manager/node_manager_client.h"
 #include "ray/rpc/node_manager/node_manager_server.h"
+#include "ray/util/util.h"
 
 namespace ray {
 namespace raylet {
@@ -22,9 +25,25 @@ namespace raylet {
 /// dispatch/spillback and the callback to trigger it.
 typedef std::tuple<Task, rpc::RequestWorkerLeaseReply *, std::function<void(void)>> Work;
 
+/// The queues of the lease requests of one shape that are ready to be dispatched, one
+/// per job, in the order in which the jobs queued their first request.
+typedef std::vector<std::pair<JobID, std::deque<Work>>> JobQueues;
+
 typedef std::function<boost::optional<rpc::GcsNodeInfo>(const NodeID &node_id)>
     NodeInfoGetter;
 
+/// Asks a remote raylet to reserve resources for some leases of a gang, all or none,
+/// under a reservation ID. The callback is called asynchronously with whether the
+/// raylet reserved them.
+typedef std::function<void(const NodeID &node_id, const TaskID &reservation_id,
+                           const TaskSpecification &resource_spec, int64_t num_leases,
+                           std::function<void(bool)> callback)>
+    PrepareGangLeasesFn;
+
+/// Asks a remote raylet to release a reservation made through PrepareGangLeasesFn.
+typedef std::function<void(const NodeID &node_id, const TaskID &reservation_id)>
+    CancelGangLeasesFn;
+
 /// Manages the queuing and dispatching of tasks. The logic is as follows:
 /// 1. Queue tasks for scheduling.
 /// 2. Pick a node on the cluster which has the available resources to run a
@@ -53,6 +72,14 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// \param is_owner_alive: A callback which returns if the owner process is alive
   /// (according to our ownership model).
   /// \param gcs_client: A gcs client.
+  /// \param delay_executor: Runs a function after a delay in milliseconds. It is used to
+  /// retry gangs that could not be reserved.
+  /// \param get_time_ms: Returns the current time in milliseconds.
+  /// \param preempt_worker: Kills a leased worker so that its resources go to a task of
+  /// a higher priority. If null, tasks are never preempted.
+  /// \param prepare_gang_leases: Reserves resources on a remote node for the leases of
+  /// a gang that are spilled back there. If null, gangs only run on this node.
+  /// \param cancel_gang_leases: Releases a reservation made by prepare_gang_leases.
   ClusterTaskManager(
       const NodeID &self_node_id,
       std::shared_ptr<ClusterResourceScheduler> cluster_resource_scheduler,
@@ -65,7 +92,12 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
       std::function<bool(const std::vector<ObjectID> &object_ids,
                          std::vector<std::unique_ptr<RayObject>> *results)>
           get_task_arguments,
-      size_t max_pinned_task_arguments_bytes);
+      size_t max_pinned_task_arguments_bytes,
+      std::function<void(std::function<void()>, int64_t)> delay_executor = nullptr,
+      std::function<int64_t()> get_time_ms = current_time_ms,
+      std::function<void(std::shared_ptr<WorkerInterface>)> preempt_worker = nullptr,
+      PrepareGangLeasesFn prepare_gang_leases = nullptr,
+      CancelGangLeasesFn cancel_gang_leases = nullptr);
 
   /// (Step 1) Queue tasks and schedule.
   /// Queue task and schedule. This hanppens when processing the worker lease request.
@@ -76,6 +108,76 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   void QueueAndScheduleTask(const Task &task, rpc::RequestWorkerLeaseReply *reply,
                             rpc::SendReplyCallback send_reply_callback) override;
 
+  /// (Step 1) Queue a batch of tasks of the same shape and schedule them once.
+  /// The first task stays queued like a regular lease request. The other tasks
+  /// that could not be granted or spilled back right away stay queued only while
+  /// this node has resources for them and they wait for a worker to start, as on a
+  /// node that has no idle workers yet. The rest are replied to as canceled.
+  ///
+  /// There is a single reply for the batch, which is sent once every task has been
+  /// granted, spilled back or canceled. The leases granted first are therefore held
+  /// back until the workers of the last ones have started.
+  ///
+  /// \param tasks: The incoming tasks to be queued and scheduled.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every task is resolved.
+  void QueueAndScheduleTasks(const std::vector<Task> &tasks,
+                             rpc::RequestWorkerLeasesReply *reply,
+                             rpc::SendReplyCallback send_reply_callback) override;
+
+  /// (Step 1) Queue a gang of lease requests that must run at the same time, such as
+  /// the workers of one step of a collective operation, and schedule it. Once there
+  /// is room for every lease of the gang in this node's view of the cluster, resources
+  /// are reserved for all of them in two phases: they are allocated on the local node
+  /// and each remote node is asked to reserve its leases through PrepareGangLeases.
+  /// Only if every remote node agrees are the local leases queued for dispatch and the
+  /// others spilled back with the ID of their reservation. Otherwise the prepared
+  /// reservations are canceled. Until then, no lease of the gang is granted. A gang
+  /// that cannot be reserved is retried with exponential backoff, and all of its
+  /// leases are canceled once it times out.
+  ///
+  /// Reserved leases keep their resources while their arguments are fetched and
+  /// pinned, and are granted once the arguments are local.
+  ///
+  /// \param tasks: The incoming tasks of the gang.
+  /// \param timeout_ms: How long to try to reserve resources for the whole gang.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every lease has been resolved.
+  void QueueAndScheduleGang(const std::vector<Task> &tasks, int64_t timeout_ms,
+                            rpc::RequestWorkerLeasesReply *reply,
+                            rpc::SendReplyCallback send_reply_callback) override;
+
+  /// Reserve resources on this node for leases of a gang that another raylet
+  /// schedules, all or none. The reservation is released if no lease request claims
+  /// it within gang_lease_reservation_timeout_ms.
+  ///
+  /// \param reservation_id: The ID under which to hold the resources.
+  /// \param resource_spec: The task spec with the resources of each lease.
+  /// \param num_leases: The number of leases to reserve resources for.
+  /// \return True if resources were reserved for all of the leases.
+  bool PrepareGangLeases(const TaskID &reservation_id,
+                         const TaskSpecification &resource_spec,
+                         int64_t num_leases) override;
+
+  /// Release a reservation made by PrepareGangLeases, if it was not claimed yet.
+  ///
+  /// \param reservation_id: The ID of the reservation.
+  void CancelGangLeases(const TaskID &reservation_id) override;
+
+  /// (Step 1) Queue the leases of a gang that another raylet spilled back to this
+  /// node, with the resources of their reservation. The leases are granted once their
+  /// arguments are local and there are workers for them. If the reservation is gone,
+  /// the leases are canceled.
+  ///
+  /// \param reservation_id: The reservation made by PrepareGangLeases.
+  /// \param tasks: The incoming tasks.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every lease has been resolved.
+  void QueueAndScheduleReservedGang(const TaskID &reservation_id,
+                                    const std::vector<Task> &tasks,
+                                    rpc::RequestWorkerLeasesReply *reply,
+                                    rpc::SendReplyCallback send_reply_callback) override;
+
   /// Move tasks from waiting to ready for dispatch. Called when a task's
   /// dependencies are resolved.
   ///
@@ -163,7 +265,17 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// Calculate normal task resources.
   ResourceSet CalcNormalTaskResources() const override;
 
+  /// Handle the start of a job and remember its scheduling weight.
+  void HandleJobStarted(const JobID &job_id, const rpc::JobConfig &job_config) override;
+
+  /// Handle the end of a job.
+  void HandleJobFinished(const JobID &job_id) override;
+
  private:
+  /// The CPU, memory and GPU that the workers of a job hold on this node, indexed by
+  /// PredefinedResources.
+  using JobUsage = std::array<double, PredefinedResources_MAX>;
+
   /// (Step 2) For each task in tasks_to_schedule_, pick a node in the system
   /// (local or remote) that has enough resources available to run the task, if
   /// any such node exist. Skip tasks which are not schedulable.
@@ -175,6 +287,10 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// will be dispatched if it is on `tasks_to_dispatch_` and there are still
   /// available resources on the node.
   ///
+  /// Tasks of higher priorities are dispatched first. Among the tasks of the same
+  /// priority, the next task comes from the job with the lowest dominant share of the
+  /// node (DRF), weighted by the scheduling weights of the jobs.
+  ///
   /// If there are not enough resources locally, up to one task per resource
   /// shape (the task at the head of the queue) will get spilled back to a
   /// different node.
@@ -190,6 +306,100 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// the available resources).
   bool TrySpillback(const Work &spec, bool &is_infeasible);
 
+  /// Add a lease request to the scheduling (or infeasible) queue of its shape.
+  void QueueWork(const Work &work);
+
+  /// A gang of lease requests that are granted all or nothing.
+  struct Gang {
+    std::vector<Work> work;
+    /// When the leases are canceled if the gang could not be reserved by then.
+    int64_t deadline_ms;
+    /// When to try to reserve the gang next.
+    int64_t next_attempt_ms;
+    /// How long to wait after the next failed attempt.
+    int64_t backoff_ms;
+    /// The ID of the current attempt to reserve the gang, which the replies of the
+    /// remote nodes refer to.
+    TaskID attempt_id;
+    /// The resources allocated for each task in the current attempt: on this node, or
+    /// if null, in the view of remote_nodes[i].
+    std::vector<std::shared_ptr<TaskResourceInstances>> allocations;
+    std::vector<std::string> remote_nodes;
+    /// The reservation that each remote node is asked to prepare, and whether it did.
+    absl::flat_hash_map<std::string, std::pair<TaskID, bool>> reservations;
+    /// The number of remote nodes that have not replied yet.
+    size_t num_pending_prepares = 0;
+  };
+
+  /// Try to reserve every pending gang whose backoff has passed, and cancel the gangs
+  /// that timed out.
+  void ScheduleGangs();
+
+  /// Allocate resources for all the leases of a gang, or for none of them, and ask the
+  /// remote nodes that get some of the leases to reserve them.
+  ///
+  /// \return True if all of the leases were allocated.
+  bool TryReserveGang(Gang &gang);
+
+  /// Handle the reply of a remote node to the request to reserve its gang leases.
+  void HandleGangLeasesPrepared(const TaskID &attempt_id, const std::string &node_id,
+                                const TaskID &reservation_id, bool success);
+
+  /// Grant the leases of a gang whose resources are reserved everywhere: queue the
+  /// local leases in reserved_gang_work_ and spill back the others.
+  void CommitGang(Gang &gang);
+
+  /// Release the resources of the current attempt to reserve a gang, including the
+  /// reservations that remote nodes prepared.
+  void AbortGangAttempt(Gang &gang);
+
+  /// Wait before the next attempt to reserve a gang, and make sure it happens.
+  void BackOffGang(Gang &gang, int64_t now_ms);
+
+  /// Queue a gang lease whose resources are reserved on this node until its arguments
+  /// are local and there is a worker for it.
+  void QueueReservedGangWork(const Work &work,
+                             std::shared_ptr<TaskResourceInstances> allocation);
+
+  /// Grant the reserved gang leases whose arguments are local and for which there are
+  /// workers.
+  void DispatchReservedGangWork();
+
+  /// Reply to all the leases of a pending gang as canceled.
+  void CancelGang(const Gang &gang);
+
+  /// Queue a task behind the tasks of the same or a higher priority.
+  void InsertByPriority(std::deque<Work> &queue, const Work &work);
+
+  /// Queue a task whose arguments are local in the dispatch queue of its job.
+  void QueueForDispatch(const Work &work);
+
+  /// Sum the resources that the leased workers of each job hold on this node.
+  absl::flat_hash_map<JobID, JobUsage> GetJobUsage() const;
+
+  /// The largest fraction of this node's CPU, memory or GPU that a job holds, divided
+  /// by the scheduling weight of the job.
+  double DominantShare(const JobID &job_id, const JobUsage &usage) const;
+
+  /// Record the resource usage and the dominant share of a job in its gauges.
+  void RecordJobMetrics(const JobID &job_id, const JobUsage &usage,
+                        double dominant_share) const;
+
+  /// Preempt a leased worker that runs a retriable task of a lower priority than a
+  /// task that cannot get resources, so that the task can run once the worker exits.
+  /// At most one worker is preempted at a time.
+  void PreemptLowerPriorityTask(const TaskSpecification &spec);
+
+  /// \return Whether a task waits in tasks_to_dispatch_ for a worker or for resources
+  /// on this node.
+  bool IsQueuedForDispatch(const TaskSpecification &spec) const;
+
+  /// Cancel a task that is still queued, like CancelTask, but search the
+  /// queues from the back since the task was queued recently.
+  ///
+  /// \return True if the task was canceled.
+  bool CancelRecentlyQueuedTask(const Task &task);
+
   /// Helper method to try dispatching a single task from the queue to an
   /// available worker. Returns whether the task should be removed from the
   /// queue and whether the worker was successfully leased to execute the work.
@@ -232,7 +442,10 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// All tasks in this map that have dependencies should be registered with
   /// the dependency manager, in case a dependency gets evicted while the task
   /// is still queued.
-  std::unordered_map<SchedulingClass, std::deque<Work>> tasks_to_dispatch_;
+  std::unordered_map<SchedulingClass, JobQueues> tasks_to_dispatch_;
+
+  /// The scheduling weights of the running jobs. Other jobs have a weight of 1.
+  absl::flat_hash_map<JobID, double> job_weights_;
 
   /// Tasks waiting for arguments to be transferred locally.
   /// Tasks move from waiting -> dispatch.
@@ -259,6 +472,40 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
   /// Tasks go between scheduling <-> infeasible.
   std::unordered_map<SchedulingClass, std::deque<Work>> infeasible_tasks_;
 
+  /// Gangs that are waiting for room for all of their leases, in the order in which
+  /// they arrived.
+  std::list<Gang> pending_gangs_;
+
+  /// Gang leases that hold resources on this node and wait for their arguments and a
+  /// worker.
+  std::deque<std::pair<Work, std::shared_ptr<TaskResourceInstances>>>
+      reserved_gang_work_;
+
+  /// Resources reserved on this node for the leases of gangs that other raylets
+  /// schedule, until lease requests claim them.
+  absl::flat_hash_map<TaskID, std::vector<std::shared_ptr<TaskResourceInstances>>>
+      gang_reservations_;
+
+  /// Runs a function after a delay, used to retry gangs.
+  std::function<void(std::function<void()>, int64_t)> delay_executor_;
+
+  /// Returns the current time in milliseconds.
+  std::function<int64_t()> get_time_ms_;
+
+  const int64_t gang_initial_backoff_ms_;
+  const int64_t gang_max_backoff_ms_;
+  const int64_t gang_reservation_timeout_ms_;
+
+  /// Ask remote raylets to reserve or release resources for gang leases.
+  PrepareGangLeasesFn prepare_gang_leases_;
+  CancelGangLeasesFn cancel_gang_leases_;
+
+  /// Kills a leased worker to free its resources for a task of a higher priority.
+  std::function<void(std::shared_ptr<WorkerInterface>)> preempt_worker_;
+
+  /// The preempted workers that have not returned their resources yet.
+  absl::flat_hash_set<WorkerID> preempted_workers_;
+
   /// Track the cumulative backlog of all workers requesting a lease to this raylet.
   std::unordered_map<SchedulingClass, int> backlog_tracker_;
 
@@ -309,7 +556,12 @@ class ClusterTaskManager : public ClusterTaskManagerInterface {
       std::shared_ptr<TaskResourceInstances> &allocated_instances, const Task &task,
       rpc::RequestWorkerLeaseReply *reply, std::function<void(void)> send_reply_callback);
 
-  void Spillback(const NodeID &spillback_to, const Work &work);
+  /// Reply to a lease request with the node to retry it at.
+  ///
+  /// \param allocate_remote_resources: Whether to subtract the task's resources from
+  /// our view of the node. It is false if they were already subtracted.
+  void Spillback(const NodeID &spillback_to, const Work &work,
+                 bool allocate_remote_resources = true);
 
   void AddToBacklogTracker(const Task &task);
   void RemoveFromBacklogTracker(const Task &task);
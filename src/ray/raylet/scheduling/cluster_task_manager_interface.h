@@ -16,6 +16,7 @@
 
 #include "ray/raylet/worker.h"
 #include "ray/rpc/server_call.h"
+#include "src/ray/protobuf/gcs.pb.h"
 #include "src/ray/protobuf/node_manager.pb.h"
 
 namespace ray {
@@ -99,6 +100,55 @@ class ClusterTaskManagerInterface {
   virtual void QueueAndScheduleTask(const Task &task, rpc::RequestWorkerLeaseReply *reply,
                                     rpc::SendReplyCallback send_reply_callback) = 0;
 
+  /// Queue a batch of lease requests of the same shape and schedule them in one pass.
+  /// This happens when processing a batched worker lease request.
+  ///
+  /// \param tasks: The incoming tasks to be queued and scheduled.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every lease has been resolved.
+  virtual void QueueAndScheduleTasks(const std::vector<Task> &tasks,
+                                     rpc::RequestWorkerLeasesReply *reply,
+                                     rpc::SendReplyCallback send_reply_callback) = 0;
+
+  /// Queue a gang of lease requests that are granted all or nothing. This happens when
+  /// processing a batched worker lease request for a gang.
+  ///
+  /// \param tasks: The incoming tasks of the gang.
+  /// \param timeout_ms: How long to try to reserve resources for the whole gang.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every lease has been resolved.
+  virtual void QueueAndScheduleGang(const std::vector<Task> &tasks, int64_t timeout_ms,
+                                    rpc::RequestWorkerLeasesReply *reply,
+                                    rpc::SendReplyCallback send_reply_callback) = 0;
+
+  /// Reserve resources on this node for leases of a gang that another raylet
+  /// schedules, all or none.
+  ///
+  /// \param reservation_id: The ID under which to hold the resources.
+  /// \param resource_spec: The task spec with the resources of each lease.
+  /// \param num_leases: The number of leases to reserve resources for.
+  /// \return True if resources were reserved for all of the leases.
+  virtual bool PrepareGangLeases(const TaskID &reservation_id,
+                                 const TaskSpecification &resource_spec,
+                                 int64_t num_leases) = 0;
+
+  /// Release a reservation made by PrepareGangLeases, if it was not claimed yet.
+  ///
+  /// \param reservation_id: The ID of the reservation.
+  virtual void CancelGangLeases(const TaskID &reservation_id) = 0;
+
+  /// Queue the leases of a gang that another raylet spilled back to this node, with
+  /// the resources of their reservation.
+  ///
+  /// \param reservation_id: The reservation made by PrepareGangLeases.
+  /// \param tasks: The incoming tasks.
+  /// \param reply: The reply of the batched lease request.
+  /// \param send_reply_callback: The function used once every lease has been resolved.
+  virtual void QueueAndScheduleReservedGang(
+      const TaskID &reservation_id, const std::vector<Task> &tasks,
+      rpc::RequestWorkerLeasesReply *reply,
+      rpc::SendReplyCallback send_reply_callback) = 0;
+
   /// Return if any tasks are pending resource acquisition.
   ///
   /// \param[in] exemplar An example task that is deadlocking.
@@ -118,6 +168,19 @@ class ClusterTaskManagerInterface {
 
   /// Calculate normal task resources.
   virtual ResourceSet CalcNormalTaskResources() const = 0;
+
+  /// Handle the start of a job. Jobs that compete for this node's resources get them in
+  /// proportion to the scheduling weights in their configs.
+  ///
+  /// \param job_id: The job that started.
+  /// \param job_config: The config of the job.
+  virtual void HandleJobStarted(const JobID &job_id,
+                                const rpc::JobConfig &job_config) = 0;
+
+  /// Handle the end of a job.
+  ///
+  /// \param job_id: The job that finished.
+  virtual void HandleJobFinished(const JobID &job_id) = 0;
 };
 }  // namespace raylet
 }  // namespace ray
@@ -104,6 +104,23 @@ Task CreateTask(const std::unordered_map<std::string, double> &required_resource
   return Task(spec_builder.Build(), TaskExecutionSpecification(execution_spec_message));
 }
 
+Task CreateTaskWithPriority(const std::unordered_map<std::string, double> &resources,
+                            int32_t priority, int32_t max_retries = 0) {
+  Task task = CreateTask(resources);
+  rpc::TaskSpec spec_message = task.GetTaskSpecification().GetMessage();
+  spec_message.set_priority(priority);
+  spec_message.set_max_retries(max_retries);
+  return Task(TaskSpecification(std::move(spec_message)), task.GetTaskExecutionSpec());
+}
+
+Task CreateTaskForJob(const std::unordered_map<std::string, double> &resources,
+                      const JobID &job_id) {
+  Task task = CreateTask(resources);
+  rpc::TaskSpec spec_message = task.GetTaskSpecification().GetMessage();
+  spec_message.set_job_id(job_id.Binary());
+  return Task(TaskSpecification(std::move(spec_message)), task.GetTaskExecutionSpec());
+}
+
 class MockTaskDependencyManager : public TaskDependencyManagerInterface {
  public:
   MockTaskDependencyManager(std::unordered_set<ObjectID> &missing_objects)
@@ -167,7 +184,27 @@ class ClusterTaskManagerTest : public ::testing::Test {
                         }
                         return true;
                       },
-                      /*max_pinned_task_arguments_bytes=*/1000) {}
+                      /*max_pinned_task_arguments_bytes=*/1000,
+                      /*delay_executor=*/
+                      [this](std::function<void()> fn, int64_t delay_ms) {
+                        delayed_calls_.emplace_back(fn, delay_ms);
+                      },
+                      /*get_time_ms=*/[this] { return current_time_ms_; },
+                      /*preempt_worker=*/
+                      [this](std::shared_ptr<WorkerInterface> worker) {
+                        preempted_workers_.push_back(worker);
+                      },
+                      /*prepare_gang_leases=*/
+                      [this](const NodeID &node_id, const TaskID &reservation_id,
+                             const TaskSpecification &resource_spec, int64_t num_leases,
+                             std::function<void(bool)> callback) {
+                        prepare_requests_.push_back(
+                            {node_id, reservation_id, num_leases, callback});
+                      },
+                      /*cancel_gang_leases=*/
+                      [this](const NodeID &node_id, const TaskID &reservation_id) {
+                        canceled_reservations_.emplace_back(node_id, reservation_id);
+                      }) {}
 
   RayObject *MakeDummyArg() {
     std::vector<uint8_t> data;
@@ -202,6 +239,37 @@ class ClusterTaskManagerTest : public ::testing::Test {
     ASSERT_TRUE(task_manager_.pinned_task_arguments_.empty());
     ASSERT_EQ(task_manager_.pinned_task_arguments_bytes_, 0);
     ASSERT_TRUE(dependency_manager_.subscribed_tasks.empty());
+    ASSERT_TRUE(task_manager_.pending_gangs_.empty());
+    ASSERT_TRUE(task_manager_.reserved_gang_work_.empty());
+    ASSERT_TRUE(task_manager_.gang_reservations_.empty());
+  }
+
+  size_t NumPendingGangs() { return task_manager_.pending_gangs_.size(); }
+
+  size_t NumReservedGangTasks() { return task_manager_.reserved_gang_work_.size(); }
+
+  /// Create tasks of the same shape with different task IDs.
+  std::vector<Task> CreateGang(const std::unordered_map<std::string, double> &resources,
+                               int num_tasks, int num_args = 0) {
+    Task first_task = CreateTask(resources, num_args);
+    std::vector<Task> tasks;
+    for (int i = 0; i < num_tasks; i++) {
+      rpc::TaskSpec spec_message = first_task.GetTaskSpecification().GetMessage();
+      spec_message.set_task_id(RandomTaskId().Binary());
+      tasks.emplace_back(TaskSpecification(std::move(spec_message)),
+                         first_task.GetTaskExecutionSpec());
+    }
+    return tasks;
+  }
+
+  /// Advance the clock and run the delayed calls that are due.
+  void AdvanceTime(int64_t delta_ms) {
+    current_time_ms_ += delta_ms;
+    auto calls = std::move(delayed_calls_);
+    delayed_calls_.clear();
+    for (auto &call : calls) {
+      call.first();
+    }
   }
 
   void AssertPinnedTaskArgumentsPresent(const Task &task) {
@@ -224,6 +292,17 @@ class ClusterTaskManagerTest : public ::testing::Test {
 
   int node_info_calls_;
   int announce_infeasible_task_calls_;
+  int64_t current_time_ms_ = 0;
+  std::vector<std::pair<std::function<void()>, int64_t>> delayed_calls_;
+  std::vector<std::shared_ptr<WorkerInterface>> preempted_workers_;
+  struct PrepareRequest {
+    NodeID node_id;
+    TaskID reservation_id;
+    int64_t num_leases;
+    std::function<void(bool)> callback;
+  };
+  std::vector<PrepareRequest> prepare_requests_;
+  std::vector<std::pair<NodeID, TaskID>> canceled_reservations_;
   std::unordered_map<NodeID, boost::optional<rpc::GcsNodeInfo>> node_info_;
 
   MockTaskDependencyManager dependency_manager_;
@@ -270,6 +349,371 @@ TEST_F(ClusterTaskManagerTest, BasicTest) {
   AssertNoLeaks();
 }
 
+TEST_F(ClusterTaskManagerTest, BatchedLeaseTest) {
+  /*
+    Test that a batch of lease requests of the same shape is granted as far as
+    the node's resources and workers allow, and that the rest of the batch is
+    returned as canceled in the same reply.
+   */
+  Task first_task = CreateTask({{ray::kCPU_ResourceLabel, 4}});
+  std::vector<Task> tasks;
+  for (int i = 0; i < 3; i++) {
+    rpc::TaskSpec spec_message = first_task.GetTaskSpecification().GetMessage();
+    if (i > 0) {
+      spec_message.set_task_id(RandomTaskId().Binary());
+    }
+    tasks.emplace_back(TaskSpecification(std::move(spec_message)),
+                       first_task.GetTaskExecutionSpec());
+  }
+
+  for (int i = 0; i < 2; i++) {
+    std::shared_ptr<MockWorker> worker =
+        std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234 + i);
+    pool_.PushWorker(std::static_pointer_cast<WorkerInterface>(worker));
+  }
+
+  rpc::RequestWorkerLeasesReply reply;
+  int num_callbacks = 0;
+  int *num_callbacks_ptr = &num_callbacks;
+  auto callback = [num_callbacks_ptr](Status, std::function<void()>,
+                                      std::function<void()>) {
+    (*num_callbacks_ptr) = *num_callbacks_ptr + 1;
+  };
+
+  task_manager_.QueueAndScheduleTasks(tasks, &reply, callback);
+
+  ASSERT_EQ(num_callbacks, 1);
+  ASSERT_EQ(leased_workers_.size(), 2);
+  ASSERT_EQ(pool_.workers.size(), 0);
+  ASSERT_EQ(reply.replies_size(), 3);
+  ASSERT_FALSE(reply.replies(0).canceled());
+  ASSERT_FALSE(reply.replies(1).canceled());
+  ASSERT_TRUE(reply.replies(2).canceled());
+
+  for (auto &entry : leased_workers_) {
+    Task finished_task;
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, BatchedSameShapeScheduledLocallyTest) {
+  /*
+    Test that once a task of a shape is scheduled on the local node, the rest of
+    the tasks of the shape in the same round are scheduled locally too, even though
+    another node could also run them.
+   */
+  auto remote_node_id = NodeID::FromRandom();
+  AddNode(remote_node_id, 8);
+  Task first_task = CreateTask({{ray::kCPU_ResourceLabel, 1}});
+  std::vector<Task> tasks;
+  for (int i = 0; i < 20; i++) {
+    rpc::TaskSpec spec_message = first_task.GetTaskSpecification().GetMessage();
+    if (i > 0) {
+      spec_message.set_task_id(RandomTaskId().Binary());
+    }
+    tasks.emplace_back(TaskSpecification(std::move(spec_message)),
+                       first_task.GetTaskExecutionSpec());
+  }
+
+  for (int i = 0; i < 3; i++) {
+    std::shared_ptr<MockWorker> worker =
+        std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234 + i);
+    pool_.PushWorker(std::static_pointer_cast<WorkerInterface>(worker));
+  }
+
+  rpc::RequestWorkerLeasesReply reply;
+  int num_callbacks = 0;
+  auto callback = [&](Status, std::function<void()>, std::function<void()>) {
+    num_callbacks++;
+  };
+  task_manager_.QueueAndScheduleTasks(tasks, &reply, callback);
+
+  // The tasks that fit on the node wait for workers to start. The others are
+  // canceled.
+  ASSERT_EQ(num_callbacks, 0);
+  ASSERT_EQ(leased_workers_.size(), 3);
+  for (int i = 0; i < 5; i++) {
+    std::shared_ptr<MockWorker> worker =
+        std::make_shared<MockWorker>(WorkerID::FromRandom(), 1240 + i);
+    pool_.PushWorker(std::static_pointer_cast<WorkerInterface>(worker));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+
+  ASSERT_EQ(num_callbacks, 1);
+  ASSERT_EQ(leased_workers_.size(), 8);
+  ASSERT_EQ(reply.replies_size(), 20);
+  for (int i = 0; i < reply.replies_size(); i++) {
+    // No task was spilled back.
+    ASSERT_TRUE(reply.replies(i).retry_at_raylet_address().raylet_id().empty());
+    ASSERT_EQ(reply.replies(i).canceled(), i >= 8);
+  }
+  ASSERT_EQ(node_info_calls_, 0);
+
+  for (auto &entry : leased_workers_) {
+    Task finished_task;
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, GangLeaseTest) {
+  /*
+    Test that a gang is only granted once there is room for all of its tasks, across
+    the local node and a remote node, and that it holds no resources before.
+   */
+  auto tasks = CreateGang({{ray::kCPU_ResourceLabel, 4}}, 3);
+  rpc::RequestWorkerLeasesReply reply;
+  int num_callbacks = 0;
+  auto callback = [&](Status, std::function<void()>, std::function<void()>) {
+    num_callbacks++;
+  };
+  task_manager_.QueueAndScheduleGang(tasks, /*timeout_ms=*/1000, &reply, callback);
+
+  // Only two of the tasks fit on the local node, so none of them is granted.
+  const NodeResources &node_resources = scheduler_->GetLocalNodeResources();
+  ASSERT_EQ(num_callbacks, 0);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  ASSERT_EQ(NumPendingGangs(), 1);
+  ASSERT_EQ(delayed_calls_.size(), 1);
+  ASSERT_EQ(delayed_calls_[0].second, 10);
+
+  // A node joins, but the gang waits for its backoff.
+  auto remote_node_id = NodeID::FromRandom();
+  AddNode(remote_node_id, 4);
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(NumPendingGangs(), 1);
+
+  // Two tasks are allocated on the local node, and the remote node is asked to
+  // reserve the third one. Nothing is granted before it agrees.
+  AdvanceTime(10);
+  ASSERT_EQ(NumPendingGangs(), 1);
+  ASSERT_EQ(NumReservedGangTasks(), 0);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 0);
+  ASSERT_EQ(prepare_requests_.size(), 1);
+  ASSERT_EQ(prepare_requests_[0].node_id, remote_node_id);
+  ASSERT_EQ(prepare_requests_[0].num_leases, 1);
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(prepare_requests_.size(), 1);
+
+  // The remote node agrees, so the local tasks wait for workers and the third one is
+  // spilled back.
+  prepare_requests_[0].callback(true);
+  ASSERT_EQ(NumPendingGangs(), 0);
+  ASSERT_EQ(NumReservedGangTasks(), 2);
+  ASSERT_EQ(node_info_calls_, 1);
+  ASSERT_EQ(num_callbacks, 0);
+
+  // A task that arrives later cannot take the reserved resources.
+  Task other_task = CreateTask({{ray::kCPU_ResourceLabel, 1}});
+  rpc::RequestWorkerLeaseReply other_reply;
+  task_manager_.QueueAndScheduleTask(other_task, &other_reply,
+                                     [](Status, std::function<void()>,
+                                        std::function<void()>) {});
+  for (int i = 0; i < 3; i++) {
+    std::shared_ptr<MockWorker> worker =
+        std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234 + i);
+    pool_.PushWorker(std::static_pointer_cast<WorkerInterface>(worker));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 1);
+  ASSERT_EQ(leased_workers_.size(), 2);
+  int num_spilled = 0;
+  for (int i = 0; i < reply.replies_size(); i++) {
+    ASSERT_FALSE(reply.replies(i).canceled());
+    if (!reply.replies(i).retry_at_raylet_address().raylet_id().empty()) {
+      ASSERT_EQ(reply.replies(i).retry_at_raylet_address().raylet_id(),
+                remote_node_id.Binary());
+      ASSERT_EQ(reply.replies(i).gang_reservation_id(),
+                prepare_requests_[0].reservation_id.Binary());
+      num_spilled++;
+    }
+  }
+  ASSERT_EQ(num_spilled, 1);
+
+  for (auto &entry : leased_workers_) {
+    Task finished_task;
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(leased_workers_.size(), 1);
+  Task finished_task;
+  task_manager_.TaskFinished(leased_workers_.begin()->second, &finished_task);
+  ASSERT_TRUE(canceled_reservations_.empty());
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, GangLeasePrepareFailureTest) {
+  /*
+    Test that a gang releases everything and backs off if one of the remote nodes
+    cannot reserve its leases, and that the reservations of the other nodes are
+    canceled, including those that arrive after the failure.
+   */
+  auto tasks = CreateGang({{ray::kCPU_ResourceLabel, 4}}, 4);
+  auto remote_node_1 = NodeID::FromRandom();
+  auto remote_node_2 = NodeID::FromRandom();
+  AddNode(remote_node_1, 4);
+  AddNode(remote_node_2, 4);
+  rpc::RequestWorkerLeasesReply reply;
+  int num_callbacks = 0;
+  auto callback = [&](Status, std::function<void()>, std::function<void()>) {
+    num_callbacks++;
+  };
+  task_manager_.QueueAndScheduleGang(tasks, /*timeout_ms=*/1000, &reply, callback);
+  ASSERT_EQ(prepare_requests_.size(), 2);
+  const NodeResources &node_resources = scheduler_->GetLocalNodeResources();
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 0);
+
+  // One node agrees and the other does not.
+  prepare_requests_[0].callback(true);
+  ASSERT_TRUE(canceled_reservations_.empty());
+  prepare_requests_[1].callback(false);
+  ASSERT_EQ(canceled_reservations_.size(), 1);
+  ASSERT_EQ(canceled_reservations_[0].first, prepare_requests_[0].node_id);
+  ASSERT_EQ(canceled_reservations_[0].second, prepare_requests_[0].reservation_id);
+  ASSERT_EQ(NumPendingGangs(), 1);
+  ASSERT_EQ(NumReservedGangTasks(), 0);
+  ASSERT_EQ(num_callbacks, 0);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  ASSERT_EQ(delayed_calls_.size(), 1);
+  ASSERT_EQ(delayed_calls_[0].second, 10);
+
+  // The next attempt is canceled while a node prepares its leases. A reservation that
+  // it makes afterwards is released.
+  AdvanceTime(10);
+  ASSERT_EQ(prepare_requests_.size(), 4);
+  ASSERT_TRUE(task_manager_.CancelTask(tasks[0].GetTaskSpecification().TaskId()));
+  ASSERT_EQ(num_callbacks, 1);
+  ASSERT_EQ(canceled_reservations_.size(), 1);
+  prepare_requests_[2].callback(true);
+  prepare_requests_[3].callback(false);
+  ASSERT_EQ(canceled_reservations_.size(), 2);
+  ASSERT_EQ(canceled_reservations_[1].second, prepare_requests_[2].reservation_id);
+  for (int i = 0; i < reply.replies_size(); i++) {
+    ASSERT_TRUE(reply.replies(i).canceled());
+  }
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, GangLeaseReservationTest) {
+  /*
+    Test the node that another raylet spills gang leases back to: it reserves their
+    resources all or nothing, grants the leases that claim the reservation once their
+    arguments are local, and releases reservations that are canceled or expire.
+   */
+  Task resource_task = CreateTask({{ray::kCPU_ResourceLabel, 4}});
+  const auto &resource_spec = resource_task.GetTaskSpecification();
+  const NodeResources &node_resources = scheduler_->GetLocalNodeResources();
+
+  // There is no room for three leases, so none is reserved.
+  auto reservation_id = RandomTaskId();
+  ASSERT_FALSE(task_manager_.PrepareGangLeases(reservation_id, resource_spec, 3));
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+
+  // A canceled reservation releases its resources.
+  ASSERT_TRUE(task_manager_.PrepareGangLeases(reservation_id, resource_spec, 2));
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 0);
+  task_manager_.CancelGangLeases(reservation_id);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  AssertNoLeaks();
+
+  // An expired reservation cannot be claimed.
+  delayed_calls_.clear();
+  ASSERT_TRUE(task_manager_.PrepareGangLeases(reservation_id, resource_spec, 2));
+  ASSERT_EQ(delayed_calls_.size(), 1);
+  AdvanceTime(delayed_calls_[0].second);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  auto tasks = CreateGang({{ray::kCPU_ResourceLabel, 4}}, 2, /*num_args=*/1);
+  rpc::RequestWorkerLeasesReply canceled_reply;
+  int num_callbacks = 0;
+  auto callback = [&](Status, std::function<void()>, std::function<void()>) {
+    num_callbacks++;
+  };
+  task_manager_.QueueAndScheduleReservedGang(reservation_id, tasks, &canceled_reply,
+                                             callback);
+  ASSERT_EQ(num_callbacks, 1);
+  for (int i = 0; i < canceled_reply.replies_size(); i++) {
+    ASSERT_TRUE(canceled_reply.replies(i).canceled());
+  }
+  AssertNoLeaks();
+
+  // The leases keep the reserved resources while their arguments are fetched.
+  reservation_id = RandomTaskId();
+  ASSERT_TRUE(task_manager_.PrepareGangLeases(reservation_id, resource_spec, 2));
+  for (const auto &task : tasks) {
+    missing_objects_.insert(task.GetTaskSpecification().GetDependencyIds()[0]);
+  }
+  for (int i = 0; i < 2; i++) {
+    std::shared_ptr<MockWorker> worker =
+        std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234 + i);
+    pool_.PushWorker(std::static_pointer_cast<WorkerInterface>(worker));
+  }
+  rpc::RequestWorkerLeasesReply reply;
+  task_manager_.QueueAndScheduleReservedGang(reservation_id, tasks, &reply, callback);
+  ASSERT_EQ(NumReservedGangTasks(), 2);
+  ASSERT_EQ(dependency_manager_.subscribed_tasks.size(), 2);
+  ASSERT_EQ(leased_workers_.size(), 0);
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 0);
+
+  // Once the arguments are local, they are pinned and the leases are granted.
+  missing_objects_.clear();
+  task_manager_.TasksUnblocked({tasks[0].GetTaskSpecification().TaskId(),
+                                tasks[1].GetTaskSpecification().TaskId()});
+  ASSERT_EQ(num_callbacks, 2);
+  ASSERT_EQ(leased_workers_.size(), 2);
+  for (const auto &task : tasks) {
+    AssertPinnedTaskArgumentsPresent(task);
+  }
+  for (auto &entry : leased_workers_) {
+    Task finished_task;
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  ASSERT_EQ(node_resources.predefined_resources[PredefinedResources::CPU].available, 8);
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, GangLeaseTimeoutTest) {
+  /*
+    Test that a gang that never fits backs off exponentially and is canceled at its
+    deadline, and that canceling one of its tasks cancels the whole gang.
+   */
+  auto tasks = CreateGang({{ray::kCPU_ResourceLabel, 4}}, 3);
+  rpc::RequestWorkerLeasesReply reply;
+  int num_callbacks = 0;
+  auto callback = [&](Status, std::function<void()>, std::function<void()>) {
+    num_callbacks++;
+  };
+  task_manager_.QueueAndScheduleGang(tasks, /*timeout_ms=*/50, &reply, callback);
+  std::vector<int64_t> delays;
+  while (!delayed_calls_.empty()) {
+    ASSERT_EQ(delayed_calls_.size(), 1);
+    delays.push_back(delayed_calls_[0].second);
+    AdvanceTime(delays.back());
+  }
+  // The last retry is at the deadline.
+  ASSERT_EQ(delays, std::vector<int64_t>({10, 20, 20}));
+  ASSERT_EQ(current_time_ms_, 50);
+  ASSERT_EQ(num_callbacks, 1);
+  for (int i = 0; i < reply.replies_size(); i++) {
+    ASSERT_TRUE(reply.replies(i).canceled());
+  }
+  AssertNoLeaks();
+
+  rpc::RequestWorkerLeasesReply canceled_reply;
+  tasks = CreateGang({{ray::kCPU_ResourceLabel, 4}}, 3);
+  task_manager_.QueueAndScheduleGang(tasks, /*timeout_ms=*/50, &canceled_reply,
+                                     callback);
+  ASSERT_TRUE(task_manager_.CancelTask(tasks[1].GetTaskSpecification().TaskId()));
+  ASSERT_EQ(num_callbacks, 2);
+  for (int i = 0; i < canceled_reply.replies_size(); i++) {
+    ASSERT_TRUE(canceled_reply.replies(i).canceled());
+  }
+  AssertNoLeaks();
+}
+
 TEST_F(ClusterTaskManagerTest, BlockedWorkerDiesTest) {
   /*
    Tests the edge case in which a worker crashes while it's blocked. In this case, its CPU
@@ -1318,6 +1762,291 @@ TEST_F(ClusterTaskManagerTest, LargeArgsNoStarvationTest) {
   AssertNoLeaks();
 }
 
+TEST_F(ClusterTaskManagerTest, PriorityTest) {
+  /*
+    Tasks of higher priorities are dispatched first, within a shape and across shapes.
+   */
+  Task low = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 8}}, 0);
+  Task high = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 8}}, 1);
+  Task highest = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 6}}, 2);
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  task_manager_.QueueAndScheduleTask(low, &reply, callback);
+  task_manager_.QueueAndScheduleTask(high, &reply, callback);
+  task_manager_.QueueAndScheduleTask(highest, &reply, callback);
+  ASSERT_EQ(num_callbacks, 0);
+
+  for (const auto &expected : {highest, high, low}) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+    task_manager_.ScheduleAndDispatchTasks();
+    ASSERT_EQ(leased_workers_.size(), 1);
+    auto worker = leased_workers_.begin()->second;
+    ASSERT_EQ(worker->GetAssignedTask().GetTaskSpecification().TaskId(),
+              expected.GetTaskSpecification().TaskId());
+    Task finished_task;
+    task_manager_.TaskFinished(worker, &finished_task);
+    leased_workers_.clear();
+  }
+  ASSERT_EQ(num_callbacks, 3);
+  ASSERT_TRUE(preempted_workers_.empty());
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, BackfillTest) {
+  /*
+    A task that cannot run reserves the resources it needs, and tasks of lower
+    priorities only run if they leave the reserved resources free.
+   */
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task running = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 6}}, 0);
+  task_manager_.QueueAndScheduleTask(running, &reply, callback);
+  ASSERT_EQ(num_callbacks, 1);
+  auto running_worker = leased_workers_.begin()->second;
+
+  // Only 2 CPUs are left, so the task waits for the 4 CPUs it needs.
+  Task high = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 4}}, 1);
+  task_manager_.QueueAndScheduleTask(high, &reply, callback);
+  ASSERT_EQ(num_callbacks, 1);
+
+  // The GPU task fits beside the reservation, but the CPU task would delay it.
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task low_gpu = CreateTaskWithPriority({{ray::kGPU_ResourceLabel, 1}}, 0);
+  Task low_cpu = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 2}}, 0);
+  task_manager_.QueueAndScheduleTask(low_gpu, &reply, callback);
+  task_manager_.QueueAndScheduleTask(low_cpu, &reply, callback);
+  ASSERT_EQ(num_callbacks, 2);
+  ASSERT_EQ(leased_workers_.size(), 2);
+  ASSERT_EQ(pool_.workers.size(), 1);
+  // The running task cannot be retried, so it is not preempted.
+  ASSERT_TRUE(preempted_workers_.empty());
+
+  // Once the running task finishes, both waiting tasks run.
+  Task finished_task;
+  task_manager_.TaskFinished(running_worker, &finished_task);
+  leased_workers_.erase(running_worker->WorkerId());
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 4);
+  ASSERT_EQ(leased_workers_.size(), 3);
+
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, PreemptionTest) {
+  /*
+    A task that cannot run anywhere preempts a retriable task of a lower priority that
+    holds the resources it needs.
+   */
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task not_retriable = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 4}}, 0);
+  Task retriable =
+      CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 4}}, 0, /*max_retries=*/3);
+  task_manager_.QueueAndScheduleTask(not_retriable, &reply, callback);
+  task_manager_.QueueAndScheduleTask(retriable, &reply, callback);
+  ASSERT_EQ(num_callbacks, 2);
+
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task high = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 2}}, 1);
+  task_manager_.QueueAndScheduleTask(high, &reply, callback);
+  ASSERT_EQ(num_callbacks, 2);
+  ASSERT_EQ(preempted_workers_.size(), 1);
+  auto victim = preempted_workers_[0];
+  ASSERT_EQ(victim->GetAssignedTask().GetTaskSpecification().TaskId(),
+            retriable.GetTaskSpecification().TaskId());
+
+  // Nothing else is preempted while the victim still holds its resources.
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(preempted_workers_.size(), 1);
+
+  // The victim exits and the waiting task runs.
+  Task finished_task;
+  task_manager_.TaskFinished(victim, &finished_task);
+  leased_workers_.erase(victim->WorkerId());
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 3);
+  ASSERT_EQ(preempted_workers_.size(), 1);
+
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, PreemptionShortfallTest) {
+  /*
+    A task of a lower priority is not preempted if its resources would not be enough
+    for the waiting task.
+   */
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task not_retriable = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 6}}, 0);
+  Task retriable =
+      CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 2}}, 0, /*max_retries=*/3);
+  task_manager_.QueueAndScheduleTask(not_retriable, &reply, callback);
+  task_manager_.QueueAndScheduleTask(retriable, &reply, callback);
+  ASSERT_EQ(num_callbacks, 2);
+
+  // The 2 CPUs of the retriable task do not cover the 4 that the waiting task needs.
+  pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  Task high = CreateTaskWithPriority({{ray::kCPU_ResourceLabel, 4}}, 1);
+  task_manager_.QueueAndScheduleTask(high, &reply, callback);
+  ASSERT_EQ(num_callbacks, 2);
+  ASSERT_TRUE(preempted_workers_.empty());
+
+  // Once the other task finishes, the waiting task runs without a preemption.
+  Task finished_task;
+  for (auto it = leased_workers_.begin(); it != leased_workers_.end(); it++) {
+    if (it->second->GetAssignedTask().GetTaskSpecification().TaskId() ==
+        not_retriable.GetTaskSpecification().TaskId()) {
+      task_manager_.TaskFinished(it->second, &finished_task);
+      leased_workers_.erase(it);
+      break;
+    }
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 3);
+  ASSERT_TRUE(preempted_workers_.empty());
+
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, FairShareTest) {
+  /*
+    Jobs that compete for the node get workers in the order of their dominant shares,
+    so a job that queued its tasks first does not take the whole node.
+   */
+  JobID job1 = JobID::FromInt(1);
+  JobID job2 = JobID::FromInt(2);
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  // The first job already holds 2 of the 8 CPUs.
+  for (int i = 0; i < 2; i++) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+    task_manager_.QueueAndScheduleTask(
+        CreateTaskForJob({{ray::kCPU_ResourceLabel, 1}}, job1), &reply, callback);
+  }
+  ASSERT_EQ(num_callbacks, 2);
+
+  // Both jobs queue more tasks than the node can run.
+  for (const auto &job_id : {job1, job2}) {
+    for (int i = 0; i < 6; i++) {
+      task_manager_.QueueAndScheduleTask(
+          CreateTaskForJob({{ray::kCPU_ResourceLabel, 1}}, job_id), &reply, callback);
+    }
+  }
+  ASSERT_EQ(num_callbacks, 2);
+  for (int i = 0; i < 6; i++) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 8);
+
+  // The second job catches up with the first one before they alternate.
+  std::unordered_map<JobID, int> num_leased;
+  for (const auto &entry : leased_workers_) {
+    num_leased[entry.second->GetAssignedTask().GetTaskSpecification().JobId()]++;
+  }
+  ASSERT_EQ(num_leased[job1], 4);
+  ASSERT_EQ(num_leased[job2], 4);
+
+  Task finished_task;
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  // The remaining tasks run once workers are available.
+  for (int i = 0; i < 6; i++) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 14);
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  AssertNoLeaks();
+}
+
+TEST_F(ClusterTaskManagerTest, WeightedFairShareTest) {
+  /*
+    A job with three times the weight of another gets three times the share of the node.
+   */
+  JobID job1 = JobID::FromInt(1);
+  JobID job2 = JobID::FromInt(2);
+  rpc::JobConfig config;
+  config.set_scheduling_weight(3);
+  task_manager_.HandleJobStarted(job2, config);
+  task_manager_.HandleJobStarted(job1, rpc::JobConfig());
+
+  rpc::RequestWorkerLeaseReply reply;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](Status, std::function<void()>,
+                                   std::function<void()>) { num_callbacks++; };
+  for (const auto &job_id : {job1, job2}) {
+    for (int i = 0; i < 8; i++) {
+      task_manager_.QueueAndScheduleTask(
+          CreateTaskForJob({{ray::kCPU_ResourceLabel, 1}}, job_id), &reply, callback);
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 8);
+
+  std::unordered_map<JobID, int> num_leased;
+  for (const auto &entry : leased_workers_) {
+    num_leased[entry.second->GetAssignedTask().GetTaskSpecification().JobId()]++;
+  }
+  ASSERT_EQ(num_leased[job1], 2);
+  ASSERT_EQ(num_leased[job2], 6);
+
+  Task finished_task;
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  for (int i = 0; i < 8; i++) {
+    pool_.PushWorker(std::make_shared<MockWorker>(WorkerID::FromRandom(), 1234));
+  }
+  task_manager_.ScheduleAndDispatchTasks();
+  ASSERT_EQ(num_callbacks, 16);
+  for (auto &entry : leased_workers_) {
+    task_manager_.TaskFinished(entry.second, &finished_task);
+  }
+  leased_workers_.clear();
+  task_manager_.HandleJobFinished(job1);
+  task_manager_.HandleJobFinished(job2);
+  AssertNoLeaks();
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
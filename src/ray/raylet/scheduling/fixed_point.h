@@ -46,5 +46,9 @@ class FixedPoint {
 
   double Double() const;
 
+  /// The value in units of 1 / RESOURCE_UNIT_SCALING. Comparing raw values gives the
+  /// same result as comparing the FixedPoints, in code that the compiler can vectorize.
+  int64_t Raw() const { return i_; }
+
   friend std::ostream &operator<<(std::ostream &out, FixedPoint const &ru1);
 };
@@ -0,0 +1,483 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/raylet/scheduling/scheduler_simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <sstream>
+
+#include "ray/common/task/task_util.h"
+#include "ray/raylet/scheduling/cluster_task_manager.h"
+#include "ray/raylet/test/util.h"
+
+namespace ray {
+namespace raylet {
+
+namespace {
+
+/// Hands out a new worker whenever there is no idle one, as if workers started
+/// instantly.
+class SimulatedWorkerPool : public WorkerPoolInterface {
+ public:
+  std::shared_ptr<WorkerInterface> PopWorker(
+      const TaskSpecification &task_spec) override {
+    if (idle_workers_.empty()) {
+      return std::make_shared<MockWorker>(WorkerID::FromRandom(), next_port_++);
+    }
+    auto worker = idle_workers_.back();
+    idle_workers_.pop_back();
+    return worker;
+  }
+
+  void PushWorker(const std::shared_ptr<WorkerInterface> &worker) override {
+    idle_workers_.push_back(worker);
+  }
+
+ private:
+  std::vector<std::shared_ptr<WorkerInterface>> idle_workers_;
+  int next_port_ = 10000;
+};
+
+/// The owners resolve the dependencies of a task before they request a lease, so the
+/// raylets never wait for arguments.
+class SimulatedDependencyManager : public TaskDependencyManagerInterface {
+ public:
+  bool RequestTaskDependencies(
+      const TaskID &task_id,
+      const std::vector<rpc::ObjectReference> &required_objects) override {
+    return true;
+  }
+
+  void RemoveTaskDependencies(const TaskID &task_id) override {}
+
+  bool TaskDependenciesBlocked(const TaskID &task_id) const override { return false; }
+};
+
+/// Node ids are derived from the node index, so that replays are reproducible.
+NodeID SimulatedNodeId(int64_t index) {
+  std::string binary(NodeID::Size(), '\0');
+  for (size_t i = 0; i < sizeof(index); i++) {
+    binary[i] = static_cast<char>((index >> (8 * i)) & 0xff);
+  }
+  return NodeID::FromBinary(binary);
+}
+
+Status ParseInt(const std::string &field, const std::string &name, int64_t *value) {
+  std::istringstream stream(field);
+  if (!(stream >> *value) || !stream.eof() || *value < 0) {
+    return Status::Invalid("Invalid " + name + " \"" + field + "\"");
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Status ParseSimulatedResources(const std::string &resource_list,
+                               std::unordered_map<std::string, double> *resources) {
+  resources->clear();
+  if (resource_list == "-") {
+    return Status::OK();
+  }
+  std::istringstream resource_string(resource_list);
+  std::string resource_name;
+  std::string resource_quantity;
+  while (std::getline(resource_string, resource_name, ',')) {
+    if (!std::getline(resource_string, resource_quantity, ',')) {
+      return Status::Invalid("No quantity for resource " + resource_name);
+    }
+    std::istringstream quantity_stream(resource_quantity);
+    double quantity;
+    if (!(quantity_stream >> quantity) || !quantity_stream.eof() || quantity < 0) {
+      return Status::Invalid("Invalid quantity \"" + resource_quantity +
+                             "\" for resource " + resource_name);
+    }
+    (*resources)[resource_name] = quantity;
+  }
+  return Status::OK();
+}
+
+Status ParseSchedulerTrace(std::istream &input, std::vector<SimulatedTask> *trace) {
+  trace->clear();
+  std::string line;
+  int64_t line_number = 0;
+  while (std::getline(input, line)) {
+    line_number++;
+    std::istringstream line_stream(line);
+    std::vector<std::string> fields;
+    std::string field;
+    while (line_stream >> field) {
+      fields.push_back(field);
+    }
+    if (fields.empty() || fields[0][0] == '#') {
+      continue;
+    }
+    const std::string location = "line " + std::to_string(line_number) + ": ";
+    if (fields.size() != 7) {
+      return Status::Invalid(location + "Expected 7 fields, got " +
+                             std::to_string(fields.size()));
+    }
+    SimulatedTask task;
+    Status status = ParseInt(fields[0], "id", &task.id);
+    if (status.ok()) {
+      status = ParseInt(fields[1], "submit time", &task.submit_time_ms);
+    }
+    if (status.ok()) {
+      status = ParseInt(fields[2], "node", &task.node);
+    }
+    if (status.ok()) {
+      status = ParseInt(fields[3], "duration", &task.duration_ms);
+    }
+    if (status.ok()) {
+      status = ParseInt(fields[4], "output size", &task.output_bytes);
+    }
+    if (status.ok()) {
+      status = ParseSimulatedResources(fields[5], &task.resources);
+    }
+    if (status.ok() && fields[6] != "-") {
+      std::istringstream dependency_string(fields[6]);
+      std::string dependency;
+      while (status.ok() && std::getline(dependency_string, dependency, ',')) {
+        task.dependencies.emplace_back();
+        status = ParseInt(dependency, "dependency", &task.dependencies.back());
+      }
+    }
+    if (!status.ok()) {
+      return Status::Invalid(location + status.message());
+    }
+    trace->push_back(std::move(task));
+  }
+  return Status::OK();
+}
+
+int64_t SchedulerSimulatorStats::QueueingLatencyPercentile(double percentile) const {
+  if (queueing_latencies_ms.empty()) {
+    return 0;
+  }
+  std::vector<int64_t> latencies = queueing_latencies_ms;
+  const size_t index = std::min(
+      latencies.size() - 1, static_cast<size_t>(percentile / 100 * latencies.size()));
+  std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+  return latencies[index];
+}
+
+std::string SchedulerSimulatorStats::DebugString() const {
+  std::stringstream result;
+  result << "tasks: " << num_tasks << "\n";
+  result << "makespan: " << makespan_ms << " ms\n";
+  result << "queueing latency: p50 " << QueueingLatencyPercentile(50) << " ms, p90 "
+         << QueueingLatencyPercentile(90) << " ms, p99 " << QueueingLatencyPercentile(99)
+         << " ms, max " << QueueingLatencyPercentile(100) << " ms\n";
+  result << "lease requests: " << num_lease_requests << ", spillbacks: "
+         << num_spillbacks << ", infeasible: " << num_infeasible << "\n";
+  result << "bytes transferred: " << bytes_transferred << "\n";
+  result << "scheduler cpu: " << scheduler_cpu_ns / 1000000 << " ms, "
+         << (num_lease_requests == 0 ? 0 : scheduler_cpu_ns / num_lease_requests)
+         << " ns per lease request\n";
+  result << "tasks per node:";
+  for (int64_t num_node_tasks : tasks_per_node) {
+    result << " " << num_node_tasks;
+  }
+  return result.str();
+}
+
+struct SchedulerSimulator::VirtualRaylet {
+  NodeID node_id;
+  std::shared_ptr<ClusterResourceScheduler> scheduler;
+  SimulatedDependencyManager dependency_manager;
+  SimulatedWorkerPool worker_pool;
+  std::unordered_map<WorkerID, std::shared_ptr<WorkerInterface>> leased_workers;
+  std::unique_ptr<ClusterTaskManager> task_manager;
+};
+
+struct SchedulerSimulator::TaskState {
+  const SimulatedTask *trace_task;
+  Task task;
+  /// The indices of the tasks that this task depends on.
+  std::vector<size_t> dependencies;
+  /// The dependencies that have not finished yet.
+  size_t num_pending_dependencies = 0;
+  /// The indices of the tasks that depend on this task.
+  std::vector<size_t> dependents;
+  /// The reply to the current lease request.
+  std::unique_ptr<rpc::RequestWorkerLeaseReply> reply;
+  int64_t submit_time_ms = 0;
+  /// The node that the task ran on, which holds its return object.
+  int64_t node = -1;
+};
+
+SchedulerSimulator::SchedulerSimulator(const SchedulerSimulatorConfig &config)
+    : config_(config) {
+  RAY_CHECK(config_.num_nodes > 0);
+  RAY_CHECK(config_.transfer_bytes_per_ms > 0);
+  stats_.tasks_per_node.resize(config_.num_nodes);
+  for (int64_t i = 0; i < config_.num_nodes; i++) {
+    auto raylet = std::make_unique<VirtualRaylet>();
+    raylet->node_id = SimulatedNodeId(i);
+    node_indices_[raylet->node_id] = i;
+    raylet->scheduler = std::make_shared<ClusterResourceScheduler>(
+        raylet->node_id.Binary(), config_.node_resources);
+    raylet->task_manager = std::make_unique<ClusterTaskManager>(
+        raylet->node_id, raylet->scheduler, raylet->dependency_manager,
+        /*is_owner_alive=*/
+        [](const WorkerID &worker_id, const NodeID &node_id) { return true; },
+        /*get_node_info=*/
+        [this](const NodeID &node_id) -> boost::optional<rpc::GcsNodeInfo> {
+          auto it = node_indices_.find(node_id);
+          if (it == node_indices_.end()) {
+            return boost::none;
+          }
+          rpc::GcsNodeInfo info;
+          info.set_node_id(node_id.Binary());
+          info.set_node_manager_address("node-" + std::to_string(it->second));
+          info.set_node_manager_port(it->second);
+          return info;
+        },
+        /*announce_infeasible_task=*/
+        [this](const Task &task) { stats_.num_infeasible++; }, raylet->worker_pool,
+        raylet->leased_workers,
+        /*get_task_arguments=*/
+        [](const std::vector<ObjectID> &object_ids,
+           std::vector<std::unique_ptr<RayObject>> *results) { return true; },
+        /*max_pinned_task_arguments_bytes=*/std::numeric_limits<size_t>::max(),
+        /*delay_executor=*/
+        [this](std::function<void()> fn, int64_t delay_ms) {
+          Post(now_ms_ + delay_ms, fn);
+        },
+        /*get_time_ms=*/[this] { return now_ms_; });
+    raylets_.push_back(std::move(raylet));
+  }
+  // Every raylet starts out with an up to date view of the whole cluster.
+  for (auto &raylet : raylets_) {
+    for (auto &other : raylets_) {
+      if (other != raylet) {
+        raylet->scheduler->AddOrUpdateNode(other->node_id.Binary(),
+                                           config_.node_resources,
+                                           config_.node_resources);
+      }
+    }
+  }
+}
+
+SchedulerSimulator::~SchedulerSimulator() {}
+
+Status SchedulerSimulator::Run(const std::vector<SimulatedTask> &trace,
+                               SchedulerSimulatorStats *stats) {
+  RAY_CHECK(!ran_) << "A simulator can only replay one trace";
+  ran_ = true;
+
+  absl::flat_hash_map<int64_t, size_t> task_indices;
+  tasks_.resize(trace.size());
+  const JobID job_id = JobID::FromInt(1);
+  const TaskID driver_task_id = TaskID::ForDriverTask(job_id);
+  for (size_t i = 0; i < trace.size(); i++) {
+    const auto &trace_task = trace[i];
+    const std::string location = "task " + std::to_string(trace_task.id) + ": ";
+    if (!task_indices.emplace(trace_task.id, i).second) {
+      return Status::Invalid(location + "Duplicate task id");
+    }
+    if (trace_task.node < 0 || trace_task.node >= config_.num_nodes) {
+      return Status::Invalid(location + "No node " + std::to_string(trace_task.node));
+    }
+    auto &state = tasks_[i];
+    state.trace_task = &trace_task;
+    for (int64_t dependency : trace_task.dependencies) {
+      auto it = task_indices.find(dependency);
+      if (it == task_indices.end()) {
+        return Status::Invalid(location + "Dependency " + std::to_string(dependency) +
+                               " does not come before the task");
+      }
+      tasks_[it->second].dependents.push_back(i);
+      state.dependencies.push_back(it->second);
+      state.num_pending_dependencies++;
+    }
+
+    TaskSpecBuilder spec_builder;
+    rpc::Address owner_address;
+    owner_address.set_raylet_id(raylets_[trace_task.node]->node_id.Binary());
+    spec_builder.SetCommonTaskSpec(
+        TaskID::ForNormalTask(job_id, driver_task_id, i), "simulated_task",
+        Language::PYTHON, FunctionDescriptorBuilder::BuildPython("", "", "", ""), job_id,
+        driver_task_id, i, driver_task_id, owner_address, /*num_returns=*/1,
+        trace_task.resources, {}, std::make_pair(PlacementGroupID::Nil(), -1), true, "");
+    rpc::TaskExecutionSpec execution_spec;
+    state.task = Task(spec_builder.Build(), TaskExecutionSpecification(execution_spec));
+  }
+
+  stats_.num_tasks = trace.size();
+  int64_t first_submit_time_ms = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    first_submit_time_ms = std::min(first_submit_time_ms, trace[i].submit_time_ms);
+    if (tasks_[i].num_pending_dependencies == 0) {
+      Post(trace[i].submit_time_ms, [this, i]() { SubmitTask(i); });
+    }
+  }
+
+  std::function<void()> report_resources = [this, &report_resources]() {
+    const bool changed = ReportResources();
+    // Nothing can happen anymore if no event is pending and the raylets have nothing
+    // new to report.
+    if (num_finished_tasks_ < tasks_.size() && (changed || !events_.empty())) {
+      Post(now_ms_ + config_.resource_report_period_ms, report_resources);
+    }
+  };
+  Post(config_.resource_report_period_ms, report_resources);
+
+  while (num_finished_tasks_ < tasks_.size() && !events_.empty()) {
+    Event event = events_.top();
+    events_.pop();
+    now_ms_ = event.time_ms;
+    event.handler();
+  }
+
+  if (num_finished_tasks_ < tasks_.size()) {
+    return Status::Invalid(std::to_string(tasks_.size() - num_finished_tasks_) +
+                           " tasks can never run, " +
+                           std::to_string(stats_.num_infeasible) +
+                           " times a task was infeasible");
+  }
+  // The last event was the end of the last task.
+  stats_.makespan_ms = tasks_.empty() ? 0 : now_ms_ - first_submit_time_ms;
+  *stats = stats_;
+  return Status::OK();
+}
+
+void SchedulerSimulator::Post(int64_t time_ms, std::function<void()> handler) {
+  events_.push({std::max(time_ms, now_ms_), next_sequence_++, std::move(handler)});
+}
+
+int64_t SchedulerSimulator::Latency(int64_t from_node, int64_t to_node) const {
+  return from_node == to_node ? 0 : config_.network_latency_ms;
+}
+
+void SchedulerSimulator::MeasureScheduler(const std::function<void()> &call) {
+  const auto start = std::chrono::steady_clock::now();
+  call();
+  stats_.scheduler_cpu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+}
+
+void SchedulerSimulator::SubmitTask(size_t task_index) {
+  auto &state = tasks_[task_index];
+  state.submit_time_ms = now_ms_;
+  RequestLease(task_index, state.trace_task->node);
+}
+
+void SchedulerSimulator::RequestLease(size_t task_index, int64_t node) {
+  stats_.num_lease_requests++;
+  auto &state = tasks_[task_index];
+  state.reply = std::make_unique<rpc::RequestWorkerLeaseReply>();
+  const int64_t reply_latency = Latency(node, state.trace_task->node);
+  MeasureScheduler([this, &state, task_index, node, reply_latency]() {
+    raylets_[node]->task_manager->QueueAndScheduleTask(
+        state.task, state.reply.get(),
+        [this, task_index, node, reply_latency](Status status,
+                                                std::function<void()> success,
+                                                std::function<void()> failure) {
+          Post(now_ms_ + reply_latency,
+               [this, task_index, node]() { HandleLeaseReply(task_index, node); });
+        });
+  });
+}
+
+void SchedulerSimulator::HandleLeaseReply(size_t task_index, int64_t node) {
+  auto &state = tasks_[task_index];
+  const auto &reply = *state.reply;
+  const int64_t owner_node = state.trace_task->node;
+  if (!reply.retry_at_raylet_address().raylet_id().empty()) {
+    stats_.num_spillbacks++;
+    const int64_t target = node_indices_.at(
+        NodeID::FromBinary(reply.retry_at_raylet_address().raylet_id()));
+    Post(now_ms_ + Latency(owner_node, target),
+         [this, task_index, target]() { RequestLease(task_index, target); });
+    return;
+  }
+  if (reply.canceled()) {
+    Post(now_ms_ + Latency(owner_node, node),
+         [this, task_index, node]() { RequestLease(task_index, node); });
+    return;
+  }
+
+  // The owner pushes the task to the leased worker, which fetches the arguments that
+  // are on other nodes before it runs the task.
+  const WorkerID worker_id = WorkerID::FromBinary(reply.worker_address().worker_id());
+  const int64_t start_time_ms = now_ms_ + Latency(owner_node, node);
+  int64_t remote_bytes = 0;
+  for (size_t dependency : state.dependencies) {
+    if (tasks_[dependency].node != node) {
+      remote_bytes += tasks_[dependency].trace_task->output_bytes;
+    }
+  }
+  stats_.bytes_transferred += remote_bytes;
+  stats_.queueing_latencies_ms.push_back(start_time_ms - state.submit_time_ms);
+  state.node = node;
+  Post(start_time_ms + remote_bytes / config_.transfer_bytes_per_ms +
+           state.trace_task->duration_ms,
+       [this, task_index, node, worker_id]() {
+         FinishTask(task_index, node, worker_id);
+       });
+}
+
+void SchedulerSimulator::FinishTask(size_t task_index, int64_t node,
+                                    const WorkerID &worker_id) {
+  auto &raylet = *raylets_[node];
+  auto worker = raylet.leased_workers[worker_id];
+  RAY_CHECK(worker != nullptr);
+  raylet.leased_workers.erase(worker_id);
+  MeasureScheduler([&raylet, &worker]() {
+    Task finished_task;
+    raylet.task_manager->TaskFinished(worker, &finished_task);
+    raylet.worker_pool.PushWorker(worker);
+    raylet.task_manager->ScheduleAndDispatchTasks();
+  });
+
+  num_finished_tasks_++;
+  stats_.tasks_per_node[node]++;
+  for (size_t dependent : tasks_[task_index].dependents) {
+    auto &dependent_state = tasks_[dependent];
+    if (--dependent_state.num_pending_dependencies == 0) {
+      Post(dependent_state.trace_task->submit_time_ms,
+           [this, dependent]() { SubmitTask(dependent); });
+    }
+  }
+}
+
+bool SchedulerSimulator::ReportResources() {
+  bool changed = false;
+  for (auto &raylet : raylets_) {
+    rpc::ResourcesData resources_data;
+    raylet->scheduler->FillResourceUsage(resources_data);
+    if (!resources_data.resources_available_changed() &&
+        resources_data.resources_total_size() == 0) {
+      continue;
+    }
+    changed = true;
+    for (auto &other : raylets_) {
+      if (other != raylet) {
+        other->scheduler->UpdateNode(raylet->node_id.Binary(), resources_data);
+      }
+    }
+  }
+  // Reporting also resets each raylet's view of the resources that it reserved on
+  // other nodes for spilled back tasks, so every raylet tries its queues again.
+  for (auto &raylet : raylets_) {
+    MeasureScheduler([&raylet]() { raylet->task_manager->ScheduleAndDispatchTasks(); });
+  }
+  return changed;
+}
+
+}  // namespace raylet
+}  // namespace ray
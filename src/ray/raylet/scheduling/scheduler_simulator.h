@@ -0,0 +1,201 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ray/common/id.h"
+#include "ray/common/status.h"
+#include "ray/common/task/task.h"
+
+namespace ray {
+namespace raylet {
+
+/// A task in a scheduling trace.
+struct SimulatedTask {
+  /// The id of the task in the trace.
+  int64_t id = 0;
+  /// The earliest time at which the owner submits the task. The owner submits it once
+  /// all of its dependencies have finished, like a core worker does.
+  int64_t submit_time_ms = 0;
+  /// The index of the node that the owner runs on. The owner sends the first lease
+  /// request for the task to this node's raylet.
+  int64_t node = 0;
+  /// How long the task runs once its arguments are local.
+  int64_t duration_ms = 0;
+  /// The size of the object that the task returns.
+  int64_t output_bytes = 0;
+  /// The resources that the task requires.
+  std::unordered_map<std::string, double> resources;
+  /// The ids of the tasks whose return objects the task takes as arguments. They must
+  /// come before the task in the trace.
+  std::vector<int64_t> dependencies;
+};
+
+/// Parse a resource list of the form "CPU,4,GPU,1", like the raylet's
+/// --static_resource_list, or "-" for no resources.
+///
+/// \param resource_list: The resource list.
+/// \param[out] resources: The resources in the list.
+/// \return Status::Invalid if the list is malformed.
+Status ParseSimulatedResources(const std::string &resource_list,
+                               std::unordered_map<std::string, double> *resources);
+
+/// Parse a task trace. Each line of the trace describes one task with the fields
+///
+///   <id> <submit_time_ms> <node> <duration_ms> <output_bytes> <resources> <deps>
+///
+/// where <resources> is a resource list such as "CPU,1" and <deps> is a comma
+/// separated list of task ids, or "-" if the task has no dependencies. Empty lines and
+/// lines that start with '#' are skipped.
+///
+/// \param input: The trace.
+/// \param[out] trace: The tasks in the trace, in order.
+/// \return Status::Invalid if a line is malformed.
+Status ParseSchedulerTrace(std::istream &input, std::vector<SimulatedTask> *trace);
+
+/// The cluster that a trace is replayed on.
+struct SchedulerSimulatorConfig {
+  /// The number of nodes in the cluster.
+  int64_t num_nodes = 1;
+  /// The resources of each node.
+  std::unordered_map<std::string, double> node_resources;
+  /// How often each raylet reports its resource usage to the other raylets.
+  int64_t resource_report_period_ms = 100;
+  /// The one way latency of a message between two nodes. Messages within a node take
+  /// no time.
+  int64_t network_latency_ms = 1;
+  /// How fast a task's arguments are fetched from other nodes before it runs.
+  int64_t transfer_bytes_per_ms = 125000;
+};
+
+/// What happened while a trace was replayed.
+struct SchedulerSimulatorStats {
+  int64_t num_tasks = 0;
+  /// The time from the first submission to the end of the last task.
+  int64_t makespan_ms = 0;
+  /// For each task, the time from its submission to the start of its execution.
+  std::vector<int64_t> queueing_latencies_ms;
+  /// The lease requests sent to raylets, including the ones after a spillback.
+  int64_t num_lease_requests = 0;
+  /// The lease requests that a raylet spilled back to another node.
+  int64_t num_spillbacks = 0;
+  /// The number of times a raylet reported a task as infeasible.
+  int64_t num_infeasible = 0;
+  /// The task arguments that had to be fetched from another node.
+  int64_t bytes_transferred = 0;
+  /// The CPU time spent in the raylets' scheduling code, measured with the wall
+  /// clock.
+  int64_t scheduler_cpu_ns = 0;
+  /// The number of tasks that ran on each node.
+  std::vector<int64_t> tasks_per_node;
+
+  /// \param percentile: A percentile between 0 and 100.
+  /// \return The queueing latency of the tasks at the percentile.
+  int64_t QueueingLatencyPercentile(double percentile) const;
+
+  std::string DebugString() const;
+};
+
+/// Replays a task trace against a simulated cluster to evaluate scheduling changes
+/// without a live cluster. Every node runs the real ClusterResourceScheduler and
+/// ClusterTaskManager, and the owners of the tasks follow the lease protocol of the
+/// core worker: they request a lease from the raylet of their node, follow spillback
+/// replies to other raylets, and push the task to the leased worker. Time is
+/// simulated, so a trace of hours replays in seconds.
+///
+/// To keep the model small, workers start instantly, every task gets its own lease,
+/// and the raylets exchange resource usage directly instead of through the GCS.
+class SchedulerSimulator {
+ public:
+  /// Create the raylets of a cluster. The scheduler options in RayConfig, such as
+  /// scheduler_spread_threshold, must be set before.
+  explicit SchedulerSimulator(const SchedulerSimulatorConfig &config);
+
+  ~SchedulerSimulator();
+
+  /// Replay a trace until every task has finished. This may only be called once.
+  ///
+  /// \param trace: The tasks to run.
+  /// \param[out] stats: What happened during the replay.
+  /// \return Status::Invalid if the trace is malformed or some tasks can never run.
+  Status Run(const std::vector<SimulatedTask> &trace, SchedulerSimulatorStats *stats);
+
+ private:
+  struct VirtualRaylet;
+  struct TaskState;
+
+  struct Event {
+    int64_t time_ms;
+    /// Orders the events that happen at the same time by when they were posted.
+    int64_t sequence;
+    std::function<void()> handler;
+
+    bool operator>(const Event &other) const {
+      return time_ms != other.time_ms ? time_ms > other.time_ms
+                                      : sequence > other.sequence;
+    }
+  };
+
+  /// Run a handler once the simulated clock reaches a time.
+  void Post(int64_t time_ms, std::function<void()> handler);
+
+  /// The latency of a message between two nodes.
+  int64_t Latency(int64_t from_node, int64_t to_node) const;
+
+  /// Call into a raylet's scheduling code and account for the time it takes.
+  void MeasureScheduler(const std::function<void()> &call);
+
+  /// The owner submits a task whose dependencies have finished.
+  void SubmitTask(size_t task_index);
+
+  /// The owner requests a lease for a task from a raylet.
+  void RequestLease(size_t task_index, int64_t node);
+
+  /// The owner receives the reply to a lease request.
+  void HandleLeaseReply(size_t task_index, int64_t node);
+
+  /// A task finishes, and the owner returns the worker.
+  void FinishTask(size_t task_index, int64_t node, const WorkerID &worker_id);
+
+  /// Every raylet reports its changed resources to the other raylets.
+  ///
+  /// \return Whether any raylet reported a change.
+  bool ReportResources();
+
+  const SchedulerSimulatorConfig config_;
+  std::vector<std::unique_ptr<VirtualRaylet>> raylets_;
+  absl::flat_hash_map<NodeID, int64_t> node_indices_;
+
+  std::vector<TaskState> tasks_;
+  size_t num_finished_tasks_ = 0;
+
+  int64_t now_ms_ = 0;
+  int64_t next_sequence_ = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+
+  SchedulerSimulatorStats stats_;
+  bool ran_ = false;
+};
+
+}  // namespace raylet
+}  // namespace ray
@@ -0,0 +1,66 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <iostream>
+
+#include "gflags/gflags.h"
+#include "ray/common/ray_config.h"
+#include "ray/raylet/scheduling/scheduler_simulator.h"
+#include "ray/util/logging.h"
+
+DEFINE_string(trace, "", "The task trace to replay, see ParseSchedulerTrace.");
+DEFINE_int64(num_nodes, 1, "The number of nodes in the simulated cluster.");
+DEFINE_string(node_resources, "CPU,8", "The resource list of each node.");
+DEFINE_int64(resource_report_period_ms, -1,
+             "How often raylets report their resources. Defaults to "
+             "raylet_report_resources_period_milliseconds.");
+DEFINE_int64(network_latency_ms, 1, "The latency of a message between two nodes.");
+DEFINE_int64(transfer_bytes_per_ms, 125000,
+             "How fast task arguments are fetched from other nodes.");
+DEFINE_string(config_list, "",
+              "Ray config overrides, for example "
+              "\"scheduler_spread_threshold,0.8;scheduler_hybrid_scheduling,true\".");
+
+int main(int argc, char *argv[]) {
+  InitShutdownRAII ray_log_shutdown_raii(ray::RayLog::StartRayLog,
+                                         ray::RayLog::ShutDownRayLog, argv[0],
+                                         ray::RayLogLevel::WARNING,
+                                         /*log_dir=*/"");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  RayConfig::instance().initialize(FLAGS_config_list);
+
+  ray::raylet::SchedulerSimulatorConfig config;
+  config.num_nodes = FLAGS_num_nodes;
+  RAY_CHECK_OK(
+      ray::raylet::ParseSimulatedResources(FLAGS_node_resources, &config.node_resources));
+  config.resource_report_period_ms =
+      FLAGS_resource_report_period_ms >= 0
+          ? FLAGS_resource_report_period_ms
+          : RayConfig::instance().raylet_report_resources_period_milliseconds();
+  config.network_latency_ms = FLAGS_network_latency_ms;
+  config.transfer_bytes_per_ms = FLAGS_transfer_bytes_per_ms;
+
+  std::ifstream trace_file(FLAGS_trace);
+  RAY_CHECK(trace_file) << "Could not open the trace " << FLAGS_trace;
+  std::vector<ray::raylet::SimulatedTask> trace;
+  RAY_CHECK_OK(ray::raylet::ParseSchedulerTrace(trace_file, &trace));
+  gflags::ShutDownCommandLineFlags();
+
+  ray::raylet::SchedulerSimulator simulator(config);
+  ray::raylet::SchedulerSimulatorStats stats;
+  RAY_CHECK_OK(simulator.Run(trace, &stats));
+  std::cout << stats.DebugString() << std::endl;
+  return 0;
+}
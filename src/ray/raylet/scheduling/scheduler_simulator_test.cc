@@ -0,0 +1,151 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/raylet/scheduling/scheduler_simulator.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+namespace ray {
+namespace raylet {
+
+class SchedulerSimulatorTest : public ::testing::Test {
+ public:
+  /// Parse a trace that is known to be valid.
+  std::vector<SimulatedTask> Trace(const std::string &text) {
+    std::istringstream input(text);
+    std::vector<SimulatedTask> trace;
+    RAY_CHECK_OK(ParseSchedulerTrace(input, &trace));
+    return trace;
+  }
+
+  SchedulerSimulatorConfig Cluster(int64_t num_nodes, const std::string &resources) {
+    SchedulerSimulatorConfig config;
+    config.num_nodes = num_nodes;
+    RAY_CHECK_OK(ParseSimulatedResources(resources, &config.node_resources));
+    return config;
+  }
+};
+
+TEST_F(SchedulerSimulatorTest, TestParseTrace) {
+  auto trace = Trace(
+      "# id submit node duration output resources deps\n"
+      "1 0 0 100 1024 CPU,1 -\n"
+      "\n"
+      "2 5 1 50 0 CPU,0.5,GPU,1 1\n"
+      "3 5 1 50 0 - 1,2\n");
+  ASSERT_EQ(trace.size(), 3);
+  ASSERT_EQ(trace[0].id, 1);
+  ASSERT_EQ(trace[0].duration_ms, 100);
+  ASSERT_EQ(trace[0].output_bytes, 1024);
+  ASSERT_TRUE(trace[0].dependencies.empty());
+  ASSERT_EQ(trace[1].submit_time_ms, 5);
+  ASSERT_EQ(trace[1].node, 1);
+  ASSERT_EQ(trace[1].resources.at("CPU"), 0.5);
+  ASSERT_EQ(trace[1].resources.at("GPU"), 1);
+  ASSERT_TRUE(trace[2].resources.empty());
+  ASSERT_EQ(trace[2].dependencies, std::vector<int64_t>({1, 2}));
+
+  for (const std::string &line :
+       {"1 0 0 100 0 CPU,1", "1 0 0 -100 0 CPU,1 -", "1 0 0 100 0 CPU -",
+        "1 0 0 100 0 CPU,x -", "1 0 0 100 0 CPU,1 2,x"}) {
+    std::istringstream input(line);
+    std::vector<SimulatedTask> malformed;
+    ASSERT_TRUE(ParseSchedulerTrace(input, &malformed).IsInvalid()) << line;
+  }
+}
+
+TEST_F(SchedulerSimulatorTest, TestQueueOnOneNode) {
+  SchedulerSimulator simulator(Cluster(1, "CPU,2"));
+  SchedulerSimulatorStats stats;
+  ASSERT_TRUE(simulator
+                  .Run(Trace("1 0 0 100 0 CPU,1 -\n"
+                             "2 0 0 100 0 CPU,1 -\n"
+                             "3 0 0 100 0 CPU,1 -\n"
+                             "4 0 0 100 0 CPU,1 -\n"),
+                       &stats)
+                  .ok());
+  // Two tasks run at a time.
+  ASSERT_EQ(stats.num_tasks, 4);
+  ASSERT_EQ(stats.makespan_ms, 200);
+  ASSERT_EQ(stats.QueueingLatencyPercentile(0), 0);
+  ASSERT_EQ(stats.QueueingLatencyPercentile(100), 100);
+  ASSERT_EQ(stats.num_lease_requests, 4);
+  ASSERT_EQ(stats.num_spillbacks, 0);
+  ASSERT_EQ(stats.tasks_per_node, std::vector<int64_t>({4}));
+}
+
+TEST_F(SchedulerSimulatorTest, TestDependencies) {
+  SchedulerSimulator simulator(Cluster(1, "CPU,4"));
+  SchedulerSimulatorStats stats;
+  ASSERT_TRUE(simulator
+                  .Run(Trace("1 0 0 10 100 CPU,1 -\n"
+                             "2 0 0 10 100 CPU,1 1\n"
+                             "3 25 0 10 100 CPU,1 2\n"),
+                       &stats)
+                  .ok());
+  // The last task waits for its submit time.
+  ASSERT_EQ(stats.makespan_ms, 35);
+  ASSERT_EQ(stats.QueueingLatencyPercentile(100), 0);
+  ASSERT_EQ(stats.bytes_transferred, 0);
+}
+
+TEST_F(SchedulerSimulatorTest, TestSpillbackAndTransfer) {
+  auto config = Cluster(2, "CPU,1");
+  config.network_latency_ms = 1;
+  config.transfer_bytes_per_ms = 1000;
+  SchedulerSimulator simulator(config);
+  SchedulerSimulatorStats stats;
+  // The second task spills back to the other node, so the last task has to fetch one
+  // of its arguments.
+  ASSERT_TRUE(simulator
+                  .Run(Trace("1 0 0 100 10000 CPU,1 -\n"
+                             "2 0 0 100 10000 CPU,1 -\n"
+                             "3 0 0 100 0 CPU,1 1,2\n"),
+                       &stats)
+                  .ok());
+  ASSERT_EQ(stats.tasks_per_node, std::vector<int64_t>({2, 1}));
+  ASSERT_GE(stats.num_spillbacks, 1);
+  ASSERT_EQ(stats.num_lease_requests, 3 + stats.num_spillbacks);
+  ASSERT_EQ(stats.bytes_transferred, 10000);
+  // The last task starts after the second one, and fetches for 10 ms.
+  ASSERT_GE(stats.makespan_ms, 210);
+  ASSERT_LT(stats.makespan_ms, 300);
+  RAY_LOG(INFO) << stats.DebugString();
+}
+
+TEST_F(SchedulerSimulatorTest, TestInvalidTraces) {
+  SchedulerSimulatorStats stats;
+  // Nothing can run a GPU task.
+  ASSERT_TRUE(SchedulerSimulator(Cluster(2, "CPU,1"))
+                  .Run(Trace("1 0 0 100 0 GPU,1 -\n"), &stats)
+                  .IsInvalid());
+  ASSERT_TRUE(SchedulerSimulator(Cluster(2, "CPU,1"))
+                  .Run(Trace("1 0 2 100 0 CPU,1 -\n"), &stats)
+                  .IsInvalid());
+  ASSERT_TRUE(SchedulerSimulator(Cluster(2, "CPU,1"))
+                  .Run(Trace("1 0 0 100 0 CPU,1 2\n"
+                             "2 0 0 100 0 CPU,1 -\n"),
+                       &stats)
+                  .IsInvalid());
+  ASSERT_TRUE(SchedulerSimulator(Cluster(2, "CPU,1"))
+                  .Run(Trace("1 0 0 100 0 CPU,1 -\n"
+                             "1 0 0 100 0 CPU,1 -\n"),
+                       &stats)
+                  .IsInvalid());
+}
+
+}  // namespace raylet
+}  // namespace ray
@@ -1,9 +1,66 @@
 #include "ray/raylet/scheduling/scheduling_policy.h"
 
+#include <algorithm>
+
 namespace ray {
 
 namespace raylet_scheduling_policy {
 
+namespace {
+
+/// The best node of a traversal so far, by the rules of HybridPolicy.
+class BestNode {
+ public:
+  BestNode(float spread_threshold, bool require_available)
+      : spread_threshold_(spread_threshold), require_available_(require_available) {}
+
+  /// Consider a feasible node.
+  ///
+  /// \param locality_bonus: How much to lower the node's utilization score because it
+  /// holds the task's arguments.
+  void Consider(int64_t node_id, bool is_available, float critical_resource_utilization,
+                float locality_bonus = 0) {
+    if (critical_resource_utilization < spread_threshold_) {
+      critical_resource_utilization = 0;
+    }
+    critical_resource_utilization -= locality_bonus;
+
+    bool update_best_node = false;
+
+    if (is_available) {
+      // Always prioritize available nodes over nodes where the task must be queued first.
+      if (!best_is_available_) {
+        update_best_node = true;
+      } else if (critical_resource_utilization < best_utilization_score_) {
+        // Break ties between available nodes by their critical resource utilization.
+        update_best_node = true;
+      }
+    } else if (!best_is_available_ &&
+               critical_resource_utilization < best_utilization_score_ &&
+               !require_available_) {
+      // Pick the best feasible node by critical resource utilization.
+      update_best_node = true;
+    }
+
+    if (update_best_node) {
+      best_node_id_ = node_id;
+      best_utilization_score_ = critical_resource_utilization;
+      best_is_available_ = is_available;
+    }
+  }
+
+  int64_t NodeId() const { return best_node_id_; }
+
+ private:
+  const float spread_threshold_;
+  const bool require_available_;
+  int64_t best_node_id_ = -1;
+  float best_utilization_score_ = INFINITY;
+  bool best_is_available_ = false;
+};
+
+}  // namespace
+
 int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t local_node_id,
                      const absl::flat_hash_map<int64_t, Node> &nodes,
                      float spread_threshold, bool force_spillback,
@@ -24,9 +81,7 @@ int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t loca
     std::sort(round.begin() + 1, round.end());
   }
 
-  int64_t best_node_id = -1;
-  float best_utilization_score = INFINITY;
-  bool best_is_available = false;
+  BestNode best_node(spread_threshold, require_available);
 
   // Step 2: Perform the round robin.
   auto round_it = round.begin();
@@ -43,39 +98,54 @@ int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t loca
     if (!node.GetLocalView().IsFeasible(resource_request)) {
       continue;
     }
+    best_node.Consider(node_id, node.GetLocalView().IsAvailable(resource_request),
+                       node.GetLocalView().CalculateCriticalResourceUtilization());
+  }
 
-    bool is_available = node.GetLocalView().IsAvailable(resource_request);
-    float critical_resource_utilization =
-        node.GetLocalView().CalculateCriticalResourceUtilization();
-    if (critical_resource_utilization < spread_threshold) {
-      critical_resource_utilization = 0;
-    }
+  return best_node.NodeId();
+}
 
-    bool update_best_node = false;
+int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t local_node_id,
+                     const ClusterResourceView &view, float spread_threshold,
+                     bool force_spillback, bool require_available,
+                     const ArgumentLocality *locality, float locality_weight) {
+  // Check the request against all nodes at once. The view's nodes are already in the
+  // globally consistent traversal order.
+  std::vector<uint8_t> fits;
+  view.Evaluate(resource_request, &fits);
 
-    if (is_available) {
-      // Always prioritize available nodes over nodes where the task must be queued first.
-      if (!best_is_available) {
-        update_best_node = true;
-      } else if (critical_resource_utilization < best_utilization_score) {
-        // Break ties between available nodes by their critical resource utilization.
-        update_best_node = true;
+  if (locality != nullptr && (locality->total_bytes == 0 || locality_weight <= 0)) {
+    locality = nullptr;
+  }
+  BestNode best_node(spread_threshold, require_available);
+  auto consider_node = [&](size_t index) {
+    if (fits[index] & ClusterResourceView::kFeasible) {
+      const int64_t node_id = view.NodeIds()[index];
+      float locality_bonus = 0;
+      if (locality != nullptr) {
+        auto it = locality->node_bytes.find(node_id);
+        if (it != locality->node_bytes.end()) {
+          locality_bonus = locality_weight * it->second / locality->total_bytes;
+        }
       }
-    } else if (!best_is_available &&
-               critical_resource_utilization < best_utilization_score &&
-               !require_available) {
-      // Pick the best feasible node by critical resource utilization.
-      update_best_node = true;
+      best_node.Consider(node_id, fits[index] & ClusterResourceView::kAvailable,
+                         view.CriticalResourceUtilization(index), locality_bonus);
     }
+  };
 
-    if (update_best_node) {
-      best_node_id = node_id;
-      best_utilization_score = critical_resource_utilization;
-      best_is_available = is_available;
+  // The local node comes first, unless we want to spillback.
+  const int64_t local_index = view.Find(local_node_id);
+  if (!force_spillback) {
+    RAY_CHECK(local_index != -1);
+    consider_node(local_index);
+  }
+  for (size_t index = 0; index < fits.size(); index++) {
+    if (static_cast<int64_t>(index) != local_index) {
+      consider_node(index);
     }
   }
 
-  return best_node_id;
+  return best_node.NodeId();
 }
 
 }  // namespace raylet_scheduling_policy
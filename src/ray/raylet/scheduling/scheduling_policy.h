@@ -1,6 +1,9 @@
+#pragma once
+
 #include <vector>
 
 #include "ray/raylet/scheduling/cluster_resource_data.h"
+#include "ray/raylet/scheduling/cluster_resource_view.h"
 
 namespace ray {
 namespace raylet_scheduling_policy {
@@ -21,6 +24,8 @@ namespace raylet_scheduling_policy {
 ///   * Always prefer available nodes over feasible nodes.
 ///   * Break ties in available/feasible by critical resource utilization.
 ///   * Critical resource utilization below a threshold should be truncated to 0.
+///   * Optionally, nodes that hold the task's arguments get a lower utilization score,
+///     in proportion to the bytes they hold.
 ///
 /// The traversal order should:
 ///   * Prioritize the local node above all others.
@@ -42,5 +47,19 @@ int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t loca
                      const absl::flat_hash_map<int64_t, Node> &nodes,
                      float spread_threshold, bool force_spillback,
                      bool require_available);
+
+/// Same as above, but checks the request against a columnar view of the nodes that the
+/// caller keeps up to date, instead of sorting the nodes and checking them one by one.
+///
+/// \param view: All the nodes that can be scheduled on.
+/// \param locality: The bytes of the task's arguments that each node holds, or null to
+/// ignore locality.
+/// \param locality_weight: How much a node that holds all of the arguments has its
+/// critical resource utilization lowered, after the truncation to the spread threshold.
+int64_t HybridPolicy(const ResourceRequest &resource_request, const int64_t local_node_id,
+                     const ClusterResourceView &view, float spread_threshold,
+                     bool force_spillback, bool require_available,
+                     const ArgumentLocality *locality = nullptr,
+                     float locality_weight = 0);
 }  // namespace raylet_scheduling_policy
 }  // namespace ray
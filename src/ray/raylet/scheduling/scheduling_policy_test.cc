@@ -2,6 +2,7 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "ray/util/util.h"
 
 namespace ray {
 
@@ -257,6 +258,142 @@ TEST_F(SchedulingPolicyTest, ForceSpillbackOnlyFeasibleLocallyTest) {
   ASSERT_EQ(to_schedule, -1);
 }
 
+TEST_F(SchedulingPolicyTest, ResourceViewMatchesNodesTest) {
+  // Scheduling on a resource view picks the same nodes as scheduling on the nodes.
+  StringIdMap map;
+  std::vector<ResourceRequest> requests = {
+      ResourceMapToResourceRequest(map, {{"CPU", 1}}),
+      ResourceMapToResourceRequest(map, {{"CPU", 2}, {"GPU", 1}}),
+      ResourceMapToResourceRequest(map, {{"CPU", 0.5}, {"custom", 1}}),
+      ResourceMapToResourceRequest(map, {{"custom", 2}, {"other", 1}}),
+  };
+  const int64_t custom_id = map.Get("custom");
+  const int64_t other_id = map.Get("other");
+  absl::flat_hash_map<int64_t, Node> nodes;
+  for (int i = 0; i < 100; i++) {
+    NodeResources resources =
+        CreateNodeResources(i % 5, 4, i % 3, 2, i % 7 == 0 ? 1 : 0, i % 2);
+    if (i % 4 == 0) {
+      resources.custom_resources[custom_id] = ResourceCapacity(i % 3, 2);
+    }
+    if (i % 8 == 0) {
+      resources.custom_resources[other_id] = ResourceCapacity(1, 1);
+    }
+    nodes.emplace(i * 13 % 100, resources);
+  }
+  ClusterResourceView view(nodes);
+  for (const auto &req : requests) {
+    for (float spread_threshold : {0.0, 0.5, 1.0}) {
+      for (bool force_spillback : {false, true}) {
+        for (bool require_available : {false, true}) {
+          ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, 5, view, spread_threshold,
+                                                           force_spillback,
+                                                           require_available),
+                    raylet_scheduling_policy::HybridPolicy(req, 5, nodes,
+                                                           spread_threshold,
+                                                           force_spillback,
+                                                           require_available));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(SchedulingPolicyTest, LocalityTest) {
+  // The nodes that hold the task's arguments are preferred over the local node when
+  // they are equally available, but not over nodes that are much less utilized.
+  StringIdMap map;
+  ResourceRequest req = ResourceMapToResourceRequest(map, {{"CPU", 1}});
+  int64_t local_node = 0;
+  int64_t data_node = 1;
+  int64_t idle_node = 2;
+
+  absl::flat_hash_map<int64_t, Node> nodes;
+  nodes.emplace(local_node, CreateNodeResources(2, 4, 0, 0, 0, 0));
+  nodes.emplace(data_node, CreateNodeResources(2, 4, 0, 0, 0, 0));
+  ClusterResourceView view(nodes);
+
+  ArgumentLocality locality;
+  locality.node_bytes[data_node] = 100;
+  locality.total_bytes = 100;
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0.5, false,
+                                                   false, &locality, 0.5),
+            data_node);
+  // Locality is off without a weight or without argument bytes.
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0.5, false,
+                                                   false, &locality, 0),
+            local_node);
+  ArgumentLocality no_bytes;
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0.5, false,
+                                                   false, &no_bytes, 0.5),
+            local_node);
+
+  // A node that holds a small part of the arguments gets a small bonus.
+  nodes.emplace(idle_node, CreateNodeResources(4, 4, 0, 0, 0, 0));
+  nodes.erase(local_node);
+  nodes.erase(data_node);
+  nodes.emplace(local_node, CreateNodeResources(1, 4, 0, 0, 0, 0));
+  nodes.emplace(data_node, CreateNodeResources(1, 4, 0, 0, 0, 0));
+  view = ClusterResourceView(nodes);
+  locality.total_bytes = 1000;
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0, false,
+                                                   false, &locality, 0.5),
+            idle_node);
+  // Unless the weight makes up for the utilization.
+  locality.total_bytes = 100;
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0, false,
+                                                   false, &locality, 1),
+            data_node);
+
+  // Nodes that cannot run the task are never picked for locality.
+  nodes.erase(data_node);
+  nodes.emplace(data_node, CreateNodeResources(0, 0, 0, 0, 0, 0));
+  view = ClusterResourceView(nodes);
+  ASSERT_EQ(raylet_scheduling_policy::HybridPolicy(req, local_node, view, 0, false,
+                                                   false, &locality, 1),
+            idle_node);
+}
+
+// Performance benchmark for scheduling decisions on clusters of different sizes, with
+// a columnar resource view that is kept up to date and with the per-node scan.
+TEST_F(SchedulingPolicyTest, HybridPolicyPerf) {
+  StringIdMap map;
+  ResourceRequest req = ResourceMapToResourceRequest(map, {{"CPU", 1}, {"GPU", 1}});
+  for (int num_nodes : {10, 100, 1000, 2000, 5000}) {
+    for (int num_tasks : {1000, 10000}) {
+      absl::flat_hash_map<int64_t, Node> nodes;
+      ClusterResourceView view;
+      for (int i = 0; i < num_nodes; i++) {
+        // Only some of the nodes have GPUs, so that every decision visits all nodes.
+        NodeResources resources = CreateNodeResources(i % 8, 8, 0, 0, i % 4 == 0 ? 1 : 0,
+                                                      i % 2 == 0 ? 1 : 0);
+        // Every node has a resource of its own, like "node:<ip>".
+        resources.custom_resources[i + 1000] = ResourceCapacity(1, 1);
+        nodes.emplace(i, resources);
+        view.AddOrUpdateNode(i, resources);
+      }
+
+      int64_t start_ms = current_time_ms();
+      for (int task = 0; task < num_tasks; task++) {
+        ASSERT_NE(
+            raylet_scheduling_policy::HybridPolicy(req, 0, view, 0.5, false, false), -1);
+      }
+      int64_t view_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+      start_ms = current_time_ms();
+      for (int task = 0; task < num_tasks; task++) {
+        ASSERT_NE(
+            raylet_scheduling_policy::HybridPolicy(req, 0, nodes, 0.5, false, false),
+            -1);
+      }
+      int64_t nodes_ms = std::max<int64_t>(current_time_ms() - start_ms, 1);
+      RAY_LOG(INFO) << num_nodes << " nodes, " << num_tasks << " tasks: "
+                    << num_tasks * 1000 / view_ms
+                    << " decisions/s with the resource view, "
+                    << num_tasks * 1000 / nodes_ms << " decisions/s scanning the nodes";
+    }
+  }
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
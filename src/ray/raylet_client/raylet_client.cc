@@ -314,6 +314,23 @@ void raylet::RayletClient::RequestWorkerLease(
   grpc_client_->RequestWorkerLease(request, callback);
 }
 
+void raylet::RayletClient::RequestWorkerLeases(
+    const TaskSpecification &resource_spec, const std::vector<TaskID> &lease_ids,
+    const rpc::ClientCallback<rpc::RequestWorkerLeasesReply> &callback,
+    const int64_t backlog_size, bool gang, const TaskID &gang_reservation_id) {
+  rpc::RequestWorkerLeasesRequest request;
+  request.mutable_resource_spec()->CopyFrom(resource_spec.GetMessage());
+  request.set_backlog_size(backlog_size);
+  for (const auto &lease_id : lease_ids) {
+    request.add_lease_ids(lease_id.Binary());
+  }
+  request.set_gang(gang);
+  if (!gang_reservation_id.IsNil()) {
+    request.set_gang_reservation_id(gang_reservation_id.Binary());
+  }
+  grpc_client_->RequestWorkerLeases(request, callback);
+}
+
 /// Spill objects to external storage.
 void raylet::RayletClient::RequestObjectSpillage(
     const ObjectID &object_id,
@@ -69,6 +69,23 @@ class WorkerLeaseInterface {
       const ray::rpc::ClientCallback<ray::rpc::RequestWorkerLeaseReply> &callback,
       const int64_t backlog_size = -1) = 0;
 
+  /// Requests several workers of the same shape from the raylet in one round trip.
+  /// The callback will be sent via gRPC once each lease has been granted, spilled
+  /// back or canceled.
+  /// \param resource_spec Resources that should be allocated for each worker.
+  /// \param lease_ids One ID per requested lease. The first ID can be used to cancel
+  /// the request while it is queued at the raylet.
+  /// \param backlog_size The queue length for the given shape on the CoreWorker, not
+  /// counting the requested leases.
+  /// \param gang Whether the leases are granted all or nothing.
+  /// \param gang_reservation_id The reservation that a raylet made for the leases of a
+  /// gang that it spilled back to this raylet, or nil.
+  virtual void RequestWorkerLeases(
+      const ray::TaskSpecification &resource_spec, const std::vector<TaskID> &lease_ids,
+      const ray::rpc::ClientCallback<ray::rpc::RequestWorkerLeasesReply> &callback,
+      const int64_t backlog_size = -1, bool gang = false,
+      const TaskID &gang_reservation_id = TaskID::Nil()) = 0;
+
   /// Returns a worker to the raylet.
   /// \param worker_port The local port of the worker on the raylet node.
   /// \param worker_id The unique worker id of the worker on the raylet node.
@@ -370,6 +387,13 @@ class RayletClient : public RayletClientInterface {
       const ray::rpc::ClientCallback<ray::rpc::RequestWorkerLeaseReply> &callback,
       const int64_t backlog_size) override;
 
+  /// Implements WorkerLeaseInterface.
+  void RequestWorkerLeases(
+      const ray::TaskSpecification &resource_spec, const std::vector<TaskID> &lease_ids,
+      const ray::rpc::ClientCallback<ray::rpc::RequestWorkerLeasesReply> &callback,
+      const int64_t backlog_size, bool gang,
+      const TaskID &gang_reservation_id) override;
+
   /// Implements WorkerLeaseInterface.
   ray::Status ReturnWorker(int worker_port, const WorkerID &worker_id,
                            bool disconnect_worker) override;
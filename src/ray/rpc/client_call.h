@@ -197,6 +197,9 @@ class ClientCallManager {
     }
   }
 
+  /// The main event loop, to which the callback functions are posted.
+  instrumented_io_context &GetMainService() { return main_service_; }
+
   /// Create a new `ClientCall` and send request.
   ///
   /// \tparam GrpcService Type of the gRPC-generated service class.
@@ -49,6 +49,12 @@ class NodeManagerClient {
     GetNodeStats(request, callback);
   }
 
+  /// Reserve resources for the leases of a gang.
+  VOID_RPC_CLIENT_METHOD(NodeManagerService, PrepareGangLeases, grpc_client_, )
+
+  /// Release resources reserved for the leases of a gang.
+  VOID_RPC_CLIENT_METHOD(NodeManagerService, CancelGangLeases, grpc_client_, )
+
  private:
   /// The RPC client.
   std::unique_ptr<GrpcClient<NodeManagerService>> grpc_client_;
@@ -79,6 +85,9 @@ class NodeManagerWorkerClient
   /// Request a worker lease.
   VOID_RPC_CLIENT_METHOD(NodeManagerService, RequestWorkerLease, grpc_client_, )
 
+  /// Request several worker leases of the same shape.
+  VOID_RPC_CLIENT_METHOD(NodeManagerService, RequestWorkerLeases, grpc_client_, )
+
   /// Return a worker lease.
   VOID_RPC_CLIENT_METHOD(NodeManagerService, ReturnWorker, grpc_client_, )
 
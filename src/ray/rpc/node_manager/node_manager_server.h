@@ -28,6 +28,9 @@ namespace rpc {
   RPC_SERVICE_HANDLER(NodeManagerService, UpdateResourceUsage)    \
   RPC_SERVICE_HANDLER(NodeManagerService, RequestResourceReport)  \
   RPC_SERVICE_HANDLER(NodeManagerService, RequestWorkerLease)     \
+  RPC_SERVICE_HANDLER(NodeManagerService, RequestWorkerLeases)    \
+  RPC_SERVICE_HANDLER(NodeManagerService, PrepareGangLeases)      \
+  RPC_SERVICE_HANDLER(NodeManagerService, CancelGangLeases)       \
   RPC_SERVICE_HANDLER(NodeManagerService, ReturnWorker)           \
   RPC_SERVICE_HANDLER(NodeManagerService, ReleaseUnusedWorkers)   \
   RPC_SERVICE_HANDLER(NodeManagerService, CancelWorkerLease)      \
@@ -70,6 +73,18 @@ class NodeManagerServiceHandler {
                                         RequestWorkerLeaseReply *reply,
                                         SendReplyCallback send_reply_callback) = 0;
 
+  virtual void HandleRequestWorkerLeases(const RequestWorkerLeasesRequest &request,
+                                         RequestWorkerLeasesReply *reply,
+                                         SendReplyCallback send_reply_callback) = 0;
+
+  virtual void HandlePrepareGangLeases(const PrepareGangLeasesRequest &request,
+                                       PrepareGangLeasesReply *reply,
+                                       SendReplyCallback send_reply_callback) = 0;
+
+  virtual void HandleCancelGangLeases(const CancelGangLeasesRequest &request,
+                                      CancelGangLeasesReply *reply,
+                                      SendReplyCallback send_reply_callback) = 0;
+
   virtual void HandleReturnWorker(const ReturnWorkerRequest &request,
                                   ReturnWorkerReply *reply,
                                   SendReplyCallback send_reply_callback) = 0;
@@ -22,10 +22,12 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/hash/hash.h"
@@ -54,6 +56,10 @@ const static int64_t RequestSizeInBytes(const PushTaskRequest &request) {
   return size;
 }
 
+/// An actor task request waiting to be sent, and the callback for its reply.
+using PushTaskRequestAndCallback =
+    std::pair<std::unique_ptr<PushTaskRequest>, ClientCallback<PushTaskReply>>;
+
 // Shared between direct actor and task submitters.
 /* class CoreWorkerClientInterface; */
 
@@ -112,6 +118,18 @@ class CoreWorkerClientInterface : public pubsub::SubscriberClientInterface {
   virtual void PushActorTask(std::unique_ptr<PushTaskRequest> request, bool skip_queue,
                              const ClientCallback<PushTaskReply> &callback) {}
 
+  /// Push several actor tasks of the same caller at once. The client may coalesce
+  /// them into fewer RPCs, but each callback still receives its own task's reply.
+  ///
+  /// \param[in] requests The requests in sequence number order, with their callbacks.
+  /// \param[in] max_batch_size The max number of tasks to coalesce into one RPC.
+  virtual void PushActorTasks(std::vector<PushTaskRequestAndCallback> requests,
+                              size_t max_batch_size) {
+    for (auto &request : requests) {
+      PushActorTask(std::move(request.first), /*skip_queue=*/false, request.second);
+    }
+  }
+
   /// Similar to PushActorTask, but sets no ordering constraint. This is used to
   /// push non-actor tasks directly to a worker.
   virtual void PushNormalTask(std::unique_ptr<PushTaskRequest> request,
@@ -286,6 +304,18 @@ class CoreWorkerClient : public std::enable_shared_from_this<CoreWorkerClient>,
     SendRequests();
   }
 
+  void PushActorTasks(std::vector<PushTaskRequestAndCallback> requests,
+                      size_t max_batch_size) override {
+    {
+      absl::MutexLock lock(&mutex_);
+      max_batch_size_ = max_batch_size;
+      for (auto &request : requests) {
+        send_queue_.push_back(std::move(request));
+      }
+    }
+    SendRequests();
+  }
+
   void PushNormalTask(std::unique_ptr<PushTaskRequest> request,
                       const ClientCallback<PushTaskReply> &callback) override {
     request->set_sequence_number(-1);
@@ -308,6 +338,10 @@ class CoreWorkerClient : public std::enable_shared_from_this<CoreWorkerClient>,
     auto this_ptr = this->shared_from_this();
 
     while (!send_queue_.empty() && rpc_bytes_in_flight_ < kMaxBytesInFlight) {
+      if (max_batch_size_ > 1 && send_queue_.size() > 1) {
+        SendBatchedRequests(this_ptr);
+        continue;
+      }
       auto pair = std::move(*send_queue_.begin());
       send_queue_.pop_front();
 
@@ -342,6 +376,65 @@ class CoreWorkerClient : public std::enable_shared_from_this<CoreWorkerClient>,
   }
 
  private:
+  /// Send the requests at the head of the send queue in a single PushTasks RPC, up to
+  /// max_batch_size_ of them and as long as the bytes in flight allow.
+  void SendBatchedRequests(const std::shared_ptr<CoreWorkerClient> &this_ptr)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    PushTasksRequest batch_request;
+    std::vector<ClientCallback<PushTaskReply>> callbacks;
+    int64_t batch_bytes = 0;
+    int64_t max_seq_no = -1;
+    while (!send_queue_.empty() && callbacks.size() < max_batch_size_ &&
+           rpc_bytes_in_flight_ < kMaxBytesInFlight) {
+      auto pair = std::move(*send_queue_.begin());
+      send_queue_.pop_front();
+
+      auto &request = pair.first;
+      int64_t task_size = RequestSizeInBytes(*request);
+      max_seq_no = std::max(max_seq_no, request->sequence_number());
+      request->set_client_processed_up_to(max_finished_seq_no_);
+      rpc_bytes_in_flight_ += task_size;
+      batch_bytes += task_size;
+      batch_request.set_intended_worker_id(request->intended_worker_id());
+      batch_request.add_requests()->Swap(request.get());
+      callbacks.push_back(std::move(pair.second));
+    }
+
+    auto rpc_callback = [this, this_ptr, max_seq_no, batch_bytes,
+                         callbacks = std::move(callbacks)](
+                            Status status, const rpc::PushTasksReply &reply) {
+      {
+        absl::MutexLock lock(&mutex_);
+        if (max_seq_no > max_finished_seq_no_) {
+          max_finished_seq_no_ = max_seq_no;
+        }
+        rpc_bytes_in_flight_ -= batch_bytes;
+        RAY_CHECK(rpc_bytes_in_flight_ >= 0);
+      }
+      SendRequests();
+      if (!status.ok()) {
+        for (const auto &callback : callbacks) {
+          callback(status, rpc::PushTaskReply());
+        }
+        return;
+      }
+      RAY_CHECK(reply.replies_size() == static_cast<int>(callbacks.size()) &&
+                reply.statuses_size() == static_cast<int>(callbacks.size()));
+      for (size_t i = 0; i < callbacks.size(); i++) {
+        // Report a failed task the same way as a failed PushTask RPC.
+        const auto &task_status = reply.statuses(i);
+        callbacks[i](task_status.ok()
+                         ? Status::OK()
+                         : GrpcStatusToRayStatus(grpc::Status(grpc::StatusCode::UNKNOWN,
+                                                              task_status.message())),
+                     reply.replies(i));
+      }
+    };
+
+    RAY_UNUSED(INVOKE_RPC_CALL(CoreWorkerService, PushTasks, batch_request,
+                               std::move(rpc_callback), grpc_client_));
+  }
+
   /// Protects against unsafe concurrent access from the callback thread.
   absl::Mutex mutex_;
 
@@ -352,14 +445,17 @@ class CoreWorkerClient : public std::enable_shared_from_this<CoreWorkerClient>,
   std::unique_ptr<GrpcClient<CoreWorkerService>> grpc_client_;
 
   /// Queue of requests to send.
-  std::deque<std::pair<std::unique_ptr<PushTaskRequest>, ClientCallback<PushTaskReply>>>
-      send_queue_ GUARDED_BY(mutex_);
+  std::deque<PushTaskRequestAndCallback> send_queue_ GUARDED_BY(mutex_);
 
   /// The number of bytes currently in flight.
   int64_t rpc_bytes_in_flight_ GUARDED_BY(mutex_) = 0;
 
   /// The max sequence number we have processed responses for.
   int64_t max_finished_seq_no_ GUARDED_BY(mutex_) = -1;
+
+  /// The max number of queued requests to coalesce into one PushTasks RPC, as last
+  /// passed to PushActorTasks by the submitter.
+  size_t max_batch_size_ GUARDED_BY(mutex_) = 1;
 };
 
 typedef std::function<std::shared_ptr<CoreWorkerClientInterface>(const rpc::Address &)>
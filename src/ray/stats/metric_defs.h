@@ -67,6 +67,12 @@ static Gauge ObjectStoreLocalObjects("object_store_num_local_objects",
                                      "Number of objects currently in the object store.",
                                      "objects");
 
+static Histogram ObjectStoreCreateRequestWaitMs(
+    "object_store_create_request_wait_ms",
+    "Time that requests to create objects waited in the object store's queue because "
+    "the store was full.",
+    "ms", {1, 10, 100, 1000, 10000});
+
 static Gauge ObjectManagerPullRequests("object_manager_num_pull_requests",
                                        "Number of active pull requests for objects.",
                                        "requests");
@@ -134,6 +140,18 @@ static Gauge NumInfeasibleTasks(
     "internal_num_infeasible_tasks",
     "The number of tasks in the scheduler that are in the 'infeasible' state.", "tasks");
 
+static Gauge JobResourceUsage(
+    "job_resource_usage",
+    "The resources that the workers of each job hold on this node. CPU and GPU are "
+    "counted in units of the resource, and memory in bytes.",
+    "units", {JobIdKey, ResourceNameKey});
+
+static Gauge JobDominantShare(
+    "job_dominant_share",
+    "The largest fraction of this node's CPU, GPU or memory that each job holds, divided "
+    "by the scheduling weight of the job.",
+    "ratio", {JobIdKey});
+
 static Gauge SpillingBandwidthMB("object_spilling_bandwidth_mb",
                                  "Bandwidth of object spilling.", "MB");
 
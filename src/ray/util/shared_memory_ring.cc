@@ -0,0 +1,329 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/util/shared_memory_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ray/util/logging.h"
+#include "ray/util/macros.h"
+
+namespace ray {
+
+namespace {
+
+/// Identifies a mapping as a SharedMemoryRing.
+constexpr uint64_t kRingMagic = 0x52415952494e4731;
+
+/// Every message is stored as an 8-byte record header holding its size, followed by
+/// the message padded to 8 bytes.
+constexpr uint64_t kRecordHeaderSize = 8;
+
+/// A record header with this size tells the reader to skip to the start of the data
+/// area, because the next record did not fit before its end.
+constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+constexpr uint64_t RoundUp(uint64_t value, uint64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+uint64_t RecordSize(uint64_t message_size) {
+  return kRecordHeaderSize + RoundUp(message_size, 8);
+}
+
+}  // namespace
+
+/// The state shared by both processes. The read and write positions only ever grow,
+/// and are on separate cache lines so that the producer and consumer do not contend.
+struct SharedMemoryRing::Header {
+  uint64_t magic;
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> write_pos;
+  alignas(64) std::atomic<uint64_t> read_pos;
+  /// Set by the consumer before it sleeps on the eventfd.
+  alignas(64) std::atomic<uint32_t> consumer_sleeping;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_LONG_LOCK_FREE == 2 &&
+                  ATOMIC_INT_LOCK_FREE == 2,
+              "The ring's atomics must be lock free to work across processes.");
+
+uint64_t SharedMemoryRing::HeaderSize() { return RoundUp(sizeof(Header), 64); }
+
+#ifdef __linux__
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Create(size_t capacity) {
+  capacity = RoundUp(std::max<size_t>(capacity, 64), 16);
+  // Create a file in shared memory, and immediately unlink it so that it does not
+  // outlive the processes using it.
+  std::string file_template = "/dev/shm/ray_ringXXXXXX";
+  std::vector<char> file_name(file_template.begin(), file_template.end());
+  file_name.push_back('\0');
+  int memory_fd = mkstemp(&file_name[0]);
+  if (memory_fd < 0) {
+    RAY_LOG(WARNING) << "Failed to create shared memory file " << &file_name[0] << ": "
+                     << std::strerror(errno);
+    return nullptr;
+  }
+  RAY_CHECK(unlink(&file_name[0]) == 0) << "Failed to unlink " << &file_name[0];
+  const size_t mapped_size = HeaderSize() + capacity;
+  if (ftruncate(memory_fd, mapped_size) != 0) {
+    RAY_LOG(WARNING) << "Failed to size shared memory ring: " << std::strerror(errno);
+    close(memory_fd);
+    return nullptr;
+  }
+  void *base =
+      mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  if (base == MAP_FAILED) {
+    RAY_LOG(WARNING) << "Failed to map shared memory ring: " << std::strerror(errno);
+    close(memory_fd);
+    return nullptr;
+  }
+  int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd < 0) {
+    RAY_LOG(WARNING) << "Failed to create eventfd: " << std::strerror(errno);
+    munmap(base, mapped_size);
+    close(memory_fd);
+    return nullptr;
+  }
+
+  auto header = new (base) Header();
+  header->capacity = capacity;
+  header->write_pos = 0;
+  header->read_pos = 0;
+  header->consumer_sleeping = 0;
+  header->magic = kRingMagic;
+  return std::unique_ptr<SharedMemoryRing>(
+      new SharedMemoryRing(memory_fd, event_fd, base, mapped_size));
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Attach(int memory_fd, int event_fd) {
+  struct stat file_stat;
+  if (fstat(memory_fd, &file_stat) != 0 ||
+      static_cast<uint64_t>(file_stat.st_size) <= HeaderSize()) {
+    RAY_LOG(WARNING) << "Invalid shared memory ring fd " << memory_fd;
+    close(memory_fd);
+    close(event_fd);
+    return nullptr;
+  }
+  const size_t mapped_size = file_stat.st_size;
+  void *base =
+      mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  if (base == MAP_FAILED) {
+    RAY_LOG(WARNING) << "Failed to map shared memory ring: " << std::strerror(errno);
+    close(memory_fd);
+    close(event_fd);
+    return nullptr;
+  }
+  auto header = static_cast<Header *>(base);
+  if (header->magic != kRingMagic || HeaderSize() + header->capacity != mapped_size) {
+    RAY_LOG(WARNING) << "Shared memory fd " << memory_fd << " does not hold a ring";
+    munmap(base, mapped_size);
+    close(memory_fd);
+    close(event_fd);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemoryRing>(
+      new SharedMemoryRing(memory_fd, event_fd, base, mapped_size));
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(base_, mapped_size_);
+  close(memory_fd_);
+  close(event_fd_);
+}
+
+#else
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Create(size_t capacity) {
+  return nullptr;
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Attach(int memory_fd, int event_fd) {
+  return nullptr;
+}
+
+SharedMemoryRing::~SharedMemoryRing() {}
+
+#endif
+
+SharedMemoryRing::SharedMemoryRing(int memory_fd, int event_fd, void *base,
+                                   size_t mapped_size)
+    : memory_fd_(memory_fd),
+      event_fd_(event_fd),
+      base_(base),
+      mapped_size_(mapped_size),
+      header_(static_cast<Header *>(base)),
+      data_(static_cast<uint8_t *>(base) + HeaderSize()),
+      capacity_(header_->capacity) {}
+
+size_t SharedMemoryRing::MaxMessageSize() const {
+  // A record may have to skip the end of the data area, so only records of at most
+  // half the capacity are guaranteed to fit into an empty ring.
+  return capacity_ / 2 - kRecordHeaderSize;
+}
+
+bool SharedMemoryRing::TryWrite(const void *data, size_t size) {
+  if (size > MaxMessageSize() || corrupted_) {
+    return false;
+  }
+  const uint64_t record_size = RecordSize(size);
+  // Only this thread moves the write position.
+  uint64_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  const uint64_t read_pos = header_->read_pos.load(std::memory_order_acquire);
+  // Records start at multiples of 8, and the reader is never ahead of the writer.
+  if (write_pos % 8 != 0 || write_pos - read_pos > capacity_) {
+    return SetCorrupted("invalid positions");
+  }
+  const uint64_t offset = write_pos % capacity_;
+  const uint64_t until_end = capacity_ - offset;
+  const bool wrap = record_size > until_end;
+  const uint64_t needed = wrap ? until_end + record_size : record_size;
+  if (capacity_ - (write_pos - read_pos) < needed) {
+    return false;
+  }
+  if (wrap) {
+    std::memcpy(data_ + offset, &kWrapMarker, sizeof(kWrapMarker));
+    write_pos += until_end;
+  }
+  uint8_t *record = data_ + write_pos % capacity_;
+  const uint32_t size32 = size;
+  std::memcpy(record, &size32, sizeof(size32));
+  std::memcpy(record + kRecordHeaderSize, data, size);
+  // Publish the record. This must be ordered before reading consumer_sleeping, which
+  // the consumer sets before checking the write position one last time.
+  header_->write_pos.store(write_pos + record_size, std::memory_order_seq_cst);
+  if (header_->consumer_sleeping.load(std::memory_order_seq_cst)) {
+#ifdef __linux__
+    uint64_t one = 1;
+    RAY_UNUSED(write(event_fd_, &one, sizeof(one)));
+#endif
+  }
+  return true;
+}
+
+bool SharedMemoryRing::TryRead(std::string *message) {
+  if (corrupted_) {
+    return false;
+  }
+  // Only this thread moves the read position.
+  uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  const uint64_t write_pos = header_->write_pos.load(std::memory_order_acquire);
+  if (read_pos == write_pos) {
+    return false;
+  }
+  if (read_pos % 8 != 0 || write_pos - read_pos > capacity_) {
+    return SetCorrupted("invalid positions");
+  }
+  uint64_t offset = read_pos % capacity_;
+  uint32_t size;
+  std::memcpy(&size, data_ + offset, sizeof(size));
+  if (size == kWrapMarker) {
+    // The producer writes the wrapped record before publishing the marker, so it is
+    // always there. A record at the start of the data area never needs a marker.
+    if (offset == 0 || write_pos - read_pos < capacity_ - offset + kRecordHeaderSize) {
+      return SetCorrupted("invalid wrap marker");
+    }
+    read_pos += capacity_ - offset;
+    offset = 0;
+    std::memcpy(&size, data_, sizeof(size));
+  }
+  // A record never extends past the end of the data area or the write position.
+  if (size > MaxMessageSize() || offset + RecordSize(size) > capacity_ ||
+      write_pos - read_pos < RecordSize(size)) {
+    return SetCorrupted("invalid record size");
+  }
+  message->assign(reinterpret_cast<const char *>(data_ + offset + kRecordHeaderSize),
+                  size);
+  header_->read_pos.store(read_pos + RecordSize(size), std::memory_order_release);
+  return true;
+}
+
+bool SharedMemoryRing::SetCorrupted(const char *reason) {
+  if (!corrupted_.exchange(true)) {
+    RAY_LOG(WARNING) << "Corrupted shared memory ring: " << reason;
+  }
+  return false;
+}
+
+bool SharedMemoryRing::Empty() const {
+  return header_->read_pos.load(std::memory_order_relaxed) ==
+         header_->write_pos.load(std::memory_order_seq_cst);
+}
+
+bool SharedMemoryRing::WaitForMessage(int64_t spin_us, int interrupt_fd) {
+  if (!Empty()) {
+    return true;
+  }
+  const auto spin_until =
+      std::chrono::steady_clock::now() + std::chrono::microseconds(spin_us);
+  while (std::chrono::steady_clock::now() < spin_until) {
+    if (!Empty()) {
+      return true;
+    }
+  }
+#ifdef __linux__
+  while (true) {
+    if (!PrepareToWait()) {
+      FinishWait();
+      return true;
+    }
+    struct pollfd fds[2] = {{event_fd_, POLLIN, 0}, {interrupt_fd, POLLIN, 0}};
+    int num_ready = poll(fds, interrupt_fd >= 0 ? 2 : 1, -1);
+    FinishWait();
+    if (num_ready < 0 && errno != EINTR) {
+      RAY_LOG(WARNING) << "Failed to wait on shared memory ring: "
+                       << std::strerror(errno);
+      return false;
+    }
+    if (interrupt_fd >= 0 && fds[1].revents != 0) {
+      return false;
+    }
+    if (!Empty()) {
+      return true;
+    }
+  }
+#else
+  return false;
+#endif
+}
+
+bool SharedMemoryRing::PrepareToWait() {
+  header_->consumer_sleeping.store(1, std::memory_order_seq_cst);
+  return Empty();
+}
+
+void SharedMemoryRing::FinishWait() {
+  header_->consumer_sleeping.store(0, std::memory_order_relaxed);
+#ifdef __linux__
+  // The eventfd is non-blocking, so this does nothing if there was no wakeup.
+  uint64_t count;
+  RAY_UNUSED(read(event_fd_, &count, sizeof(count)));
+#endif
+}
+
+}  // namespace ray
@@ -0,0 +1,130 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ray {
+
+/// A single-producer, single-consumer queue of messages in shared memory. It passes
+/// messages between two processes on the same node without a syscall per message.
+///
+/// The ring lives in a file that the creating process passes to its peer as a file
+/// descriptor, e.g. over a Unix socket, together with an eventfd used to wake the
+/// consumer. The producer only signals the eventfd when the consumer is about to
+/// sleep, so a busy consumer is never woken through the kernel.
+///
+/// At most one thread at a time may write, and at most one thread at a time may read.
+/// Only supported on Linux; Create returns nullptr elsewhere.
+///
+/// The peer can write anything into the shared memory, so the ring checks the
+/// positions and record sizes that it reads from there. Once they are inconsistent,
+/// the ring is corrupted and no longer reads or writes messages.
+class SharedMemoryRing {
+ public:
+  /// Create a new ring.
+  ///
+  /// \param capacity The number of bytes available for messages.
+  /// \return The ring, or nullptr if shared memory could not be set up.
+  static std::unique_ptr<SharedMemoryRing> Create(size_t capacity);
+
+  /// Map a ring that another process created. Takes ownership of both fds.
+  ///
+  /// \param memory_fd The fd of the ring's shared memory, see MemoryFd.
+  /// \param event_fd The ring's eventfd, see EventFd.
+  /// \return The ring, or nullptr if the fds do not describe a valid ring.
+  static std::unique_ptr<SharedMemoryRing> Attach(int memory_fd, int event_fd);
+
+  ~SharedMemoryRing();
+
+  int MemoryFd() const { return memory_fd_; }
+
+  int EventFd() const { return event_fd_; }
+
+  /// The largest message that TryWrite accepts.
+  size_t MaxMessageSize() const;
+
+  /// Append a message to the ring.
+  ///
+  /// \return False if the message is larger than MaxMessageSize, if the ring does
+  /// not have room for it until the consumer catches up, or if the ring is corrupted.
+  bool TryWrite(const void *data, size_t size);
+
+  /// Pop the oldest message in the ring.
+  ///
+  /// \param[out] message The popped message.
+  /// \return False if the ring is empty or corrupted.
+  bool TryRead(std::string *message);
+
+  /// Whether the ring holds positions or records that a well-behaved peer could not
+  /// have written. Check this when TryRead or TryWrite fails.
+  bool Corrupted() const { return corrupted_; }
+
+  /// Wait until the ring has a message to read. This busy-polls for up to spin_us
+  /// microseconds, then sleeps until the producer signals the eventfd.
+  ///
+  /// \param spin_us How long to busy-poll before sleeping.
+  /// \param interrupt_fd If not -1, stop waiting when this fd becomes readable or is
+  /// closed by its peer, e.g. a socket to the producing process.
+  /// \return True if there is a message to read, false if interrupted.
+  bool WaitForMessage(int64_t spin_us, int interrupt_fd = -1);
+
+  /// Tell the producer that the consumer is about to wait for EventFd to become
+  /// readable, e.g. from an event loop. The consumer must call FinishWait once it
+  /// wakes up.
+  ///
+  /// \return False if a message arrived in the meantime. The consumer should read it
+  /// instead of waiting, and must still call FinishWait.
+  bool PrepareToWait();
+
+  /// Undo PrepareToWait, and consume any pending wakeup of EventFd.
+  void FinishWait();
+
+ private:
+  struct Header;
+
+  SharedMemoryRing(int memory_fd, int event_fd, void *base, size_t mapped_size);
+
+  /// The size of the header at the start of the mapping, rounded up to a cache line.
+  static uint64_t HeaderSize();
+
+  bool Empty() const;
+
+  /// Mark the ring as corrupted.
+  ///
+  /// \return False, for the caller to return.
+  bool SetCorrupted(const char *reason);
+
+  /// The fd of the shared memory file.
+  const int memory_fd_;
+  /// The eventfd used to wake a sleeping consumer.
+  const int event_fd_;
+  /// The mapping of the whole shared memory file.
+  void *const base_;
+  const size_t mapped_size_;
+  /// The shared read and write positions, at the start of the mapping.
+  Header *const header_;
+  /// The message data, after the header.
+  uint8_t *const data_;
+  const uint64_t capacity_;
+  /// Whether the ring was found to be corrupted, see Corrupted.
+  std::atomic<bool> corrupted_{false};
+};
+
+}  // namespace ray
@@ -0,0 +1,180 @@
+// Copyright 2017 The Ray Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ray/util/shared_memory_ring.h"
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace ray {
+
+// Map the same ring a second time, as the peer process would.
+std::unique_ptr<SharedMemoryRing> AttachPeer(const SharedMemoryRing &ring) {
+  return SharedMemoryRing::Attach(dup(ring.MemoryFd()), dup(ring.EventFd()));
+}
+
+TEST(SharedMemoryRingTest, TestReadWrite) {
+  auto ring = SharedMemoryRing::Create(1024);
+  ASSERT_NE(ring, nullptr);
+  auto peer = AttachPeer(*ring);
+  ASSERT_NE(peer, nullptr);
+
+  std::string message;
+  ASSERT_FALSE(peer->TryRead(&message));
+  ASSERT_TRUE(ring->TryWrite("hello", 5));
+  ASSERT_TRUE(ring->TryWrite("", 0));
+  ASSERT_TRUE(ring->TryWrite("world!", 6));
+  ASSERT_TRUE(peer->TryRead(&message));
+  ASSERT_EQ(message, "hello");
+  ASSERT_TRUE(peer->TryRead(&message));
+  ASSERT_EQ(message, "");
+  ASSERT_TRUE(peer->TryRead(&message));
+  ASSERT_EQ(message, "world!");
+  ASSERT_FALSE(peer->TryRead(&message));
+}
+
+TEST(SharedMemoryRingTest, TestFullAndWrapAround) {
+  auto ring = SharedMemoryRing::Create(1024);
+  ASSERT_NE(ring, nullptr);
+  ASSERT_FALSE(ring->TryWrite(std::string(2048, 'x').data(), 2048));
+
+  // Messages of varying sizes so that records straddle the end of the ring.
+  std::string message;
+  int next_write = 0;
+  int next_read = 0;
+  for (int round = 0; round < 1000; round++) {
+    while (true) {
+      std::string value(next_write % 300, 'a' + next_write % 26);
+      if (!ring->TryWrite(value.data(), value.size())) {
+        break;
+      }
+      next_write++;
+    }
+    // The ring is full, so at least one message must be readable.
+    ASSERT_TRUE(ring->TryRead(&message));
+    ASSERT_EQ(message, std::string(next_read % 300, 'a' + next_read % 26));
+    next_read++;
+  }
+  while (ring->TryRead(&message)) {
+    ASSERT_EQ(message, std::string(next_read % 300, 'a' + next_read % 26));
+    next_read++;
+  }
+  ASSERT_EQ(next_read, next_write);
+}
+
+TEST(SharedMemoryRingTest, TestCorruptedRecord) {
+  const size_t capacity = 1024;
+  auto ring = SharedMemoryRing::Create(capacity);
+  ASSERT_NE(ring, nullptr);
+  auto peer = AttachPeer(*ring);
+  ASSERT_NE(peer, nullptr);
+  ASSERT_TRUE(ring->TryWrite("hello", 5));
+
+  // Overwrite the size of the record, as a misbehaving peer could. The data area is
+  // at the end of the mapping.
+  struct stat file_stat;
+  ASSERT_EQ(fstat(ring->MemoryFd(), &file_stat), 0);
+  void *base = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    ring->MemoryFd(), 0);
+  ASSERT_NE(base, MAP_FAILED);
+  const uint32_t size = 4 * capacity;
+  std::memcpy(static_cast<uint8_t *>(base) + file_stat.st_size - capacity, &size,
+              sizeof(size));
+  munmap(base, file_stat.st_size);
+
+  // The reader stops instead of reading past the ring.
+  std::string message;
+  ASSERT_FALSE(peer->Corrupted());
+  ASSERT_FALSE(peer->TryRead(&message));
+  ASSERT_TRUE(peer->Corrupted());
+  ASSERT_FALSE(peer->TryRead(&message));
+}
+
+TEST(SharedMemoryRingTest, TestProducerConsumer) {
+  auto ring = SharedMemoryRing::Create(4096);
+  ASSERT_NE(ring, nullptr);
+  auto peer = AttachPeer(*ring);
+  ASSERT_NE(peer, nullptr);
+
+  const int num_messages = 100000;
+  std::thread producer([&ring]() {
+    for (int i = 0; i < num_messages; i++) {
+      std::string value = std::to_string(i);
+      while (!ring->TryWrite(value.data(), value.size())) {
+        std::this_thread::yield();
+      }
+      if (i % 1000 == 0) {
+        // Let the consumer fall asleep now and then.
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  });
+
+  std::string message;
+  for (int i = 0; i < num_messages; i++) {
+    ASSERT_TRUE(peer->WaitForMessage(/*spin_us=*/10));
+    ASSERT_TRUE(peer->TryRead(&message));
+    ASSERT_EQ(message, std::to_string(i));
+  }
+  producer.join();
+}
+
+TEST(SharedMemoryRingTest, TestPrepareToWait) {
+  auto ring = SharedMemoryRing::Create(1024);
+  ASSERT_NE(ring, nullptr);
+  auto peer = AttachPeer(*ring);
+  ASSERT_NE(peer, nullptr);
+  struct pollfd event = {peer->EventFd(), POLLIN, 0};
+
+  // The producer does not signal a consumer that is not waiting.
+  ASSERT_TRUE(ring->TryWrite("a", 1));
+  ASSERT_EQ(poll(&event, 1, 0), 0);
+  ASSERT_FALSE(peer->PrepareToWait());
+  peer->FinishWait();
+
+  std::string message;
+  ASSERT_TRUE(peer->TryRead(&message));
+  ASSERT_TRUE(peer->PrepareToWait());
+  ASSERT_TRUE(ring->TryWrite("b", 1));
+  ASSERT_EQ(poll(&event, 1, 0), 1);
+  peer->FinishWait();
+  ASSERT_EQ(poll(&event, 1, 0), 0);
+  ASSERT_TRUE(peer->TryRead(&message));
+  ASSERT_EQ(message, "b");
+}
+
+TEST(SharedMemoryRingTest, TestWaitInterrupted) {
+  auto ring = SharedMemoryRing::Create(1024);
+  ASSERT_NE(ring, nullptr);
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::thread closer([&fds]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    close(fds[1]);
+  });
+  // The peer going away wakes up the consumer.
+  ASSERT_FALSE(ring->WaitForMessage(/*spin_us=*/0, fds[0]));
+  closer.join();
+  close(fds[0]);
+}
+
+}  // namespace ray
@@ -78,6 +78,15 @@ inline int64_t current_time_ms() {
   return ms_since_epoch.count();
 }
 
+/// Return the number of microseconds since the steady clock epoch. Like
+/// current_time_ms(), this is only meaningful for measuring intervals.
+inline int64_t current_time_us() {
+  std::chrono::microseconds us_since_epoch =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch());
+  return us_since_epoch.count();
+}
+
 inline int64_t current_sys_time_ms() {
   std::chrono::milliseconds ms_since_epoch =
       std::chrono::duration_cast<std::chrono::milliseconds>(